@@ -0,0 +1,248 @@
+/// @file coro_bench.cpp
+/// @brief 协程切换开销：spawn + 结束、yield + resume 往返，对照 ucontext；独立栈与共享栈挂起大量协程的内存
+/// @note 用法: coro_bench [iter_num] [pending_num]
+///       ucontext 的 swapcontext 每次切换都有一次 sigprocmask 系统调用
+///       spawn 用 40 字节的捕获（与 TimeoutDecorator / PBService 的闭包相当），另给出先包成 std::function 的对照；
+///       alloc/op 为计时区间内全局 operator new 次数除以操作数（替换全局 operator new 计数）
+///       挂起测试中每个协程先调用一次用 16KB 栈的函数（类似解码），再带着约 2KB 的栈挂起（类似等 RPC 回包），
+///       统计 RSS 增量：独立栈挂起期间保留触及过的所有页，共享栈只保存挂起时实际用到的部分
+#include <ucontext.h>
+#include <unistd.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+#include "core/stackful_coroutine.h"
+
+namespace
+{
+
+uint64_t g_alloc_num = 0;
+
+}  // namespace
+
+void* operator new(size_t size)
+{
+    ++g_alloc_num;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+
+template <typename Func>
+double NsPerOp(uint64_t iter_num, Func&& func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) /
+           static_cast<double>(iter_num);
+}
+
+struct OpCost
+{
+    double ns = 0;
+    double alloc = 0;
+};
+
+template <typename Func>
+OpCost Measure(uint64_t iter_num, Func&& func)
+{
+    uint64_t alloc_begin = g_alloc_num;
+    OpCost cost;
+    cost.ns = NsPerOp(iter_num, std::forward<Func>(func));
+    cost.alloc = static_cast<double>(g_alloc_num - alloc_begin) / static_cast<double>(iter_num);
+    return cost;
+}
+
+void PrintCost(const char* name, const OpCost& cost)
+{
+    printf("%-32s %10.1f %10.3f\n", name, cost.ns, cost.alloc);
+}
+
+/// 模拟请求处理闭包的捕获：服务指针、上下文、方法描述、gid 等共 40 字节
+struct FakeRequest
+{
+    uint64_t* counter = nullptr;
+    void* context = nullptr;
+    const void* service = nullptr;
+    const void* method = nullptr;
+    uint64_t gid = 0;
+};
+static_assert(sizeof(FakeRequest) == 40);
+
+ucontext_t g_main_ctx;
+ucontext_t g_coro_ctx;
+volatile bool g_coro_quit = false;
+
+void UcontextLoop()
+{
+    while (!g_coro_quit)
+        swapcontext(&g_coro_ctx, &g_main_ctx);
+}
+
+/// 模拟解码等临时用栈较深的调用
+__attribute__((noinline)) void DeepCall()
+{
+    char buf[16 * 1024];
+    for (size_t i = 0; i < sizeof(buf); i += 512)
+        buf[i] = static_cast<char>(i);
+    asm volatile("" : : "r"(buf) : "memory");
+}
+
+size_t RssKB()
+{
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(file);
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+}
+
+/// 挂起 pending_num 个协程后全部恢复，输出内存和恢复耗时
+void BenchPending(const char* name, const ua::StackfulCoroutine::Option& option, uint32_t pending_num)
+{
+    ua::StackfulCoroutine coroutine(option);
+    std::vector<ua::Coro*> coros;
+    coros.reserve(pending_num);
+    size_t rss_before = RssKB();
+    for (uint32_t i = 0; i < pending_num; ++i)
+    {
+        bool ok = coroutine.Spawn([&coroutine, &coros]() {
+            char buf[2048];
+            for (size_t j = 0; j < sizeof(buf); j += 64)
+                buf[j] = static_cast<char>(j);
+            asm volatile("" : : "r"(buf) : "memory");
+            DeepCall();
+            coros.push_back(coroutine.ThisCoro());
+            coroutine.ThisCoro()->Yield();
+            asm volatile("" : : "r"(buf) : "memory");
+        });
+        if (!ok)
+        {
+            printf("%-10s spawn failed at %u\n", name, i);
+            break;
+        }
+    }
+    size_t rss_delta = RssKB() - rss_before;
+    size_t pending = coros.size();
+    double resume_ns = NsPerOp(pending > 0 ? pending : 1, [&]() {
+        for (ua::Coro* coro : coros)
+            coro->Resume();
+    });
+    printf("%-10s %10zu %14zu %12zu %12zu %10.1f\n", name, pending, coroutine.StackPool().MappedBytes() / 1024,
+           coroutine.SavedStackCapacity() / 1024, rss_delta, resume_ns);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    uint64_t iter_num = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    uint32_t pending_num = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 20000;
+    printf("iter_num:%" PRIu64 "\n", iter_num);
+    printf("%-32s %10s %10s\n", "case", "ns/op", "alloc/op");
+
+    ua::StackfulCoroutine coroutine;
+    uint64_t counter = 0;
+
+    PrintCost("spawn+finish", Measure(iter_num, [&]() {
+        for (uint64_t i = 0; i < iter_num; ++i)
+            coroutine.Spawn([&counter]() { ++counter; });
+    }));
+
+    FakeRequest request{&counter, &coroutine, &g_alloc_num, &iter_num, 0};
+    PrintCost("spawn+finish 40B capture", Measure(iter_num, [&]() {
+        for (uint64_t i = 0; i < iter_num; ++i)
+        {
+            request.gid = i;
+            coroutine.Spawn([request]() { *request.counter += request.gid & 1; });
+        }
+    }));
+
+    PrintCost("spawn+finish 40B std::function", Measure(iter_num, [&]() {
+        for (uint64_t i = 0; i < iter_num; ++i)
+        {
+            request.gid = i;
+            coroutine.Spawn(std::function<void()>([request]() { *request.counter += request.gid & 1; }));
+        }
+    }));
+
+    PrintCost("spawn+yield+resume+finish", Measure(iter_num, [&]() {
+        ua::Coro* coro = nullptr;
+        for (uint64_t i = 0; i < iter_num; ++i)
+        {
+            coroutine.Spawn([&]() {
+                coro = coroutine.ThisCoro();
+                coro->Yield();
+                ++counter;
+            });
+            coro->Resume();
+        }
+    }));
+
+    ua::Coro* loop_coro = nullptr;
+    bool quit = false;
+    coroutine.Spawn([&]() {
+        loop_coro = coroutine.ThisCoro();
+        while (!quit)
+            loop_coro->Yield();
+    });
+    OpCost round_trip = Measure(iter_num, [&]() {
+        for (uint64_t i = 0; i < iter_num; ++i)
+            loop_coro->Resume();
+    });
+    quit = true;
+    loop_coro->Resume();
+    PrintCost("yield+resume round trip", round_trip);
+
+    std::vector<char> stack(128 * 1024);
+    getcontext(&g_coro_ctx);
+    g_coro_ctx.uc_stack.ss_sp = stack.data();
+    g_coro_ctx.uc_stack.ss_size = stack.size();
+    g_coro_ctx.uc_link = &g_main_ctx;
+    makecontext(&g_coro_ctx, UcontextLoop, 0);
+    OpCost ucontext = Measure(iter_num, [&]() {
+        for (uint64_t i = 0; i < iter_num; ++i)
+            swapcontext(&g_main_ctx, &g_coro_ctx);
+    });
+    g_coro_quit = true;
+    swapcontext(&g_main_ctx, &g_coro_ctx);
+    PrintCost("ucontext round trip", ucontext);
+
+    printf("total coro:%zu, stack mapped:%zu KB, counter:%" PRIu64 "\n", coroutine.GetTotalCoro(),
+           coroutine.StackPool().MappedBytes() / 1024, counter);
+
+    printf("\npending_num:%u, stack 128KB, shared: 4 x 1MB\n", pending_num);
+    printf("%-10s %10s %14s %12s %12s %10s\n", "mode", "pending", "mapped(KB)", "saved(KB)", "rss(KB)",
+           "resume ns");
+    ua::StackfulCoroutine::Option private_option;
+    BenchPending("private", private_option, pending_num);
+    ua::StackfulCoroutine::Option shared_option;
+    shared_option.mode = ua::CoroStackMode::kShared;
+    shared_option.stack_size = 1024 * 1024;
+    shared_option.shared_stack_num = 4;
+    BenchPending("shared", shared_option, pending_num);
+    return 0;
+}
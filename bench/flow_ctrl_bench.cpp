@@ -0,0 +1,184 @@
+/// @file flow_ctrl_bench.cpp
+/// @brief 流控模式对比：离散模拟突发负载下各模式的排队时延分布
+/// @note 用法: flow_ctrl_bench [seconds] [seed]
+///       模拟 ServerCore 的帧循环：每帧先跑逻辑（偶发重帧），再按预算收包，每个包固定处理耗时
+///       到达为开关式突发：ON 段超出处理能力，OFF 段低负载，平均负载低于处理能力
+///       被提前丢弃的包只计解包开销；输出各模式的排队时延分位和丢弃数
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+#include "core/flow_controller.h"
+
+using ua::FlowControlOption;
+using ua::FlowController;
+using ua::FlowMode;
+
+namespace
+{
+
+struct SimOption
+{
+    uint64_t duration_us = 20 * 1000 * 1000;
+    uint64_t seed = 1;
+    uint64_t max_proc_us = 10000;      // 单帧时间上限，对应 frame.max_proc_ms
+    uint64_t logic_us = 2000;          // 普通帧逻辑耗时
+    uint64_t heavy_logic_us = 12000;   // 重帧逻辑耗时
+    double heavy_ratio = 0.03;         // 重帧比例
+    uint64_t min_frame_us = 1000;      // 空闲时一帧至少这么长
+    uint64_t svc_us = 50;              // 每个包的处理耗时
+    uint64_t shed_us = 5;              // 丢弃一个包的开销
+    uint64_t on_us = 200000;           // 突发段长度
+    uint64_t off_us = 300000;          // 低负载段长度
+    double on_rate = 0.025;            // 突发段到达率（包/us）
+    double off_rate = 0.004;           // 低负载段到达率（包/us）
+    double rsp_ratio = 0.1;            // 回包比例，回包不可丢
+};
+
+struct Pkg
+{
+    uint64_t arrived_us;
+    bool droppable;
+};
+
+struct SimResult
+{
+    std::vector<uint64_t> sojourn_us;
+    uint64_t shed_num = 0;
+    uint64_t left_num = 0;
+    uint64_t frame_num = 0;
+    uint64_t overrun_num = 0;
+};
+
+std::vector<Pkg> GenArrivals(const SimOption& sim)
+{
+    std::mt19937_64 rng(sim.seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    std::vector<Pkg> pkgs;
+    double now = 0;
+    while (now < sim.duration_us)
+    {
+        uint64_t period = sim.on_us + sim.off_us;
+        bool on = static_cast<uint64_t>(now) % period < sim.on_us;
+        std::exponential_distribution<double> gap(on ? sim.on_rate : sim.off_rate);
+        now += gap(rng);
+        pkgs.push_back({static_cast<uint64_t>(now), uni(rng) >= sim.rsp_ratio});
+    }
+    return pkgs;
+}
+
+SimResult Simulate(const SimOption& sim, const FlowControlOption& option, const std::vector<Pkg>& arrivals)
+{
+    std::mt19937_64 rng(sim.seed + 1);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    FlowController ctrl;
+    ctrl.Init(option);
+
+    SimResult result;
+    result.sojourn_us.reserve(arrivals.size());
+    std::deque<Pkg> queue;
+    size_t next = 0;
+    uint64_t now = 0;
+    while (now < sim.duration_us)
+    {
+        uint64_t frame_start = now;
+        now += uni(rng) < sim.heavy_ratio ? sim.heavy_logic_us : sim.logic_us;
+        uint64_t remain_us = sim.max_proc_us > now - frame_start ? sim.max_proc_us - (now - frame_start) : 0;
+
+        // 收包阶段：边收边到达
+        uint64_t recv_start = now;
+        uint32_t budget = ctrl.Budget();
+        uint32_t deal = 0;
+        while (deal < budget)
+        {
+            while (next < arrivals.size() && arrivals[next].arrived_us <= now)
+                queue.push_back(arrivals[next++]);
+            if (queue.empty())
+                break;
+            Pkg pkg = queue.front();
+            queue.pop_front();
+            ++deal;
+            uint64_t sojourn_us = now - pkg.arrived_us;
+            if (ctrl.OnSojourn(sojourn_us / 1000, pkg.droppable))
+            {
+                ++result.shed_num;
+                now += sim.shed_us;
+                continue;
+            }
+            result.sojourn_us.push_back(sojourn_us);
+            now += sim.svc_us;
+        }
+
+        uint64_t used_us = now - recv_start;
+        if (used_us > remain_us)
+            ++result.overrun_num;
+        ctrl.OnFrame(now / 1000, remain_us / 1000, used_us / 1000);
+        ++result.frame_num;
+        now = std::max(now, frame_start + sim.min_frame_us);
+        while (next < arrivals.size() && arrivals[next].arrived_us <= now)
+            queue.push_back(arrivals[next++]);
+    }
+    result.left_num = queue.size() + (arrivals.size() - next);
+    return result;
+}
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+void Report(const char* name, SimResult& result)
+{
+    std::sort(result.sojourn_us.begin(), result.sojourn_us.end());
+    const auto& s = result.sojourn_us;
+    printf("%-20s %10zu %8" PRIu64 " %8" PRIu64 " %8.2f %8.2f %8.2f %8.2f %8" PRIu64 "\n", name, s.size(),
+           result.shed_num, result.overrun_num, Percentile(s, 0.5) / 1000.0, Percentile(s, 0.99) / 1000.0,
+           Percentile(s, 0.999) / 1000.0, (s.empty() ? 0 : s.back()) / 1000.0, result.left_num);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    SimOption sim;
+    if (argc > 1)
+        sim.duration_us = strtoull(argv[1], nullptr, 10) * 1000 * 1000;
+    if (argc > 2)
+        sim.seed = strtoull(argv[2], nullptr, 10);
+
+    FlowControlOption aimd;
+    aimd.max_deal_pkg_num = 100;
+    aimd.max_num = 1000;
+    aimd.min_num = 10;
+    aimd.inc_delta = 2;
+    aimd.dec_delta = 50;
+    aimd.judge_range_ms = 1;
+
+    FlowControlOption delay = aimd;
+    delay.mode = FlowMode::kDelayTarget;
+    delay.target_delay_ms = 5;
+    delay.interval_ms = 100;
+
+    FlowControlOption shed = delay;
+    shed.shed_on_delay = true;
+
+    std::vector<Pkg> arrivals = GenArrivals(sim);
+    printf("arrivals:%zu, duration:%" PRIu64 "s, seed:%" PRIu64 "\n", arrivals.size(), sim.duration_us / 1000000,
+           sim.seed);
+    printf("%-20s %10s %8s %8s %8s %8s %8s %8s %8s\n", "mode", "dealt", "shed", "overrun", "p50(ms)", "p99(ms)",
+           "p999(ms)", "max(ms)", "left");
+
+    SimResult aimd_result = Simulate(sim, aimd, arrivals);
+    Report("aimd", aimd_result);
+    SimResult delay_result = Simulate(sim, delay, arrivals);
+    Report("delay_target", delay_result);
+    SimResult shed_result = Simulate(sim, shed, arrivals);
+    Report("delay_target+shed", shed_result);
+    return 0;
+}
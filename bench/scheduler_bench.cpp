@@ -0,0 +1,180 @@
+/// @file scheduler_bench.cpp
+/// @brief 调度器吞吐对比：大量活跃 gid 下入队 + 派发 + 回包的平均耗时
+/// @note 用法: scheduler_bench [gid_num] [round_num]
+///       每轮随机给 gid 投递一批请求（128 字节），LoopOnce 全部派发，处理函数记下 gid，轮末统一 OnResponse
+///       naive 为常见写法：std::map<gid, std::deque<std::string>> + 每包一次堆分配
+///       alloc/req 为计时区间内全局 operator new 次数除以请求数（替换全局 operator new 计数）
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "core/gid_serial_scheduler.h"
+
+namespace
+{
+
+uint64_t g_alloc_num = 0;
+
+}  // namespace
+
+void* operator new(size_t size)
+{
+    ++g_alloc_num;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+
+/// 常见的按 gid 串行实现，作为对照
+class NaiveScheduler : public ua::IScheduler
+{
+public:
+    bool OnRequest(uint64_t, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) override
+    {
+        auto& queue = queues_[gid];
+        queue.emplace_back(data, len);
+        (void)custom_data;
+        if (!busy_.count(gid) && queue.size() == 1)
+            ready_.push_back(gid);
+        return true;
+    }
+    void OnResponse(uint64_t gid) override
+    {
+        busy_.erase(gid);
+        auto iter = queues_.find(gid);
+        if (iter == queues_.end())
+            return;
+        if (iter->second.empty())
+            queues_.erase(iter);
+        else
+            ready_.push_back(gid);
+    }
+    uint32_t LoopOnce(uint32_t proc_num) override
+    {
+        uint32_t count = 0;
+        while (!ready_.empty() && (proc_num == 0 || count < proc_num))
+        {
+            uint64_t gid = ready_.front();
+            ready_.pop_front();
+            std::string pkg = std::move(queues_[gid].front());
+            queues_[gid].pop_front();
+            busy_.insert(gid);
+            ProcOnce(gid, pkg.data(), static_cast<uint32_t>(pkg.size()), 0);
+            ++count;
+        }
+        return count;
+    }
+    size_t CacheNum(uint64_t gid) const override
+    {
+        auto iter = queues_.find(gid);
+        return iter == queues_.end() ? 0 : iter->second.size();
+    }
+
+private:
+    std::map<uint64_t, std::deque<std::string>> queues_;
+    std::unordered_set<uint64_t> busy_;
+    std::deque<uint64_t> ready_;
+};
+
+struct BenchResult
+{
+    uint64_t request_num = 0;
+    uint64_t dispatch_num = 0;
+    double ns_per_request = 0;
+    double alloc_per_request = 0;
+};
+
+BenchResult Run(ua::IScheduler& scheduler, uint32_t gid_num, uint32_t round_num, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint64_t> pick(1, gid_num);
+    std::vector<uint64_t> in_flight;
+    in_flight.reserve(gid_num);
+    scheduler.SetProcFunc([&](uint64_t gid, const char*, uint32_t, uint64_t) {
+        in_flight.push_back(gid);
+        return true;
+    });
+
+    char payload[128] = {};
+    BenchResult result;
+    uint32_t batch = gid_num / 2;  // 每轮平均每个 gid 半个请求，撞上的 gid 会排队
+    uint64_t alloc_begin = g_alloc_num;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < round_num; ++round)
+    {
+        for (uint32_t i = 0; i < batch; ++i)
+        {
+            uint64_t gid = pick(rng);
+            if (scheduler.OnRequest(i, gid, payload, sizeof(payload), 0))
+                ++result.request_num;
+        }
+        result.dispatch_num += scheduler.LoopOnce(0);
+        for (uint64_t gid : in_flight)
+            scheduler.OnResponse(gid);
+        in_flight.clear();
+    }
+    // 排空
+    while (true)
+    {
+        uint32_t num = scheduler.LoopOnce(0);
+        if (num == 0)
+            break;
+        result.dispatch_num += num;
+        for (uint64_t gid : in_flight)
+            scheduler.OnResponse(gid);
+        in_flight.clear();
+    }
+    auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+    result.ns_per_request = static_cast<double>(cost.count()) / static_cast<double>(result.request_num);
+    result.alloc_per_request =
+        static_cast<double>(g_alloc_num - alloc_begin) / static_cast<double>(result.request_num);
+    return result;
+}
+
+void Report(const char* name, const BenchResult& result)
+{
+    printf("%-16s %12" PRIu64 " %12" PRIu64 " %10.1f %10.3f\n", name, result.request_num, result.dispatch_num,
+           result.ns_per_request, result.alloc_per_request);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    uint32_t gid_num = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 100000;
+    uint32_t round_num = argc > 2 ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 10)) : 50;
+
+    printf("gid_num:%u, round_num:%u, payload:128B\n", gid_num, round_num);
+    printf("%-16s %12s %12s %10s %10s\n", "scheduler", "request", "dispatch", "ns/req", "alloc/req");
+
+    NaiveScheduler naive;
+    Report("naive", Run(naive, gid_num, round_num, 1));
+
+    ua::GidSerialScheduler::Option option;
+    option.expect_gid_num = gid_num;
+    ua::GidSerialScheduler serial(option);
+    BenchResult result = Run(serial, gid_num, round_num, 1);
+    Report("gid_serial", result);
+    printf("gid_serial arena reserved: %zu KB\n", serial.Arena().ReservedBytes() / 1024);
+    return 0;
+}
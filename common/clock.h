@@ -2,6 +2,7 @@
 /// @brief 时钟工具（C++20 重写版）
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include "patterns/singleton.h"
 
@@ -11,14 +12,15 @@ namespace ua
 class Clock : public Singleton<Clock>
 {
 public:
-    [[nodiscard]] uint64_t CurrentSec() const noexcept { return micro_sec_ / 1000000; }
-    [[nodiscard]] uint64_t CurrentMilliSec() const noexcept { return micro_sec_ / 1000; }
-    [[nodiscard]] uint64_t CurrentMicroSec() const noexcept { return micro_sec_; }
-    void Update(uint64_t micro_sec) noexcept { micro_sec_ = micro_sec; }
+    [[nodiscard]] uint64_t CurrentSec() const noexcept { return CurrentMicroSec() / 1000000; }
+    [[nodiscard]] uint64_t CurrentMilliSec() const noexcept { return CurrentMicroSec() / 1000; }
+    [[nodiscard]] uint64_t CurrentMicroSec() const noexcept { return micro_sec_.load(std::memory_order_relaxed); }
+    void Update(uint64_t micro_sec) noexcept { micro_sec_.store(micro_sec, std::memory_order_relaxed); }
 
 private:
     friend class Singleton<Clock>;
-    uint64_t micro_sec_ = 0;
+    /// 多线程运行时下由各线程更新，只要求原子不要求顺序
+    std::atomic<uint64_t> micro_sec_{0};
 };
 
 }  // namespace ua
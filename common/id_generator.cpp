@@ -9,9 +9,12 @@ namespace ua
 bool IDGenerator::Init() noexcept
 {
     // 高 32 位为当前秒级时间戳，低 32 位从 0 递增
-    base_seq_id_.store(
-        (static_cast<uint64_t>(Clock::GetInst().CurrentSec()) << 32) & 0xFFFFFFFF00000000ULL,
-        std::memory_order_relaxed);
+    // 多个分片各自 SvrInit 时会重复调用，只向前推进，避免已发出的 ID 再次出现
+    uint64_t base = (static_cast<uint64_t>(Clock::GetInst().CurrentSec()) << 32) & 0xFFFFFFFF00000000ULL;
+    uint64_t curr = base_seq_id_.load(std::memory_order_relaxed);
+    while (curr < base && !base_seq_id_.compare_exchange_weak(curr, base, std::memory_order_relaxed))
+    {
+    }
     return true;
 }
 
@@ -0,0 +1,164 @@
+/// @file inplace_function.h
+/// @brief 内联存储的只移动可调用对象，替代热路径上的 std::function
+/// @note 闭包放在对象内部 Capacity 字节的缓冲里，从不申请堆内存；闭包超过容量或对齐要求时编译报错
+///       只能移动不能拷贝，闭包本身也可以是只移动的（如捕获 unique_ptr）
+///       与 std::function 一样 operator() 为 const，可调用 mutable lambda
+///       由空的 std::function / 函数指针构造时结果为空，调用空对象触发 assert
+///       容量更小的 InplaceFunction 可以转换为容量更大的（作为闭包整体放入）
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ua
+{
+
+inline constexpr size_t kInplaceFunctionDefaultCapacity = 32;
+
+template <typename Signature, size_t Capacity = kInplaceFunctionDefaultCapacity>
+class InplaceFunction;
+
+namespace detail
+{
+
+template <typename T>
+struct IsInplaceFunction : std::false_type
+{
+};
+
+template <typename Signature, size_t Capacity>
+struct IsInplaceFunction<InplaceFunction<Signature, Capacity>> : std::true_type
+{
+};
+
+template <typename T>
+struct IsStdFunction : std::false_type
+{
+};
+
+template <typename Signature>
+struct IsStdFunction<std::function<Signature>> : std::true_type
+{
+};
+
+/// 可能为空的可调用对象：为空时构造出的 InplaceFunction 也为空
+template <typename T>
+inline constexpr bool kNullableCallable = std::is_pointer_v<T> || std::is_member_pointer_v<T> ||
+                                          IsStdFunction<T>::value || IsInplaceFunction<T>::value;
+
+}  // namespace detail
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+public:
+    static constexpr size_t kCapacity = Capacity;
+    static constexpr size_t kAlign = alignof(std::max_align_t);
+
+    InplaceFunction() noexcept = default;
+    InplaceFunction(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Fn = std::decay_t<F>>
+        requires(!std::is_same_v<Fn, InplaceFunction> && std::is_invocable_r_v<R, Fn&, Args...>)
+    InplaceFunction(F&& func)
+    {
+        static_assert(sizeof(Fn) <= Capacity, "InplaceFunction: closure too large, capture less or raise Capacity");
+        static_assert(alignof(Fn) <= kAlign, "InplaceFunction: closure over-aligned");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "InplaceFunction: closure must be nothrow movable");
+        if constexpr (detail::kNullableCallable<Fn>)
+        {
+            if (!func)
+                return;
+        }
+        ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(func));
+        ops_ = &kOps<Fn>;
+    }
+
+    InplaceFunction(InplaceFunction&& other) noexcept { MoveFrom(other); }
+
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction& operator=(std::nullptr_t) noexcept
+    {
+        Reset();
+        return *this;
+    }
+
+    template <typename F, typename Fn = std::decay_t<F>>
+        requires(!std::is_same_v<Fn, InplaceFunction> && std::is_invocable_r_v<R, Fn&, Args...>)
+    InplaceFunction& operator=(F&& func)
+    {
+        return *this = InplaceFunction(std::forward<F>(func));
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { Reset(); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    R operator()(Args... args) const
+    {
+        assert(ops_);
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops
+    {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*relocate)(void* dst, void* src) noexcept;  // 移动构造到 dst 并析构 src
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr Ops kOps = {
+        [](void* storage, Args&&... args) -> R {
+            if constexpr (std::is_void_v<R>)
+                std::invoke(*static_cast<Fn*>(storage), std::forward<Args>(args)...);
+            else
+                return std::invoke(*static_cast<Fn*>(storage), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        },
+        [](void* storage) noexcept { static_cast<Fn*>(storage)->~Fn(); },
+    };
+
+    void MoveFrom(InplaceFunction& other) noexcept
+    {
+        if (!other.ops_)
+            return;
+        other.ops_->relocate(storage_, other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+    }
+
+    void Reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(kAlign) mutable unsigned char storage_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+}  // namespace ua
@@ -9,14 +9,12 @@ uint64_t TimeoutQueue::Add(Task task, uint64_t expire_time, uint32_t interval_ti
 {
     uint64_t new_id = GenerateID();
 
-    auto [_, ok1] = timer_id_index_.emplace(new_id, expire_time);
-    if (!ok1)
+    if (!InsertIndex(new_id, expire_time))
         return 0;
 
-    auto [__, ok2] = timer_queue_.emplace(Timer{new_id, interval_time, expire_time, std::move(task)});
-    if (!ok2)
+    if (!InsertTimer(Timer{new_id, interval_time, expire_time, std::move(task)}))
     {
-        timer_id_index_.erase(new_id);
+        RecycleIndex(timer_id_index_.extract(new_id));
         return 0;
     }
 
@@ -29,8 +27,11 @@ bool TimeoutQueue::Cancel(uint64_t timer_id)
     if (iter == timer_id_index_.end())
         return false;
 
-    timer_queue_.erase(Timer{timer_id, 0, iter->second, nullptr});
-    timer_id_index_.erase(iter);
+    auto node = timer_queue_.extract(Timer{timer_id, 0, iter->second, nullptr});
+    RecycleIndex(timer_id_index_.extract(iter));
+    // 放在最后：析构 task 时可能再操作定时器
+    if (!node.empty())
+        RecycleTimer(std::move(node));
     return true;
 }
 
@@ -43,22 +44,27 @@ uint32_t TimeoutQueue::TimeOut(uint64_t now)
         if (iter->expire_time > now)
             break;
 
-        // 拷贝一份，先删再执行，防止 task 中操作定时器
-        Timer tmp = *iter;
-        timer_id_index_.erase(iter->seq_id);
-        timer_queue_.erase(iter);
-
-        // 循环定时器：重新加入
-        if (tmp.interval_time > 0)
+        // 摘出节点再执行，不拷贝 task，防止 task 中操作定时器
+        auto node = timer_queue_.extract(iter);
+        Timer& timer = node.value();
+        if (timer.interval_time == 0)
         {
-            tmp.expire_time += tmp.interval_time;
-            if (auto [_, ok] = timer_id_index_.emplace(tmp.seq_id, tmp.expire_time); ok)
-            {
-                timer_queue_.insert(tmp);
-            }
+            RecycleIndex(timer_id_index_.extract(timer.seq_id));
+            timer.task(timer.seq_id, timer.interval_time);
+            RecycleTimer(std::move(node));
+            ++count;
+            continue;
         }
 
-        tmp.task(tmp.seq_id, tmp.interval_time);
+        // 循环定时器：执行期间仍视为存在（Exist 为真），执行中被取消则不再加回
+        timer.expire_time += timer.interval_time;
+        timer_id_index_[timer.seq_id] = timer.expire_time;
+        timer.task(timer.seq_id, timer.interval_time);
+        if (auto index = timer_id_index_.find(timer.seq_id);
+            index != timer_id_index_.end() && index->second == timer.expire_time)
+            timer_queue_.insert(std::move(node));
+        else
+            RecycleTimer(std::move(node));
         ++count;
     }
     return count;
@@ -75,6 +81,51 @@ void TimeoutQueue::Clear()
     timer_id_index_.clear();
 }
 
+bool TimeoutQueue::InsertIndex(uint64_t timer_id, uint64_t expire_time)
+{
+    if (free_indexes_.empty())
+        return timer_id_index_.emplace(timer_id, expire_time).second;
+
+    IndexMap::node_type node = std::move(free_indexes_.back());
+    free_indexes_.pop_back();
+    node.key() = timer_id;
+    node.mapped() = expire_time;
+    auto result = timer_id_index_.insert(std::move(node));
+    if (!result.inserted)
+        RecycleIndex(std::move(result.node));
+    return result.inserted;
+}
+
+bool TimeoutQueue::InsertTimer(Timer&& timer)
+{
+    if (free_timers_.empty())
+        return timer_queue_.insert(std::move(timer)).second;
+
+    TimerSet::node_type node = std::move(free_timers_.back());
+    free_timers_.pop_back();
+    node.value() = std::move(timer);
+    auto result = timer_queue_.insert(std::move(node));
+    if (!result.inserted)
+        RecycleTimer(std::move(result.node));
+    return result.inserted;
+}
+
+void TimeoutQueue::RecycleIndex(IndexMap::node_type&& node)
+{
+    if (!node.empty() && free_indexes_.size() < kMaxFreeNode)
+        free_indexes_.push_back(std::move(node));
+}
+
+void TimeoutQueue::RecycleTimer(TimerSet::node_type&& node)
+{
+    if (node.empty())
+        return;
+    // task 的析构可能重入 Add，先析构再放回
+    node.value().task = nullptr;
+    if (free_timers_.size() < kMaxFreeNode)
+        free_timers_.push_back(std::move(node));
+}
+
 uint64_t TimeoutQueue::GenerateID() noexcept
 {
     ++base_id_;
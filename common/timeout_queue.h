@@ -1,12 +1,16 @@
 /// @file timeout_queue.h
 /// @brief 优先队列定时器（C++20 重写版）
 /// @note 改进: timer_id 使用 uint64_t 避免回绕
+///       task 为 InplaceFunction，闭包随 Timer 内联存放，超时时摘出节点执行，不拷贝
+///       摘下的 set / 索引节点（析构 task 后）留作下次 Add 复用，稳态下添加和触发定时器不申请内存
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <set>
 #include <unordered_map>
+#include <vector>
+#include "inplace_function.h"
 
 namespace ua
 {
@@ -15,7 +19,7 @@ class TimeoutQueue
 {
 public:
     /// 改进: timer_id 使用 uint64_t 避免 32 位回绕
-    using Task = std::function<void(uint64_t timer_id, uint32_t interval_time)>;
+    using Task = InplaceFunction<void(uint64_t timer_id, uint32_t interval_time), 64>;
 
     /// 添加定时器，返回唯一 timer_id，失败返回 0
     [[nodiscard]] uint64_t Add(Task task, uint64_t expire_time, uint32_t interval_time = 0);
@@ -25,10 +29,17 @@ public:
     uint32_t TimeOut(uint64_t now);
     /// 判断定时器是否存在
     [[nodiscard]] bool Exist(uint64_t timer_id) const;
+    /// 最近一个定时器的到期时间，没有定时器返回 0
+    [[nodiscard]] uint64_t NextExpireTime() const noexcept
+    {
+        return timer_queue_.empty() ? 0 : timer_queue_.begin()->expire_time;
+    }
     /// 清空所有定时器
     void Clear();
 
 private:
+    static constexpr size_t kMaxFreeNode = 1024;
+
     [[nodiscard]] uint64_t GenerateID() noexcept;
 
     struct Timer
@@ -51,8 +62,20 @@ private:
         }
     };
 
-    std::set<Timer> timer_queue_;
-    std::unordered_map<uint64_t, uint64_t> timer_id_index_;
+    using TimerSet = std::set<Timer>;
+    using IndexMap = std::unordered_map<uint64_t, uint64_t>;
+
+    /// 插入索引 / 定时器，优先复用空闲节点，键已存在返回 false
+    bool InsertIndex(uint64_t timer_id, uint64_t expire_time);
+    bool InsertTimer(Timer&& timer);
+    /// 回收摘下的节点：先析构 task 再放进空闲列表
+    void RecycleIndex(IndexMap::node_type&& node);
+    void RecycleTimer(TimerSet::node_type&& node);
+
+    TimerSet timer_queue_;
+    IndexMap timer_id_index_;
+    std::vector<TimerSet::node_type> free_timers_;
+    std::vector<IndexMap::node_type> free_indexes_;
     uint64_t base_id_ = 0;
 };
 
@@ -0,0 +1,203 @@
+/// @file spsc_ring_buf.h
+/// @brief 单生产者单消费者无锁变长环形缓冲区
+/// @note 内存由外部提供（堆或共享内存），读写位置单调递增，容量取 2 的幂
+///       每条记录: [u32 长度][数据]，按 8 字节对齐；尾部放不下时写回绕标记跳到开头
+///       生产者/消费者各自缓存对方位置，热路径上通常只有一次 release store
+#pragma once
+
+#include <sys/uio.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ua
+{
+
+class SpscRingBuf
+{
+public:
+    SpscRingBuf() = default;
+    SpscRingBuf(const SpscRingBuf&) = delete;
+    SpscRingBuf& operator=(const SpscRingBuf&) = delete;
+
+    /// buf_size 需为 2 的幂
+    static constexpr size_t need_total_mem_size(size_t buf_size) { return sizeof(BuffHead) + buf_size; }
+
+    /// 初始化，可用区域向下取整到 2 的幂；check=true 时校验已有数据（共享内存恢复）
+    bool init(void* mem, size_t mem_size, bool check = false)
+    {
+        if (!mem || mem_size < sizeof(BuffHead) + kMinBufSize)
+            return false;
+
+        size_t buf_size = kMinBufSize;
+        while (buf_size * 2 <= mem_size - sizeof(BuffHead))
+            buf_size *= 2;
+
+        auto* head = reinterpret_cast<BuffHead*>(mem);
+        if (check)
+        {
+            if (head->m_size != buf_size ||
+                head->m_write_pos.load(std::memory_order_relaxed) - head->m_read_pos.load(std::memory_order_relaxed) >
+                    buf_size)
+                return false;
+        }
+        else
+        {
+            head->m_write_pos.store(0, std::memory_order_relaxed);
+            head->m_read_pos.store(0, std::memory_order_relaxed);
+            head->m_size = buf_size;
+        }
+
+        m_head = head;
+        m_buf = reinterpret_cast<uint8_t*>(mem) + sizeof(BuffHead);
+        m_mask = buf_size - 1;
+        m_cached_read = head->m_read_pos.load(std::memory_order_acquire);
+        m_cached_write = head->m_write_pos.load(std::memory_order_acquire);
+        return true;
+    }
+
+    [[nodiscard]] bool is_init() const { return m_head != nullptr; }
+    [[nodiscard]] size_t capacity() const { return m_head->m_size; }
+    /// 已占用字节数（含记录头和对齐），仅作观测用
+    [[nodiscard]] size_t size() const
+    {
+        return m_head->m_write_pos.load(std::memory_order_acquire) - m_head->m_read_pos.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    /// 单条记录允许的最大数据长度
+    [[nodiscard]] size_t max_item_len() const { return m_head->m_size / 2 - sizeof(ItemHeader); }
+
+    // ==================== 生产者 ====================
+
+    /// 预留 len 字节的写空间，返回写入地址，空间不足返回 nullptr；写完后必须调用 commit
+    [[nodiscard]] uint8_t* reserve(uint32_t len)
+    {
+        if (len > max_item_len())
+            return nullptr;
+
+        uint64_t write_pos = m_head->m_write_pos.load(std::memory_order_relaxed);
+        size_t need = align_bytes(sizeof(ItemHeader) + len);
+        size_t contiguous = m_head->m_size - (write_pos & m_mask);
+        size_t total = need > contiguous ? contiguous + need : need;
+
+        if (write_pos + total - m_cached_read > m_head->m_size)
+        {
+            m_cached_read = m_head->m_read_pos.load(std::memory_order_acquire);
+            if (write_pos + total - m_cached_read > m_head->m_size)
+                return nullptr;
+        }
+
+        if (need > contiguous)
+        {
+            // 尾部放不下，写回绕标记，数据从开头写
+            get_header(write_pos)->m_len = kWrapMarker;
+            write_pos += contiguous;
+        }
+
+        m_reserve_pos = write_pos;
+        return m_buf + (write_pos & m_mask) + sizeof(ItemHeader);
+    }
+
+    /// 提交 reserve 的空间，len 不能超过 reserve 时的长度
+    void commit(uint32_t len)
+    {
+        get_header(m_reserve_pos)->m_len = len;
+        m_head->m_write_pos.store(m_reserve_pos + align_bytes(sizeof(ItemHeader) + len), std::memory_order_release);
+    }
+
+    bool push(const void* data, uint32_t len)
+    {
+        uint8_t* dst = reserve(len);
+        if (!dst)
+            return false;
+        std::memcpy(dst, data, len);
+        commit(len);
+        return true;
+    }
+
+    bool push(const struct iovec* iov, size_t iov_cnt)
+    {
+        size_t total_len = 0;
+        for (size_t i = 0; i < iov_cnt; ++i)
+            total_len += iov[i].iov_len;
+        if (total_len > max_item_len())
+            return false;
+
+        uint8_t* dst = reserve(static_cast<uint32_t>(total_len));
+        if (!dst)
+            return false;
+        for (size_t i = 0; i < iov_cnt; ++i)
+        {
+            std::memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+            dst += iov[i].iov_len;
+        }
+        commit(static_cast<uint32_t>(total_len));
+        return true;
+    }
+
+    // ==================== 消费者 ====================
+
+    /// 获取队头记录，为空返回 nullptr
+    [[nodiscard]] const uint8_t* front(uint32_t& len)
+    {
+        uint64_t read_pos = m_head->m_read_pos.load(std::memory_order_relaxed);
+        if (read_pos == m_cached_write)
+        {
+            m_cached_write = m_head->m_write_pos.load(std::memory_order_acquire);
+            if (read_pos == m_cached_write)
+                return nullptr;
+        }
+
+        const ItemHeader* header = get_header(read_pos);
+        if (header->m_len == kWrapMarker)
+        {
+            read_pos += m_head->m_size - (read_pos & m_mask);
+            m_head->m_read_pos.store(read_pos, std::memory_order_release);
+            return front(len);
+        }
+
+        len = header->m_len;
+        return reinterpret_cast<const uint8_t*>(header + 1);
+    }
+
+    /// 弹出队头记录（必须先 front 成功）
+    void pop()
+    {
+        uint64_t read_pos = m_head->m_read_pos.load(std::memory_order_relaxed);
+        const ItemHeader* header = get_header(read_pos);
+        m_head->m_read_pos.store(read_pos + align_bytes(sizeof(ItemHeader) + header->m_len), std::memory_order_release);
+    }
+
+private:
+    struct ItemHeader
+    {
+        uint32_t m_len = 0;
+        uint32_t m_reserved = 0;
+    };
+
+    /// 读写位置分属不同 cache line，避免伪共享
+    struct BuffHead
+    {
+        alignas(64) std::atomic<uint64_t> m_write_pos{0};
+        alignas(64) std::atomic<uint64_t> m_read_pos{0};
+        alignas(64) uint64_t m_size = 0;
+    };
+
+    static constexpr uint32_t kWrapMarker = 0xFFFFFFFF;
+    static constexpr size_t kAlign = 8;
+    static constexpr size_t kMinBufSize = 64;
+
+    static constexpr size_t align_bytes(size_t bytes) { return (bytes + kAlign - 1) & ~(kAlign - 1); }
+
+    ItemHeader* get_header(uint64_t pos) { return reinterpret_cast<ItemHeader*>(m_buf + (pos & m_mask)); }
+
+    BuffHead* m_head = nullptr;
+    uint8_t* m_buf = nullptr;
+    uint64_t m_mask = 0;
+    uint64_t m_cached_read = 0;   // 生产者侧缓存
+    uint64_t m_cached_write = 0;  // 消费者侧缓存
+    uint64_t m_reserve_pos = 0;   // 生产者侧 reserve 的位置
+};
+
+}  // namespace ua
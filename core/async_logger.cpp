@@ -0,0 +1,452 @@
+/// @file async_logger.cpp
+/// @brief 异步日志后端实现
+#include "async_logger.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "binary_log.h"
+#include "common/utils.h"
+
+namespace ua
+{
+
+// ==================== LogFileSink ====================
+
+bool LogFileSink::Open(const Option& option, std::string* err_msg)
+{
+    Close();
+    option_ = option;
+
+    fd_ = utils::GetFileFd(option_.file_path, true, err_msg);
+    if (fd_ < 0)
+        return false;
+
+    off_t end = lseek(fd_, 0, SEEK_END);
+    file_size_ = end > 0 ? static_cast<uint64_t>(end) : 0;
+    buffer_.clear();
+    buffer_.reserve(option_.write_buf_size);
+    last_sync_ms_ = utils::CurrentRealMilliSec();
+    need_sync_ = false;
+    return true;
+}
+
+void LogFileSink::Close()
+{
+    if (fd_ < 0)
+        return;
+
+    WriteOut();
+    if (need_sync_)
+        fdatasync(fd_);
+    close(fd_);
+    fd_ = -1;
+    need_sync_ = false;
+}
+
+void LogFileSink::Append(const char* data, size_t len)
+{
+    if (fd_ < 0)
+        return;
+
+    if (buffer_.size() + len > option_.write_buf_size)
+        WriteOut();
+
+    if (len > option_.write_buf_size)
+    {
+        // 超大单条直接写
+        buffer_.assign(data, len);
+        WriteOut();
+        return;
+    }
+    buffer_.append(data, len);
+}
+
+void LogFileSink::Flush(uint64_t now_ms)
+{
+    if (fd_ < 0)
+        return;
+
+    WriteOut();
+    // 只在刷盘轮次之间滚动，保证一轮内写入的记录（及其调用点定义）落在同一个文件
+    if (option_.rotate_size > 0 && file_size_ >= option_.rotate_size)
+    {
+        Rotate();
+        return;
+    }
+    if (need_sync_ && option_.fsync_interval_ms > 0 && now_ms >= last_sync_ms_ + option_.fsync_interval_ms)
+    {
+        fdatasync(fd_);
+        last_sync_ms_ = now_ms;
+        need_sync_ = false;
+    }
+}
+
+void LogFileSink::WriteOut()
+{
+    size_t offset = 0;
+    while (offset < buffer_.size())
+    {
+        ssize_t ret = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // 磁盘错误时丢弃本批数据，避免无限重试卡住刷盘线程
+            fprintf(stderr, "async log write %s fail: %s\n", option_.file_path.c_str(), strerror(errno));
+            break;
+        }
+        offset += static_cast<size_t>(ret);
+    }
+
+    if (offset > 0)
+    {
+        file_size_ += offset;
+        need_sync_ = true;
+    }
+    buffer_.clear();
+}
+
+void LogFileSink::Rotate()
+{
+    if (need_sync_)
+        fdatasync(fd_);
+    close(fd_);
+    fd_ = -1;
+
+    const std::string& path = option_.file_path;
+    if (option_.rotate_num == 0)
+    {
+        unlink(path.c_str());
+    }
+    else
+    {
+        for (uint32_t i = option_.rotate_num - 1; i >= 1; --i)
+        {
+            std::string from = path + "." + std::to_string(i);
+            std::string to = path + "." + std::to_string(i + 1);
+            rename(from.c_str(), to.c_str());
+        }
+        rename(path.c_str(), (path + ".1").c_str());
+    }
+
+    fd_ = utils::GetFileFd(path, true);
+    file_size_ = 0;
+    need_sync_ = false;
+    ++rotate_count_;
+    if (fd_ < 0)
+        fprintf(stderr, "async log reopen %s fail\n", path.c_str());
+}
+
+// ==================== AsyncLogger ====================
+
+/// 线程退出时归还缓冲，供后续新线程复用
+struct ThreadRingHolder
+{
+    ~ThreadRingHolder()
+    {
+        if (ring)
+            AsyncLogger::GetInst().ReleaseRing(ring);
+    }
+    AsyncLogger::ThreadRing* ring = nullptr;
+};
+
+static thread_local ThreadRingHolder tls_ring_holder;
+
+AsyncLogger::~AsyncLogger()
+{
+    Stop();
+    ThreadRing* ring = ring_list_.exchange(nullptr);
+    while (ring)
+    {
+        ThreadRing* next = ring->next;
+        delete ring;
+        ring = next;
+    }
+}
+
+bool AsyncLogger::Start(const Option& option, std::string* err_msg)
+{
+    if (running_.load(std::memory_order_acquire))
+    {
+        if (err_msg)
+            *err_msg += "async logger already running";
+        return false;
+    }
+
+    option_ = option;
+    if (!sink_.Open(option_.sink, err_msg))
+        return false;
+
+    emitted_sites_.clear();
+    sink_rotate_count_ = sink_.RotateCount();
+
+    running_.store(true, std::memory_order_release);
+    flush_thread_ = std::thread([this]() { FlushLoop(); });
+    return true;
+}
+
+void AsyncLogger::Stop()
+{
+    if (!running_.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    flush_cv_.notify_all();
+    if (flush_thread_.joinable())
+        flush_thread_.join();
+
+    // 线程退出后再收一次尾巴
+    DrainAll();
+    sink_.Close();
+}
+
+AsyncLogger::ThreadRing* AsyncLogger::AcquireRing()
+{
+    // 优先复用已退出线程留下且已消费完的缓冲
+    for (ThreadRing* ring = ring_list_.load(std::memory_order_acquire); ring; ring = ring->next)
+    {
+        bool expected = false;
+        if (ring->ring.empty() && ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            return ring;
+    }
+
+    auto* ring = new ThreadRing;
+    size_t mem_size = SpscRingBuf::need_total_mem_size(option_.ring_size);
+    ring->mem = std::make_unique<uint8_t[]>(mem_size);
+    ring->ring.init(ring->mem.get(), mem_size);
+
+    // 无锁头插，刷盘线程遍历时不需要加锁
+    ThreadRing* head = ring_list_.load(std::memory_order_relaxed);
+    do
+    {
+        ring->next = head;
+    } while (!ring_list_.compare_exchange_weak(head, ring, std::memory_order_release, std::memory_order_relaxed));
+    return ring;
+}
+
+void AsyncLogger::ReleaseRing(ThreadRing* ring)
+{
+    ring->in_use.store(false, std::memory_order_release);
+}
+
+void AsyncLogger::Output(Logger::PriorityType priority, const char* msg, uint32_t len)
+{
+    Write(kRecordText, static_cast<uint8_t>(priority), msg, len);
+}
+
+bool AsyncLogger::Write(uint8_t kind, uint8_t priority, const void* data, uint32_t len)
+{
+    if (!running_.load(std::memory_order_relaxed))
+    {
+        drop_num_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ThreadRing*& ring = tls_ring_holder.ring;
+    if (!ring)
+        ring = AcquireRing();
+
+    RecordHead head{kind, priority};
+    struct iovec iov[2];
+    iov[0].iov_base = &head;
+    iov[0].iov_len = sizeof(head);
+    iov[1].iov_base = const_cast<void*>(data);
+    iov[1].iov_len = len;
+
+    if (ring->ring.push(iov, 2))
+        return true;
+
+    if (option_.full_policy == FullPolicy::Block && sizeof(head) + len <= ring->ring.max_item_len())
+    {
+        block_num_.fetch_add(1, std::memory_order_relaxed);
+        while (running_.load(std::memory_order_relaxed))
+        {
+            std::this_thread::yield();
+            if (ring->ring.push(iov, 2))
+                return true;
+        }
+    }
+
+    drop_num_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void AsyncLogger::Flush()
+{
+    if (!running_.load(std::memory_order_acquire))
+        return;
+
+    std::unique_lock<std::mutex> lock(flush_mutex_);
+    uint64_t request = ++flush_request_;
+    flush_cv_.notify_all();
+    flush_cv_.wait(lock, [this, request]() { return flush_done_ >= request || !running_.load(); });
+}
+
+size_t AsyncLogger::DrainAll()
+{
+    size_t count = 0;
+    for (ThreadRing* ring = ring_list_.load(std::memory_order_acquire); ring; ring = ring->next)
+    {
+        uint32_t len = 0;
+        while (const uint8_t* data = ring->ring.front(len))
+        {
+            HandleRecord(data, len);
+            ring->ring.pop();
+            ++count;
+        }
+    }
+
+    uint64_t drop_num = drop_num_.load(std::memory_order_relaxed);
+    if (drop_num > reported_drop_num_)
+    {
+        // 按普通文本记录处理，raw_binary 模式下同样成帧
+        char record[128];
+        RecordHead head{kRecordText, static_cast<uint8_t>(Logger::PRIORITY_WARN)};
+        std::memcpy(record, &head, sizeof(head));
+        int n = snprintf(record + sizeof(head), sizeof(record) - sizeof(head), "[WARN]|async logger dropped %lu lines",
+                         static_cast<unsigned long>(drop_num - reported_drop_num_));
+        HandleRecord(reinterpret_cast<const uint8_t*>(record), static_cast<uint32_t>(sizeof(head) + n));
+        reported_drop_num_ = drop_num;
+    }
+    return count;
+}
+
+void AsyncLogger::HandleRecord(const uint8_t* data, uint32_t len)
+{
+    if (len < sizeof(RecordHead))
+        return;
+
+    RecordHead head;
+    std::memcpy(&head, data, sizeof(head));
+    const char* body = reinterpret_cast<const char*>(data + sizeof(head));
+    uint32_t body_len = len - static_cast<uint32_t>(sizeof(head));
+
+    if (option_.raw_binary)
+    {
+        if (sink_.RotateCount() != sink_rotate_count_)
+        {
+            // 新文件需要重新写调用点定义
+            sink_rotate_count_ = sink_.RotateCount();
+            emitted_sites_.clear();
+        }
+        if (sink_.WrittenSize() == 0)
+            sink_.Append(kRawFileMagic, sizeof(kRawFileMagic));
+        if (head.kind == kRecordBinary && body_len >= sizeof(uint32_t))
+        {
+            uint32_t site_id = 0;
+            std::memcpy(&site_id, body, sizeof(site_id));
+            EmitSite(site_id);
+        }
+        AppendRawFrame(head.kind, head.priority, body, body_len);
+        return;
+    }
+
+    if (head.kind == kRecordText)
+    {
+        sink_.Append(body, body_len);
+        sink_.Append("\n", 1);
+    }
+    else if (head.kind == kRecordBinary)
+    {
+        HandleBinaryRecord(head.priority, data + sizeof(head), body_len);
+    }
+}
+
+void AsyncLogger::HandleBinaryRecord(uint8_t priority, const uint8_t* data, uint32_t len)
+{
+    if (len < sizeof(uint32_t))
+        return;
+
+    uint32_t site_id = 0;
+    std::memcpy(&site_id, data, sizeof(site_id));
+    const LogSite* site = FindSite(site_id);
+    if (!site)
+        return;
+
+    format_buf_.clear();
+    if (!BinaryLog::Format(priority, site->fmt, site->file, site->line, site->func, data, len, format_buf_))
+        return;
+    format_buf_.push_back('\n');
+    sink_.Append(format_buf_.data(), format_buf_.size());
+}
+
+const LogSite* AsyncLogger::FindSite(uint32_t site_id)
+{
+    if (site_id == 0)
+        return nullptr;
+    if (site_id > site_cache_.size())
+        site_cache_.resize(site_id, nullptr);
+    if (!site_cache_[site_id - 1])
+        site_cache_[site_id - 1] = LogSiteRegistry::Get(site_id);
+    return site_cache_[site_id - 1];
+}
+
+void AsyncLogger::EmitSite(uint32_t site_id)
+{
+    if (site_id < emitted_sites_.size() && emitted_sites_[site_id])
+        return;
+
+    const LogSite* site = FindSite(site_id);
+    if (!site)
+        return;
+
+    // 调用点定义: [u32 id][u32 行号][u8 优先级] fmt\0 file\0 func\0
+    format_buf_.clear();
+    format_buf_.append(reinterpret_cast<const char*>(&site_id), sizeof(site_id));
+    format_buf_.append(reinterpret_cast<const char*>(&site->line), sizeof(site->line));
+    format_buf_.push_back(static_cast<char>(site->priority));
+    format_buf_.append(site->fmt, strlen(site->fmt) + 1);
+    format_buf_.append(site->file, strlen(site->file) + 1);
+    format_buf_.append(site->func, strlen(site->func) + 1);
+    AppendRawFrame(kRecordSite, site->priority, format_buf_.data(), static_cast<uint32_t>(format_buf_.size()));
+
+    if (site_id >= emitted_sites_.size())
+        emitted_sites_.resize(site_id + 1, false);
+    emitted_sites_[site_id] = true;
+}
+
+void AsyncLogger::AppendRawFrame(uint8_t kind, uint8_t priority, const void* data, uint32_t len)
+{
+    RawFrameHead frame{len, kind, priority};
+    sink_.Append(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    sink_.Append(static_cast<const char*>(data), len);
+}
+
+void AsyncLogger::FlushLoop()
+{
+    while (running_.load(std::memory_order_acquire))
+    {
+        uint64_t request = 0;
+        {
+            std::lock_guard<std::mutex> lock(flush_mutex_);
+            request = flush_request_;
+        }
+
+        size_t count = DrainAll();
+        sink_.Flush(utils::CurrentRealMilliSec());
+
+        std::unique_lock<std::mutex> lock(flush_mutex_);
+        if (request > flush_done_)
+        {
+            flush_done_ = request;
+            flush_cv_.notify_all();
+        }
+
+        // 有数据就继续收，空闲时等待轮询间隔或 Flush 请求
+        if (count == 0)
+        {
+            flush_cv_.wait_for(lock, std::chrono::milliseconds(option_.flush_interval_ms), [this]() {
+                return flush_request_ > flush_done_ || !running_.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    flush_done_ = flush_request_;
+    flush_cv_.notify_all();
+}
+
+}  // namespace ua
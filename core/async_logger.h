@@ -0,0 +1,180 @@
+/// @file async_logger.h
+/// @brief 异步日志后端：每线程 SPSC 环形缓冲 + 后台刷盘线程
+/// @note 业务线程只做一次 memcpy 进入本线程的环形缓冲，不再有 write 系统调用
+///       后台线程轮询所有缓冲，批量写入文件，按大小滚动，按时间间隔批量 fsync
+///       缓冲满时按 FullPolicy 处理：丢弃并计数，或自旋等待刷盘线程腾出空间
+///       二进制日志记录（见 binary_log.h）在刷盘线程格式化，或 raw_binary 模式下原样落盘
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "containers/spsc_ring_buf.h"
+#include "logger.h"
+#include "patterns/singleton.h"
+
+namespace ua
+{
+
+struct LogSite;
+
+/// 带滚动和批量 fsync 的缓冲文件输出
+class LogFileSink
+{
+public:
+    struct Option
+    {
+        std::string file_path;                      // 日志文件路径，滚动后为 file_path.1 ~ file_path.N
+        uint64_t rotate_size = 512ULL * 1024 * 1024; // 单文件最大字节数，0 表示不滚动
+        uint32_t rotate_num = 10;                   // 保留的历史文件数
+        uint32_t write_buf_size = 256 * 1024;       // 用户态写缓冲大小
+        uint32_t fsync_interval_ms = 1000;          // 两次 fdatasync 的最小间隔，0 表示不主动 fsync
+    };
+
+    LogFileSink() = default;
+    LogFileSink(const LogFileSink&) = delete;
+    LogFileSink& operator=(const LogFileSink&) = delete;
+    ~LogFileSink() { Close(); }
+
+    bool Open(const Option& option, std::string* err_msg = nullptr);
+    void Close();
+    /// 追加一段数据，缓冲满时写出
+    void Append(const char* data, size_t len);
+    /// 写出用户态缓冲，超过大小时滚动，按间隔 fdatasync
+    void Flush(uint64_t now_ms);
+
+    /// 当前文件已写入（含未写出缓冲）的字节数
+    [[nodiscard]] uint64_t WrittenSize() const noexcept { return file_size_ + buffer_.size(); }
+    /// 已滚动次数，调用方据此判断是否换了新文件
+    [[nodiscard]] uint32_t RotateCount() const noexcept { return rotate_count_; }
+
+private:
+    void WriteOut();
+    void Rotate();
+
+    Option option_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    uint64_t last_sync_ms_ = 0;
+    bool need_sync_ = false;
+    uint32_t rotate_count_ = 0;
+    std::string buffer_;
+};
+
+class AsyncLogger : public Singleton<AsyncLogger>
+{
+public:
+    /// 环形缓冲满时的策略
+    enum class FullPolicy : uint8_t
+    {
+        Drop = 0,   // 丢弃并计数（默认，业务线程绝不阻塞）
+        Block = 1,  // 自旋等待刷盘线程腾出空间（不丢日志）
+    };
+
+    struct Option
+    {
+        LogFileSink::Option sink{};
+        uint32_t ring_size = 1024 * 1024;  // 每个线程的环形缓冲大小，取 2 的幂
+        uint32_t flush_interval_ms = 5;    // 刷盘线程空闲时的轮询间隔
+        FullPolicy full_policy = FullPolicy::Drop;
+        bool raw_binary = false;  // true: 所有记录按帧原样落盘，由 log_decoder 还原；false: 刷盘线程格式化为文本
+    };
+
+    /// 启动刷盘线程；需自行把 Output 设置为 Logger 的输出函数
+    bool Start(const Option& option, std::string* err_msg = nullptr);
+    /// 停止刷盘线程，写完所有缓冲后关闭文件
+    void Stop();
+    [[nodiscard]] bool IsRunning() const noexcept { return running_.load(std::memory_order_acquire); }
+
+    /// 热路径：写入当前线程的环形缓冲，可直接作为 Logger::OutputFunc
+    void Output(Logger::PriorityType priority, const char* msg, uint32_t len);
+    /// 写入一条原始记录，kind 区分记录类型
+    bool Write(uint8_t kind, uint8_t priority, const void* data, uint32_t len);
+
+    /// 等待当前已写入的日志全部落到文件（测试/退出前使用）
+    void Flush();
+
+    /// 因缓冲满被丢弃的日志条数
+    [[nodiscard]] uint64_t DropNum() const noexcept { return drop_num_.load(std::memory_order_relaxed); }
+    /// Block 策略下等待过的次数
+    [[nodiscard]] uint64_t BlockNum() const noexcept { return block_num_.load(std::memory_order_relaxed); }
+
+    /// 记录类型
+    static constexpr uint8_t kRecordText = 0;
+    static constexpr uint8_t kRecordBinary = 1;  // BinaryLog 编码的记录
+    static constexpr uint8_t kRecordSite = 2;    // 调用点定义，只出现在 raw_binary 文件中
+
+    /// raw_binary 文件头，每个文件（含滚动后的新文件）开头写一次
+    static constexpr char kRawFileMagic[8] = {'U', 'A', 'B', 'L', 'O', 'G', '1', '\n'};
+    /// raw_binary 帧头: [u32 长度][u8 类型][u8 优先级] + 数据
+    struct RawFrameHead
+    {
+        uint32_t len;
+        uint8_t kind;
+        uint8_t priority;
+    } __attribute__((packed));
+
+    ~AsyncLogger();
+
+private:
+    friend class Singleton<AsyncLogger>;
+    AsyncLogger() = default;
+
+    /// 每线程一个缓冲，线程退出后可被新线程复用
+    struct ThreadRing
+    {
+        SpscRingBuf ring;
+        std::unique_ptr<uint8_t[]> mem;
+        std::atomic<bool> in_use{true};
+        ThreadRing* next = nullptr;
+    };
+
+    /// 记录头：类型 + 优先级
+    struct RecordHead
+    {
+        uint8_t kind = 0;
+        uint8_t priority = 0;
+    };
+
+    ThreadRing* AcquireRing();
+    void ReleaseRing(ThreadRing* ring);
+    void FlushLoop();
+    /// 消费所有线程缓冲，返回本轮消费的记录数
+    size_t DrainAll();
+    void HandleRecord(const uint8_t* data, uint32_t len);
+    void HandleBinaryRecord(uint8_t priority, const uint8_t* data, uint32_t len);
+    void AppendRawFrame(uint8_t kind, uint8_t priority, const void* data, uint32_t len);
+    /// raw 模式下确保调用点定义已写入当前文件
+    void EmitSite(uint32_t site_id);
+    const LogSite* FindSite(uint32_t site_id);
+
+    friend struct ThreadRingHolder;
+
+    Option option_;
+    LogFileSink sink_;
+    std::thread flush_thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<ThreadRing*> ring_list_{nullptr};
+    std::atomic<uint64_t> drop_num_{0};
+    std::atomic<uint64_t> block_num_{0};
+    uint64_t reported_drop_num_ = 0;
+
+    /// 以下仅刷盘线程访问
+    std::vector<const LogSite*> site_cache_;
+    std::vector<bool> emitted_sites_;
+    uint32_t sink_rotate_count_ = 0;
+    std::string format_buf_;
+
+    /// Flush 等待用
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    uint64_t flush_request_ = 0;
+    uint64_t flush_done_ = 0;
+};
+
+}  // namespace ua
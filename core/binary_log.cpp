@@ -0,0 +1,336 @@
+/// @file binary_log.cpp
+/// @brief 二进制日志实现：调用点注册、记录提交、离线格式化
+#include "binary_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <vector>
+#include "async_logger.h"
+
+namespace ua
+{
+
+namespace
+{
+
+std::mutex& SiteMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<const LogSite*>& SiteTable()
+{
+    static std::vector<const LogSite*> sites;
+    return sites;
+}
+
+const char* PriorityTag(uint8_t priority)
+{
+    static const char* const kTags[] = {"NULL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+    return priority < sizeof(kTags) / sizeof(kTags[0]) ? kTags[priority] : "UNKNOWN";
+}
+
+/// 解码后的参数
+struct DecodedArg
+{
+    uint8_t type = 0;
+    uint64_t value = 0;
+    std::string_view str;
+};
+
+template <typename T>
+void AppendFormat(std::string& out, const std::string& spec, T value)
+{
+    char buf[256];
+    int n = snprintf(buf, sizeof(buf), spec.c_str(), value);
+    if (n < 0)
+        return;
+    if (static_cast<size_t>(n) < sizeof(buf))
+    {
+        out.append(buf, static_cast<size_t>(n));
+        return;
+    }
+    size_t old_size = out.size();
+    out.resize(old_size + static_cast<size_t>(n) + 1);
+    snprintf(out.data() + old_size, static_cast<size_t>(n) + 1, spec.c_str(), value);
+    out.resize(old_size + static_cast<size_t>(n));
+}
+
+int64_t ArgAsInt(const DecodedArg& arg)
+{
+    if (arg.type == BinaryLog::kArgDouble)
+    {
+        double d = 0;
+        std::memcpy(&d, &arg.value, sizeof(d));
+        return static_cast<int64_t>(d);
+    }
+    return static_cast<int64_t>(arg.value);
+}
+
+double ArgAsDouble(const DecodedArg& arg)
+{
+    if (arg.type == BinaryLog::kArgDouble)
+    {
+        double d = 0;
+        std::memcpy(&d, &arg.value, sizeof(d));
+        return d;
+    }
+    if (arg.type == BinaryLog::kArgInt)
+        return static_cast<double>(static_cast<int64_t>(arg.value));
+    return static_cast<double>(arg.value);
+}
+
+/// 按 printf 语法逐个转换说明符格式化，参数类型以记录中的类型为准
+void FormatArgs(const char* fmt, const std::vector<DecodedArg>& args, std::string& out)
+{
+    size_t arg_idx = 0;
+    auto next_arg = [&args, &arg_idx]() -> const DecodedArg* {
+        return arg_idx < args.size() ? &args[arg_idx++] : nullptr;
+    };
+
+    const char* p = fmt;
+    while (*p)
+    {
+        if (*p != '%')
+        {
+            out.push_back(*p++);
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out.push_back('%');
+            p += 2;
+            continue;
+        }
+
+        // 解析 %[flags][width][.precision][length]conv，去掉长度修饰后按实际类型重新拼
+        std::string spec = "%";
+        ++p;
+        while (*p && strchr("-+ #0'", *p))
+            spec.push_back(*p++);
+        if (*p == '*')
+        {
+            const DecodedArg* arg = next_arg();
+            spec += std::to_string(arg ? ArgAsInt(*arg) : 0);
+            ++p;
+        }
+        while (*p >= '0' && *p <= '9')
+            spec.push_back(*p++);
+        if (*p == '.')
+        {
+            spec.push_back(*p++);
+            if (*p == '*')
+            {
+                const DecodedArg* arg = next_arg();
+                spec += std::to_string(arg ? ArgAsInt(*arg) : 0);
+                ++p;
+            }
+            while (*p >= '0' && *p <= '9')
+                spec.push_back(*p++);
+        }
+        while (*p && strchr("hlLqjzt", *p))
+            ++p;
+
+        char conv = *p;
+        if (!conv)
+            break;
+        ++p;
+
+        if (conv == 'n')
+            continue;
+
+        const DecodedArg* arg = next_arg();
+        if (!arg)
+        {
+            out += "<?>";
+            continue;
+        }
+
+        switch (conv)
+        {
+            case 'd':
+            case 'i':
+                AppendFormat(out, spec + "lld", static_cast<long long>(ArgAsInt(*arg)));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec.push_back('l');
+                spec.push_back('l');
+                spec.push_back(conv);
+                AppendFormat(out, spec, static_cast<unsigned long long>(ArgAsInt(*arg)));
+                break;
+            case 'c':
+                AppendFormat(out, spec + "c", static_cast<int>(ArgAsInt(*arg)));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec.push_back(conv);
+                AppendFormat(out, spec, ArgAsDouble(*arg));
+                break;
+            case 'p':
+                AppendFormat(out, spec + "p", reinterpret_cast<void*>(static_cast<uintptr_t>(arg->value)));
+                break;
+            case 's':
+                if (arg->type != BinaryLog::kArgString)
+                    out += std::to_string(ArgAsInt(*arg));
+                else if (spec.size() == 1)
+                    out.append(arg->str);
+                else
+                    AppendFormat(out, spec + "s", std::string(arg->str).c_str());
+                break;
+            default:
+                out.push_back('%');
+                out.push_back(conv);
+                break;
+        }
+    }
+}
+
+}  // namespace
+
+// ==================== LogSiteRegistry ====================
+
+uint32_t LogSiteRegistry::Register(LogSite& site)
+{
+    std::lock_guard<std::mutex> lock(SiteMutex());
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id != 0)
+        return id;
+
+    auto& sites = SiteTable();
+    sites.push_back(&site);
+    id = static_cast<uint32_t>(sites.size());
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+const LogSite* LogSiteRegistry::Get(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(SiteMutex());
+    auto& sites = SiteTable();
+    return id > 0 && id <= sites.size() ? sites[id - 1] : nullptr;
+}
+
+uint32_t LogSiteRegistry::Size()
+{
+    std::lock_guard<std::mutex> lock(SiteMutex());
+    return static_cast<uint32_t>(SiteTable().size());
+}
+
+// ==================== BinaryLog ====================
+
+uint8_t* BinaryLog::GetBuffer()
+{
+    static thread_local uint8_t buffer[kMaxRecordSize];
+    return buffer;
+}
+
+uint64_t BinaryLog::NowMicroSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+void BinaryLog::EncodeString(uint8_t* buf, uint32_t& offset, const char* str, size_t len)
+{
+    if (offset + sizeof(uint32_t) > kMaxRecordSize)
+        return;
+
+    // 放不下时截断
+    size_t left = kMaxRecordSize - offset - sizeof(uint32_t);
+    if (len > left)
+        len = left;
+
+    uint32_t len32 = static_cast<uint32_t>(len);
+    std::memcpy(buf + offset, &len32, sizeof(len32));
+    offset += sizeof(len32);
+    std::memcpy(buf + offset, str, len);
+    offset += len32;
+}
+
+void BinaryLog::Commit(uint8_t priority, const uint8_t* data, uint32_t len)
+{
+    AsyncLogger::GetInst().Write(AsyncLogger::kRecordBinary, priority, data, len);
+}
+
+void BinaryLog::FormatTime(uint64_t time_us, std::string& out)
+{
+    char time_buf[64];
+    time_t sec = static_cast<time_t>(time_us / 1000000);
+    struct tm tm_val;
+    localtime_r(&sec, &tm_val);
+    size_t time_len = strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", &tm_val);
+    snprintf(time_buf + time_len, sizeof(time_buf) - time_len, ".%06lu ",
+             static_cast<unsigned long>(time_us % 1000000));
+    out += time_buf;
+}
+
+bool BinaryLog::Format(uint8_t priority, const char* fmt, const char* file, uint32_t line, const char* func,
+                       const uint8_t* data, uint32_t len, std::string& out)
+{
+    if (len < sizeof(RecordHead) + 1)
+        return false;
+
+    RecordHead head;
+    std::memcpy(&head, data, sizeof(head));
+    uint32_t offset = sizeof(head);
+    uint32_t arg_num = data[offset++];
+    if (arg_num > kMaxArgNum || offset + arg_num > len)
+        return false;
+
+    const uint8_t* types = data + offset;
+    offset += arg_num;
+
+    std::vector<DecodedArg> args;
+    args.reserve(arg_num);
+    for (uint32_t i = 0; i < arg_num; ++i)
+    {
+        DecodedArg arg;
+        arg.type = types[i];
+        if (arg.type == kArgString)
+        {
+            uint32_t str_len = 0;
+            if (offset + sizeof(str_len) > len)
+                break;
+            std::memcpy(&str_len, data + offset, sizeof(str_len));
+            offset += sizeof(str_len);
+            if (offset + str_len > len)
+                break;
+            arg.str = std::string_view(reinterpret_cast<const char*>(data + offset), str_len);
+            offset += str_len;
+        }
+        else
+        {
+            // 编码时被截断的尾部参数解码为缺失
+            if (offset + sizeof(arg.value) > len)
+                break;
+            std::memcpy(&arg.value, data + offset, sizeof(arg.value));
+            offset += sizeof(arg.value);
+        }
+        args.push_back(arg);
+    }
+
+    // 延迟格式化，时间戳取记录时刻
+    FormatTime(head.time_us, out);
+    char prefix[512];
+    int n = snprintf(prefix, sizeof(prefix), "[%s]|%lu|%lu|%s:%u:%s|", PriorityTag(priority),
+                     static_cast<unsigned long>(head.ctx_id), static_cast<unsigned long>(head.uid), file, line, func);
+    if (n > 0)
+        out.append(prefix, std::min(static_cast<size_t>(n), sizeof(prefix) - 1));
+
+    FormatArgs(fmt, args, out);
+    return true;
+}
+
+}  // namespace ua
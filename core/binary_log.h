@@ -0,0 +1,182 @@
+/// @file binary_log.h
+/// @brief 二进制（延迟格式化）日志
+/// @note 热路径只记录: 调用点 id + 时间戳 + 上下文 id + uid + 原始参数字节，不做 vsnprintf
+///       调用点（格式串/文件/行号/函数）为每个 UA_LOG_* 处的静态 LogSite，首次使用时分配 id
+///       记录写入 AsyncLogger 的环形缓冲，由刷盘线程格式化成文本，或原样落盘后用 log_decoder 离线还原
+///       参数编码: [u8 个数][u8 类型 * N][值 * N]，整数/浮点/指针固定 8 字节，字符串为 [u32 长度][字节]
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ua
+{
+
+/// 日志调用点，由日志宏定义为函数内静态变量
+struct LogSite
+{
+    constexpr LogSite(const char* fmt, const char* file, const char* func, uint32_t line, uint8_t priority) noexcept
+        : fmt(fmt), file(file), func(func), line(line), priority(priority)
+    {
+    }
+
+    const char* fmt;
+    const char* file;
+    const char* func;
+    uint32_t line;
+    uint8_t priority;
+    std::atomic<uint32_t> id{0};  // 0 表示尚未注册
+};
+
+/// 进程内调用点表，id 从 1 开始连续分配
+class LogSiteRegistry
+{
+public:
+    /// 注册调用点（并发安全，重复注册返回已有 id）
+    static uint32_t Register(LogSite& site);
+    /// 按 id 查找，不存在返回 nullptr
+    static const LogSite* Get(uint32_t id);
+    static uint32_t Size();
+};
+
+/// 二进制日志编码
+class BinaryLog
+{
+public:
+    /// 参数类型
+    enum ArgType : uint8_t
+    {
+        kArgInt = 1,
+        kArgUint = 2,
+        kArgDouble = 3,
+        kArgString = 4,
+        kArgPointer = 5,
+    };
+
+    /// 记录头
+    struct RecordHead
+    {
+        uint32_t site_id;
+        uint64_t time_us;
+        uint64_t ctx_id;
+        uint64_t uid;
+    } __attribute__((packed));
+
+    static constexpr uint32_t kMaxArgNum = 32;
+    static constexpr uint32_t kMaxRecordSize = 4 * 1024;
+
+    template <typename... Args>
+    static void Write(LogSite& site, uint64_t ctx_id, uint64_t uid, const Args&... args)
+    {
+        uint32_t len = 0;
+        const uint8_t* data = EncodeRecord(len, site, ctx_id, uid, args...);
+        Commit(site.priority, data, len);
+    }
+
+    /// 编码到线程局部缓冲，返回记录首地址，在本线程下一次编码前有效
+    template <typename... Args>
+    static const uint8_t* EncodeRecord(uint32_t& len, LogSite& site, uint64_t ctx_id, uint64_t uid,
+                                       const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= kMaxArgNum, "too many log arguments");
+
+        uint32_t site_id = site.id.load(std::memory_order_acquire);
+        if (site_id == 0)
+            site_id = LogSiteRegistry::Register(site);
+
+        uint8_t* buf = GetBuffer();
+        RecordHead head{site_id, NowMicroSec(), ctx_id, uid};
+        std::memcpy(buf, &head, sizeof(head));
+        uint32_t offset = sizeof(head);
+        buf[offset++] = static_cast<uint8_t>(sizeof...(Args));
+        ((buf[offset++] = TypeOf<Args>()), ...);
+        (Encode(buf, offset, args), ...);
+
+        len = offset;
+        return buf;
+    }
+
+    static uint64_t NowMicroSec();
+    /// 追加 "YYYY-MM-DD HH:MM:SS.uuuuuu " 时间前缀
+    static void FormatTime(uint64_t time_us, std::string& out);
+
+    /// 将一条记录格式化为文本行（不含换行），供刷盘线程和离线解码工具共用
+    /// @return false 表示记录损坏
+    static bool Format(uint8_t priority, const char* fmt, const char* file, uint32_t line, const char* func,
+                       const uint8_t* data, uint32_t len, std::string& out);
+
+private:
+    template <typename T>
+    static constexpr uint8_t TypeOf()
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, const char*> ||
+                      std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>)
+            return kArgString;
+        else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>)
+            return kArgPointer;
+        else if constexpr (std::is_floating_point_v<U>)
+            return kArgDouble;
+        else if constexpr (std::is_enum_v<U>)
+            return std::is_signed_v<std::underlying_type_t<U>> ? kArgInt : kArgUint;
+        else if constexpr (std::is_integral_v<U>)
+            return std::is_signed_v<U> ? kArgInt : kArgUint;
+        else
+            static_assert(sizeof(U) == 0, "unsupported binary log argument type");
+    }
+
+    template <typename T>
+    static void Encode(uint8_t* buf, uint32_t& offset, const T& arg)
+    {
+        using U = std::decay_t<T>;
+        constexpr uint8_t type = TypeOf<T>();
+        if constexpr (type == kArgString)
+        {
+            std::string_view str;
+            if constexpr (std::is_pointer_v<U>)
+            {
+                const char* ptr = arg;
+                str = ptr ? std::string_view(ptr) : std::string_view("(null)");
+            }
+            else
+                str = arg;
+            EncodeString(buf, offset, str.data(), str.size());
+        }
+        else
+        {
+            uint64_t value = 0;
+            if constexpr (type == kArgDouble)
+            {
+                double d = static_cast<double>(arg);
+                std::memcpy(&value, &d, sizeof(d));
+            }
+            else if constexpr (type == kArgPointer)
+                value = reinterpret_cast<uintptr_t>(static_cast<const void*>(arg));
+            else if constexpr (type == kArgInt)
+                value = static_cast<uint64_t>(static_cast<int64_t>(arg));
+            else
+                value = static_cast<uint64_t>(arg);
+            EncodeFixed(buf, offset, value);
+        }
+    }
+
+    static void EncodeFixed(uint8_t* buf, uint32_t& offset, uint64_t value)
+    {
+        // 超长记录时丢弃尾部参数，解码时按缺失参数处理
+        if (offset + sizeof(value) > kMaxRecordSize)
+            return;
+        std::memcpy(buf + offset, &value, sizeof(value));
+        offset += sizeof(value);
+    }
+
+    static void EncodeString(uint8_t* buf, uint32_t& offset, const char* str, size_t len);
+
+    static uint8_t* GetBuffer();
+    static void Commit(uint8_t priority, const uint8_t* data, uint32_t len);
+};
+
+}  // namespace ua
@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include "common/inplace_function.h"
 #include "context_mgr.h"
 
 namespace ua
@@ -18,21 +19,15 @@ namespace ua
 /// 上下文基类
 struct Context
 {
-    /// 自定义回调处理函数
-    using Callback = std::function<void(int32_t)>;
+    /// 自定义回调处理函数（内联存放闭包，超出容量编译报错）
+    using Callback = InplaceFunction<void(int32_t), 48>;
     /// 自定义回收函数
-    using RecycleFun = std::function<void()>;
+    using RecycleFun = InplaceFunction<void(), 48>;
 
     Context() noexcept : id(auto_counter_.fetch_add(1, std::memory_order_relaxed)) {}
     virtual ~Context() = default;
 
-    void SetCallback(const Callback& cb, const RecycleFun& fun = nullptr)
-    {
-        callback_ = cb;
-        recycle_ = fun;
-    }
-
-    void SetCallback(Callback&& cb, RecycleFun&& fun = nullptr) noexcept
+    void SetCallback(Callback cb, RecycleFun fun = nullptr) noexcept
     {
         callback_ = std::move(cb);
         recycle_ = std::move(fun);
@@ -80,6 +75,9 @@ struct ServerContext : public Context
     uint64_t gid = 0;
     uint16_t pkg_flag = 0;
     uint32_t svr_version = 0;  // 改进: 修正拼写 svr_verison -> svr_version
+    uint64_t trace_id = 0;     // 所属 trace（上游传入或本地采样生成），见 SpanTracer
+    uint64_t span_id = 0;      // 本请求的 span id，非 0 表示被采样
+    uint64_t sched_seq = 0;    // 经调度器派发时的 seq，处理完 OnResponse(gid, seq) 带回
 };
 
 /// 客户端上下文 —— 主调侧，一个 RPC 对应一个
@@ -91,16 +89,17 @@ struct ClientContext : public Context
     }
     ~ClientContext() override = default;
 
-    uint32_t timer_id = 0;
     ServerContext* server_ctx = nullptr;
 };
 
 /// 异步任务封装：回调 + 回收 + 阻塞（三合一）
+/// 面向业务的接口，保留 std::function；Pending 时移动进挂起上下文的回调
+/// 闭包超过 std::function 的小对象缓冲（16 字节）会分配，框架内部只放指针闭包，状态放在池化的客户端上下文里
 struct AsyncTask
 {
     using RpcCallback = std::function<void(int32_t, ServerContext*)>;
     using BlockingCallBack = std::function<void()>;
-    using RecycleCallBack = Context::RecycleFun;
+    using RecycleCallBack = std::function<void()>;
 
     AsyncTask(std::nullptr_t) noexcept {}
 
@@ -1,14 +1,17 @@
 /// @file context_controller.cpp
 /// @brief 上下文控制器实现（C++20 重写版）
-/// @note 改进: insert 失败时取消定时器并返回错误
+/// @note 改进: 挂起失败时返回错误
 ///       改进: Init 接受 ICoroutine* 参数
+#define UA_LOG_MODULE ua::kLogModuleCore  // 框架日志单独归类，可按模块调级别
 #include "context_controller.h"
+#include <utility>
 #include "common/clock.h"
-#include "common/id_generator.h"
 #include "coro_mgr.h"
+#include "flight_recorder.h"
 #include "logger.h"
 #include "rpc_error.h"
 #include "server_statistics.h"
+#include "span_tracer.h"
 
 namespace ua
 {
@@ -18,6 +21,7 @@ bool ContextController::Init(ICoroutine* coroutine) noexcept
     if (!init_)
     {
         use_coroutine_ = (coroutine != nullptr);
+        stack_shared_ = coroutine && coroutine->StackShared();
         init_ = true;
     }
     return true;
@@ -25,39 +29,50 @@ bool ContextController::Init(ICoroutine* coroutine) noexcept
 
 uint32_t ContextController::ProcTimeOut(uint64_t now)
 {
-    return timeout_queue_.TimeOut(now);
+    expired_.clear();
+    pending_table_.Expire(now, expired_);
+    uint32_t count = 0;
+    for (uint64_t seq_id : expired_)
+    {
+        // 前面的超时回调里可能已经唤醒了后面的
+        if (!pending_table_.Contains(seq_id))
+            continue;
+        auto* client_ctx = Awake(seq_id, RPC_TIME_OUT);
+        if (client_ctx)
+            client_ctx->Run();
+        ++count;
+    }
+    return count;
+}
+
+uint64_t ContextController::AllocSeqID(uint32_t timeout)
+{
+    return pending_table_.Reserve(Clock::GetInst().CurrentMilliSec() + timeout);
 }
 
 ClientContext* ContextController::Awake(uint64_t seq_id, int32_t ret_code)
 {
-    auto iter = context_cache_.find(seq_id);
-    if (iter == context_cache_.end())
+    // 迟到（已超时）或重复的回包：槽已释放，代数不符
+    auto* client_ctx = pending_table_.Remove(seq_id);
+    if (!client_ctx)
     {
         UA_LOG_WARN(0, "cache can not find seq_id(%lu), ret(%d)", seq_id, ret_code);
         return nullptr;
     }
 
-    auto* client_ctx = iter->second;
-    assert(client_ctx);
-    context_cache_.erase(iter);
-
-    if (ret_code != RPC_TIME_OUT)
-    {
-        timeout_queue_.Cancel(client_ctx->timer_id);
-    }
-    else
-    {
+    if (ret_code == RPC_TIME_OUT)
         ServerStatistics::GetInst().statistics().inc_rpc_time_out_num();
-    }
 
-    UA_LOG_TRACE(0, "seq_id(%lu) awake, timer_id(%u), ret(%d)", seq_id, client_ctx->timer_id, ret_code);
+    UA_LOG_TRACE(0, "seq_id(%lu) awake, ret(%d)", seq_id, ret_code);
+    FlightRecorder::RecordEvent(ret_code == RPC_TIME_OUT ? FlightEvent::kRpcTimeout : FlightEvent::kAwake,
+                                client_ctx->server_ctx ? client_ctx->server_ctx->gid : 0, seq_id, 0, ret_code);
+    SpanTracer::End(SpanTracer::Ref(client_ctx->server_ctx), "rpc_wait", static_cast<uint64_t>(ret_code));
 
     client_ctx->ret_code = ret_code;
-    client_ctx->timer_id = 0;
     return client_ctx;
 }
 
-int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx, const AsyncTask& task)
+int32_t ContextController::AddPending(uint64_t& seq_id, uint32_t timeout, ClientContext* client_ctx)
 {
     if (!client_ctx)
     {
@@ -65,38 +80,43 @@ int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientCont
         return RPC_SYS_ERR;
     }
 
-    if (seq_id == 0)
-        seq_id = IDGenerator::GetInst().GenerateSeqID();
-
     uint64_t expire_time = Clock::GetInst().CurrentMilliSec() + timeout;
-    uint64_t timer_id = timeout_queue_.Add(
-        [this, seq_id](uint64_t /*timer_id*/, uint32_t /*interval_time*/) {
-            auto* tmp_context = Awake(seq_id, RPC_TIME_OUT);
-            if (tmp_context)
-                tmp_context->Run();
-        },
-        expire_time);
-
-    if (timer_id == 0)
+    if (!pending_table_.Add(seq_id, client_ctx, expire_time))
     {
-        UA_LOG_ERROR(0, "add context timer error seq_id(%lu)", seq_id);
+        // 改进: 重复挂起或预留已失效时返回错误而非 SUCCESS
+        UA_LOG_ERROR(0, "pending table add error, seq_id(%lu)", seq_id);
         return RPC_SYS_ERR;
     }
 
-    client_ctx->timer_id = static_cast<uint32_t>(timer_id);
+    UA_LOG_TRACE(0, "seq_id(%lu) pending, expire_time(%lu)", seq_id, expire_time);
+    FlightRecorder::RecordEvent(FlightEvent::kPending, client_ctx->server_ctx ? client_ctx->server_ctx->gid : 0,
+                                seq_id, 0, 0, timeout);
+    SpanTracer::Begin(SpanTracer::Ref(client_ctx->server_ctx), "rpc_wait", seq_id);
+    ServerStatistics::GetInst().statistics().save_max_coro_pending_num_max(
+        static_cast<uint32_t>(PendingContextNum()));
+    return RPC_SUCCESS;
+}
 
-    auto [_, ok] = context_cache_.emplace(seq_id, client_ctx);
-    if (!ok)
+int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx, AsyncTask task)
+{
+    // 协程模式下直接在主栈上执行的处理函数（标记为非阻塞）不能 Yield
+    // PBService::Rpc 在发包前已做同样的检查，这里是其他调用方的兜底（此时请求可能已发出）
+    if (UseCoroutine() && !(task.callback && task.blocking_fun) && !CoroMgr::ThisCoro())
     {
-        // 改进: insert 失败时取消刚添加的定时器，返回错误而非 SUCCESS
-        timeout_queue_.Cancel(timer_id);
-        UA_LOG_ERROR(0, "context_cache insert error, seq_id(%lu)", seq_id);
+        UA_LOG_ERROR(client_ctx && client_ctx->server_ctx ? client_ctx->server_ctx->gid : 0,
+                     "pending outside coroutine, seq_id(%lu), handler marked non-blocking?", seq_id);
+        assert(false && "pending outside coroutine");
+        pending_table_.Release(seq_id);
         return RPC_SYS_ERR;
     }
 
-    UA_LOG_TRACE(0, "seq_id(%lu) pending, timer_id(%lu), expire_time(%lu)", seq_id, timer_id, expire_time);
-    ServerStatistics::GetInst().statistics().save_max_coro_pending_num_max(
-        static_cast<uint32_t>(PendingContextNum()));
+    int32_t ret = AddPending(seq_id, timeout, client_ctx);
+    if (ret != RPC_SUCCESS)
+    {
+        pending_table_.Release(seq_id);
+        return ret;
+    }
+    SpanRef span = SpanTracer::Ref(client_ctx->server_ctx);
 
     if (UseCoroutine())
     {
@@ -105,24 +125,37 @@ int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientCont
         if (task.callback && task.blocking_fun)
         {
             client_ctx->SetCallback(
-                [=, cb = task.callback](int32_t ret_code) { cb(ret_code, server_ctx); },
-                task.recycle_fun);
+                [=, cb = std::move(task.callback)](int32_t ret_code) { cb(ret_code, server_ctx); },
+                std::move(task.recycle_fun));
             ContextMgr::SetCurrServerContext(nullptr);
+            SpanTracer::Instant(span, "yield", seq_id);
             task.blocking_fun();
+            SpanTracer::Instant(span, "resume", seq_id);
         }
         else
         {
             // 协程模式：Yield/Resume
             Coro* coro = CoroMgr::ThisCoro();
-            assert(coro);
-            client_ctx->SetCallback(
-                [=, cb = task.callback](int32_t ret_code) {
-                    if (cb)
-                        cb(ret_code, server_ctx);
-                },
-                [coro]() { coro->Resume(); });
+            if (stack_shared_)
+            {
+                // 共享栈：挂起期间栈上的对象（回调捕获的 rsp 等）被换出，回调推迟到恢复后在协程内执行
+                client_ctx->SetCallback([](int32_t) {}, [coro]() { coro->Resume(); });
+            }
+            else
+            {
+                client_ctx->SetCallback(
+                    [=, cb = std::move(task.callback)](int32_t ret_code) {
+                        if (cb)
+                            cb(ret_code, server_ctx);
+                    },
+                    [coro]() { coro->Resume(); });
+            }
             ContextMgr::SetCurrServerContext(nullptr);
+            SpanTracer::Instant(span, "yield", seq_id);
             coro->Yield();
+            SpanTracer::Instant(span, "resume", seq_id);
+            if (stack_shared_ && task.callback)
+                task.callback(client_ctx->ret_code, server_ctx);
         }
         ContextMgr::SetCurrServerContext(server_ctx);
     }
@@ -132,7 +165,7 @@ int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientCont
         auto* server_ctx = client_ctx->server_ctx;
         assert(server_ctx);
         client_ctx->SetCallback(
-            [=, cb = task.callback](int32_t ret_code) {
+            [=, cb = std::move(task.callback)](int32_t ret_code) {
                 server_ctx->to_be_continue = false;
                 ContextMgr::SetCurrServerContext(server_ctx);
                 if (cb)
@@ -140,7 +173,7 @@ int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientCont
                 if (server_ctx->IsFinish())
                     server_ctx->Run();
             },
-            task.recycle_fun);
+            std::move(task.recycle_fun));
 
         server_ctx->to_be_continue = true;
         ContextMgr::SetCurrServerContext(nullptr);
@@ -149,6 +182,38 @@ int32_t ContextController::Pending(uint64_t seq_id, uint32_t timeout, ClientCont
     return RPC_SUCCESS;
 }
 
+int32_t ContextController::PendingAsync(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx,
+                                        std::coroutine_handle<> handle)
+{
+    int32_t ret = AddPending(seq_id, timeout, client_ctx);
+    if (ret != RPC_SUCCESS)
+    {
+        pending_table_.Release(seq_id);
+        return ret;
+    }
+    // 唤醒时只恢复协程，回包处理在协程内 co_await 返回之后进行
+    client_ctx->SetCallback([](int32_t) {}, [handle]() { handle.resume(); });
+    SpanTracer::Instant(SpanTracer::Ref(client_ctx->server_ctx), "yield", seq_id);
+    ContextMgr::SetCurrServerContext(nullptr);
+    return RPC_SUCCESS;
+}
+
+bool ContextController::PendingAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    ret_ = ctrl_.PendingAsync(seq_id_, timeout_, client_ctx_, handle);
+    // 挂起失败时不挂起，直接返回错误码
+    return ret_ == RPC_SUCCESS;
+}
+
+int32_t ContextController::PendingAwaiter::await_resume() const
+{
+    if (ret_ != RPC_SUCCESS)
+        return ret_;
+    ContextMgr::SetCurrServerContext(client_ctx_->server_ctx);
+    SpanTracer::Instant(SpanTracer::Ref(client_ctx_->server_ctx), "resume", seq_id_);
+    return client_ctx_->ret_code;
+}
+
 bool ContextController::UseCoroutine() const noexcept
 {
     return use_coroutine_;
@@ -156,7 +221,7 @@ bool ContextController::UseCoroutine() const noexcept
 
 size_t ContextController::PendingContextNum() const noexcept
 {
-    return context_cache_.size();
+    return pending_table_.PendingNum();
 }
 
 size_t ContextController::PendingCoroutineNum() const noexcept
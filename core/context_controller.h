@@ -2,11 +2,13 @@
 /// @brief 上下文控制器（C++20 重写版）
 /// @note 支持协程/异步双模式上下文切换
 ///       改进: Init 参数改为 ICoroutine*，避免隐式 bool 转换
+///       挂起表见 PendingTable：发包前用 AllocSeqID 取号，回包按 seq_id 直接定位槽，超时走粗粒度时间轮
 #pragma once
 
-#include <unordered_map>
-#include "common/timeout_queue.h"
+#include <coroutine>
+#include <vector>
 #include "context.h"
+#include "pending_table.h"
 
 namespace ua
 {
@@ -20,23 +22,67 @@ public:
     bool Init(ICoroutine* coroutine) noexcept;
     /// 处理定时器超时
     uint32_t ProcTimeOut(uint64_t now);
+    /// 最近一个挂起上下文的超时时间，没有返回 0
+    [[nodiscard]] uint64_t NextExpireTime() const noexcept { return pending_table_.NextExpireTime(); }
+    /// 为即将发出的请求取 seq_id（预留挂起表的槽），之后以该 seq_id 调用 Pending
+    /// 发送失败可 ReleaseSeqID，不释放则 timeout 后自动回收
+    [[nodiscard]] uint64_t AllocSeqID(uint32_t timeout);
+    void ReleaseSeqID(uint64_t seq_id) noexcept { pending_table_.Release(seq_id); }
     /// 挂起当前上下文
+    /// seq_id 为 0 时分配；非 AllocSeqID 取得的 seq_id 也可使用，但要多一次哈希查找
     /// 改进: insert 失败时返回错误而非 SUCCESS
-    int32_t Pending(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx, const AsyncTask& task);
+    /// task 按值接收，回调和回收函数移动进 client_ctx；传右值可省去 std::function 的拷贝（及其可能的分配）
+    int32_t Pending(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx, AsyncTask task);
+    /// 挂起 C++20 协程（见 task.h），唤醒或超时时恢复 handle；失败返回错误码且不会恢复
+    /// 与 ICoroutine 无关，非协程模式下也可以使用
+    int32_t PendingAsync(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx, std::coroutine_handle<> handle);
+
+    /// co_await PendingAwait(...) 挂起当前 C++20 协程，结果为 Awake 的 ret_code（或挂起失败的错误码）
+    /// client_ctx 需在恢复前一直有效（放在协程帧里即可）
+    class PendingAwaiter
+    {
+    public:
+        PendingAwaiter(ContextController& ctrl, uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx) noexcept
+            : ctrl_(ctrl), client_ctx_(client_ctx), seq_id_(seq_id), timeout_(timeout)
+        {
+        }
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        int32_t await_resume() const;
+
+    private:
+        ContextController& ctrl_;
+        ClientContext* client_ctx_;
+        uint64_t seq_id_;
+        uint32_t timeout_;
+        int32_t ret_ = 0;
+    };
+    [[nodiscard]] PendingAwaiter PendingAwait(uint64_t seq_id, uint32_t timeout, ClientContext* client_ctx) noexcept
+    {
+        return PendingAwaiter(*this, seq_id, timeout, client_ctx);
+    }
+
     /// 唤醒挂起的上下文
     ClientContext* Awake(uint64_t seq_id, int32_t ret_code);
     /// 是否使用协程模式
     [[nodiscard]] bool UseCoroutine() const noexcept;
+    /// 协程是否共享栈：挂起期间协程栈上的对象不可访问，挂起的 ClientContext 需放在堆上
+    [[nodiscard]] bool StackShared() const noexcept { return stack_shared_; }
     /// 挂起的上下文数量
     [[nodiscard]] size_t PendingContextNum() const noexcept;
     /// 挂起的协程数量
     [[nodiscard]] size_t PendingCoroutineNum() const noexcept;
 
 private:
-    TimeoutQueue timeout_queue_;
-    std::unordered_map<uint64_t, ClientContext*> context_cache_;
+    /// 放入挂起表并计时，seq_id 为 0 时分配
+    int32_t AddPending(uint64_t& seq_id, uint32_t timeout, ClientContext* client_ctx);
+
+    PendingTable pending_table_;
+    std::vector<uint64_t> expired_;  // ProcTimeOut 复用的缓冲
     bool init_ = false;
     bool use_coroutine_ = false;
+    bool stack_shared_ = false;
 };
 
 }  // namespace ua
@@ -0,0 +1,169 @@
+/// @file coro_context.cpp
+/// @brief 协程上下文切换实现
+#include "coro_context.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define UA_CORO_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define UA_CORO_ASAN 1
+#endif
+#endif
+#ifdef UA_CORO_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+
+extern "C" void ua_coro_trampoline();
+
+namespace ua
+{
+
+void CoroUnpoisonStack([[maybe_unused]] const void* low, [[maybe_unused]] size_t size) noexcept
+{
+#ifdef UA_CORO_ASAN
+    ASAN_UNPOISON_MEMORY_REGION(low, size);
+#endif
+}
+
+}  // namespace ua
+
+#if defined(__x86_64__)
+
+// 栈布局（从 sp 往高地址）: x87 控制字, mxcsr, r15, r14, r13, r12, rbx, rbp, 返回地址
+asm(R"(
+    .text
+    .globl ua_coro_switch
+    .hidden ua_coro_switch
+    .type ua_coro_switch, @function
+    .p2align 4
+ua_coro_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $16, %rsp
+    stmxcsr 8(%rsp)
+    fnstcw (%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr 8(%rsp)
+    fldcw (%rsp)
+    addq $16, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size ua_coro_switch, .-ua_coro_switch
+
+    .globl ua_coro_trampoline
+    .hidden ua_coro_trampoline
+    .type ua_coro_trampoline, @function
+    .p2align 4
+ua_coro_trampoline:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size ua_coro_trampoline, .-ua_coro_trampoline
+)");
+
+namespace ua
+{
+
+void* CoroMakeContext(char* stack_high, CoroEntryFunc entry, void* arg) noexcept
+{
+    // ret 之后 rsp 16 字节对齐，trampoline 里 call 进入 entry 时与普通函数调用一致
+    auto top = reinterpret_cast<uintptr_t>(stack_high) & ~uintptr_t{15};
+    top -= 16;
+    auto* frame = reinterpret_cast<uint64_t*>(top - 72);
+
+    uint32_t mxcsr = 0;
+    uint16_t fpu_cw = 0;
+    asm volatile("stmxcsr %0" : "=m"(mxcsr));
+    asm volatile("fnstcw %0" : "=m"(fpu_cw));
+
+    std::memset(frame, 0, 72);
+    std::memcpy(&frame[0], &fpu_cw, sizeof(fpu_cw));
+    std::memcpy(&frame[1], &mxcsr, sizeof(mxcsr));
+    frame[4] = reinterpret_cast<uint64_t>(entry);  // r13
+    frame[5] = reinterpret_cast<uint64_t>(arg);    // r12
+    frame[8] = reinterpret_cast<uint64_t>(&ua_coro_trampoline);
+    return frame;
+}
+
+}  // namespace ua
+
+#elif defined(__aarch64__)
+
+// 栈布局（从 sp 往高地址）: x19-x28, x29, x30, d8-d15，共 160 字节
+asm(R"(
+    .text
+    .globl ua_coro_switch
+    .hidden ua_coro_switch
+    .type ua_coro_switch, %function
+    .p2align 4
+ua_coro_switch:
+    sub sp, sp, #160
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mov x9, sp
+    str x9, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    add sp, sp, #160
+    ret
+    .size ua_coro_switch, .-ua_coro_switch
+
+    .globl ua_coro_trampoline
+    .hidden ua_coro_trampoline
+    .type ua_coro_trampoline, %function
+    .p2align 4
+ua_coro_trampoline:
+    mov x0, x19
+    blr x20
+    brk #0
+    .size ua_coro_trampoline, .-ua_coro_trampoline
+)");
+
+namespace ua
+{
+
+void* CoroMakeContext(char* stack_high, CoroEntryFunc entry, void* arg) noexcept
+{
+    auto top = reinterpret_cast<uintptr_t>(stack_high) & ~uintptr_t{15};
+    auto* frame = reinterpret_cast<uint64_t*>(top - 160);
+    std::memset(frame, 0, 160);
+    frame[0] = reinterpret_cast<uint64_t>(arg);    // x19
+    frame[1] = reinterpret_cast<uint64_t>(entry);  // x20
+    frame[11] = reinterpret_cast<uint64_t>(&ua_coro_trampoline);  // x30
+    return frame;
+}
+
+}  // namespace ua
+
+#else
+#error "coro_context: unsupported architecture (x86-64 / aarch64 only)"
+#endif
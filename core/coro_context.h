@@ -0,0 +1,27 @@
+/// @file coro_context.h
+/// @brief 协程上下文切换（手写汇编，只保存被调用者保存寄存器）
+/// @note x86-64: rbx rbp r12-r15 + mxcsr / x87 控制字；aarch64: x19-x29 lr + d8-d15
+///       上下文就是切出时的栈指针，寄存器压在各自的栈上；不改信号掩码，没有系统调用
+///       ASan 不感知切栈，复用的栈和共享栈换入换出前后要 CoroUnpoisonStack 清掉残留的红区标记
+#pragma once
+
+#include <cstddef>
+
+extern "C" {
+/// 保存当前上下文到 *from_sp，切换到 to_sp
+void ua_coro_switch(void** from_sp, void* to_sp);
+}
+
+namespace ua
+{
+
+using CoroEntryFunc = void (*)(void*);
+
+/// 在 [.., stack_high) 上构造初始帧，第一次切入时调用 entry(arg)；entry 不能返回（结束时切走）
+/// 返回可传给 ua_coro_switch 的栈指针
+void* CoroMakeContext(char* stack_high, CoroEntryFunc entry, void* arg) noexcept;
+
+/// 清除 [low, low + size) 在 ASan 中的 poison 标记，未开启 ASan 时为空操作
+void CoroUnpoisonStack(const void* low, size_t size) noexcept;
+
+}  // namespace ua
@@ -30,7 +30,8 @@ public:
     }
 
 private:
-    inline static ICoroutine* coroutine_ = nullptr;
+    /// 线程级，分片运行时下每个工作线程各有一个协程插件
+    inline static thread_local ICoroutine* coroutine_ = nullptr;
 };
 
 }  // namespace ua
@@ -0,0 +1,99 @@
+/// @file coro_stack_pool.cpp
+/// @brief 协程栈池实现
+#include "coro_stack_pool.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "coro_context.h"
+#include "logger.h"
+
+namespace ua
+{
+
+CoroStackPool::~CoroStackPool()
+{
+    for (auto& stacks : free_stacks_)
+    {
+        for (auto& stack : stacks)
+            Unmap(stack);
+        stacks.clear();
+    }
+}
+
+bool CoroStackPool::Alloc(size_t size, Stack& stack)
+{
+    uint32_t size_class = 0;
+    while (size_class < kClassNum && ClassSize(size_class) < size)
+        ++size_class;
+    if (size_class == kClassNum)
+    {
+        UA_LOG_ERROR(0, "coroutine stack size %zu too large", size);
+        return false;
+    }
+
+    auto& stacks = free_stacks_[size_class];
+    if (!stacks.empty())
+    {
+        stack = stacks.back();
+        stacks.pop_back();
+        ++used_num_;
+        return true;
+    }
+
+    static const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t map_size = ClassSize(size_class) + kPageSize;
+    void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "mmap coroutine stack failed, size %zu: %s", map_size, strerror(errno));
+        return false;
+    }
+    // 栈向低地址增长，保护页放在最低处
+    if (mprotect(addr, kPageSize, PROT_NONE) != 0)
+    {
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "mprotect coroutine stack guard failed: %s", strerror(errno));
+        munmap(addr, map_size);
+        return false;
+    }
+
+    stack.base = static_cast<char*>(addr);
+    stack.map_size = map_size;
+    stack.low = stack.base + kPageSize;
+    stack.size = ClassSize(size_class);
+    stack.size_class = static_cast<uint8_t>(size_class);
+    // 新映射可能落在已退出线程的栈地址上，ASan 的旧标记还在
+    CoroUnpoisonStack(stack.low, stack.size);
+    mapped_bytes_ += map_size;
+    ++used_num_;
+    return true;
+}
+
+void CoroStackPool::Free(Stack& stack)
+{
+    if (!stack.valid())
+        return;
+    --used_num_;
+    auto& stacks = free_stacks_[stack.size_class];
+    if (stacks.size() < max_free_per_class_)
+        stacks.push_back(stack);
+    else
+        Unmap(stack);
+    stack = Stack{};
+}
+
+void CoroStackPool::Unmap(Stack& stack)
+{
+    munmap(stack.base, stack.map_size);
+    mapped_bytes_ -= stack.map_size;
+}
+
+size_t CoroStackPool::FreeNum() const noexcept
+{
+    size_t num = 0;
+    for (const auto& stacks : free_stacks_)
+        num += stacks.size();
+    return num;
+}
+
+}  // namespace ua
@@ -0,0 +1,63 @@
+/// @file coro_stack_pool.h
+/// @brief 协程栈池：mmap 分配、底部保护页、按大小分级复用
+/// @note 栈大小按 2 的幂分级（16KB ~ 8MB），释放的栈挂到对应级别的空闲链表，下次同级别分配直接复用，不再 mmap；
+///       每个栈最低处一页 PROT_NONE，栈溢出直接段错误而不是踩坏相邻内存
+///       使用 MAP_NORESERVE，未触及的栈页不占物理内存
+///       非线程安全，每个线程的协程实现各用一个
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ua
+{
+
+class CoroStackPool
+{
+public:
+    struct Stack
+    {
+        char* base = nullptr;    // mmap 起始地址（含保护页）
+        size_t map_size = 0;     // mmap 总大小
+        char* low = nullptr;     // 可用栈的低地址（保护页之上）
+        size_t size = 0;         // 可用栈大小
+        uint8_t size_class = 0;
+
+        [[nodiscard]] char* high() const noexcept { return low + size; }
+        [[nodiscard]] bool valid() const noexcept { return base != nullptr; }
+    };
+
+    static constexpr uint32_t kMinClassShift = 14;  // 16KB
+    static constexpr uint32_t kClassNum = 10;       // 16KB .. 8MB
+
+    explicit CoroStackPool(size_t max_free_per_class = 4096) : max_free_per_class_(max_free_per_class) {}
+    ~CoroStackPool();
+    CoroStackPool(const CoroStackPool&) = delete;
+    CoroStackPool& operator=(const CoroStackPool&) = delete;
+
+    /// 按 size 向上取级别分配，失败返回 false
+    bool Alloc(size_t size, Stack& stack);
+    /// 归还，空闲链表超过上限时直接 munmap
+    void Free(Stack& stack);
+
+    [[nodiscard]] static size_t ClassSize(uint32_t size_class) noexcept
+    {
+        return size_t{1} << (size_class + kMinClassShift);
+    }
+    /// 当前 mmap 的总字节数（含空闲栈和保护页）
+    [[nodiscard]] size_t MappedBytes() const noexcept { return mapped_bytes_; }
+    [[nodiscard]] size_t UsedNum() const noexcept { return used_num_; }
+    [[nodiscard]] size_t FreeNum() const noexcept;
+
+private:
+    void Unmap(Stack& stack);
+
+    size_t max_free_per_class_;
+    std::array<std::vector<Stack>, kClassNum> free_stacks_;
+    size_t mapped_bytes_ = 0;
+    size_t used_num_ = 0;
+};
+
+}  // namespace ua
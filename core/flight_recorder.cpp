@@ -0,0 +1,426 @@
+/// @file flight_recorder.cpp
+/// @brief 共享内存飞行记录器实现
+/// @note 映射文件布局: [FlightShmHeader][FlightSiteEntry * max_site_num][字符串区][UnfixedRingBuf<0>]
+///       环形缓冲中每条记录为 [u8 类型][u8 优先级][负载]，满时覆盖最旧的记录
+#include "flight_recorder.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "common/utils.h"
+#include "containers/unfixed_ring_buf.h"
+
+namespace ua
+{
+
+namespace
+{
+
+struct FlightShmHeader
+{
+    static constexpr uint32_t kMagic = 0x55414652;  // "UAFR"
+    static constexpr uint32_t kVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pid;
+    uint32_t max_site_num;
+    uint32_t str_arena_size;
+    uint32_t str_used;
+    uint64_t ring_mem_size;  // 含 UnfixedRingBuf 头
+    uint64_t init_ms;
+    std::atomic<uint64_t> write_num;
+    /// 跨进程自旋锁，崩溃时若持有则导出方忽略它
+    std::atomic<uint32_t> lock;
+    uint32_t reserved;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "共享内存自旋锁需要无锁原子量");
+
+/// 调用点表项，下标为 LogSiteRegistry 分配的 id，字符串以偏移存放在字符串区
+struct FlightSiteEntry
+{
+    uint32_t fmt_off;
+    uint32_t file_off;
+    uint32_t func_off;
+    uint32_t line;
+    uint8_t priority;
+    uint8_t valid;
+    uint8_t reserved[2];
+};
+
+/// 一条记录的类型头
+struct FlightRecordHead
+{
+    uint8_t kind;
+    uint8_t priority;
+};
+
+size_t MapSize(uint32_t max_site_num, uint32_t str_arena_size, uint64_t ring_mem_size)
+{
+    return sizeof(FlightShmHeader) + sizeof(FlightSiteEntry) * max_site_num + str_arena_size + ring_mem_size;
+}
+
+/// 进程内状态，由 FlightRecorder::Init/Close 维护
+FlightShmHeader* g_header = nullptr;
+FlightSiteEntry* g_sites = nullptr;
+char* g_str_arena = nullptr;
+size_t g_map_size = 0;
+UnfixedRingBuf<0> g_ring;
+/// 调用点是否已登记到共享内存，避免每条日志都加锁检查
+std::atomic<bool> g_site_written[FlightRecorder::kMaxSiteNum];
+
+class ShmSpinLock
+{
+public:
+    explicit ShmSpinLock(std::atomic<uint32_t>& lock) noexcept : lock_(lock)
+    {
+        while (lock_.exchange(1, std::memory_order_acquire) != 0)
+        {
+            while (lock_.load(std::memory_order_relaxed) != 0)
+                std::this_thread::yield();
+        }
+    }
+    ~ShmSpinLock() { lock_.store(0, std::memory_order_release); }
+
+private:
+    std::atomic<uint32_t>& lock_;
+};
+
+bool LoadFile(const std::string& path, std::vector<char>& content, std::string* err_msg)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        if (err_msg)
+        {
+            *err_msg += "open file failed, error: ";
+            *err_msg += strerror(errno);
+        }
+        return false;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(FlightShmHeader)))
+    {
+        if (err_msg)
+            *err_msg += "file too small, maybe recorder not init";
+        close(fd);
+        return false;
+    }
+
+    content.resize(static_cast<size_t>(file_stat.st_size));
+    size_t offset = 0;
+    while (offset < content.size())
+    {
+        ssize_t n = pread(fd, content.data() + offset, content.size() - offset, static_cast<off_t>(offset));
+        if (n <= 0)
+        {
+            if (err_msg)
+                *err_msg += "read file failed";
+            close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    close(fd);
+    return true;
+}
+
+/// 取字符串区中的字符串，越界返回 nullptr
+const char* ArenaString(const char* arena, uint32_t arena_size, uint32_t offset)
+{
+    if (offset >= arena_size)
+        return nullptr;
+    const char* str = arena + offset;
+    return memchr(str, '\0', arena_size - offset) ? str : nullptr;
+}
+
+/// 导出一份内存快照，快照会被修改（弹出环形缓冲）
+int64_t DumpMem(char* mem, size_t size, FILE* out, std::string* err_msg)
+{
+    auto* header = reinterpret_cast<FlightShmHeader*>(mem);
+    if (header->magic != FlightShmHeader::kMagic || header->version != FlightShmHeader::kVersion ||
+        MapSize(header->max_site_num, header->str_arena_size, header->ring_mem_size) != size)
+    {
+        if (err_msg)
+            *err_msg += "header magic/version/size not match";
+        return -1;
+    }
+
+    auto* sites = reinterpret_cast<const FlightSiteEntry*>(mem + sizeof(FlightShmHeader));
+    const char* arena = reinterpret_cast<const char*>(sites + header->max_site_num);
+    char* ring_mem = const_cast<char*>(arena) + header->str_arena_size;
+
+    UnfixedRingBuf<0> ring;
+    if (!ring.init(ring_mem, header->ring_mem_size, true))
+    {
+        if (err_msg)
+            *err_msg += "ring buffer head broken";
+        return -1;
+    }
+
+    fprintf(out, "# flight recorder pid %u, init_ms %lu, total written %lu, kept %zu\n", header->pid,
+            static_cast<unsigned long>(header->init_ms),
+            static_cast<unsigned long>(header->write_num.load(std::memory_order_relaxed)), ring.get_num());
+    if (header->lock.load(std::memory_order_relaxed) != 0)
+        fprintf(out, "# writer was holding the lock, the last record may be partial\n");
+
+    int64_t count = 0;
+    std::string line;
+    while (!ring.empty())
+    {
+        size_t len = 0;
+        const uint8_t* item = ring.front(len);
+        if (!item || len < sizeof(FlightRecordHead) || len > ring.size())
+        {
+            fprintf(out, "# ring buffer broken, stop\n");
+            break;
+        }
+
+        FlightRecordHead head;
+        std::memcpy(&head, item, sizeof(head));
+        const uint8_t* data = item + sizeof(head);
+        auto data_len = static_cast<uint32_t>(len - sizeof(head));
+
+        line.clear();
+        if (head.kind == FlightRecorder::kRecordLog && data_len >= sizeof(BinaryLog::RecordHead))
+        {
+            BinaryLog::RecordHead log_head;
+            std::memcpy(&log_head, data, sizeof(log_head));
+            const FlightSiteEntry* site =
+                log_head.site_id < header->max_site_num && sites[log_head.site_id].valid ? &sites[log_head.site_id]
+                                                                                        : nullptr;
+            const char* fmt = site ? ArenaString(arena, header->str_arena_size, site->fmt_off) : nullptr;
+            const char* file = site ? ArenaString(arena, header->str_arena_size, site->file_off) : nullptr;
+            const char* func = site ? ArenaString(arena, header->str_arena_size, site->func_off) : nullptr;
+            if (!fmt || !file || !func ||
+                !BinaryLog::Format(head.priority, fmt, file, site->line, func, data, data_len, line))
+            {
+                line.clear();
+                BinaryLog::FormatTime(log_head.time_us, line);
+                line += "[UNKNOWN]|site " + std::to_string(log_head.site_id);
+            }
+        }
+        else if (head.kind == FlightRecorder::kRecordEvent && data_len == sizeof(FlightEventRecord))
+        {
+            FlightEventRecord event;
+            std::memcpy(&event, data, sizeof(event));
+            BinaryLog::FormatTime(event.time_us, line);
+            char buf[256];
+            int n = snprintf(buf, sizeof(buf), "[EVENT]|%s|%lu|seq_id(%lu)|cmd(%u)|ret(%d)|extra(%u)",
+                             FlightRecorder::EventName(event.event), static_cast<unsigned long>(event.gid),
+                             static_cast<unsigned long>(event.seq_id), event.cmd, event.ret, event.extra);
+            if (n > 0)
+                line.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+        }
+        else
+        {
+            line = "# unknown record kind " + std::to_string(head.kind);
+        }
+
+        line.push_back('\n');
+        fwrite(line.data(), 1, line.size(), out);
+        ring.pop();
+        ++count;
+    }
+    return count;
+}
+
+}  // namespace
+
+bool FlightRecorder::Init(const Option& option, std::string* err_msg)
+{
+    if (IsInit())
+    {
+        if (err_msg)
+            *err_msg += "flight recorder already init";
+        return false;
+    }
+
+    uint64_t ring_mem_size = UnfixedRingBuf<0>::need_total_mem_size(option.ring_size);
+    size_t map_size = MapSize(kMaxSiteNum, kStrArenaSize, ring_mem_size);
+    if (option.shm_file.empty() || option.ring_size == 0 || map_size > UINT32_MAX)
+    {
+        if (err_msg)
+            *err_msg += "invalid shm_file or ring_size";
+        return false;
+    }
+
+    // 上一轮进程留下的内容先导出，之后整块重置（调用点 id 只在本进程内有效）
+    struct stat file_stat{};
+    bool file_exist = stat(option.shm_file.c_str(), &file_stat) == 0 && file_stat.st_size > 0;
+    if (file_exist && option.dump_previous)
+    {
+        std::vector<char> content;
+        std::string dump_err;
+        if (LoadFile(option.shm_file, content, &dump_err))
+        {
+            std::string last_file = option.shm_file + ".last";
+            FILE* out = fopen(last_file.c_str(), "w");
+            if (out)
+            {
+                DumpMem(content.data(), content.size(), out, &dump_err);
+                fclose(out);
+            }
+        }
+    }
+
+    // GetMmapMem 只在空文件时扩容，大小不一致时先调整，避免映射越过文件末尾
+    if (file_exist && static_cast<size_t>(file_stat.st_size) != map_size &&
+        truncate(option.shm_file.c_str(), static_cast<off_t>(map_size)) != 0)
+    {
+        if (err_msg)
+        {
+            *err_msg += "truncate file failed, error: ";
+            *err_msg += strerror(errno);
+        }
+        return false;
+    }
+
+    bool is_exist = false;
+    char* mem = utils::GetMmapMem(option.shm_file, static_cast<uint32_t>(map_size), is_exist, err_msg);
+    if (!mem)
+        return false;
+
+    auto* header = reinterpret_cast<FlightShmHeader*>(mem);
+    std::memset(mem, 0, sizeof(FlightShmHeader) + sizeof(FlightSiteEntry) * kMaxSiteNum);
+    header->pid = static_cast<uint32_t>(getpid());
+    header->max_site_num = kMaxSiteNum;
+    header->str_arena_size = kStrArenaSize;
+    header->str_used = 1;  // 偏移 0 保留
+    header->ring_mem_size = ring_mem_size;
+    header->init_ms = utils::CurrentRealMilliSec();
+
+    g_header = header;
+    g_sites = reinterpret_cast<FlightSiteEntry*>(mem + sizeof(FlightShmHeader));
+    g_str_arena = reinterpret_cast<char*>(g_sites + kMaxSiteNum);
+    g_str_arena[0] = '\0';
+    g_map_size = map_size;
+    g_ring.init(g_str_arena + kStrArenaSize, ring_mem_size, false);
+    for (auto& written : g_site_written)
+        written.store(false, std::memory_order_relaxed);
+
+    // 最后写魔数，导出方看到魔数时布局已完整
+    header->version = FlightShmHeader::kVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = FlightShmHeader::kMagic;
+
+    ring_mem_.store(mem, std::memory_order_release);
+    level_.store(option.level, std::memory_order_relaxed);
+    event_on_.store(option.record_event, std::memory_order_relaxed);
+    return true;
+}
+
+void FlightRecorder::Close()
+{
+    char* mem = ring_mem_.exchange(nullptr, std::memory_order_acq_rel);
+    level_.store(0, std::memory_order_relaxed);
+    event_on_.store(false, std::memory_order_relaxed);
+    if (!mem)
+        return;
+
+    // 调用方保证此时已无写入线程
+    munmap(mem, g_map_size);
+    g_header = nullptr;
+    g_sites = nullptr;
+    g_str_arena = nullptr;
+    g_map_size = 0;
+}
+
+void FlightRecorder::SetLevel(uint8_t priority) noexcept
+{
+    if (IsInit())
+        level_.store(priority, std::memory_order_relaxed);
+}
+
+void FlightRecorder::AppendLog(LogSite& site, const uint8_t* data, uint32_t len)
+{
+    if (!IsInit())
+        return;
+
+    uint32_t site_id = site.id.load(std::memory_order_relaxed);
+    if (site_id < kMaxSiteNum && !g_site_written[site_id].load(std::memory_order_relaxed))
+        RegisterSite(site_id, site);
+    Append(kRecordLog, site.priority, data, len);
+}
+
+void FlightRecorder::RegisterSite(uint32_t site_id, const LogSite& site)
+{
+    if (g_site_written[site_id].exchange(true, std::memory_order_relaxed))
+        return;
+
+    ShmSpinLock lock(g_header->lock);
+    const char* strs[] = {site.fmt, site.file, site.func};
+    uint32_t offs[3] = {};
+    for (int i = 0; i < 3; ++i)
+    {
+        size_t len = strlen(strs[i]) + 1;
+        // 字符串区写满后不再登记，导出时该调用点显示为 UNKNOWN
+        if (g_header->str_used + len > g_header->str_arena_size)
+            return;
+        std::memcpy(g_str_arena + g_header->str_used, strs[i], len);
+        offs[i] = g_header->str_used;
+        g_header->str_used += static_cast<uint32_t>(len);
+    }
+
+    FlightSiteEntry& entry = g_sites[site_id];
+    entry.fmt_off = offs[0];
+    entry.file_off = offs[1];
+    entry.func_off = offs[2];
+    entry.line = site.line;
+    entry.priority = site.priority;
+    entry.valid = 1;
+}
+
+void FlightRecorder::Append(uint8_t kind, uint8_t priority, const uint8_t* data, uint32_t len)
+{
+    if (!IsInit())
+        return;
+
+    FlightRecordHead head{kind, priority};
+    struct iovec iov[2];
+    iov[0].iov_base = &head;
+    iov[0].iov_len = sizeof(head);
+    iov[1].iov_base = const_cast<uint8_t*>(data);
+    iov[1].iov_len = len;
+
+    ShmSpinLock lock(g_header->lock);
+    g_ring.push(iov, 2, true);
+    g_header->write_num.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t FlightRecorder::Dump(const std::string& shm_file, FILE* out, std::string* err_msg)
+{
+    // 拷贝一份快照再解析，不影响仍在写入的进程
+    std::vector<char> content;
+    if (!LoadFile(shm_file, content, err_msg))
+        return -1;
+    return DumpMem(content.data(), content.size(), out, err_msg);
+}
+
+const char* FlightRecorder::EventName(uint16_t event) noexcept
+{
+    switch (static_cast<FlightEvent>(event))
+    {
+        case FlightEvent::kRecvCmd:
+            return "recv_cmd";
+        case FlightEvent::kPending:
+            return "pending";
+        case FlightEvent::kAwake:
+            return "awake";
+        case FlightEvent::kRpcTimeout:
+            return "rpc_timeout";
+        case FlightEvent::kTimerTimeout:
+            return "timer_timeout";
+    }
+    return "unknown";
+}
+
+}  // namespace ua
@@ -0,0 +1,115 @@
+/// @file flight_recorder.h
+/// @brief 崩溃后可回放的共享内存飞行记录器
+/// @note 进程把最近的日志和关键框架事件（收包、RPC 挂起/唤醒、超时）写入一块文件映射的环形缓冲，
+///       覆盖写，不受日志级别和 Logger 输出函数影响；进程崩溃后内容仍在映射文件里，
+///       重启时 Init 先把上一轮内容导出为文本，也可以用 tools/flight_dump 离线导出
+///       日志按 BinaryLog 编码（不做 vsnprintf），调用点信息在首次写入时登记到共享内存的调用点表，
+///       所以导出方不需要原进程的符号
+///       多线程写入由共享内存内的自旋锁串行化，临界区只有一次 memcpy
+///       飞行记录和正常输出都开启时，日志参数会各求值一次，日志参数不应有副作用
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "binary_log.h"
+
+namespace ua
+{
+
+/// 框架事件类型
+enum class FlightEvent : uint16_t
+{
+    kRecvCmd = 1,       // 收到请求，seq_id 为请求 seq，cmd 为请求命令字
+    kPending = 2,       // RPC 挂起，extra 为超时时间（毫秒）
+    kAwake = 3,         // RPC 唤醒，ret 为结果码
+    kRpcTimeout = 4,    // RPC 超时唤醒
+    kTimerTimeout = 5,  // 定时事件触发，seq_id 为事件 id
+};
+
+/// 事件记录，定长
+struct FlightEventRecord
+{
+    uint64_t time_us;
+    uint64_t gid;
+    uint64_t seq_id;
+    uint32_t cmd;
+    int32_t ret;
+    uint32_t extra;
+    uint16_t event;
+} __attribute__((packed));
+
+class FlightRecorder
+{
+public:
+    struct Option
+    {
+        std::string shm_file;               // 映射文件路径
+        uint32_t ring_size = 16 * 1024 * 1024;  // 环形缓冲字节数
+        uint8_t level = 4;                  // 记录的日志级别上限（Logger::PriorityType），0 表示不记日志
+        bool record_event = true;           // 是否记录框架事件
+        bool dump_previous = true;          // Init 时把上一轮内容导出到 shm_file + ".last"
+    };
+
+    /// 记录类型
+    enum RecordKind : uint8_t
+    {
+        kRecordLog = 1,    // BinaryLog 编码的日志
+        kRecordEvent = 2,  // FlightEventRecord
+    };
+
+    static constexpr uint32_t kMaxSiteNum = 8192;
+    static constexpr uint32_t kStrArenaSize = 1024 * 1024;
+
+    /// 映射共享内存并开始记录，重复调用返回 false
+    static bool Init(const Option& option, std::string* err_msg = nullptr);
+    /// 停止记录并解除映射（映射文件保留）
+    static void Close();
+    [[nodiscard]] static bool IsInit() noexcept { return ring_mem_.load(std::memory_order_acquire) != nullptr; }
+
+    /// 热路径：一次 relaxed 读 + 比较
+    [[nodiscard]] static bool Accept(uint8_t priority) noexcept
+    {
+        return priority <= level_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] static bool AcceptEvent() noexcept { return event_on_.load(std::memory_order_relaxed); }
+
+    /// 运行期调整记录级别
+    static void SetLevel(uint8_t priority) noexcept;
+
+    template <typename... Args>
+    static void RecordLog(LogSite& site, uint64_t ctx_id, uint64_t uid, const Args&... args)
+    {
+        uint32_t len = 0;
+        const uint8_t* data = BinaryLog::EncodeRecord(len, site, ctx_id, uid, args...);
+        AppendLog(site, data, len);
+    }
+
+    static void RecordEvent(FlightEvent event, uint64_t gid, uint64_t seq_id, uint32_t cmd = 0, int32_t ret = 0,
+                            uint32_t extra = 0) noexcept
+    {
+        if (__builtin_expect(!AcceptEvent(), 1))
+            return;
+        FlightEventRecord record{BinaryLog::NowMicroSec(), gid, seq_id, cmd, ret, extra,
+                                 static_cast<uint16_t>(event)};
+        Append(kRecordEvent, 0, reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+    }
+
+    /// 把映射文件中的记录按时间顺序导出为文本，可在另一个进程中调用
+    /// @return 导出的记录数，文件不存在或格式不对返回 -1
+    static int64_t Dump(const std::string& shm_file, FILE* out, std::string* err_msg = nullptr);
+
+    [[nodiscard]] static const char* EventName(uint16_t event) noexcept;
+
+private:
+    static void AppendLog(LogSite& site, const uint8_t* data, uint32_t len);
+    static void Append(uint8_t kind, uint8_t priority, const uint8_t* data, uint32_t len);
+    static void RegisterSite(uint32_t site_id, const LogSite& site);
+
+    static constinit inline std::atomic<uint8_t> level_{0};
+    static constinit inline std::atomic<bool> event_on_{false};
+    static constinit inline std::atomic<char*> ring_mem_{nullptr};
+};
+
+}  // namespace ua
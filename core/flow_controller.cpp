@@ -0,0 +1,67 @@
+/// @file flow_controller.cpp
+/// @brief 自适应流控实现
+#include "flow_controller.h"
+#include <algorithm>
+
+namespace ua
+{
+
+void FlowController::Init(const FlowControlOption& option) noexcept
+{
+    option_ = option;
+    budget_ = option.max_deal_pkg_num;
+    interval_start_ms_ = 0;
+    interval_min_sojourn_ = kNoSample;
+    dropping_ = false;
+}
+
+void FlowController::Decrease() noexcept
+{
+    if (budget_ > option_.min_num + option_.dec_delta)
+        budget_ -= option_.dec_delta;
+    else if (budget_ > option_.min_num)
+        budget_ = option_.min_num;
+}
+
+void FlowController::Increase(uint32_t delta) noexcept
+{
+    if (budget_ + delta < option_.max_num)
+        budget_ += delta;
+    else if (budget_ < option_.max_num)
+        budget_ = option_.max_num;
+}
+
+uint32_t FlowController::OnFrame(uint64_t now_ms, uint64_t remain_ms, uint64_t used_ms) noexcept
+{
+    bool overrun = used_ms > remain_ms + option_.judge_range_ms;
+    bool spare = used_ms + option_.judge_range_ms * 2 < remain_ms;
+
+    if (option_.mode == FlowMode::kAimd)
+    {
+        // 超时了快速缩减收包量，空闲了慢慢增加
+        if (overrun)
+            Decrease();
+        else if (spare)
+            Increase(option_.inc_delta);
+        return budget_;
+    }
+
+    // 区间结束：最小排队时延仍高于目标说明队列一直没排空
+    if (interval_start_ms_ == 0)
+        interval_start_ms_ = now_ms;
+    if (now_ms >= interval_start_ms_ + option_.interval_ms)
+    {
+        dropping_ = interval_min_sojourn_ != kNoSample && interval_min_sojourn_ > option_.target_delay_ms;
+        interval_start_ms_ = now_ms;
+        interval_min_sojourn_ = kNoSample;
+    }
+
+    // 帧超时的保护优先于时延目标；积压时按当前预算的 1/4 加速增长
+    if (overrun)
+        Decrease();
+    else if (spare)
+        Increase(dropping_ ? std::max(option_.inc_delta, budget_ / 4) : option_.inc_delta);
+    return budget_;
+}
+
+}  // namespace ua
@@ -0,0 +1,79 @@
+/// @file flow_controller.h
+/// @brief 每帧收包预算的自适应流控
+/// @note 两种模式:
+///       kAimd        原有的快减慢增：本帧超出剩余时间就减 dec_delta，明显有余量就加 inc_delta，只看帧耗时
+///       kDelayTarget 以排队时延为目标（CoDel 思路）：按 interval_ms 统计区间内的最小排队时延，
+///                    最小值仍高于 target_delay_ms 说明存在持续积压，积压期间帧内有余量时按预算的 1/4 加速增长，
+///                    尽快把队列排空；无积压时与 kAimd 相同
+///       提前丢弃（shed_on_delay）: 持续积压时排队超过 target_delay_ms 的请求直接丢弃，
+///       否则只丢排队超过 interval_ms 的请求，回包从不丢弃
+///       纯计算，不取时钟，便于模拟和测试
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace ua
+{
+
+enum class FlowMode : uint8_t
+{
+    kAimd = 0,
+    kDelayTarget = 1,
+};
+
+/// 自适应流控参数（即 ServerCore::SvrOption::FlowControl）
+struct FlowControlOption
+{
+    uint32_t max_deal_pkg_num = 0;     // 初始最大处理包个数
+    uint32_t max_num = 0;              // 能处理的最大包数
+    uint32_t min_num = 0;              // 能处理的最小包数
+    uint32_t inc_delta = 0;            // 增加的单位
+    uint32_t dec_delta = 0;            // 减少的单位（快减）
+    uint32_t judge_range_ms = 0;       // 差异判断区间 (ms)
+
+    FlowMode mode = FlowMode::kAimd;
+    uint32_t target_delay_ms = 5;      // kDelayTarget: 排队时延目标 (ms)
+    uint32_t interval_ms = 100;        // kDelayTarget: 统计最小排队时延的区间 (ms)
+    bool shed_on_delay = false;        // kDelayTarget: 是否按排队时延提前丢弃请求
+};
+
+class FlowController
+{
+public:
+    void Init(const FlowControlOption& option) noexcept;
+
+    /// 收到一个包时调用，sojourn_ms 为排队时延；返回 true 表示该请求应提前丢弃（droppable 为 false 时总是 false）
+    bool OnSojourn(uint64_t sojourn_ms, bool droppable) noexcept
+    {
+        if (option_.mode != FlowMode::kDelayTarget)
+            return false;
+        if (sojourn_ms < interval_min_sojourn_)
+            interval_min_sojourn_ = sojourn_ms;
+        if (!option_.shed_on_delay || !droppable)
+            return false;
+        return sojourn_ms > (dropping_ ? option_.target_delay_ms : option_.interval_ms);
+    }
+
+    /// 每帧收包阶段后调用：remain_ms 为本帧留给逻辑和收包的时间，used_ms 为实际耗时；返回新的收包预算
+    uint32_t OnFrame(uint64_t now_ms, uint64_t remain_ms, uint64_t used_ms) noexcept;
+
+    [[nodiscard]] uint32_t Budget() const noexcept { return budget_; }
+    /// 是否处于持续积压状态
+    [[nodiscard]] bool Dropping() const noexcept { return dropping_; }
+    [[nodiscard]] const FlowControlOption& Option() const noexcept { return option_; }
+
+private:
+    void Decrease() noexcept;
+    void Increase(uint32_t delta) noexcept;
+
+    static constexpr uint64_t kNoSample = std::numeric_limits<uint64_t>::max();
+
+    FlowControlOption option_;
+    uint32_t budget_ = 0;
+    uint64_t interval_start_ms_ = 0;
+    uint64_t interval_min_sojourn_ = kNoSample;
+    bool dropping_ = false;
+};
+
+}  // namespace ua
@@ -0,0 +1,387 @@
+/// @file gid_serial_scheduler.cpp
+/// @brief 按 gid 串行的请求调度器实现
+#include "gid_serial_scheduler.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include "common/clock.h"
+#include "logger.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+GidSerialScheduler::~GidSerialScheduler()
+{
+    for (auto& queue : slots_)
+    {
+        while (queue.head)
+        {
+            PkgArena::Pkg* pkg = queue.head;
+            queue.head = pkg->next;
+            DropOnce(pkg->gid, pkg->data(), pkg->len, pkg->custom_data);
+            arena_.Free(pkg);
+        }
+    }
+}
+
+void GidSerialScheduler::Init(const Option& option)
+{
+    option_ = option;
+    slots_.reserve(option_.expect_gid_num);
+    ready_fifo_.reserve(option_.expect_gid_num);
+    Rehash(std::bit_ceil(std::max<size_t>(static_cast<size_t>(option_.expect_gid_num) * 2, 16)));
+}
+
+uint32_t GidSerialScheduler::FindSlot(uint64_t gid) const noexcept
+{
+    if (buckets_.empty())
+        return kNil;
+    const size_t mask = buckets_.size() - 1;
+    for (size_t i = BucketOf(gid);; i = (i + 1) & mask)
+    {
+        uint32_t slot = buckets_[i];
+        if (slot == kNil || slots_[slot].gid == gid)
+            return slot;
+    }
+}
+
+uint32_t GidSerialScheduler::InsertSlot(uint64_t gid)
+{
+    uint32_t slot = FindSlot(gid);
+    if (slot != kNil)
+        return slot;
+
+    // 负载不超过一半，探测链短
+    if ((gid_num_ + 1) * 2 > buckets_.size())
+        Rehash(std::max<size_t>(buckets_.size() * 2, 16));
+
+    if (free_slot_ != kNil)
+    {
+        slot = free_slot_;
+        free_slot_ = slots_[slot].next_free;
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+    GidQueue& queue = slots_[slot];
+    queue.gid = gid;
+    queue.next_free = kNil;
+    queue.used = true;
+
+    const size_t mask = buckets_.size() - 1;
+    size_t i = BucketOf(gid);
+    while (buckets_[i] != kNil)
+        i = (i + 1) & mask;
+    buckets_[i] = slot;
+    ++gid_num_;
+    return slot;
+}
+
+void GidSerialScheduler::EraseSlot(uint32_t slot)
+{
+    GidQueue& queue = slots_[slot];
+    const size_t mask = buckets_.size() - 1;
+    size_t hole = BucketOf(queue.gid);
+    while (buckets_[hole] != slot)
+        hole = (hole + 1) & mask;
+
+    // 向后移位删除：后面探测链上能放进空位的前移，不留墓碑
+    for (size_t i = (hole + 1) & mask; buckets_[i] != kNil; i = (i + 1) & mask)
+    {
+        size_t home = BucketOf(slots_[buckets_[i]].gid);
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            buckets_[hole] = buckets_[i];
+            hole = i;
+        }
+    }
+    buckets_[hole] = kNil;
+
+    queue.head = nullptr;
+    queue.tail = nullptr;
+    queue.num = 0;
+    queue.used = false;
+    queue.ready = false;
+    queue.in_flight = false;
+    queue.next_free = free_slot_;
+    free_slot_ = slot;
+    --gid_num_;
+}
+
+void GidSerialScheduler::Rehash(size_t bucket_num)
+{
+    buckets_.assign(bucket_num, kNil);
+    bucket_shift_ = 64 - static_cast<uint32_t>(std::countr_zero(bucket_num));
+    const size_t mask = bucket_num - 1;
+    for (uint32_t slot = 0; slot < slots_.size(); ++slot)
+    {
+        if (!slots_[slot].used)
+            continue;
+        size_t i = BucketOf(slots_[slot].gid);
+        while (buckets_[i] != kNil)
+            i = (i + 1) & mask;
+        buckets_[i] = slot;
+    }
+}
+
+bool GidSerialScheduler::OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data)
+{
+    return OnRequest(seq, gid, data, len, custom_data, ReqMeta{});
+}
+
+bool GidSerialScheduler::OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data,
+                                   const ReqMeta& meta)
+{
+    uint64_t now_ms = Clock::GetInst().CurrentMilliSec();
+    if (option_.drop_expired && meta.deadline_ms > 0 && meta.deadline_ms < now_ms)
+    {
+        // 已经处理掉了，不算调度失败
+        ++stat_.expire_drop_num;
+        ServerStatistics::GetInst().AddCmdExpireDrop(meta.cmd);
+        UA_LOG_WARN_RATE(20, 50, gid, "scheduler drop expired pkg, cmd(0x%08X), seq(%lu), expired(%lu)", meta.cmd,
+                         seq, meta.deadline_ms);
+        DropOnce(gid, data, len, custom_data);
+        return true;
+    }
+
+    if (total_num_ >= option_.max_total_num)
+    {
+        ++stat_.reject_num;
+        UA_LOG_WARN_EVERY_MS(1000, gid, "scheduler full, total_num(%zu)", total_num_);
+        return false;
+    }
+
+    uint32_t slot = InsertSlot(gid);
+    GidQueue& queue = slots_[slot];
+    if (queue.num >= option_.max_queue_per_gid)
+    {
+        ++stat_.reject_num;
+        UA_LOG_WARN_RATE(20, 50, gid, "gid queue full, num(%u), seq(%lu)", queue.num, seq);
+        return false;
+    }
+
+    PkgArena::Pkg* pkg = arena_.Alloc(data, len);
+    pkg->gid = gid;
+    pkg->seq = seq;
+    pkg->custom_data = custom_data;
+    pkg->enqueue_ms = now_ms;
+    pkg->deadline_ms = meta.deadline_ms;
+    pkg->cmd = meta.cmd;
+    if (queue.tail)
+        queue.tail->next = pkg;
+    else
+        queue.head = pkg;
+    queue.tail = pkg;
+    ++queue.num;
+    ++total_num_;
+    ++stat_.request_num;
+
+    // 空闲的 gid 有了第一个请求才就绪，处理中的 gid 等 OnResponse
+    if (queue.num == 1 && !queue.in_flight)
+        PushReady(slot);
+    return true;
+}
+
+void GidSerialScheduler::PushReady(uint32_t slot)
+{
+    GidQueue& queue = slots_[slot];
+    queue.ready = true;
+    ReadyItem item;
+    item.deadline = queue.head->deadline_ms > 0 ? queue.head->deadline_ms : std::numeric_limits<uint64_t>::max();
+    item.order = ready_order_++;
+    item.gid = queue.gid;
+    item.slot = slot;
+    item.epoch = ++queue.ready_epoch;
+    bool edf = option_.mode == Mode::kEdf;
+    if (!edf || option_.edf_fair_num > 0)
+        ready_fifo_.push_back(item);
+    if (edf)
+    {
+        ready_heap_.push_back(item);
+        std::push_heap(ready_heap_.begin(), ready_heap_.end(), LaterDeadline{});
+    }
+    ++ready_num_;
+
+    // kEdf 下每条就绪记录有一份会失效，失效记录太多时清理一次
+    if (edf && ready_fifo_.size() - fifo_head_ + ready_heap_.size() > ready_num_ * 4 + 64)
+        CompactReady();
+}
+
+bool GidSerialScheduler::IsValid(const ReadyItem& item) const
+{
+    const GidQueue& queue = slots_[item.slot];
+    return queue.used && queue.gid == item.gid && queue.ready && queue.ready_epoch == item.epoch;
+}
+
+void GidSerialScheduler::CompactReady()
+{
+    auto invalid = [this](const ReadyItem& item) { return !IsValid(item); };
+    ready_fifo_.erase(ready_fifo_.begin(), ready_fifo_.begin() + static_cast<std::ptrdiff_t>(fifo_head_));
+    fifo_head_ = 0;
+    ready_fifo_.erase(std::remove_if(ready_fifo_.begin(), ready_fifo_.end(), invalid), ready_fifo_.end());
+    ready_heap_.erase(std::remove_if(ready_heap_.begin(), ready_heap_.end(), invalid), ready_heap_.end());
+    std::make_heap(ready_heap_.begin(), ready_heap_.end(), LaterDeadline{});
+}
+
+bool GidSerialScheduler::TakeReady(const ReadyItem& item)
+{
+    if (!IsValid(item))
+        return false;
+    slots_[item.slot].ready = false;
+    --ready_num_;
+    return true;
+}
+
+bool GidSerialScheduler::PopReady(uint32_t& slot)
+{
+    if (ready_num_ == 0)
+    {
+        // 只剩失效记录
+        ready_fifo_.clear();
+        fifo_head_ = 0;
+        ready_heap_.clear();
+        return false;
+    }
+
+    bool use_heap = option_.mode == Mode::kEdf &&
+                    (option_.edf_fair_num == 0 || ++dispatch_turn_ % option_.edf_fair_num != 0);
+    if (use_heap)
+    {
+        while (!ready_heap_.empty())
+        {
+            std::pop_heap(ready_heap_.begin(), ready_heap_.end(), LaterDeadline{});
+            ReadyItem item = ready_heap_.back();
+            ready_heap_.pop_back();
+            if (TakeReady(item))
+            {
+                slot = item.slot;
+                return true;
+            }
+        }
+    }
+    ReadyItem item;
+    while (PopFifo(item))
+    {
+        if (TakeReady(item))
+        {
+            slot = item.slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GidSerialScheduler::PopFifo(ReadyItem& item) noexcept
+{
+    if (fifo_head_ >= ready_fifo_.size())
+        return false;
+    item = ready_fifo_[fifo_head_++];
+    // 取空时整体复位；一直取不空时已取走的部分过半再前移，容量不释放
+    if (fifo_head_ == ready_fifo_.size())
+    {
+        ready_fifo_.clear();
+        fifo_head_ = 0;
+    }
+    else if (fifo_head_ >= 1024 && fifo_head_ * 2 >= ready_fifo_.size())
+    {
+        ready_fifo_.erase(ready_fifo_.begin(), ready_fifo_.begin() + static_cast<std::ptrdiff_t>(fifo_head_));
+        fifo_head_ = 0;
+    }
+    return true;
+}
+
+void GidSerialScheduler::OnResponse(uint64_t gid)
+{
+    uint32_t slot = FindSlot(gid);
+    if (slot == kNil || !slots_[slot].in_flight)
+    {
+        ++stat_.unknown_rsp_num;
+        UA_LOG_WARN_EVERY_MS(1000, gid, "scheduler response without in flight request");
+        return;
+    }
+    Release(slot);
+}
+
+void GidSerialScheduler::Release(uint32_t slot)
+{
+    GidQueue& queue = slots_[slot];
+    queue.in_flight = false;
+    if (queue.num > 0)
+        PushReady(slot);
+    else
+        EraseSlot(slot);
+}
+
+void GidSerialScheduler::DropExpired(GidQueue& queue, uint64_t now_ms)
+{
+    while (queue.head && queue.head->deadline_ms > 0 && queue.head->deadline_ms < now_ms)
+    {
+        PkgArena::Pkg* pkg = queue.head;
+        queue.head = pkg->next;
+        if (!queue.head)
+            queue.tail = nullptr;
+        --queue.num;
+        --total_num_;
+        ++stat_.expire_drop_num;
+        ServerStatistics::GetInst().AddCmdExpireDrop(pkg->cmd);
+        UA_LOG_WARN_RATE(20, 50, pkg->gid, "scheduler drop expired pkg, cmd(0x%08X), seq(%lu), expired(%lu)",
+                         pkg->cmd, pkg->seq, pkg->deadline_ms);
+        DropOnce(pkg->gid, pkg->data(), pkg->len, pkg->custom_data);
+        arena_.Free(pkg);
+    }
+}
+
+uint32_t GidSerialScheduler::LoopOnce(uint32_t proc_num)
+{
+    uint64_t now_ms = Clock::GetInst().CurrentMilliSec();
+    uint32_t count = 0;
+    uint32_t slot = kNil;
+    while ((proc_num == 0 || count < proc_num) && PopReady(slot))
+    {
+        GidQueue& queue = slots_[slot];
+        const uint64_t gid = queue.gid;
+        if (option_.drop_expired)
+        {
+            DropExpired(queue, now_ms);
+            if (!queue.head)
+            {
+                EraseSlot(slot);
+                continue;
+            }
+        }
+
+        PkgArena::Pkg* pkg = queue.head;
+        queue.head = pkg->next;
+        if (!queue.head)
+            queue.tail = nullptr;
+        --queue.num;
+        --total_num_;
+        queue.in_flight = true;
+
+        // 非协程模式下 ProcOnce 里可能同步 OnResponse 并删除 gid、OnRequest 扩容槽数组，之后要重新查找
+        bool ok = ProcOnce(pkg->seq, gid, pkg->data(), pkg->len, pkg->custom_data);
+        arena_.Free(pkg);
+        ++stat_.dispatch_num;
+        ++count;
+
+        if (!ok)
+        {
+            ++stat_.proc_fail_num;
+            slot = FindSlot(gid);
+            if (slot != kNil && slots_[slot].in_flight)
+                Release(slot);
+        }
+    }
+    return count;
+}
+
+size_t GidSerialScheduler::CacheNum(uint64_t gid) const
+{
+    uint32_t slot = FindSlot(gid);
+    return slot == kNil ? 0 : slots_[slot].num;
+}
+
+}  // namespace ua
@@ -0,0 +1,152 @@
+/// @file gid_serial_scheduler.h
+/// @brief 按 gid 串行的请求调度器（IScheduler 的参考实现）
+/// @note 同一个 gid 同时最多一个请求在处理（actor 语义），OnResponse 后才派发该 gid 的下一个请求
+///       有待处理请求且不在处理中的 gid 就绪，LoopOnce 每次从就绪 gid 中选一个派发其队首请求:
+///       kRoundRobin 按就绪顺序轮转
+///       kEdf        选队首请求过期时间最早的 gid（没有过期时间的排最后），每 edf_fair_num 次派发
+///                   按就绪顺序选一次，保证没有过期时间的 gid 不会饿死；同一 gid 内始终按到达顺序
+///       drop_expired 时已过期的请求在入队和派发前直接丢弃（不调用 ProcOnce，计入 expire_drop）
+///       被丢弃的包和析构时仍在排队的包都经 DropFunc 通知所有者
+///       每个 gid 的队列长度有上限，超过时 OnRequest 返回 false（PBService 计入 schedule_drop）
+///       包数据存放在 PkgArena 里，gid 的队列是块头串起来的侵入式链表，入队不做额外分配
+///       gid 表为槽数组 + 线性探测的开放寻址索引，空闲 gid 的槽放回空闲链表复用，
+///       表只在活跃 gid 数创新高时扩容，稳态下入队、派发、回包都不申请内存
+///       ProcOnce 返回 false（包被丢弃/出错）时视为处理结束，立即放行该 gid
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "interface/scheduler_interface.h"
+#include "pkg_arena.h"
+
+namespace ua
+{
+
+class GidSerialScheduler : public IScheduler
+{
+public:
+    enum class Mode : uint8_t
+    {
+        kRoundRobin = 0,
+        kEdf = 1,
+    };
+
+    struct Option
+    {
+        uint32_t max_queue_per_gid = 256;   // 每个 gid 最多缓存的请求数（不含处理中的）
+        uint32_t max_total_num = 1 << 20;   // 总缓存请求数上限
+        uint32_t expect_gid_num = 1024;     // 预留的 gid 表容量
+        Mode mode = Mode::kRoundRobin;
+        uint32_t edf_fair_num = 8;          // kEdf: 每多少次派发按就绪顺序选一次，0 表示纯 EDF
+        bool drop_expired = true;           // 入队和派发前丢弃已过期的请求
+    };
+
+    struct Stat
+    {
+        uint64_t request_num = 0;      // 入队数
+        uint64_t dispatch_num = 0;     // 派发数
+        uint64_t reject_num = 0;       // 超出上限拒绝数
+        uint64_t expire_drop_num = 0;  // 过期丢弃数
+        uint64_t proc_fail_num = 0;    // ProcOnce 返回 false 的次数
+        uint64_t unknown_rsp_num = 0;  // 没有处理中请求的 OnResponse
+    };
+
+    GidSerialScheduler() = default;
+    explicit GidSerialScheduler(const Option& option) { Init(option); }
+    ~GidSerialScheduler() override;
+
+    void Init(const Option& option);
+
+    bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) override;
+    bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data,
+                   const ReqMeta& meta) override;
+    void OnResponse(uint64_t gid) override;
+    using IScheduler::OnResponse;  // 同一 gid 只有一个在途请求，不需要 seq
+    [[nodiscard]] uint32_t LoopOnce(uint32_t proc_num) override;
+    [[nodiscard]] size_t CacheNum(uint64_t gid) const override;
+
+    /// 缓存的请求总数
+    [[nodiscard]] size_t TotalNum() const noexcept { return total_num_; }
+    /// 有缓存或处理中的 gid 数
+    [[nodiscard]] size_t GidNum() const noexcept { return gid_num_; }
+    [[nodiscard]] size_t ReadyNum() const noexcept { return ready_num_; }
+    [[nodiscard]] const Stat& GetStat() const noexcept { return stat_; }
+    [[nodiscard]] const PkgArena& Arena() const noexcept { return arena_; }
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    struct GidQueue
+    {
+        uint64_t gid = 0;
+        PkgArena::Pkg* head = nullptr;
+        PkgArena::Pkg* tail = nullptr;
+        uint32_t num = 0;
+        uint32_t ready_epoch = 0;  // 每次就绪加一（槽复用时不清零），就绪队列里 epoch 对不上的记录已失效
+        uint32_t next_free = kNil;
+        bool used = false;
+        bool ready = false;
+        bool in_flight = false;
+    };
+
+    /// 就绪记录，kEdf 下同时进 FIFO 和最早过期堆，先被取到的那边生效
+    struct ReadyItem
+    {
+        uint64_t deadline = 0;  // 队首请求过期时间，不过期为 UINT64_MAX
+        uint64_t order = 0;     // 就绪先后，过期时间相同时先就绪先派发
+        uint64_t gid = 0;
+        uint32_t slot = 0;
+        uint32_t epoch = 0;
+    };
+    struct LaterDeadline
+    {
+        bool operator()(const ReadyItem& a, const ReadyItem& b) const noexcept
+        {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.order > b.order;
+        }
+    };
+
+    /// gid 所在的槽，没有返回 kNil
+    [[nodiscard]] uint32_t FindSlot(uint64_t gid) const noexcept;
+    /// 查找或新建 gid 的槽
+    uint32_t InsertSlot(uint64_t gid);
+    /// 删除空闲 gid，槽放回空闲链表
+    void EraseSlot(uint32_t slot);
+    void Rehash(size_t bucket_num);
+    [[nodiscard]] size_t BucketOf(uint64_t gid) const noexcept
+    {
+        return static_cast<size_t>((gid * 0x9e3779b97f4a7c15ULL) >> bucket_shift_);
+    }
+
+    void PushReady(uint32_t slot);
+    /// 取一个就绪 gid 的槽，没有返回 false
+    bool PopReady(uint32_t& slot);
+    bool TakeReady(const ReadyItem& item);
+    /// 取就绪顺序的队首记录，空返回 false
+    bool PopFifo(ReadyItem& item) noexcept;
+    [[nodiscard]] bool IsValid(const ReadyItem& item) const;
+    void CompactReady();
+    /// 丢掉队首已过期的请求
+    void DropExpired(GidQueue& queue, uint64_t now_ms);
+    /// gid 的请求处理完：有后续请求则重新就绪，否则删除
+    void Release(uint32_t slot);
+
+    Option option_;
+    std::vector<GidQueue> slots_;              // 下标即槽号，扩容后元素地址会变，跨 ProcOnce 只保存槽号
+    std::vector<uint32_t> buckets_;            // 开放寻址索引，存槽号，kNil 为空
+    uint32_t bucket_shift_ = 64;
+    uint32_t free_slot_ = kNil;
+    size_t gid_num_ = 0;
+    std::vector<ReadyItem> ready_fifo_;        // 就绪顺序，[fifo_head_, size) 为未取的部分，复用容量
+    size_t fifo_head_ = 0;
+    std::vector<ReadyItem> ready_heap_;        // kEdf: 按队首过期时间的小顶堆
+    size_t ready_num_ = 0;
+    uint64_t ready_order_ = 0;
+    uint64_t dispatch_turn_ = 0;
+    PkgArena arena_;
+    size_t total_num_ = 0;
+    Stat stat_;
+};
+
+}  // namespace ua
@@ -1,14 +1,17 @@
 /// @file channel_interface.h
 /// @brief 收发包通道抽象接口（C++20 重写版）
-/// @note 使用 std::move_only_function 替代 std::function（可选）
+/// @note 收包回调为 InplaceFunction（只移动、闭包内联存放）
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include "common/inplace_function.h"
 
 namespace ua
 {
 
+class RecvCodec;
+
 /// 通信通道抽象接口
 class IChannel
 {
@@ -18,21 +21,29 @@ public:
     /// @param data_len 数据长度
     /// @param recv_id 来源端点 ID
     /// @param arrived_time 到达时间戳（毫秒）
-    using RecvCallBack = std::function<int32_t(const char*, size_t, uint32_t, uint64_t)>;
+    using RecvCallBack = InplaceFunction<int32_t(const char*, size_t, uint32_t, uint64_t)>;
 
     void SetCallback(RecvCallBack callback) noexcept { recv_callback_ = std::move(callback); }
 
+    /// 已解码收包回调：在其他线程上预先解码的 channel（如 RecvPipeline）优先使用，codec 已对 data 解码
+    using DecodedCallBack = InplaceFunction<int32_t(RecvCodec&, const char*, size_t, uint32_t, uint64_t)>;
+
+    void SetDecodedCallback(DecodedCallBack callback) noexcept { decoded_callback_ = std::move(callback); }
+
     /// 获取当前端点 ID
     [[nodiscard]] virtual uint32_t MyID() const = 0;
     /// 发送数据
     virtual int32_t Send(uint32_t dest_id, const char* buff, size_t buff_len) = 0;
     /// 收包驱动循环，返回处理的包数量
     virtual size_t Loop(uint32_t max_recv_count) = 0;
+    /// 可读即有包的文件描述符（水平触发语义，由 Loop 负责清除），供事件循环空闲时 epoll 等待；不支持返回 -1
+    [[nodiscard]] virtual int GetFd() const { return -1; }
 
     virtual ~IChannel() = default;
 
 protected:
     RecvCallBack recv_callback_;
+    DecodedCallBack decoded_callback_;
 };
 
 }  // namespace ua
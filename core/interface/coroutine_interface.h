@@ -2,8 +2,9 @@
 /// @brief 非对称协程接口（C++20 重写版）
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include "common/inplace_function.h"
 
 namespace ua
 {
@@ -36,12 +37,16 @@ public:
     /// 启动一个协程（C 风格函数指针版）
     using CoroFunc = void(void*);
     virtual bool Spawn(CoroFunc f, void* args) = 0;
-    /// 启动一个协程（std::function 版）
-    using CoroTask = std::function<void()>;
+    /// 启动一个协程（闭包版）：闭包内联存放在协程对象里，不申请堆内存，超过 kCoroTaskCapacity 字节编译报错
+    /// 传入 std::function 也可以（整体放入），但其自身构造时可能已经分配
+    static constexpr size_t kCoroTaskCapacity = 64;
+    using CoroTask = InplaceFunction<void(), kCoroTaskCapacity>;
     virtual bool Spawn(CoroTask task) = 0;
 
     /// 获取当前协程的 Coro 指针，不在协程中返回 nullptr
     [[nodiscard]] virtual Coro* ThisCoro() const = 0;
+    /// 是否共享栈：挂起期间协程栈上对象的地址不可访问（内容被换出），框架据此把挂起期间要访问的对象放到堆上
+    [[nodiscard]] virtual bool StackShared() const { return false; }
 
     virtual ~ICoroutine() = default;
 };
@@ -3,7 +3,7 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
+#include "common/inplace_function.h"
 
 namespace ua
 {
@@ -12,21 +12,44 @@ class IScheduler
 {
 public:
     /// 处理函数: (gid, data, len, custom_data) -> bool
-    using ProcFunc = std::function<bool(uint64_t, const char*, uint32_t, uint64_t)>;
+    using ProcFunc = InplaceFunction<bool(uint64_t, const char*, uint32_t, uint64_t)>;
+
+    /// 入队时已知的请求信息（来自已解码的包头），调度器据此排序或提前丢弃，无需再解码
+    struct ReqMeta
+    {
+        uint32_t cmd = 0;
+        uint64_t deadline_ms = 0;  // 绝对过期时间，0 表示不过期
+    };
+
+    /// 丢弃函数: (gid, data, len, custom_data)，已被 OnRequest 接收的包未派发就被丢弃时调用
+    /// （挤掉最老的、过期、调度器析构），包的所有者据此释放随包传递的资源；不可在其中回调调度器
+    using DropFunc = InplaceFunction<void(uint64_t, const char*, uint32_t, uint64_t)>;
 
     void SetProcFunc(ProcFunc func) noexcept { proc_func_ = std::move(func); }
+    void SetDropFunc(DropFunc func) noexcept { drop_func_ = std::move(func); }
     void SetStop(bool stop) noexcept { stop_ = stop; }
     [[nodiscard]] bool IsStop() const noexcept { return stop_; }
 
     /// 请求包入调度器，失败返回 false
     virtual bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) = 0;
+    /// 带请求信息入队，默认忽略 meta
+    virtual bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data,
+                           const ReqMeta& meta)
+    {
+        return OnRequest(seq, gid, data, len, custom_data);
+    }
     /// 处理完一个请求包后回调
     virtual void OnResponse(uint64_t gid) = 0;
+    /// 带 seq（OnRequest 传入的，派发时见 DispatchingSeq）回调，同一 gid 可并发的调度器据此归还对应请求，默认忽略 seq
+    virtual void OnResponse(uint64_t gid, uint64_t seq) { OnResponse(gid); }
     /// 驱动调度器，proc_num=0 处理所有包，返回已处理数量
     [[nodiscard]] virtual uint32_t LoopOnce(uint32_t proc_num) = 0;
     /// 获取缓存的包数量
     [[nodiscard]] virtual size_t CacheNum(uint64_t gid) const = 0;
 
+    /// ProcOnce 期间正在派发的请求的 seq，调度器没有提供时为 0
+    [[nodiscard]] uint64_t DispatchingSeq() const noexcept { return dispatching_seq_; }
+
     virtual ~IScheduler() = default;
 
 protected:
@@ -35,8 +58,27 @@ protected:
         return proc_func_(gid, data, len, custom_data);
     }
 
+    /// 派发时带上 seq，处理函数里可用 DispatchingSeq 取到
+    bool ProcOnce(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data)
+    {
+        uint64_t outer_seq = dispatching_seq_;
+        dispatching_seq_ = seq;
+        bool ok = proc_func_(gid, data, len, custom_data);
+        dispatching_seq_ = outer_seq;
+        return ok;
+    }
+
+    /// 通知所有者一个已接收的包被丢弃
+    void DropOnce(uint64_t gid, const char* data, uint32_t len, uint64_t custom_data)
+    {
+        if (drop_func_)
+            drop_func_(gid, data, len, custom_data);
+    }
+
 private:
     ProcFunc proc_func_;
+    DropFunc drop_func_;
+    uint64_t dispatching_seq_ = 0;
     bool stop_ = false;
 };
 
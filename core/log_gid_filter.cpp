@@ -0,0 +1,160 @@
+/// @file log_gid_filter.cpp
+/// @brief 定向日志 gid 过滤器实现
+#include "log_gid_filter.h"
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <unordered_set>
+
+namespace ua
+{
+
+namespace
+{
+
+std::mutex& WatchMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_set<uint64_t>& WatchSet()
+{
+    static std::unordered_set<uint64_t> gids;
+    return gids;
+}
+
+/// 按空白切分
+std::vector<std::string_view> SplitArgs(std::string_view cmd)
+{
+    std::vector<std::string_view> args;
+    size_t pos = 0;
+    while (pos < cmd.size())
+    {
+        size_t begin = cmd.find_first_not_of(" \t", pos);
+        if (begin == std::string_view::npos)
+            break;
+        size_t end = cmd.find_first_of(" \t", begin);
+        if (end == std::string_view::npos)
+            end = cmd.size();
+        args.push_back(cmd.substr(begin, end - begin));
+        pos = end;
+    }
+    return args;
+}
+
+}  // namespace
+
+bool LogGidFilter::Contains(uint64_t gid)
+{
+    std::lock_guard<std::mutex> lock(WatchMutex());
+    return WatchSet().count(gid) > 0;
+}
+
+bool LogGidFilter::Add(uint64_t gid)
+{
+    if (gid == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(WatchMutex());
+    auto& gids = WatchSet();
+    if (gids.count(gid))
+        return true;
+    if (gids.size() >= kMaxWatchNum)
+        return false;
+
+    gids.insert(gid);
+    uint32_t bit = Hash(gid) & (kBitNum - 1);
+    bits_[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+    watch_num_.store(static_cast<uint32_t>(gids.size()), std::memory_order_relaxed);
+    return true;
+}
+
+bool LogGidFilter::Remove(uint64_t gid)
+{
+    std::lock_guard<std::mutex> lock(WatchMutex());
+    if (!WatchSet().erase(gid))
+        return false;
+
+    RebuildBits();
+    return true;
+}
+
+void LogGidFilter::Clear()
+{
+    std::lock_guard<std::mutex> lock(WatchMutex());
+    WatchSet().clear();
+    RebuildBits();
+}
+
+std::vector<uint64_t> LogGidFilter::List()
+{
+    std::lock_guard<std::mutex> lock(WatchMutex());
+    std::vector<uint64_t> gids(WatchSet().begin(), WatchSet().end());
+    std::sort(gids.begin(), gids.end());
+    return gids;
+}
+
+void LogGidFilter::RebuildBits()
+{
+    // 调用方持锁；重建期间读者可能短暂漏判，只影响定向日志
+    for (auto& word : bits_)
+        word.store(0, std::memory_order_relaxed);
+    for (uint64_t gid : WatchSet())
+    {
+        uint32_t bit = Hash(gid) & (kBitNum - 1);
+        bits_[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+    }
+    watch_num_.store(static_cast<uint32_t>(WatchSet().size()), std::memory_order_relaxed);
+}
+
+bool LogGidFilter::ExecCommand(std::string_view cmd, std::string& result)
+{
+    auto args = SplitArgs(cmd);
+    if (args.empty())
+    {
+        result = "usage: add|del <gid>... / clear / list";
+        return false;
+    }
+
+    if (args[0] == "clear")
+    {
+        Clear();
+        result = "ok";
+        return true;
+    }
+
+    if (args[0] == "list")
+    {
+        result.clear();
+        for (uint64_t gid : List())
+        {
+            if (!result.empty())
+                result.push_back(' ');
+            result += std::to_string(gid);
+        }
+        return true;
+    }
+
+    bool is_add = args[0] == "add";
+    if ((!is_add && args[0] != "del") || args.size() < 2)
+    {
+        result = "usage: add|del <gid>... / clear / list";
+        return false;
+    }
+
+    result.clear();
+    for (size_t i = 1; i < args.size(); ++i)
+    {
+        uint64_t gid = 0;
+        auto [ptr, ec] = std::from_chars(args[i].data(), args[i].data() + args[i].size(), gid);
+        bool ok = ec == std::errc() && ptr == args[i].data() + args[i].size() && (is_add ? Add(gid) : Remove(gid));
+        if (!result.empty())
+            result.push_back(' ');
+        result.append(args[i]);
+        result += ok ? ":ok" : ":fail";
+    }
+    return true;
+}
+
+}  // namespace ua
@@ -0,0 +1,74 @@
+/// @file log_gid_filter.h
+/// @brief 按 gid 定向打开 TRACE/DEBUG 日志
+/// @note 运行期维护一个"关注 gid"集合，UA_LOG_TRACE/DEBUG 在级别关闭时，
+///       若 uid 或当前 ServerContext 的 gid（ContextMgr）被关注，仍然输出
+///       快速路径: 无关注 gid 时只有一次原子读；有关注 gid 时未命中的 gid 只做一次位图探测，
+///       位图命中后再加锁查精确集合排除哈希冲突
+///       增删只在管理命令中发生，删除时按精确集合重建位图
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "context_mgr.h"
+
+namespace ua
+{
+
+class LogGidFilter
+{
+public:
+    static constexpr uint32_t kBitNum = 64 * 1024;
+    static constexpr uint32_t kWordNum = kBitNum / 64;
+    static constexpr uint32_t kMaxWatchNum = 1024;
+
+    /// 热路径：uid 或当前上下文 gid 是否被关注
+    [[nodiscard]] static bool ShouldLog(uint64_t uid) noexcept
+    {
+        if (__builtin_expect(watch_num_.load(std::memory_order_relaxed) == 0, 1))
+            return false;
+        return IsWatched(uid) || IsWatched(ContextMgr::GetContextId());
+    }
+
+    [[nodiscard]] static bool IsWatched(uint64_t gid) noexcept
+    {
+        if (gid == 0)
+            return false;
+        uint32_t bit = Hash(gid) & (kBitNum - 1);
+        if (!(bits_[bit / 64].load(std::memory_order_relaxed) & (1ULL << (bit % 64))))
+            return false;
+        return Contains(gid);
+    }
+
+    /// 关注 gid，超过 kMaxWatchNum 返回 false
+    static bool Add(uint64_t gid);
+    static bool Remove(uint64_t gid);
+    static void Clear();
+    [[nodiscard]] static uint32_t Size() noexcept { return watch_num_.load(std::memory_order_relaxed); }
+    [[nodiscard]] static std::vector<uint64_t> List();
+
+    /// 管理命令入口: "add <gid> [gid...]" / "del <gid> [gid...]" / "clear" / "list"
+    /// @return 命令是否合法，result 为回显
+    static bool ExecCommand(std::string_view cmd, std::string& result);
+
+private:
+    static constexpr uint32_t Hash(uint64_t gid) noexcept
+    {
+        gid ^= gid >> 33;
+        gid *= 0xff51afd7ed558ccdULL;
+        gid ^= gid >> 33;
+        return static_cast<uint32_t>(gid);
+    }
+
+    /// 位图命中后的精确确认
+    static bool Contains(uint64_t gid);
+    static void RebuildBits();
+
+    static constinit inline std::atomic<uint32_t> watch_num_{0};
+    static constinit inline std::array<std::atomic<uint64_t>, kWordNum> bits_{};
+};
+
+}  // namespace ua
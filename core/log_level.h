@@ -0,0 +1,123 @@
+/// @file log_level.h
+/// @brief 日志级别：编译期下限 + 运行期按模块分级
+/// @note UA_LOG_MIN_LEVEL: 编译期下限，低于它的日志宏整体被 if constexpr 剔除，不生成任何代码
+///       LogLevelTable: 每个模块一个 std::atomic<uint8_t> 级别，常量初始化（无 guard），
+///       日志宏在调用 Logger::GetInst() 和 std::function 之前先做一次 relaxed 读，关闭时只剩一次比较
+///       Logger::SetCanOutputFunc 会把放行的最高级别同步到所有模块，之后可再按模块单独调整
+///       模块 id 由编译单元在包含本头文件前定义 UA_LOG_MODULE 指定，缺省为 kLogModuleDefault
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+/// 编译期日志级别下限（与 Logger::PriorityType 数值一致: 1=ERROR ... 5=TRACE）
+#ifndef UA_LOG_MIN_LEVEL
+#define UA_LOG_MIN_LEVEL 5
+#endif
+
+/// 当前编译单元的日志模块 id
+#ifndef UA_LOG_MODULE
+#define UA_LOG_MODULE ua::kLogModuleDefault
+#endif
+
+namespace ua
+{
+
+/// 框架内置模块 id，业务模块从 kLogModuleUserBegin 开始
+constexpr uint32_t kLogModuleDefault = 0;
+constexpr uint32_t kLogModuleCore = 1;
+constexpr uint32_t kLogModulePb = 2;
+constexpr uint32_t kLogModuleUserBegin = 16;
+constexpr uint32_t kMaxLogModule = 64;
+
+namespace detail
+{
+
+using LogLevelArray = std::array<std::atomic<uint8_t>, kMaxLogModule>;
+
+template <size_t... I>
+constexpr LogLevelArray MakeLogLevels(std::index_sequence<I...>, uint8_t level)
+{
+    return LogLevelArray{((void)I, level)...};
+}
+
+}  // namespace detail
+
+class LogLevelTable
+{
+public:
+    /// 热路径：一次 relaxed 读 + 比较
+    template <uint32_t Module>
+    [[nodiscard]] static bool Enabled(uint8_t priority) noexcept
+    {
+        static_assert(Module < kMaxLogModule, "log module id out of range");
+        return priority <= levels_[Module].load(std::memory_order_relaxed);
+    }
+
+    /// 设置模块级别，priority 取 Logger::PriorityType，0 表示关闭该模块所有日志
+    static bool SetLevel(uint32_t module, uint8_t priority) noexcept
+    {
+        if (module >= kMaxLogModule)
+            return false;
+        levels_[module].store(priority, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// 按模块名设置级别（管理命令用），名字不存在返回 false
+    static bool SetLevel(const char* name, uint8_t priority) noexcept
+    {
+        int32_t module = FindModule(name);
+        return module >= 0 && SetLevel(static_cast<uint32_t>(module), priority);
+    }
+
+    static void SetAllLevel(uint8_t priority) noexcept
+    {
+        for (auto& level : levels_)
+            level.store(priority, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] static uint8_t GetLevel(uint32_t module) noexcept
+    {
+        return module < kMaxLogModule ? levels_[module].load(std::memory_order_relaxed) : 0;
+    }
+
+    /// 注册模块名，name 需为静态字符串；启动阶段调用
+    static bool RegisterModule(uint32_t module, const char* name) noexcept
+    {
+        if (module >= kMaxLogModule || !name)
+            return false;
+        names_[module] = name;
+        return true;
+    }
+
+    [[nodiscard]] static const char* GetModuleName(uint32_t module) noexcept
+    {
+        return module < kMaxLogModule ? names_[module] : nullptr;
+    }
+
+    /// 返回模块 id，找不到返回 -1
+    [[nodiscard]] static int32_t FindModule(const char* name) noexcept
+    {
+        if (!name)
+            return -1;
+        for (uint32_t i = 0; i < kMaxLogModule; ++i)
+        {
+            if (names_[i] && strcmp(names_[i], name) == 0)
+                return static_cast<int32_t>(i);
+        }
+        return -1;
+    }
+
+private:
+    static constexpr uint8_t kDefaultLevel = 0;  // 与未设置 CanOutputFunc 的 Logger 一致全关，由 SetCanOutputFunc 同步
+
+    /// 常量初始化，访问时无需 guard
+    static constinit inline detail::LogLevelArray levels_ =
+        detail::MakeLogLevels(std::make_index_sequence<kMaxLogModule>{}, kDefaultLevel);
+    static inline const char* names_[kMaxLogModule] = {"default", "core", "pb"};
+};
+
+}  // namespace ua
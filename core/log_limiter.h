@@ -0,0 +1,116 @@
+/// @file log_limiter.h
+/// @brief 日志限频：按调用点的计数采样 / 时间间隔 / 令牌桶
+/// @note 每个调用点一个静态限频器（见 logger.h 中 UA_LOG_*_EVERY_N / _EVERY_MS / _RATE），
+///       被抑制的条数累加到限频器和 ServerStatistics::log_suppressed_num，
+///       下一条放行的日志在末尾带上 "|suppressed(N)"
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include "common/utils.h"
+
+namespace ua
+{
+
+/// 每 N 条输出一条
+class LogEveryN
+{
+public:
+    constexpr explicit LogEveryN(uint32_t n) noexcept : n_(n > 0 ? n : 1) {}
+
+    bool Allow(uint32_t& suppressed) noexcept
+    {
+        uint64_t count = count_.fetch_add(1, std::memory_order_relaxed);
+        if (count % n_ != 0)
+            return false;
+        suppressed = count == 0 ? 0 : n_ - 1;
+        return true;
+    }
+
+private:
+    uint32_t n_;
+    std::atomic<uint64_t> count_{0};
+};
+
+/// 每 interval_ms 最多输出一条
+class LogEveryMs
+{
+public:
+    constexpr explicit LogEveryMs(uint32_t interval_ms) noexcept : interval_ms_(interval_ms) {}
+
+    bool Allow(uint32_t& suppressed) noexcept
+    {
+        uint64_t now = utils::CurrentRealMilliSec();
+        uint64_t last = last_ms_.load(std::memory_order_relaxed);
+        // CAS 保证同一时间窗口只有一个线程放行
+        if (last != 0 && now < last + interval_ms_)
+        {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!last_ms_.compare_exchange_strong(last, now, std::memory_order_relaxed))
+        {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    uint32_t interval_ms_;
+    std::atomic<uint64_t> last_ms_{0};
+    std::atomic<uint32_t> suppressed_{0};
+};
+
+/// 令牌桶：每秒补充 rate 个令牌，最多积攒 burst 个
+class LogTokenBucket
+{
+public:
+    constexpr LogTokenBucket(uint32_t rate, uint32_t burst) noexcept
+        : rate_(rate > 0 ? rate : 1), burst_milli_(static_cast<int64_t>(std::max<uint32_t>(burst, 1)) * 1000),
+          tokens_milli_(burst_milli_)
+    {
+    }
+
+    bool Allow(uint32_t& suppressed) noexcept
+    {
+        Refill(utils::CurrentRealMilliSec());
+        if (tokens_milli_.fetch_sub(1000, std::memory_order_relaxed) < 1000)
+        {
+            tokens_milli_.fetch_add(1000, std::memory_order_relaxed);
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    void Refill(uint64_t now) noexcept
+    {
+        uint64_t last = last_ms_.load(std::memory_order_relaxed);
+        if (last == 0)
+        {
+            last_ms_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+            return;
+        }
+        if (now <= last || !last_ms_.compare_exchange_strong(last, now, std::memory_order_relaxed))
+            return;
+
+        // 1ms 补充 rate 个千分之一令牌
+        int64_t add = static_cast<int64_t>(now - last) * rate_;
+        int64_t tokens = tokens_milli_.fetch_add(add, std::memory_order_relaxed) + add;
+        if (tokens > burst_milli_)
+            tokens_milli_.store(burst_milli_, std::memory_order_relaxed);
+    }
+
+    uint32_t rate_;
+    int64_t burst_milli_;
+    std::atomic<int64_t> tokens_milli_;
+    std::atomic<uint64_t> last_ms_{0};
+    std::atomic<uint32_t> suppressed_{0};
+};
+
+}  // namespace ua
@@ -2,13 +2,23 @@
 /// @brief 框架日志系统（C++20 重写版）
 /// @note 改进: 使用 thread_local buffer，天然线程安全
 ///       改进: 去掉成员变量 buffer，避免多线程竞争
+///       日志宏先过编译期下限 UA_LOG_MIN_LEVEL 和模块级别表（见 log_level.h），关闭时开销只有一次原子读
+///       TRACE/DEBUG 额外受 LogGidFilter 控制：关注的 gid 即使级别关闭也输出（定向排查单个玩家）
+///       热点路径可用 UA_LOG_*_EVERY_N / _EVERY_MS / _RATE 按调用点限频（见 log_limiter.h）
+///       二进制模式下日志宏不再格式化，只记录调用点 id 和原始参数（见 binary_log.h），需先启动 AsyncLogger
+///       FlightRecorder 开启时，不论正常级别如何，达到其记录级别的日志都写入共享内存飞行记录（见 flight_recorder.h）
 #pragma once
 
 #include <cassert>
 #include <cstdarg>
 #include <cstdio>
 #include <functional>
+#include "binary_log.h"
 #include "context_mgr.h"
+#include "flight_recorder.h"
+#include "log_gid_filter.h"
+#include "log_level.h"
+#include "log_limiter.h"
 #include "patterns/singleton.h"
 #include "server_statistics.h"
 
@@ -58,12 +68,44 @@ public:
             output_func_(priority, msg, len);
     }
 
+    /// 设置级别判定函数，同时把它放行的最高级别同步到 LogLevelTable 所有模块，
+    /// 关闭的级别在日志宏里一次 relaxed 读就被拒绝，不再访问单例和 std::function
+    /// @note 会覆盖之前按模块设置的级别；func 的结果若运行期变化，变化后需调用 SyncLevelTable
     using CanOutputFunc = std::function<bool(PriorityType)>;
-    void SetCanOutputFunc(CanOutputFunc func) { can_output_func_ = std::move(func); }
+    void SetCanOutputFunc(CanOutputFunc func)
+    {
+        can_output_func_ = std::move(func);
+        SyncLevelTable();
+    }
+
+    /// 按级别上限过滤的便捷写法，等价于 SetCanOutputFunc(p <= level)
+    void SetLevel(PriorityType level)
+    {
+        SetCanOutputFunc([level](PriorityType priority) { return priority <= level; });
+    }
+
+    /// 从高到低探测 CanOutputFunc 放行的最高级别，写入所有模块；未设置时全部关闭
+    void SyncLevelTable()
+    {
+        uint8_t level = PRIORITY_NULL;
+        for (int32_t priority = PRIORITY_MAX - 1; priority > PRIORITY_NULL && can_output_func_; --priority)
+        {
+            if (can_output_func_(static_cast<PriorityType>(priority)))
+            {
+                level = static_cast<uint8_t>(priority);
+                break;
+            }
+        }
+        LogLevelTable::SetAllLevel(level);
+    }
 
     using OutputFunc = std::function<void(PriorityType, const char*, uint32_t)>;
     void SetOutputFunc(OutputFunc func) { output_func_ = std::move(func); }
 
+    /// 二进制（延迟格式化）模式开关，记录直接写入 AsyncLogger，不经过 OutputFunc
+    void SetBinaryMode(bool enable) noexcept { binary_mode_ = enable; }
+    [[nodiscard]] bool IsBinaryMode() const noexcept { return binary_mode_; }
+
 private:
     friend class Singleton<Logger>;
     Logger() = default;
@@ -78,6 +120,7 @@ private:
 
     CanOutputFunc can_output_func_;
     OutputFunc output_func_;
+    bool binary_mode_ = false;
 };
 
 }  // namespace ua
@@ -85,45 +128,140 @@ private:
 // ========== 日志宏 ==========
 #define _FILE_NAME_ ((__builtin_strrchr(__FILE__, '/') ?: __FILE__ - 1) + 1)
 
-#define _UA_LOG_(priority, level, format, ...)                                                      \
-    {                                                                                               \
-        if (ua::Logger::GetInst().CanOutput(priority))                                              \
-        {                                                                                           \
-            ua::ServerStatistics::GetInst().statistics().inc_log_##level##_num();                    \
-            uint32_t _fmt_str_len_ = ua::Logger::GetInst().Format(format, ##__VA_ARGS__);           \
-            ua::Logger::GetInst().Output(priority, ua::Logger::GetInst().GetBuff(), _fmt_str_len_); \
-        }                                                                                           \
+/// 格式化并输出一条日志（级别已判定通过）
+/// 调用点 _ua_log_site_ 由外层宏定义
+#define _UA_LOG_EMIT_(priority, level, tag, uid, format, ...)                                                  \
+    {                                                                                                        \
+        ua::ServerStatistics::GetInst().statistics().inc_log_##level##_num();                                 \
+        if (ua::Logger::GetInst().IsBinaryMode())                                                            \
+        {                                                                                                    \
+            ua::BinaryLog::Write(_ua_log_site_, ua::ContextMgr::GetContextId(), uid, ##__VA_ARGS__);         \
+        }                                                                                                    \
+        else                                                                                                 \
+        {                                                                                                    \
+            uint32_t _fmt_str_len_ =                                                                         \
+                ua::Logger::GetInst().Format("[" tag "]|%lu|%lu|%s:%d:%s|" format, ua::ContextMgr::GetContextId(), \
+                                             uid, _FILE_NAME_, __LINE__, __FUNCTION__, ##__VA_ARGS__);       \
+            ua::Logger::GetInst().Output(priority, ua::Logger::GetInst().GetBuff(), _fmt_str_len_);          \
+        }                                                                                                    \
+    }
+
+/// 写入飞行记录器，独立于正常日志级别（见 flight_recorder.h）
+#define _UA_LOG_FLIGHT_(priority, uid, ...)                                                              \
+    if (__builtin_expect(ua::FlightRecorder::Accept(priority), 0))                                       \
+    {                                                                                                    \
+        ua::FlightRecorder::RecordLog(_ua_log_site_, ua::ContextMgr::GetContextId(), uid, ##__VA_ARGS__); \
+    }
+
+/// 1. 编译期: 低于 UA_LOG_MIN_LEVEL 的分支被 if constexpr 剔除
+/// 2. 运行期: 先查模块级别表（一次 relaxed 读），通过后才访问 Logger 单例和 CanOutputFunc
+#define _UA_LOG_(priority, level, tag, uid, format, ...)                                                 \
+    {                                                                                                    \
+        if constexpr ((priority) <= UA_LOG_MIN_LEVEL)                                                    \
+        {                                                                                                \
+            static ua::LogSite _ua_log_site_{format, _FILE_NAME_, __FUNCTION__, __LINE__, priority};     \
+            const uint64_t _ua_log_uid_ = static_cast<uint64_t>(uid);                                    \
+            _UA_LOG_FLIGHT_(priority, _ua_log_uid_, ##__VA_ARGS__);                                      \
+            if (__builtin_expect(ua::LogLevelTable::Enabled<UA_LOG_MODULE>(priority), 0) &&              \
+                ua::Logger::GetInst().CanOutput(priority))                                               \
+            {                                                                                            \
+                _UA_LOG_EMIT_(priority, level, tag, _ua_log_uid_, format, ##__VA_ARGS__);                \
+            }                                                                                            \
+        }                                                                                                \
+    }
+
+/// TRACE/DEBUG: 级别关闭时，uid 或当前上下文 gid 在 LogGidFilter 关注集合中仍然输出
+#define _UA_LOG_WATCHED_(priority, level, tag, uid, format, ...)                                         \
+    {                                                                                                    \
+        if constexpr ((priority) <= UA_LOG_MIN_LEVEL)                                                    \
+        {                                                                                                \
+            static ua::LogSite _ua_log_site_{format, _FILE_NAME_, __FUNCTION__, __LINE__, priority};     \
+            const uint64_t _ua_log_uid_ = static_cast<uint64_t>(uid);                                    \
+            _UA_LOG_FLIGHT_(priority, _ua_log_uid_, ##__VA_ARGS__);                                      \
+            if ((__builtin_expect(ua::LogLevelTable::Enabled<UA_LOG_MODULE>(priority), 0) &&             \
+                 ua::Logger::GetInst().CanOutput(priority)) ||                                           \
+                ua::LogGidFilter::ShouldLog(_ua_log_uid_))                                               \
+            {                                                                                            \
+                _UA_LOG_EMIT_(priority, level, tag, _ua_log_uid_, format, ##__VA_ARGS__);                \
+            }                                                                                            \
+        }                                                                                                \
     }
 
-#define UA_LOG_TRACE(uid, format, ...)                                                                            \
-    {                                                                                                             \
-        _UA_LOG_(ua::Logger::PRIORITY_TRACE, trace, "[TRACE]|%lu|%lu|%s:%d:%s|" format,                           \
-                 ua::ContextMgr::GetContextId(), static_cast<uint64_t>(uid), _FILE_NAME_, __LINE__, __FUNCTION__, \
-                 ##__VA_ARGS__);                                                                                  \
+#define UA_LOG_TRACE(uid, format, ...)                                                           \
+    {                                                                                            \
+        _UA_LOG_WATCHED_(ua::Logger::PRIORITY_TRACE, trace, "TRACE", uid, format, ##__VA_ARGS__); \
     }
 
-#define UA_LOG_DEBUG(uid, format, ...)                                                                            \
-    {                                                                                                             \
-        _UA_LOG_(ua::Logger::PRIORITY_DEBUG, debug, "[DEBUG]|%lu|%lu|%s:%d:%s|" format,                           \
-                 ua::ContextMgr::GetContextId(), static_cast<uint64_t>(uid), _FILE_NAME_, __LINE__, __FUNCTION__, \
-                 ##__VA_ARGS__);                                                                                  \
+#define UA_LOG_DEBUG(uid, format, ...)                                                           \
+    {                                                                                            \
+        _UA_LOG_WATCHED_(ua::Logger::PRIORITY_DEBUG, debug, "DEBUG", uid, format, ##__VA_ARGS__); \
     }
 
-#define UA_LOG_INFO(uid, format, ...)                                                                                \
-    {                                                                                                                \
-        _UA_LOG_(ua::Logger::PRIORITY_INFO, info, "[INFO]|%lu|%lu|%s:%d:%s|" format, ua::ContextMgr::GetContextId(), \
-                 static_cast<uint64_t>(uid), _FILE_NAME_, __LINE__, __FUNCTION__, ##__VA_ARGS__);                    \
+#define UA_LOG_INFO(uid, format, ...)                                                 \
+    {                                                                                 \
+        _UA_LOG_(ua::Logger::PRIORITY_INFO, info, "INFO", uid, format, ##__VA_ARGS__); \
     }
 
-#define UA_LOG_WARN(uid, format, ...)                                                                                \
-    {                                                                                                                \
-        _UA_LOG_(ua::Logger::PRIORITY_WARN, warn, "[WARN]|%lu|%lu|%s:%d:%s|" format, ua::ContextMgr::GetContextId(), \
-                 static_cast<uint64_t>(uid), _FILE_NAME_, __LINE__, __FUNCTION__, ##__VA_ARGS__);                    \
+#define UA_LOG_WARN(uid, format, ...)                                                 \
+    {                                                                                 \
+        _UA_LOG_(ua::Logger::PRIORITY_WARN, warn, "WARN", uid, format, ##__VA_ARGS__); \
     }
 
-#define UA_LOG_ERROR(uid, format, ...)                                                                            \
-    {                                                                                                             \
-        _UA_LOG_(ua::Logger::PRIORITY_ERROR, error, "[ERROR]|%lu|%lu|%s:%d:%s|" format,                           \
-                 ua::ContextMgr::GetContextId(), static_cast<uint64_t>(uid), _FILE_NAME_, __LINE__, __FUNCTION__, \
-                 ##__VA_ARGS__);                                                                                  \
+#define UA_LOG_ERROR(uid, format, ...)                                                   \
+    {                                                                                    \
+        _UA_LOG_(ua::Logger::PRIORITY_ERROR, error, "ERROR", uid, format, ##__VA_ARGS__); \
     }
+
+// ========== 限频日志宏 ==========
+/// 级别通过后再过调用点限频器；被抑制的条数计入 ServerStatistics，下一条放行的日志带 "|suppressed(N)"
+/// LEVEL 取 ERROR/WARN/INFO/DEBUG/TRACE，limiter_args 为限频器构造参数（带括号）
+#define _UA_LOG_LIMITED_(LEVEL, limiter_type, limiter_args, uid, format, ...)                                   \
+    {                                                                                                           \
+        if constexpr ((ua::Logger::PRIORITY_##LEVEL) <= UA_LOG_MIN_LEVEL)                                       \
+        {                                                                                                       \
+            if (__builtin_expect(ua::LogLevelTable::Enabled<UA_LOG_MODULE>(ua::Logger::PRIORITY_##LEVEL), 0))   \
+            {                                                                                                   \
+                static limiter_type _ua_log_limiter_ limiter_args;                                              \
+                uint32_t _ua_log_suppressed_ = 0;                                                               \
+                if (_ua_log_limiter_.Allow(_ua_log_suppressed_))                                                \
+                {                                                                                               \
+                    UA_LOG_##LEVEL(uid, format "|suppressed(%u)", ##__VA_ARGS__, _ua_log_suppressed_);          \
+                }                                                                                               \
+                else                                                                                            \
+                {                                                                                               \
+                    ua::ServerStatistics::GetInst().statistics().inc_log_suppressed_num();                       \
+                }                                                                                               \
+            }                                                                                                   \
+        }                                                                                                       \
+    }
+
+/// 每 n 条输出一条
+#define UA_LOG_ERROR_EVERY_N(n, uid, format, ...) _UA_LOG_LIMITED_(ERROR, ua::LogEveryN, (n), uid, format, ##__VA_ARGS__)
+#define UA_LOG_WARN_EVERY_N(n, uid, format, ...) _UA_LOG_LIMITED_(WARN, ua::LogEveryN, (n), uid, format, ##__VA_ARGS__)
+#define UA_LOG_INFO_EVERY_N(n, uid, format, ...) _UA_LOG_LIMITED_(INFO, ua::LogEveryN, (n), uid, format, ##__VA_ARGS__)
+#define UA_LOG_DEBUG_EVERY_N(n, uid, format, ...) _UA_LOG_LIMITED_(DEBUG, ua::LogEveryN, (n), uid, format, ##__VA_ARGS__)
+#define UA_LOG_TRACE_EVERY_N(n, uid, format, ...) _UA_LOG_LIMITED_(TRACE, ua::LogEveryN, (n), uid, format, ##__VA_ARGS__)
+
+/// 每 ms 毫秒最多输出一条
+#define UA_LOG_ERROR_EVERY_MS(ms, uid, format, ...) \
+    _UA_LOG_LIMITED_(ERROR, ua::LogEveryMs, (ms), uid, format, ##__VA_ARGS__)
+#define UA_LOG_WARN_EVERY_MS(ms, uid, format, ...) \
+    _UA_LOG_LIMITED_(WARN, ua::LogEveryMs, (ms), uid, format, ##__VA_ARGS__)
+#define UA_LOG_INFO_EVERY_MS(ms, uid, format, ...) \
+    _UA_LOG_LIMITED_(INFO, ua::LogEveryMs, (ms), uid, format, ##__VA_ARGS__)
+#define UA_LOG_DEBUG_EVERY_MS(ms, uid, format, ...) \
+    _UA_LOG_LIMITED_(DEBUG, ua::LogEveryMs, (ms), uid, format, ##__VA_ARGS__)
+#define UA_LOG_TRACE_EVERY_MS(ms, uid, format, ...) \
+    _UA_LOG_LIMITED_(TRACE, ua::LogEveryMs, (ms), uid, format, ##__VA_ARGS__)
+
+/// 令牌桶：每秒 rate 条，允许突发 burst 条
+#define UA_LOG_ERROR_RATE(rate, burst, uid, format, ...) \
+    _UA_LOG_LIMITED_(ERROR, ua::LogTokenBucket, (rate, burst), uid, format, ##__VA_ARGS__)
+#define UA_LOG_WARN_RATE(rate, burst, uid, format, ...) \
+    _UA_LOG_LIMITED_(WARN, ua::LogTokenBucket, (rate, burst), uid, format, ##__VA_ARGS__)
+#define UA_LOG_INFO_RATE(rate, burst, uid, format, ...) \
+    _UA_LOG_LIMITED_(INFO, ua::LogTokenBucket, (rate, burst), uid, format, ##__VA_ARGS__)
+#define UA_LOG_DEBUG_RATE(rate, burst, uid, format, ...) \
+    _UA_LOG_LIMITED_(DEBUG, ua::LogTokenBucket, (rate, burst), uid, format, ##__VA_ARGS__)
+#define UA_LOG_TRACE_RATE(rate, burst, uid, format, ...) \
+    _UA_LOG_LIMITED_(TRACE, ua::LogTokenBucket, (rate, burst), uid, format, ##__VA_ARGS__)
@@ -0,0 +1,238 @@
+/// @file pending_table.cpp
+/// @brief 挂起 RPC 表实现
+#include "pending_table.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+namespace ua
+{
+
+namespace
+{
+
+/// 新槽的初始代数：进程启动时取随机种子，之后递增并打散（各表、各分片线程共用）
+uint32_t RandomGeneration() noexcept
+{
+    static const uint64_t seed = []() {
+        std::random_device rd;
+        auto now = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        return (static_cast<uint64_t>(rd()) << 32) ^ rd() ^ now;
+    }();
+    static std::atomic<uint64_t> counter{0};
+    uint64_t value = seed + counter.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ULL;
+    value ^= value >> 31;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 29;
+    return static_cast<uint32_t>(value >> 32);
+}
+
+}  // namespace
+
+PendingTable::PendingTable(uint32_t bucket_ms, uint32_t bucket_num) : bucket_ms_(std::max<uint32_t>(bucket_ms, 1))
+{
+    uint64_t num = 1;
+    while (num < bucket_num)
+        num <<= 1;
+    buckets_.assign(num, kNil);
+    bucket_mask_ = num - 1;
+}
+
+uint32_t PendingTable::Resolve(uint64_t seq_id) const noexcept
+{
+    uint32_t index = kNil;
+    if (IsTableID(seq_id))
+    {
+        index = static_cast<uint32_t>(seq_id);
+    }
+    else
+    {
+        auto iter = foreign_index_.find(seq_id);
+        if (iter == foreign_index_.end())
+            return kNil;
+        index = iter->second;
+    }
+    if (index >= slots_.size())
+        return kNil;
+    const Slot& slot = slots_[index];
+    if (slot.state == SlotState::kFree || slot.key != seq_id)
+        return kNil;
+    return index;
+}
+
+uint32_t PendingTable::AllocSlot()
+{
+    uint32_t index = free_head_;
+    if (index != kNil)
+    {
+        free_head_ = slots_[index].next;
+    }
+    else
+    {
+        index = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+        slots_.back().generation = RandomGeneration();
+    }
+    Slot& slot = slots_[index];
+    slot.ctx = nullptr;
+    slot.key = MakeID(index, slot.generation);
+    slot.prev = kNil;
+    slot.next = kNil;
+    slot.state = SlotState::kReserved;
+    ++used_num_;
+    return index;
+}
+
+void PendingTable::FreeSlot(uint32_t index) noexcept
+{
+    Slot& slot = slots_[index];
+    Unlink(index);
+    if (slot.state == SlotState::kPending)
+        --pending_num_;
+    if (!IsTableID(slot.key))
+        foreign_index_.erase(slot.key);
+    // 代数加一，旧 seq_id 之后都查不到
+    ++slot.generation;
+    slot.ctx = nullptr;
+    slot.key = 0;
+    slot.state = SlotState::kFree;
+    slot.next = free_head_;
+    free_head_ = index;
+    --used_num_;
+}
+
+void PendingTable::Link(uint32_t index, uint64_t expire_ms) noexcept
+{
+    // 向上取整保证不提前超时；已处理过的桶不会再访问，放到下一个桶
+    Slot& slot = slots_[index];
+    slot.expire_tick = std::max((expire_ms + bucket_ms_ - 1) / bucket_ms_, cur_tick_ + 1);
+    uint32_t& head = buckets_[slot.expire_tick & bucket_mask_];
+    slot.prev = kNil;
+    slot.next = head;
+    if (head != kNil)
+        slots_[head].prev = index;
+    head = index;
+}
+
+void PendingTable::Unlink(uint32_t index) noexcept
+{
+    Slot& slot = slots_[index];
+    if (slot.prev != kNil)
+        slots_[slot.prev].next = slot.next;
+    else
+        buckets_[slot.expire_tick & bucket_mask_] = slot.next;
+    if (slot.next != kNil)
+        slots_[slot.next].prev = slot.prev;
+    slot.prev = kNil;
+    slot.next = kNil;
+}
+
+uint64_t PendingTable::Reserve(uint64_t expire_ms)
+{
+    uint32_t index = AllocSlot();
+    Link(index, expire_ms);
+    return slots_[index].key;
+}
+
+void PendingTable::Release(uint64_t seq_id) noexcept
+{
+    uint32_t index = Resolve(seq_id);
+    if (index != kNil && slots_[index].state == SlotState::kReserved)
+        FreeSlot(index);
+}
+
+bool PendingTable::Add(uint64_t& seq_id, ClientContext* ctx, uint64_t expire_ms)
+{
+    uint32_t index = kNil;
+    if (seq_id == 0)
+    {
+        index = AllocSlot();
+        seq_id = slots_[index].key;
+    }
+    else if (IsTableID(seq_id))
+    {
+        index = Resolve(seq_id);
+        if (index == kNil || slots_[index].state != SlotState::kReserved)
+            return false;
+        Unlink(index);
+    }
+    else
+    {
+        if (foreign_index_.contains(seq_id))
+            return false;
+        index = AllocSlot();
+        slots_[index].key = seq_id;
+        foreign_index_.emplace(seq_id, index);
+    }
+
+    Slot& slot = slots_[index];
+    slot.ctx = ctx;
+    slot.state = SlotState::kPending;
+    ++pending_num_;
+    Link(index, expire_ms);
+    return true;
+}
+
+ClientContext* PendingTable::Remove(uint64_t seq_id) noexcept
+{
+    uint32_t index = Resolve(seq_id);
+    if (index == kNil || slots_[index].state != SlotState::kPending)
+        return nullptr;
+    ClientContext* ctx = slots_[index].ctx;
+    FreeSlot(index);
+    return ctx;
+}
+
+bool PendingTable::Contains(uint64_t seq_id) const noexcept
+{
+    uint32_t index = Resolve(seq_id);
+    return index != kNil && slots_[index].state == SlotState::kPending;
+}
+
+void PendingTable::Expire(uint64_t now_ms, std::vector<uint64_t>& expired)
+{
+    uint64_t now_tick = now_ms / bucket_ms_;
+    if (now_tick <= cur_tick_)
+        return;
+    if (used_num_ == 0)
+    {
+        cur_tick_ = now_tick;
+        return;
+    }
+
+    // 落后超过一圈时每个桶只需看一次
+    uint64_t steps = std::min<uint64_t>(now_tick - cur_tick_, bucket_mask_ + 1);
+    for (uint64_t i = 1; i <= steps; ++i)
+    {
+        uint32_t index = buckets_[(cur_tick_ + i) & bucket_mask_];
+        while (index != kNil)
+        {
+            Slot& slot = slots_[index];
+            uint32_t next = slot.next;
+            if (slot.expire_tick <= now_tick)
+            {
+                if (slot.state == SlotState::kPending)
+                    expired.push_back(slot.key);
+                else
+                    FreeSlot(index);
+            }
+            index = next;
+        }
+    }
+    cur_tick_ = now_tick;
+}
+
+uint64_t PendingTable::NextExpireTime() const noexcept
+{
+    if (used_num_ == 0)
+        return 0;
+    for (uint64_t tick = cur_tick_ + 1; tick <= cur_tick_ + bucket_mask_ + 1; ++tick)
+    {
+        if (buckets_[tick & bucket_mask_] != kNil)
+            return tick * bucket_ms_;
+    }
+    return 0;
+}
+
+}  // namespace ua
@@ -0,0 +1,107 @@
+/// @file pending_table.h
+/// @brief 挂起 RPC 表：seq_id 编码槽号 + 代数，粗粒度时间轮超时
+/// @note 本表分配的 seq_id = 最高位标记 | 31 位代数 << 32 | 32 位槽号，查找直接下标访问，无需哈希；
+///       槽释放时代数加一，迟到或重复的回包因代数不符查不到
+///       新槽的初始代数随机（进程级随机种子 + 计数打散）：不同分片、重启前后的表槽号相同但代数不同，
+///       路由错分片或重启前发出的回包只有 2^-31 的概率撞上活跃的槽
+///       超时按 bucket_ms 向上取整放进时间轮的桶里（不会提前，最多晚一个桶），
+///       超出一圈的超时留在桶里等下一圈再判断
+///       调用方自带的 seq_id（最高位为 0，如 IDGenerator 生成的）走兼容索引，仍占槽、走时间轮
+///       单线程使用
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ua
+{
+
+struct ClientContext;
+
+class PendingTable
+{
+public:
+    static constexpr uint32_t kDefaultBucketMs = 8;
+    static constexpr uint32_t kDefaultBucketNum = 512;  // 一圈约 4 秒，覆盖默认 3 秒超时
+
+    /// bucket_num 向上取整为 2 的幂
+    explicit PendingTable(uint32_t bucket_ms = kDefaultBucketMs, uint32_t bucket_num = kDefaultBucketNum);
+
+    /// 是否为本表分配的 seq_id
+    [[nodiscard]] static constexpr bool IsTableID(uint64_t seq_id) noexcept { return (seq_id & kTableFlag) != 0; }
+
+    /// 预留一个槽并返回 seq_id，发包前取号用；到 expire_ms 仍未 Add 则自动释放
+    [[nodiscard]] uint64_t Reserve(uint64_t expire_ms);
+    /// 释放未挂起的预留，其他情况不做任何事
+    void Release(uint64_t seq_id) noexcept;
+
+    /// 挂起 ctx，expire_ms 到期后由 Expire 报告
+    /// seq_id 为 0 时分配并回填；为 Reserve 的结果时使用该槽；其他值走兼容索引
+    /// seq_id 已挂起、预留已失效或兼容索引重复时返回 false
+    bool Add(uint64_t& seq_id, ClientContext* ctx, uint64_t expire_ms);
+    /// 摘除挂起的上下文并释放槽，不存在（含代数不符）返回 nullptr
+    ClientContext* Remove(uint64_t seq_id) noexcept;
+    /// 是否有挂起的 seq_id
+    [[nodiscard]] bool Contains(uint64_t seq_id) const noexcept;
+
+    /// 推进时间轮到 now_ms：到期的挂起 seq_id 追加到 expired（不摘除，由调用方 Remove），到期的预留直接释放
+    void Expire(uint64_t now_ms, std::vector<uint64_t>& expired);
+    /// 最近一个非空桶的到期时间（可能早于实际超时），没有挂起和预留返回 0
+    [[nodiscard]] uint64_t NextExpireTime() const noexcept;
+
+    /// 挂起的数量（不含预留）
+    [[nodiscard]] size_t PendingNum() const noexcept { return pending_num_; }
+    /// 预留但未挂起的数量
+    [[nodiscard]] size_t ReservedNum() const noexcept { return used_num_ - pending_num_; }
+    /// 已分配的槽数（只增不减，空闲槽复用）
+    [[nodiscard]] size_t SlotNum() const noexcept { return slots_.size(); }
+
+private:
+    static constexpr uint64_t kTableFlag = 1ULL << 63;
+    static constexpr uint32_t kGenMask = 0x7FFFFFFF;
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    enum class SlotState : uint8_t
+    {
+        kFree = 0,
+        kReserved = 1,
+        kPending = 2,
+    };
+
+    struct Slot
+    {
+        ClientContext* ctx = nullptr;
+        uint64_t key = 0;          // 调用方看到的 seq_id
+        uint64_t expire_tick = 0;
+        uint32_t generation = 0;   // 新建时随机取值
+        uint32_t prev = kNil;      // 桶内链表；空闲时 next 串空闲链表
+        uint32_t next = kNil;
+        SlotState state = SlotState::kFree;
+    };
+
+    [[nodiscard]] static constexpr uint64_t MakeID(uint32_t index, uint32_t generation) noexcept
+    {
+        return kTableFlag | (static_cast<uint64_t>(generation & kGenMask) << 32) | index;
+    }
+
+    /// seq_id 对应的槽号，不是本表的或代数不符返回 kNil
+    [[nodiscard]] uint32_t Resolve(uint64_t seq_id) const noexcept;
+    uint32_t AllocSlot();
+    void FreeSlot(uint32_t index) noexcept;
+    void Link(uint32_t index, uint64_t expire_ms) noexcept;
+    void Unlink(uint32_t index) noexcept;
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> buckets_;  // 每个桶的链表头
+    std::unordered_map<uint64_t, uint32_t> foreign_index_;  // 调用方自带 seq_id -> 槽号
+    uint32_t free_head_ = kNil;
+    uint32_t bucket_ms_;
+    uint64_t bucket_mask_;
+    uint64_t cur_tick_ = 0;  // 已处理到的桶时刻
+    size_t used_num_ = 0;
+    size_t pending_num_ = 0;
+};
+
+}  // namespace ua
@@ -0,0 +1,134 @@
+/// @file pkg_arena.h
+/// @brief 调度器缓存包用的分级内存池
+/// @note 按 2 的幂分级（64B ~ 64KB，含块头），每级一条空闲链表，从 256KB 的大块上切分，释放只回收到链表不归还系统；
+///       超过最大级别的包单独 new/delete
+///       块头带侵入式 next 指针，调度器直接用它串队列，入队不再额外分配
+///       非线程安全，和调度器同线程使用；析构只释放大块，仍在队列里的大包由调用方 Free
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace ua
+{
+
+class PkgArena
+{
+public:
+    /// 缓存包的块头，数据紧跟其后
+    struct Pkg
+    {
+        Pkg* next = nullptr;
+        uint64_t gid = 0;
+        uint64_t seq = 0;
+        uint64_t custom_data = 0;
+        uint64_t enqueue_ms = 0;
+        uint64_t deadline_ms = 0;  // 0 表示不过期
+        uint64_t tag = 0;          // 调度器自用（如公平队列的虚拟完成时间）
+        uint32_t cmd = 0;
+        uint32_t len = 0;
+        uint8_t size_class = 0;
+
+        [[nodiscard]] char* data() noexcept { return reinterpret_cast<char*>(this + 1); }
+        [[nodiscard]] const char* data() const noexcept { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    static constexpr uint32_t kMinClassShift = 6;
+    static constexpr uint32_t kClassNum = 11;  // 64B .. 64KB
+    static constexpr uint8_t kLargeClass = 0xFF;
+    static constexpr size_t kChunkSize = 256 * 1024;
+
+    PkgArena() = default;
+    PkgArena(const PkgArena&) = delete;
+    PkgArena& operator=(const PkgArena&) = delete;
+
+    /// 分配一个块并拷贝数据
+    Pkg* Alloc(const char* data, uint32_t len)
+    {
+        size_t need = sizeof(Pkg) + len;
+        uint32_t size_class = SizeClass(need);
+        Pkg* pkg = nullptr;
+        if (size_class == kLargeClass)
+        {
+            pkg = static_cast<Pkg*>(::operator new(need));
+            large_bytes_ += need;
+        }
+        else if (free_lists_[size_class])
+        {
+            pkg = free_lists_[size_class];
+            free_lists_[size_class] = pkg->next;
+        }
+        else
+        {
+            pkg = static_cast<Pkg*>(Carve(ClassSize(size_class)));
+        }
+        new (pkg) Pkg();
+        pkg->len = len;
+        pkg->size_class = static_cast<uint8_t>(size_class);
+        if (len > 0)
+            std::memcpy(pkg->data(), data, len);
+        ++used_num_;
+        return pkg;
+    }
+
+    void Free(Pkg* pkg) noexcept
+    {
+        if (!pkg)
+            return;
+        --used_num_;
+        if (pkg->size_class == kLargeClass)
+        {
+            large_bytes_ -= sizeof(Pkg) + pkg->len;
+            ::operator delete(pkg);
+            return;
+        }
+        pkg->next = free_lists_[pkg->size_class];
+        free_lists_[pkg->size_class] = pkg;
+    }
+
+    /// 正在使用的块数
+    [[nodiscard]] size_t UsedNum() const noexcept { return used_num_; }
+    /// 从系统拿到的总字节数（大块 + 单独分配的大包）
+    [[nodiscard]] size_t ReservedBytes() const noexcept { return chunks_.size() * kChunkSize + large_bytes_; }
+
+private:
+    static constexpr size_t ClassSize(uint32_t size_class) noexcept { return size_t{1} << (size_class + kMinClassShift); }
+
+    static uint32_t SizeClass(size_t need) noexcept
+    {
+        for (uint32_t i = 0; i < kClassNum; ++i)
+        {
+            if (need <= ClassSize(i))
+                return i;
+        }
+        return kLargeClass;
+    }
+
+    void* Carve(size_t size)
+    {
+        if (chunk_remain_ < size)
+        {
+            chunks_.push_back(std::make_unique<char[]>(kChunkSize));
+            chunk_cursor_ = chunks_.back().get();
+            chunk_remain_ = kChunkSize;
+        }
+        void* ptr = chunk_cursor_;
+        chunk_cursor_ += size;
+        chunk_remain_ -= size;
+        return ptr;
+    }
+
+    std::array<Pkg*, kClassNum> free_lists_{};
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* chunk_cursor_ = nullptr;
+    size_t chunk_remain_ = 0;
+    size_t used_num_ = 0;
+    size_t large_bytes_ = 0;
+};
+
+}  // namespace ua
@@ -0,0 +1,102 @@
+/// @file recv_classifier.cpp
+/// @brief 分级收包实现
+#include "recv_classifier.h"
+#include <algorithm>
+#include "logger.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+bool RecvClassifier::Init(const Option& option, std::string* err_msg)
+{
+    if (option.enable && option.deferred_max_num == 0)
+    {
+        if (err_msg)
+            *err_msg += "recv classifier deferred_max_num is 0";
+        return false;
+    }
+    option_ = option;
+    deferred_.clear();
+    deferred_.resize(option_.enable ? option_.deferred_max_num : 0);
+    deferred_head_ = 0;
+    deferred_num_ = 0;
+    req_budget_ = kUnlimited;
+    return true;
+}
+
+uint32_t RecvClassifier::BeginFrame(uint32_t req_budget)
+{
+    req_budget_ = req_budget;
+    uint32_t count = 0;
+    replaying_ = true;
+    while (deferred_num_ > 0 && req_budget_ > 0)
+    {
+        // 先出队再重放，重放里的 Admit 只扣预算
+        DeferredPkg& pkg = deferred_[deferred_head_];
+        deferred_head_ = (deferred_head_ + 1) % deferred_.size();
+        --deferred_num_;
+        --req_budget_;
+        if (replayer_)
+            replayer_(pkg.transport_type, pkg.data.data(), pkg.data.size(), pkg.recv_id, pkg.arrived_time);
+        ++count;
+    }
+    replaying_ = false;
+    return count;
+}
+
+uint32_t RecvClassifier::ReadLimit(uint32_t exempt_num) const noexcept
+{
+    if (req_budget_ == kUnlimited)
+        return kUnlimited;
+    // 延后队列没排空时 BeginFrame 已用完预算，多读的包都受队列剩余空间约束
+    size_t space = deferred_.size() - deferred_num_;
+    return req_budget_ + static_cast<uint32_t>(std::min<size_t>(exempt_num, space));
+}
+
+bool RecvClassifier::Admit(uint32_t flag, uint32_t transport_type, const char* data, size_t len, uint32_t recv_id,
+                           uint64_t arrived_time)
+{
+    if (!option_.enable)
+        return true;
+
+    auto& statistics = ServerStatistics::GetInst().statistics();
+    PkgClass pkg_class = Classify(flag);
+    if (pkg_class == PkgClass::kResponse)
+    {
+        statistics.inc_recv_rsp_num();
+        return true;
+    }
+    if (pkg_class == PkgClass::kKey)
+    {
+        statistics.inc_recv_key_num();
+        return true;
+    }
+
+    if (replaying_ || req_budget_ == kUnlimited)
+        return true;
+    // 还有延后的请求时新请求也要排队，保持到达顺序
+    if (req_budget_ > 0 && deferred_num_ == 0)
+    {
+        --req_budget_;
+        return true;
+    }
+
+    if (deferred_num_ == deferred_.size())
+    {
+        // 只有绕过 ReadLimit 收包才会走到这里，直接处理比丢弃好
+        UA_LOG_WARN_EVERY_MS(1000, 0, "recv classifier deferred queue full(%zu), deal inline", deferred_num_);
+        return true;
+    }
+
+    DeferredPkg& pkg = deferred_[(deferred_head_ + deferred_num_) % deferred_.size()];
+    pkg.transport_type = transport_type;
+    pkg.recv_id = recv_id;
+    pkg.arrived_time = arrived_time;
+    pkg.data.assign(data, data + len);
+    ++deferred_num_;
+    statistics.inc_recv_deferred_num();
+    return false;
+}
+
+}  // namespace ua
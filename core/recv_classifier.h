@@ -0,0 +1,91 @@
+/// @file recv_classifier.h
+/// @brief 按包类型分级收包：回包和关键包优先，普通请求受流控预算约束
+/// @note 收包阶段的每个包按标志位分为三类:
+///       kResponse 回包（唤醒挂起的上下文），总是立即处理
+///       kKey      关键包（客户端/服务器关键包），总是立即处理，不受流控缩减影响
+///       kNormal   普通请求，本帧预算（流控结果）用完后拷贝进延后队列，下一帧开头在预算内优先重放
+///       每帧从 channel 多读的包数不超过 exempt_num 和延后队列剩余空间，延后队列不会溢出；
+///       回包和关键包因此可以越过普通请求先被读到，普通请求整体仍按到达顺序处理
+///       标志位掩码由使用方给出（PBService 使用 FLAG_RSP_PKG / FLAG_*_KEY_PKG）
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace ua
+{
+
+class RecvClassifier
+{
+public:
+    enum class PkgClass : uint8_t
+    {
+        kResponse = 0,
+        kKey = 1,
+        kNormal = 2,
+    };
+
+    struct Option
+    {
+        bool enable = false;
+        uint32_t rsp_flag_mask = 0x0001;     // 回包标志位
+        uint32_t key_flag_mask = 0x0030;     // 关键包标志位
+        uint32_t deferred_max_num = 1024;    // 延后队列容量
+        uint32_t exempt_num = 0;             // 每帧额外读包上限（回包/关键包），0 表示取流控的 max_num
+    };
+
+    /// 重放延后的请求，走和收包相同的处理流程
+    using Replayer =
+        std::function<void(uint32_t transport_type, const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time)>;
+
+    bool Init(const Option& option, std::string* err_msg = nullptr);
+    void SetReplayer(Replayer replayer) { replayer_ = std::move(replayer); }
+
+    [[nodiscard]] bool Enabled() const noexcept { return option_.enable; }
+    [[nodiscard]] const Option& GetOption() const noexcept { return option_; }
+    [[nodiscard]] PkgClass Classify(uint32_t flag) const noexcept
+    {
+        if (flag & option_.rsp_flag_mask)
+            return PkgClass::kResponse;
+        if (flag & option_.key_flag_mask)
+            return PkgClass::kKey;
+        return PkgClass::kNormal;
+    }
+
+    /// 收包阶段开始：设置本帧普通请求预算并先重放延后的请求，返回重放个数
+    uint32_t BeginFrame(uint32_t req_budget);
+    /// 本帧还能从 channel 读的包数
+    [[nodiscard]] uint32_t ReadLimit(uint32_t exempt_num) const noexcept;
+    /// 收包阶段结束，之后（如 OnProc 里手动收包）不再延后
+    void EndFrame() noexcept { req_budget_ = kUnlimited; }
+
+    /// 收到一个解码后的包，返回 true 表示立即处理，false 表示已拷贝进延后队列
+    bool Admit(uint32_t flag, uint32_t transport_type, const char* data, size_t len, uint32_t recv_id,
+               uint64_t arrived_time);
+
+    [[nodiscard]] size_t DeferredNum() const noexcept { return deferred_num_; }
+
+private:
+    struct DeferredPkg
+    {
+        uint32_t transport_type = 0;
+        uint32_t recv_id = 0;
+        uint64_t arrived_time = 0;
+        std::vector<char> data;  // 复用容量
+    };
+
+    static constexpr uint32_t kUnlimited = std::numeric_limits<uint32_t>::max();
+
+    Option option_;
+    Replayer replayer_;
+    std::vector<DeferredPkg> deferred_;  // 环形队列
+    size_t deferred_head_ = 0;
+    size_t deferred_num_ = 0;
+    uint32_t req_budget_ = kUnlimited;
+    bool replaying_ = false;
+};
+
+}  // namespace ua
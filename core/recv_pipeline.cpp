@@ -0,0 +1,285 @@
+/// @file recv_pipeline.cpp
+/// @brief 收包流水线实现
+#include "recv_pipeline.h"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "common/utils.h"
+#include "containers/spsc_ring_buf.h"
+#include "interface/codec_interface.h"
+#include "logger.h"
+
+namespace ua
+{
+
+struct RecvPipeline::Slot
+{
+    std::unique_ptr<RecvCodec> codec;
+    std::vector<char> data;  // 按需增长，之后复用容量
+    uint32_t recv_id = 0;
+    uint64_t arrived_time = 0;
+};
+
+namespace
+{
+
+/// 队列里每条记录是一个 4 字节槽号，按 8 字节对齐占 8 字节，留一倍余量给回绕
+size_t IndexQueueMemSize(uint32_t slot_num)
+{
+    size_t buf_size = 64;
+    while (buf_size < static_cast<size_t>(slot_num) * 16)
+        buf_size *= 2;
+    return SpscRingBuf::need_total_mem_size(buf_size);
+}
+
+}  // namespace
+
+RecvPipeline::RecvPipeline() = default;
+
+RecvPipeline::~RecvPipeline()
+{
+    Stop();
+}
+
+bool RecvPipeline::Start(const Option& option, std::string* err_msg)
+{
+    if (IsRunning())
+    {
+        if (err_msg)
+            *err_msg += "recv pipeline already started";
+        return false;
+    }
+    if (!option.channel || !option.codec_creator || option.slot_num == 0 || option.batch_num == 0)
+    {
+        if (err_msg)
+            *err_msg += "invalid recv pipeline option";
+        return false;
+    }
+
+    option_ = option;
+    slots_.clear();
+    for (uint32_t i = 0; i < option_.slot_num; ++i)
+    {
+        auto slot = std::make_unique<Slot>();
+        slot->codec = option_.codec_creator();
+        if (!slot->codec)
+        {
+            if (err_msg)
+                *err_msg += "create recv codec failed";
+            return false;
+        }
+        slots_.push_back(std::move(slot));
+    }
+
+    size_t mem_size = IndexQueueMemSize(option_.slot_num);
+    ready_mem_ = std::make_unique<uint8_t[]>(mem_size);
+    free_mem_ = std::make_unique<uint8_t[]>(mem_size);
+    ready_queue_ = std::make_unique<SpscRingBuf>();
+    free_queue_ = std::make_unique<SpscRingBuf>();
+    if (!ready_queue_->init(ready_mem_.get(), mem_size) || !free_queue_->init(free_mem_.get(), mem_size))
+    {
+        if (err_msg)
+            *err_msg += "init recv pipeline queue failed";
+        return false;
+    }
+
+    // 开始时所有槽都归 IO 线程
+    io_free_slots_.clear();
+    io_free_slots_.reserve(option_.slot_num);
+    for (uint32_t i = 0; i < option_.slot_num; ++i)
+        io_free_slots_.push_back(option_.slot_num - 1 - i);
+
+    option_.channel->SetCallback([this](const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time) {
+        return OnIORecv(data, len, recv_id, arrived_time);
+    });
+
+    stop_.store(false, std::memory_order_relaxed);
+    io_thread_ = std::thread([this]() { IOMain(); });
+    UA_LOG_INFO(0, "recv pipeline start, slot_num:%u, batch_num:%u", option_.slot_num, option_.batch_num);
+    return true;
+}
+
+void RecvPipeline::Stop()
+{
+    if (!IsRunning())
+        return;
+    stop_.store(true, std::memory_order_release);
+    io_thread_.join();
+    TakeOverStatistics();
+}
+
+uint32_t RecvPipeline::MyID() const
+{
+    return option_.channel->MyID();
+}
+
+int32_t RecvPipeline::Send(uint32_t dest_id, const char* buff, size_t buff_len)
+{
+    return option_.channel->Send(dest_id, buff, buff_len);
+}
+
+size_t RecvPipeline::Loop(uint32_t max_recv_count)
+{
+    if (!ready_queue_)
+        return 0;
+    if (io_stat_ready_.load(std::memory_order_relaxed))
+        TakeOverStatistics();
+
+    size_t count = 0;
+    uint32_t len = 0;
+    const uint8_t* item = nullptr;
+    while (count < max_recv_count && (item = ready_queue_->front(len)) != nullptr)
+    {
+        uint32_t index = 0;
+        std::memcpy(&index, item, sizeof(index));
+        ready_queue_->pop();
+
+        Slot& slot = *slots_[index];
+        if (decoded_callback_)
+            decoded_callback_(*slot.codec, slot.data.data(), slot.data.size(), slot.recv_id, slot.arrived_time);
+        else if (recv_callback_)
+            recv_callback_(slot.data.data(), slot.data.size(), slot.recv_id, slot.arrived_time);
+
+        // 槽数不超过队列容量，归还不会失败
+        free_queue_->push(&index, sizeof(index));
+        ++count;
+    }
+    return count;
+}
+
+void RecvPipeline::IOMain()
+{
+    if (option_.cpu >= 0)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(option_.cpu, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+            UA_LOG_WARN(0, "recv pipeline set cpu affinity failed, cpu:%d", option_.cpu);
+    }
+
+    uint64_t next_hand_over_ms = 0;
+    while (!stop_.load(std::memory_order_acquire))
+    {
+        if (io_now_ms_ >= next_hand_over_ms)
+        {
+            HandOverStatistics();
+            next_hand_over_ms = io_now_ms_ + kStatHandOverMs;
+        }
+
+        // 收回逻辑线程处理完的槽
+        uint32_t len = 0;
+        const uint8_t* item = nullptr;
+        while ((item = free_queue_->front(len)) != nullptr)
+        {
+            uint32_t index = 0;
+            std::memcpy(&index, item, sizeof(index));
+            free_queue_->pop();
+            io_free_slots_.push_back(index);
+        }
+
+        size_t recv_num = 0;
+        if (io_free_slots_.empty())
+        {
+            // 逻辑线程跟不上，包留在真实 channel 里
+            full_num_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            io_now_ms_ = utils::CurrentRealMilliSec();
+            uint32_t max_recv = std::min<uint32_t>(option_.batch_num, static_cast<uint32_t>(io_free_slots_.size()));
+            recv_num = option_.channel->Loop(max_recv);
+        }
+
+        if (recv_num == 0)
+        {
+            if (option_.idle_sleep_us > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(option_.idle_sleep_us));
+            else
+                std::this_thread::yield();
+        }
+    }
+    HandOverStatistics();
+}
+
+int32_t RecvPipeline::OnIORecv(const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time)
+{
+    recv_num_.fetch_add(1, std::memory_order_relaxed);
+    if (io_free_slots_.empty())
+    {
+        // channel 回调次数超过 Loop 的上限时才会走到这里
+        full_num_.fetch_add(1, std::memory_order_relaxed);
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "recv pipeline no free slot, drop pkg, recv_id:%u", recv_id);
+        return -1;
+    }
+
+    uint32_t index = io_free_slots_.back();
+    Slot& slot = *slots_[index];
+    slot.data.assign(data, data + len);
+    slot.recv_id = recv_id;
+    slot.arrived_time = arrived_time;
+
+    RecvCodec& codec = *slot.codec;
+    codec.Reset();
+    if (!codec.Decode(slot.data.data(), static_cast<uint32_t>(len)))
+    {
+        decode_fail_num_.fetch_add(1, std::memory_order_relaxed);
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "recv pipeline decode pkg failed, recv_id:%u, len:%zu", recv_id, len);
+        return -1;
+    }
+
+    uint64_t timeout = codec.GetTimeout();
+    if (option_.drop_expired && timeout > 0 && timeout < io_now_ms_)
+    {
+        expire_drop_num_.fetch_add(1, std::memory_order_relaxed);
+        UA_LOG_WARN_RATE(20, 50, codec.GetGid(), "recv pipeline drop expired pkg, cmd(0x%08X), seq_id(%lu), expired(%lu)",
+                         codec.GetCmd(), codec.GetSeqID(), timeout);
+        return 0;
+    }
+
+    if (option_.validator && !option_.validator(codec))
+    {
+        validate_drop_num_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    io_free_slots_.pop_back();
+    ready_queue_->push(&index, sizeof(index));
+    ready_num_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+void RecvPipeline::HandOverStatistics()
+{
+    auto& local = ServerStatistics::GetInst();
+    {
+        std::lock_guard<std::mutex> lock(stat_mutex_);
+        io_stat_.Merge(local);
+    }
+    local.ClearStatistics();
+    io_stat_ready_.store(true, std::memory_order_relaxed);
+}
+
+void RecvPipeline::TakeOverStatistics()
+{
+    io_stat_ready_.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(stat_mutex_);
+    ServerStatistics::GetInst().Merge(io_stat_);
+    io_stat_.ClearStatistics();
+}
+
+RecvPipeline::Stat RecvPipeline::GetStat() const
+{
+    Stat stat;
+    stat.recv_num = recv_num_.load(std::memory_order_relaxed);
+    stat.ready_num = ready_num_.load(std::memory_order_relaxed);
+    stat.decode_fail_num = decode_fail_num_.load(std::memory_order_relaxed);
+    stat.expire_drop_num = expire_drop_num_.load(std::memory_order_relaxed);
+    stat.validate_drop_num = validate_drop_num_.load(std::memory_order_relaxed);
+    stat.full_num = full_num_.load(std::memory_order_relaxed);
+    return stat;
+}
+
+}  // namespace ua
@@ -0,0 +1,110 @@
+/// @file recv_pipeline.h
+/// @brief 收包流水线：在独立 IO 线程上收包、解码、丢弃过期包，逻辑线程只做分发
+/// @note 包装一个真实 channel，自身也是 IChannel，可直接作为 transport 的 channel 交给 PBService
+///       IO 线程从空闲槽队列取槽，把包拷进槽内缓冲并用槽自带的 codec 解码，通过校验后把槽号放入就绪队列；
+///       逻辑线程 Loop 时取出就绪槽，调用已解码回调（没有时退化为原始收包回调），处理完把槽还给空闲队列
+///       两个队列都是单生产者单消费者无锁环形缓冲；没有空闲槽时 IO 线程停止收包，包留在真实 channel 中，形成背压
+///       槽内的包和 codec 在回调返回前有效，回调内需要保留的数据自行拷贝
+///       真实 channel 的 Loop 在 IO 线程调用，Send 仍在逻辑线程调用，要求其收发可并发（如收发队列分离的共享内存通道）
+///       IO 线程的日志计数等只写本线程的 ServerStatistics，定期交到交接区，由逻辑线程 Loop / Stop 时并入逻辑线程的统计
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "interface/channel_interface.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+class SpscRingBuf;
+
+class RecvPipeline : public IChannel
+{
+public:
+    /// 每个槽一个 codec，由 IO 线程解码、逻辑线程读取
+    using CodecCreator = std::function<std::unique_ptr<RecvCodec>()>;
+    /// 在 IO 线程上对已解码的包做额外校验（如预解析包体），返回 false 丢弃
+    using Validator = std::function<bool(const RecvCodec&)>;
+
+    struct Option
+    {
+        IChannel* channel = nullptr;       // 真实收发通道
+        CodecCreator codec_creator;
+        Validator validator;
+        uint32_t slot_num = 1024;          // 在途包上限（背压阈值）
+        uint32_t batch_num = 64;           // IO 线程单次收包上限
+        bool drop_expired = true;          // IO 线程丢弃 GetTimeout() 已过的包
+        int cpu = -1;                      // IO 线程绑定的 CPU，-1 不绑定
+        uint32_t idle_sleep_us = 50;       // IO 线程空闲时休眠时长，0 表示只让出 CPU
+    };
+
+    struct Stat
+    {
+        uint64_t recv_num = 0;           // IO 线程收到的包
+        uint64_t ready_num = 0;          // 交给逻辑线程的包
+        uint64_t decode_fail_num = 0;    // 解码失败丢弃
+        uint64_t expire_drop_num = 0;    // 过期丢弃
+        uint64_t validate_drop_num = 0;  // 校验失败丢弃
+        uint64_t full_num = 0;           // 没有空闲槽暂停收包的次数
+    };
+
+    RecvPipeline();
+    ~RecvPipeline() override;
+
+    /// 创建槽和队列并启动 IO 线程
+    bool Start(const Option& option, std::string* err_msg = nullptr);
+    /// 停止并回收 IO 线程，未处理的就绪包丢弃
+    void Stop();
+    [[nodiscard]] bool IsRunning() const noexcept { return io_thread_.joinable(); }
+
+    [[nodiscard]] uint32_t MyID() const override;
+    int32_t Send(uint32_t dest_id, const char* buff, size_t buff_len) override;
+    /// 逻辑线程调用：分发就绪的包，返回分发数量
+    size_t Loop(uint32_t max_recv_count) override;
+
+    [[nodiscard]] Stat GetStat() const;
+
+private:
+    struct Slot;
+
+    /// IO 线程交出统计的间隔
+    static constexpr uint64_t kStatHandOverMs = 100;
+
+    void IOMain();
+    int32_t OnIORecv(const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time);
+    /// IO 线程把本线程的统计交到交接区并清零
+    void HandOverStatistics();
+    /// 逻辑线程把交接区的统计并入本线程
+    void TakeOverStatistics();
+
+    Option option_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::unique_ptr<uint8_t[]> ready_mem_;
+    std::unique_ptr<uint8_t[]> free_mem_;
+    std::unique_ptr<SpscRingBuf> ready_queue_;  // IO 线程 -> 逻辑线程
+    std::unique_ptr<SpscRingBuf> free_queue_;   // 逻辑线程 -> IO 线程
+    std::vector<uint32_t> io_free_slots_;       // IO 线程本地缓存的空闲槽
+    uint64_t io_now_ms_ = 0;
+    std::thread io_thread_;
+    std::atomic<bool> stop_{false};
+
+    std::atomic<uint64_t> recv_num_{0};
+    std::atomic<uint64_t> ready_num_{0};
+    std::atomic<uint64_t> decode_fail_num_{0};
+    std::atomic<uint64_t> expire_drop_num_{0};
+    std::atomic<uint64_t> validate_drop_num_{0};
+    std::atomic<uint64_t> full_num_{0};
+
+    std::mutex stat_mutex_;
+    ServerStatistics io_stat_;  // IO 线程统计的交接区，stat_mutex_ 保护
+    std::atomic<bool> io_stat_ready_{false};
+};
+
+}  // namespace ua
@@ -1,6 +1,7 @@
 /// @file server_core.cpp
 /// @brief 服务核心实现（C++20 重写版）
 /// @note 保持与原版完全兼容的三阶段时间片调度和自适应流控
+#define UA_LOG_MODULE ua::kLogModuleCore  // 框架日志单独归类，可按模块调级别
 #include "server_core.h"
 #include <algorithm>
 #include <string>
@@ -29,12 +30,26 @@ static constexpr uint32_t TIMEOUT_CHANNEL_INDEX = PBService::MAX_TRANSPORT_NUM;
 static constexpr uint32_t TIMEOUT_CHANNEL_INDEX = 32;
 #endif
 
+ServerCore::~ServerCore()
+{
+    // 调度器可能比本对象活得久，析构时丢弃的事件不能再回调进来
+    if (req_scheduler_)
+        req_scheduler_->SetDropFunc(nullptr);
+}
+
 bool ServerCore::SvrInit(const SvrOption& option)
 {
     if (!CheckOption(option))
         return false;
 
     option_ = option;
+    flow_ctrl_.Init(option_.flow_ctrl);
+    std::string err_msg;
+    if (!recv_classifier_.Init(option_.recv_class, &err_msg))
+    {
+        UA_LOG_ERROR(0, "recv classifier init fail: %s", err_msg.c_str());
+        return false;
+    }
 
     // 初始化全局 ID 生成器
     if (!IDGenerator::GetInst().Init())
@@ -43,6 +58,13 @@ bool ServerCore::SvrInit(const SvrOption& option)
         return false;
     }
 
+    if (!option_.coroutine && option_.use_builtin_coroutine)
+    {
+        builtin_coroutine_ = std::make_unique<StackfulCoroutine>(option_.builtin_coro);
+        option_.coroutine = builtin_coroutine_.get();
+        UA_LOG_INFO(0, "use builtin coroutine, stack mode:%u, stack size:%zu",
+                    static_cast<uint32_t>(option_.builtin_coro.mode), option_.builtin_coro.stack_size);
+    }
     if (option_.coroutine)
     {
         option_.coroutine->SetMaxCoroNum(option_.max_coro_num);
@@ -92,6 +114,12 @@ bool ServerCore::CheckOption(const SvrOption& option) const
         return false;
     }
 
+    if (option.flow_ctrl.mode == FlowMode::kDelayTarget && option.flow_ctrl.interval_ms == 0)
+    {
+        UA_LOG_ERROR(0, "flow ctrl interval_ms is 0");
+        return false;
+    }
+
     if (option.frame.min_on_proc_ms > option.frame.max_proc_ms)
     {
         UA_LOG_ERROR(0, "min_on_proc_ms(%u) > max_proc_ms(%u)", option.frame.min_on_proc_ms,
@@ -115,6 +143,13 @@ bool ServerCore::InitPBService()
     if (option_.pb_service)
     {
         option_.pb_service->SetContextCtrl(&context_ctrl_);
+        if (recv_classifier_.Enabled())
+            option_.pb_service->SetRecvClassifier(&recv_classifier_);
+        if (option_.flow_ctrl.mode == FlowMode::kDelayTarget)
+        {
+            option_.pb_service->SetSojournWatch(
+                [this](uint64_t sojourn_ms, bool droppable) { return OnSojourn(sojourn_ms, droppable); });
+        }
         UA_LOG_INFO(0, "init pb service");
     }
     else
@@ -134,8 +169,8 @@ void ServerCore::SvrTick(uint64_t now_ms, uint64_t tick_count)
 
     if (end_ms > begin_ms + option_.max_tick_ms)
     {
-        UA_LOG_WARN(0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u", end_ms, begin_ms, end_ms - begin_ms,
-                    option_.max_tick_ms);
+        UA_LOG_WARN_EVERY_MS(1000, 0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u", end_ms, begin_ms, end_ms - begin_ms,
+                             option_.max_tick_ms);
         ServerStatistics::GetInst().statistics().inc_tick_timeout();
     }
 
@@ -155,8 +190,8 @@ size_t ServerCore::SvrProc(uint64_t now_ms)
     uint64_t end_ms = utils::CurrentRealMilliSec();
     if (end_ms > begin_ms + option_.frame.max_ctx_proc_ms)
     {
-        UA_LOG_WARN(0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u, ctx(%u) timeout(%u)", end_ms, begin_ms,
-                    end_ms - begin_ms, option_.frame.max_ctx_proc_ms, ctx_count, timeout_count);
+        UA_LOG_WARN_EVERY_MS(1000, 0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u, ctx(%u) timeout(%u)", end_ms, begin_ms,
+                             end_ms - begin_ms, option_.frame.max_ctx_proc_ms, ctx_count, timeout_count);
         ServerStatistics::GetInst().statistics().inc_proc_timeout_0();
     }
     ServerStatistics::GetInst().statistics().set_max_proc_deal_time_0(
@@ -179,8 +214,8 @@ size_t ServerCore::SvrProc(uint64_t now_ms)
         static_cast<uint32_t>(end_ms1 - end_ms));
     if (end_ms1 > end_ms + remain_ms)
     {
-        UA_LOG_WARN(0, "end_ms1(%lu) - end_ms(%lu) = %lu > remain_ms(%lu), proc(%u)", end_ms1, end_ms,
-                    end_ms1 - end_ms, remain_ms, proc_count);
+        UA_LOG_WARN_EVERY_MS(1000, 0, "end_ms1(%lu) - end_ms(%lu) = %lu > remain_ms(%lu), proc(%u)", end_ms1, end_ms,
+                             end_ms1 - end_ms, remain_ms, proc_count);
         ServerStatistics::GetInst().statistics().inc_proc_timeout_1();
     }
 
@@ -194,81 +229,84 @@ size_t ServerCore::SvrProc(uint64_t now_ms)
         deal_pkg_count += deal_scheduler_count;
     }
 
-    // 有调度器或者不是 stop 时才收包
-    if (req_scheduler_ || !stop_)
+    uint32_t one_loop_num = option_.flow_ctrl.min_num;
+    if (option_.flow_ctrl.max_deal_pkg_num > deal_pkg_count + option_.flow_ctrl.min_num)
+        one_loop_num = option_.flow_ctrl.max_deal_pkg_num - deal_pkg_count;
+    // 分级收包：上一帧延后的请求先在预算内处理（已收下的包停止时也要处理完）
+    if (recv_classifier_.Enabled())
     {
-        uint32_t one_loop_num = option_.flow_ctrl.min_num;
-        if (option_.flow_ctrl.max_deal_pkg_num > deal_pkg_count + option_.flow_ctrl.min_num)
-            one_loop_num = option_.flow_ctrl.max_deal_pkg_num - deal_pkg_count;
+        uint32_t replay_count = recv_classifier_.BeginFrame(one_loop_num);
+        deal_pkg_count += replay_count;
+        one_loop_num = recv_classifier_.ReadLimit(option_.recv_class.exempt_num ? option_.recv_class.exempt_num
+                                                                                : option_.flow_ctrl.max_num);
+    }
 
-        auto* transport_info = DefaultTransportInfo();
-        if (transport_info && transport_info->channel)
-            deal_pkg_count += static_cast<uint32_t>(transport_info->channel->Loop(one_loop_num));
+    // 有调度器或者不是 stop 时才收包，所有 transport 按权重分预算；没有登记时只收默认 transport
+    if ((req_scheduler_ || !stop_) && one_loop_num > 0)
+    {
+        if (!transport_poller_.Empty())
+        {
+            deal_pkg_count += static_cast<uint32_t>(transport_poller_.Poll(one_loop_num));
+        }
+        else
+        {
+            auto* transport_info = DefaultTransportInfo();
+            if (transport_info && transport_info->channel)
+                deal_pkg_count += static_cast<uint32_t>(transport_info->channel->Loop(one_loop_num));
+        }
     }
+    if (recv_classifier_.Enabled())
+        recv_classifier_.EndFrame();
 
     uint64_t end_ms2 = utils::CurrentRealMilliSec();
     ServerStatistics::GetInst().statistics().set_max_proc_deal_time_2(
         static_cast<uint32_t>(end_ms2 - end_ms1));
     if (end_ms2 > end_ms + remain_ms)
     {
-        UA_LOG_WARN(0, "end_ms2(%lu) - end_ms(%lu) = %lu > remain_ms(%lu), scheduler(%u) deal(%u)", end_ms2, end_ms,
-                    end_ms2 - end_ms, remain_ms, deal_scheduler_count, deal_pkg_count);
+        UA_LOG_WARN_EVERY_MS(1000, 0, "end_ms2(%lu) - end_ms(%lu) = %lu > remain_ms(%lu), scheduler(%u) deal(%u)",
+                             end_ms2, end_ms, end_ms2 - end_ms, remain_ms, deal_scheduler_count, deal_pkg_count);
         ServerStatistics::GetInst().statistics().inc_proc_timeout_2();
     }
 
     // 自适应流控：根据当前是否超时动态调整收包上限
-    AdjustParam(remain_ms, end_ms2 - end_ms);
+    AdjustParam(end_ms2, remain_ms, end_ms2 - end_ms);
 
     // 检查单次 proc 是否超时
     end_ms = utils::CurrentRealMilliSec();
     if (end_ms > begin_ms + option_.frame.max_proc_ms)
     {
-        UA_LOG_WARN(0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u, ctx(%u) timeout(%u) deal(%u)", end_ms, begin_ms,
-                    end_ms - begin_ms, option_.frame.max_proc_ms, ctx_count, timeout_count,
-                    proc_count + deal_pkg_count);
+        UA_LOG_WARN_EVERY_MS(1000, 0, "end_ms(%lu) - begin_ms(%lu) = %lu > %u, ctx(%u) timeout(%u) deal(%u)", end_ms,
+                             begin_ms, end_ms - begin_ms, option_.frame.max_proc_ms, ctx_count, timeout_count,
+                             proc_count + deal_pkg_count);
         ServerStatistics::GetInst().statistics().inc_proc_total_timeout();
     }
 
     return ctx_count + timeout_count + proc_count + deal_pkg_count;
 }
 
-void ServerCore::AdjustParam(uint64_t remain_ms, uint64_t used_ms)
+void ServerCore::AdjustParam(uint64_t now_ms, uint64_t remain_ms, uint64_t used_ms)
 {
-    // 快减慢增策略
-    if (used_ms > remain_ms + option_.flow_ctrl.judge_range_ms)
-    {
-        // 超时了，快速缩减收包量
-        if (option_.flow_ctrl.max_deal_pkg_num > option_.flow_ctrl.min_num + option_.flow_ctrl.dec_delta)
-            option_.flow_ctrl.max_deal_pkg_num -= option_.flow_ctrl.dec_delta;
-        else if (option_.flow_ctrl.max_deal_pkg_num > option_.flow_ctrl.min_num)
-            option_.flow_ctrl.max_deal_pkg_num = option_.flow_ctrl.min_num;
-    }
-    else if (used_ms + option_.flow_ctrl.judge_range_ms * 2 < remain_ms)
-    {
-        // 空闲了，慢慢增加收包量
-        if (option_.flow_ctrl.max_deal_pkg_num + option_.flow_ctrl.inc_delta < option_.flow_ctrl.max_num)
-            option_.flow_ctrl.max_deal_pkg_num += option_.flow_ctrl.inc_delta;
-        else if (option_.flow_ctrl.max_deal_pkg_num < option_.flow_ctrl.max_num)
-            option_.flow_ctrl.max_deal_pkg_num = option_.flow_ctrl.max_num;
-    }
+    option_.flow_ctrl.max_deal_pkg_num = flow_ctrl_.OnFrame(now_ms, remain_ms, used_ms);
+}
+
+bool ServerCore::OnSojourn(uint64_t sojourn_ms, bool droppable)
+{
+    if (!flow_ctrl_.OnSojourn(sojourn_ms, droppable))
+        return false;
+    ServerStatistics::GetInst().statistics().inc_shed_drop_num();
+    return true;
 }
 
 bool ServerCore::SvrStopReady() const
 {
     if (stop_)
     {
-        if (context_ctrl_.PendingContextNum() == 0)
+        if (context_ctrl_.PendingContextNum() == 0 && recv_classifier_.DeferredNum() == 0)
             return true;
 
         // 200ms 打印一次，防止日志过多
-        static uint64_t last_log_time = 0;
-        uint64_t now = utils::CurrentRealMilliSec();
-        if (last_log_time + 200 < now)
-        {
-            UA_LOG_WARN(0, "pending context(%lu) coroutine(%lu)", context_ctrl_.PendingContextNum(),
-                        context_ctrl_.PendingCoroutineNum());
-            last_log_time = now;
-        }
+        UA_LOG_WARN_EVERY_MS(200, 0, "pending context(%lu) coroutine(%lu)", context_ctrl_.PendingContextNum(),
+                             context_ctrl_.PendingCoroutineNum());
     }
     return false;
 }
@@ -316,7 +354,8 @@ const TransportInfo* ServerCore::FindTransportInfo(uint32_t transport_type) cons
     return nullptr;
 }
 
-bool ServerCore::AddTransportInfo(uint32_t transport_type, const TransportInfo& info, bool is_default)
+bool ServerCore::AddTransportInfo(uint32_t transport_type, const TransportInfo& info, bool is_default,
+                                  uint32_t weight)
 {
 #ifdef UA_HAS_PROTOBUF
     if (!option_.pb_service)
@@ -325,12 +364,22 @@ bool ServerCore::AddTransportInfo(uint32_t transport_type, const TransportInfo&
         return false;
     if (is_default)
         default_transport_ = transport_type;
-    return true;
+    return AddPollChannel(transport_type, info.channel, weight);
 #else
     return false;
 #endif
 }
 
+bool ServerCore::AddPollChannel(uint32_t transport_type, IChannel* channel, uint32_t weight)
+{
+    return transport_poller_.Add(transport_type, channel, weight);
+}
+
+bool ServerCore::SetTransportWeight(uint32_t transport_type, uint32_t weight)
+{
+    return transport_poller_.SetWeight(transport_type, weight);
+}
+
 const IRouting* ServerCore::DefaultRouting() const
 {
     auto* info = DefaultTransportInfo();
@@ -398,9 +447,24 @@ bool ServerCore::SetScheduler(IScheduler* new_scheduler)
         else
             return false;
     });
+    // 被调度器丢弃的定时事件要归还事件槽引用，请求包没有需要释放的资源
+    req_scheduler_->SetDropFunc([this](uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) {
+        if (static_cast<uint32_t>(custom_data) == TIMEOUT_CHANNEL_INDEX)
+            timeout_decorator_.DropEvent(data, len);
+    });
     return true;
 }
 
+uint64_t ServerCore::NextDeadline() const noexcept
+{
+    uint64_t ctx_expire = context_ctrl_.NextExpireTime();
+    // 停止过程中不再处理定时事件
+    uint64_t timer_expire = stop_ ? 0 : timeout_decorator_.NextExpireTime();
+    if (ctx_expire == 0 || timer_expire == 0)
+        return ctx_expire | timer_expire;
+    return std::min(ctx_expire, timer_expire);
+}
+
 uint64_t ServerCore::AddTimer(uint64_t gid, TimeoutCallback&& callback, uint64_t expire_time, uint32_t interval_time)
 {
     return timeout_decorator_.AddEvent(gid, std::move(callback), expire_time, interval_time);
@@ -6,10 +6,15 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include "context_controller.h"
+#include "flow_controller.h"
+#include "recv_classifier.h"
+#include "stackful_coroutine.h"
 #include "system_mgr.h"
 #include "timeout_decorator.h"
+#include "transport_poller.h"
 
 namespace ua
 {
@@ -22,6 +27,7 @@ struct TransportInfo;
 class IServiceMesh;
 class IScheduler;
 class ICoroutine;
+class IChannel;
 
 class ServerCore : public SystemMgr
 {
@@ -31,8 +37,14 @@ public:
     [[nodiscard]] const TransportInfo* DefaultTransportInfo() const;
     /// 获取对应类型的 transport
     [[nodiscard]] const TransportInfo* FindTransportInfo(uint32_t transport_type) const;
-    /// 添加一个 transport，可指定为默认
-    bool AddTransportInfo(uint32_t transport_type, const TransportInfo& info, bool is_default = false);
+    /// 添加一个 transport，可指定为默认；收包阶段按 weight 分配收包预算
+    bool AddTransportInfo(uint32_t transport_type, const TransportInfo& info, bool is_default = false,
+                          uint32_t weight = 1);
+    /// 让收包阶段驱动一个 channel（AddTransportInfo 已自动添加，不使用 PBService 时直接调用）
+    bool AddPollChannel(uint32_t transport_type, IChannel* channel, uint32_t weight = 1);
+    /// 调整 transport 的收包权重
+    bool SetTransportWeight(uint32_t transport_type, uint32_t weight);
+    [[nodiscard]] const TransportPoller& GetTransportPoller() const noexcept { return transport_poller_; }
     /// 获取路由管理器
     [[nodiscard]] const IRouting* DefaultRouting() const;
     [[nodiscard]] IRouting* DefaultRouting();
@@ -46,6 +58,8 @@ public:
     [[nodiscard]] const PBService* GetPBService() const;
     [[nodiscard]] PBService* GetPBService();
 #endif
+    /// 内置协程（未启用时为 nullptr），可查看共享栈的保存字节数等
+    [[nodiscard]] const StackfulCoroutine* GetBuiltinCoroutine() const noexcept { return builtin_coroutine_.get(); }
     /// 设置调度器
     bool SetScheduler(IScheduler* new_scheduler);
 
@@ -54,6 +68,9 @@ public:
     {
         // 协程插件（nullptr 表示非协程模式）
         ICoroutine* coroutine = nullptr;
+        // coroutine 为 nullptr 时使用内置协程（独立栈 / 共享栈，见 stackful_coroutine.h）
+        bool use_builtin_coroutine = false;
+        StackfulCoroutine::Option builtin_coro{};
 #ifdef UA_HAS_PROTOBUF
         // PBService（nullptr 表示不使用）
         PBService* pb_service = nullptr;
@@ -70,18 +87,13 @@ public:
         };
         FrameTimeLimit frame{};
 
-        // 自适应流控
-        struct FlowControl
-        {
-            uint32_t max_deal_pkg_num = 0;     // 初始最大处理包个数
-            uint32_t max_num = 0;              // 能处理的最大包数
-            uint32_t min_num = 0;              // 能处理的最小包数
-            uint32_t inc_delta = 0;            // 增加的单位
-            uint32_t dec_delta = 0;            // 减少的单位（快减）
-            uint32_t judge_range_ms = 0;       // 差异判断区间 (ms)
-        };
+        // 自适应流控（快减慢增或排队时延目标，见 flow_controller.h）
+        using FlowControl = FlowControlOption;
         FlowControl flow_ctrl{};
 
+        // 分级收包（回包/关键包优先，普通请求受流控预算约束，见 recv_classifier.h）
+        RecvClassifier::Option recv_class{};
+
         // tick 处理最大超时时间 (ms)
         uint32_t max_tick_ms = 1000;
     };
@@ -100,6 +112,14 @@ public:
     [[nodiscard]] bool SvrStopReady() const;
     /// 是否正在停止
     [[nodiscard]] bool IsStoping() const noexcept { return stop_; }
+    /// 最近一个需要 SvrProc 处理的超时时间（挂起上下文超时 / 定时事件），没有返回 0
+    [[nodiscard]] uint64_t NextDeadline() const noexcept;
+    /// 上报收到的包的排队时延，返回 true 表示该请求应按流控提前丢弃（已计入 shed_drop_num）
+    /// 使用 PBService 时自动上报，自定义收包逻辑可自行调用
+    bool OnSojourn(uint64_t sojourn_ms, bool droppable);
+    [[nodiscard]] const FlowController& GetFlowController() const noexcept { return flow_ctrl_; }
+    /// 分级收包器，自定义收包逻辑可调用 Admit 并设置 Replayer
+    [[nodiscard]] RecvClassifier& GetRecvClassifier() noexcept { return recv_classifier_; }
 
     using TimeoutCallback = TimeoutDecorator::TimeoutTask;
     /// 添加定时事件
@@ -107,7 +127,7 @@ public:
     /// 取消定时事件
     bool CancelTimer(uint64_t timer_id);
 
-    virtual ~ServerCore() = default;
+    virtual ~ServerCore();
 
 protected:
     virtual bool OnInit() { return true; }
@@ -120,15 +140,19 @@ private:
 #ifdef UA_HAS_PROTOBUF
     bool InitPBService();
 #endif
-    void AdjustParam(uint64_t remain_ms, uint64_t used_ms);
+    void AdjustParam(uint64_t now_ms, uint64_t remain_ms, uint64_t used_ms);
 
 protected:
     bool stop_ = false;
     uint32_t default_transport_ = 0;
     ContextController context_ctrl_;
     TimeoutDecorator timeout_decorator_;
+    FlowController flow_ctrl_;
+    RecvClassifier recv_classifier_;
+    TransportPoller transport_poller_;
     IScheduler* req_scheduler_ = nullptr;
     IServiceMesh* service_mesh_ = nullptr;
+    std::unique_ptr<StackfulCoroutine> builtin_coroutine_;
     SvrOption option_;
 };
 
@@ -0,0 +1,279 @@
+/// @file server_runner.cpp
+/// @brief 内置服务主循环实现
+#include "server_runner.h"
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "common/clock.h"
+#include "common/utils.h"
+#include "interface/channel_interface.h"
+#include "logger.h"
+#include "server_core.h"
+#include "server_statistics.h"
+#include "transport.h"
+
+namespace ua
+{
+
+namespace
+{
+
+bool AddReadFd(int epoll_fd, int fd)
+{
+    struct epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0 || errno == EEXIST;
+}
+
+/// eventfd / timerfd 读出计数即清除可读状态
+void DrainFd(int fd)
+{
+    uint64_t value = 0;
+    while (read(fd, &value, sizeof(value)) == sizeof(value))
+    {
+    }
+}
+
+}  // namespace
+
+ServerRunner::~ServerRunner()
+{
+    Close();
+}
+
+bool ServerRunner::BlockSignals(const std::vector<int>& signals, std::string* err_msg)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int sig : signals)
+        sigaddset(&mask, sig);
+    int ret = pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    if (ret != 0)
+    {
+        if (err_msg)
+            *err_msg += std::string("pthread_sigmask failed: ") + strerror(ret);
+        return false;
+    }
+    return true;
+}
+
+bool ServerRunner::Init(const Option& option, std::string* err_msg)
+{
+    Close();
+    option_ = option;
+    if (option_.tick_interval_ms == 0)
+        option_.tick_interval_ms = 1;
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || timer_fd_ < 0 || event_fd_ < 0 || !AddReadFd(epoll_fd_, timer_fd_) ||
+        !AddReadFd(epoll_fd_, event_fd_))
+    {
+        if (err_msg)
+            *err_msg += std::string("create runner fd failed: ") + strerror(errno);
+        Close();
+        return false;
+    }
+
+    if (!option_.quit_signals.empty())
+    {
+        if (!BlockSignals(option_.quit_signals, err_msg))
+        {
+            Close();
+            return false;
+        }
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int sig : option_.quit_signals)
+            sigaddset(&mask, sig);
+        signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (signal_fd_ < 0 || !AddReadFd(epoll_fd_, signal_fd_))
+        {
+            if (err_msg)
+                *err_msg += std::string("create signalfd failed: ") + strerror(errno);
+            Close();
+            return false;
+        }
+    }
+
+    quit_.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+void ServerRunner::Close()
+{
+    for (int* fd : {&signal_fd_, &event_fd_, &timer_fd_, &epoll_fd_})
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+bool ServerRunner::AddChannels(ServerCore& core)
+{
+    std::vector<IChannel*> channels = option_.channels;
+    if (channels.empty())
+        channels = core.GetTransportPoller().Channels();
+    if (channels.empty())
+    {
+        const TransportInfo* info = core.DefaultTransportInfo();
+        if (info && info->channel)
+            channels.push_back(info->channel);
+    }
+
+    all_channel_has_fd_ = true;
+    for (IChannel* channel : channels)
+    {
+        int fd = channel->GetFd();
+        if (fd < 0)
+        {
+            all_channel_has_fd_ = false;
+            continue;
+        }
+        if (!AddReadFd(epoll_fd_, fd))
+        {
+            UA_LOG_ERROR(0, "epoll add channel fd %d failed: %s", fd, strerror(errno));
+            return false;
+        }
+    }
+    if (!all_channel_has_fd_)
+        UA_LOG_INFO(0, "some channel has no fd, idle wait at most %u ms", option_.poll_wait_ms);
+    return true;
+}
+
+void ServerRunner::ResetTimer(uint64_t expire_ms)
+{
+    struct itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(expire_ms / 1000);
+    spec.it_value.tv_nsec = static_cast<long>(expire_ms % 1000) * 1000000;
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "timerfd_settime failed: %s", strerror(errno));
+}
+
+bool ServerRunner::Run(ServerCore& core)
+{
+    if (epoll_fd_ < 0)
+    {
+        UA_LOG_ERROR(0, "server runner not init");
+        return false;
+    }
+    if (!AddChannels(core))
+        return false;
+
+    uint64_t next_tick_ms = 0;
+    uint32_t idle_rounds = 0;
+    bool quit_notified = false;
+    while (true)
+    {
+        uint64_t now_us = utils::CurrentRealMicroSec();
+        uint64_t now_ms = now_us / 1000;
+        Clock::GetInst().Update(now_us);
+
+        if (now_ms >= next_tick_ms)
+        {
+            core.SvrTick(now_ms, tick_count_++);
+            // 处理不过来时不补 tick
+            next_tick_ms = std::max(next_tick_ms + option_.tick_interval_ms, now_ms + 1);
+            ResetTimer(next_tick_ms);
+            // 一直忙碌时不会进入 epoll，按 tick 频率检查一次信号
+            ReadSignals();
+        }
+
+        if (!quit_notified && quit_.load(std::memory_order_acquire))
+        {
+            UA_LOG_INFO(0, "server runner notify quit");
+            core.SvrNtfQuit();
+            quit_notified = true;
+        }
+
+        size_t deal_num = core.SvrProc(now_ms);
+        if (quit_notified && core.SvrStopReady())
+            break;
+
+        if (deal_num > 0)
+        {
+            idle_rounds = 0;
+            continue;
+        }
+        // 短暂空转，避免刚空闲就陷入系统调用
+        if (++idle_rounds < option_.idle_spin_num)
+            continue;
+        idle_rounds = 0;
+        WaitIdle(core, utils::CurrentRealMilliSec());
+    }
+
+    UA_LOG_INFO(0, "server runner quit, tick_count:%lu, idle_num:%lu", tick_count_, idle_num_);
+    return core.SvrFinish();
+}
+
+void ServerRunner::WaitIdle(ServerCore& core, uint64_t now_ms)
+{
+    // tick 由 timerfd 唤醒，这里只考虑超时和不支持 fd 的 channel
+    uint64_t timeout_ms = option_.max_wait_ms;
+    if (!all_channel_has_fd_)
+        timeout_ms = std::min<uint64_t>(timeout_ms, option_.poll_wait_ms);
+    uint64_t deadline = core.NextDeadline();
+    if (deadline > 0)
+        timeout_ms = deadline <= now_ms ? 0 : std::min(timeout_ms, deadline - now_ms);
+    if (timeout_ms == 0)
+        return;
+
+    ++idle_num_;
+    ServerStatistics::GetInst().statistics().inc_on_idle_num();
+
+    struct epoll_event events[16];
+    int num = epoll_wait(epoll_fd_, events, 16, static_cast<int>(timeout_ms));
+    for (int i = 0; i < num; ++i)
+    {
+        int fd = events[i].data.fd;
+        if (fd == event_fd_ || fd == timer_fd_)
+        {
+            DrainFd(fd);
+        }
+        else if (fd == signal_fd_)
+        {
+            ReadSignals();
+        }
+        // channel 的 fd 由下一次 SvrProc 里的 Loop 处理
+    }
+}
+
+void ServerRunner::ReadSignals()
+{
+    if (signal_fd_ < 0)
+        return;
+    struct signalfd_siginfo info;
+    while (read(signal_fd_, &info, sizeof(info)) == sizeof(info))
+    {
+        UA_LOG_INFO(0, "server runner recv signal %u", info.ssi_signo);
+        quit_.store(true, std::memory_order_release);
+    }
+}
+
+void ServerRunner::Wakeup() noexcept
+{
+    if (event_fd_ < 0)
+        return;
+    uint64_t value = 1;
+    ssize_t ret = write(event_fd_, &value, sizeof(value));
+    (void)ret;
+}
+
+void ServerRunner::Stop() noexcept
+{
+    quit_.store(true, std::memory_order_release);
+    Wakeup();
+}
+
+}  // namespace ua
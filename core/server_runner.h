@@ -0,0 +1,76 @@
+/// @file server_runner.h
+/// @brief 内置服务主循环：timerfd 驱动 SvrTick，空闲时 epoll 阻塞等待
+/// @note 有活干时连续调用 SvrProc；连续 idle_spin_num 次无事可做才进入 epoll，等待以下任一事件：
+///       channel 的 fd 可读、跨线程 Wakeup（eventfd）、tick 到期（timerfd）、退出信号（signalfd），
+///       超时时间取 ServerCore 最近的超时时刻，有不提供 fd 的 channel 时最多等 poll_wait_ms
+///       每轮循环更新 Clock；每次进入等待累加 on_idle_num 统计
+///       收到退出信号或 Stop 后调用 SvrNtfQuit，SvrStopReady 后 SvrFinish 并返回
+///       signalfd 要求信号在所有线程都被屏蔽：Init 屏蔽调用线程，之后创建的线程继承；
+///       之前已创建的线程需自行屏蔽（或在 main 开头先调用 BlockSignals）
+#pragma once
+
+#include <csignal>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ua
+{
+
+class IChannel;
+class ServerCore;
+
+class ServerRunner
+{
+public:
+    struct Option
+    {
+        uint32_t tick_interval_ms = 100;       // SvrTick 间隔
+        uint32_t idle_spin_num = 8;            // 连续空转多少次后进入 epoll 等待
+        uint32_t max_wait_ms = 100;            // 单次等待上限
+        uint32_t poll_wait_ms = 1;             // 有 channel 不提供 fd 时单次等待上限
+        std::vector<IChannel*> channels;       // 需要等待的 channel，为空时取收包阶段驱动的所有 channel
+        std::vector<int> quit_signals = {SIGTERM, SIGINT};
+    };
+
+    ServerRunner() = default;
+    ~ServerRunner();
+    ServerRunner(const ServerRunner&) = delete;
+    ServerRunner& operator=(const ServerRunner&) = delete;
+
+    /// 在屏蔽信号的线程上调用，之后该线程创建的线程都继承屏蔽
+    static bool BlockSignals(const std::vector<int>& signals, std::string* err_msg = nullptr);
+
+    /// 创建 epoll / timerfd / eventfd / signalfd
+    bool Init(const Option& option, std::string* err_msg = nullptr);
+    /// 在调用 SvrInit 之后、同一线程上调用，直到服务退出，返回 SvrFinish 的结果
+    bool Run(ServerCore& core);
+
+    /// 唤醒 epoll 等待（线程安全）
+    void Wakeup() noexcept;
+    /// 请求退出（线程安全）
+    void Stop() noexcept;
+
+    [[nodiscard]] uint64_t TickCount() const noexcept { return tick_count_; }
+    [[nodiscard]] uint64_t IdleNum() const noexcept { return idle_num_; }
+
+private:
+    void Close();
+    bool AddChannels(ServerCore& core);
+    void ResetTimer(uint64_t expire_ms);
+    void WaitIdle(ServerCore& core, uint64_t now_ms);
+    void ReadSignals();
+
+    Option option_;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int event_fd_ = -1;
+    int signal_fd_ = -1;
+    bool all_channel_has_fd_ = true;
+    std::atomic<bool> quit_{false};
+    uint64_t tick_count_ = 0;
+    uint64_t idle_num_ = 0;
+};
+
+}  // namespace ua
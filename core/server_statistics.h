@@ -2,6 +2,8 @@
 /// @brief 运行时统计（C++20 重写版）
 /// @note 改进: 去掉 UA_DEF_MEMBER 等宏，使用普通成员变量
 ///       改进: 使用 = {} 清零代替 memset
+///       线程级单例：每个线程只写自己的一份，多线程（IO 线程 + 分片）之间不共享计数和 map
+///       多分片时由分片线程定期把增量 Merge 到分片的交接区，导出线程再汇总到自己这一份（见 ShardRuntime::CollectStatistics）
 #pragma once
 
 #include <algorithm>
@@ -33,6 +35,7 @@ struct ServerStatisticsSt
     uint32_t log_info_num = 0;
     uint32_t log_debug_num = 0;
     uint32_t log_trace_num = 0;
+    uint32_t log_suppressed_num = 0;  // 被限频宏抑制的日志条数
     uint32_t rpc_time_out_num = 0;
     uint32_t coro_num_max = 0;
     uint32_t coro_pending_num_max = 0;
@@ -47,6 +50,11 @@ struct ServerStatisticsSt
     uint32_t proc_deal_time_2 = 0;
     uint32_t tick_timeout = 0;
     uint32_t tick_deal_time = 0;
+    uint32_t shed_drop_num = 0;  // 流控按排队时延提前丢弃的请求数
+    uint32_t recv_rsp_num = 0;       // 分级收包: 回包数
+    uint32_t recv_key_num = 0;       // 分级收包: 关键包数
+    uint32_t recv_deferred_num = 0;  // 分级收包: 超出预算延后处理的请求数
+    uint64_t coro_saved_stack_bytes_max = 0;  // 共享栈协程: 换出保存的栈字节总数峰值
 
     // 便利的递增/最大值方法
     void inc_recv_pkg_num(uint32_t n = 1) { recv_pkg_num += n; }
@@ -58,6 +66,7 @@ struct ServerStatisticsSt
     void inc_log_info_num(uint32_t n = 1) { log_info_num += n; }
     void inc_log_debug_num(uint32_t n = 1) { log_debug_num += n; }
     void inc_log_trace_num(uint32_t n = 1) { log_trace_num += n; }
+    void inc_log_suppressed_num(uint32_t n = 1) { log_suppressed_num += n; }
     void inc_rpc_time_out_num(uint32_t n = 1) { rpc_time_out_num += n; }
     void inc_on_proc_num(uint32_t n = 1) { on_proc_num += n; }
     void inc_on_idle_num(uint32_t n = 1) { on_idle_num += n; }
@@ -66,6 +75,10 @@ struct ServerStatisticsSt
     void inc_proc_timeout_2(uint32_t n = 1) { proc_timeout_2 += n; }
     void inc_proc_total_timeout(uint32_t n = 1) { proc_total_timeout += n; }
     void inc_tick_timeout(uint32_t n = 1) { tick_timeout += n; }
+    void inc_shed_drop_num(uint32_t n = 1) { shed_drop_num += n; }
+    void inc_recv_rsp_num(uint32_t n = 1) { recv_rsp_num += n; }
+    void inc_recv_key_num(uint32_t n = 1) { recv_key_num += n; }
+    void inc_recv_deferred_num(uint32_t n = 1) { recv_deferred_num += n; }
 
     void set_max_proc_deal_time_0(uint32_t v) { proc_deal_time_0 = std::max(proc_deal_time_0, v); }
     void set_max_proc_deal_time_1(uint32_t v) { proc_deal_time_1 = std::max(proc_deal_time_1, v); }
@@ -76,6 +89,48 @@ struct ServerStatisticsSt
     void save_max_recv_pkg_size_max(uint32_t v) { recv_pkg_size_max = std::max(recv_pkg_size_max, v); }
     void save_max_coro_num_max(uint32_t v) { coro_num_max = std::max(coro_num_max, v); }
     void save_max_coro_pending_num_max(uint32_t v) { coro_pending_num_max = std::max(coro_pending_num_max, v); }
+    void save_max_coro_saved_stack_bytes_max(uint64_t v)
+    {
+        coro_saved_stack_bytes_max = std::max(coro_saved_stack_bytes_max, v);
+    }
+
+    /// 汇总另一个线程的统计：计数累加，_max / deal_time 类取最大值（即单线程峰值）
+    void Merge(const ServerStatisticsSt& other)
+    {
+        recv_pkg_num += other.recv_pkg_num;
+        recv_byte_num += other.recv_byte_num;
+        recv_error_pkg_num += other.recv_error_pkg_num;
+        send_pkg_num += other.send_pkg_num;
+        send_byte_num += other.send_byte_num;
+        send_error_pkg_num += other.send_error_pkg_num;
+        save_max_send_pkg_size_max(other.send_pkg_size_max);
+        save_max_recv_pkg_size_max(other.recv_pkg_size_max);
+        log_error_num += other.log_error_num;
+        log_warn_num += other.log_warn_num;
+        log_info_num += other.log_info_num;
+        log_debug_num += other.log_debug_num;
+        log_trace_num += other.log_trace_num;
+        log_suppressed_num += other.log_suppressed_num;
+        rpc_time_out_num += other.rpc_time_out_num;
+        save_max_coro_num_max(other.coro_num_max);
+        save_max_coro_pending_num_max(other.coro_pending_num_max);
+        on_proc_num += other.on_proc_num;
+        on_idle_num += other.on_idle_num;
+        proc_timeout_0 += other.proc_timeout_0;
+        proc_timeout_1 += other.proc_timeout_1;
+        proc_timeout_2 += other.proc_timeout_2;
+        proc_total_timeout += other.proc_total_timeout;
+        set_max_proc_deal_time_0(other.proc_deal_time_0);
+        set_max_proc_deal_time_1(other.proc_deal_time_1);
+        set_max_proc_deal_time_2(other.proc_deal_time_2);
+        tick_timeout += other.tick_timeout;
+        set_max_tick_deal_time(other.tick_deal_time);
+        shed_drop_num += other.shed_drop_num;
+        recv_rsp_num += other.recv_rsp_num;
+        recv_key_num += other.recv_key_num;
+        recv_deferred_num += other.recv_deferred_num;
+        save_max_coro_saved_stack_bytes_max(other.coro_saved_stack_bytes_max);
+    }
 };
 
 struct NotClearServerStatisticsSt
@@ -104,19 +159,44 @@ struct SendCmdStatisticsInfo
     uint32_t max_send_size = 0;
 };
 
-class ServerStatistics : public Singleton<ServerStatistics>
+struct TransportStatisticsInfo
+{
+    std::map<uint32_t, uint32_t> queue_cost_map;
+    uint32_t recv_num = 0;
+    uint32_t busy_num = 0;  // 用满收包配额的帧数
+};
+
+/// 调度器按请求类别的统计
+struct SchedClassStatisticsInfo
+{
+    std::map<uint32_t, uint32_t> wait_cost_map;     // 入队到派发
+    std::map<uint32_t, uint32_t> service_cost_map;  // 派发到 OnResponse
+    uint32_t dispatch_num = 0;
+    uint32_t drop_num = 0;                          // 队列超限丢弃/拒绝
+    uint32_t expire_drop = 0;
+    uint32_t max_queue_len = 0;
+};
+
+class ServerStatistics : public MSingleton<ServerStatistics, true>
 {
 public:
+    /// 线程单例之外的独立实例，用作分片统计的交接区
+    ServerStatistics() = default;
+
     /// 改进: 使用值初始化代替 memset
     void ClearStatistics()
     {
         statistics_ = {};
         recv_cmd_2_info_.clear();
         send_cmd_2_info_.clear();
+        transport_2_info_.clear();
+        sched_class_2_info_.clear();
     }
 
     [[nodiscard]] const auto& RecvCmd2Info() const noexcept { return recv_cmd_2_info_; }
     [[nodiscard]] const auto& SendCmd2Info() const noexcept { return send_cmd_2_info_; }
+    [[nodiscard]] const auto& Transport2Info() const noexcept { return transport_2_info_; }
+    [[nodiscard]] const auto& SchedClass2Info() const noexcept { return sched_class_2_info_; }
     [[nodiscard]] ServerStatisticsSt& statistics() noexcept { return statistics_; }
     [[nodiscard]] NotClearServerStatisticsSt& not_clear_statistics() noexcept { return not_clear_statistics_; }
 
@@ -162,14 +242,95 @@ public:
         recv_cmd_2_info_[cmd].queue_cost_map[GetCostBucket(duration)] += 1;
     }
 
+    void SetTransportQueueCost(uint32_t transport_type, uint32_t duration)
+    {
+        transport_2_info_[transport_type].queue_cost_map[GetCostBucket(duration)] += 1;
+    }
+
+    void SetSchedClassWait(uint32_t sched_class, uint32_t duration, uint32_t queue_len)
+    {
+        auto& info = sched_class_2_info_[sched_class];
+        info.wait_cost_map[GetCostBucket(duration)] += 1;
+        ++info.dispatch_num;
+        info.max_queue_len = std::max(info.max_queue_len, queue_len);
+    }
+
+    void SetSchedClassService(uint32_t sched_class, uint32_t duration)
+    {
+        sched_class_2_info_[sched_class].service_cost_map[GetCostBucket(duration)] += 1;
+    }
+
+    void AddSchedClassDrop(uint32_t sched_class, bool expired)
+    {
+        auto& info = sched_class_2_info_[sched_class];
+        if (expired)
+            ++info.expire_drop;
+        else
+            ++info.drop_num;
+    }
+
+    void AddTransportRecv(uint32_t transport_type, uint32_t recv_num, bool busy)
+    {
+        auto& info = transport_2_info_[transport_type];
+        info.recv_num += recv_num;
+        info.busy_num += busy ? 1 : 0;
+    }
+
+    /// 把 other 的周期统计累加进来（不含 not_clear_statistics），other 不变
+    void Merge(const ServerStatistics& other)
+    {
+        statistics_.Merge(other.statistics_);
+        for (const auto& [cmd, from] : other.recv_cmd_2_info_)
+        {
+            auto& info = recv_cmd_2_info_[cmd];
+            for (const auto& [ret_code, num] : from.error_code_2_num)
+                info.error_code_2_num[ret_code] += num;
+            MergeCostMap(info.cost_map, from.cost_map);
+            MergeCostMap(info.queue_cost_map, from.queue_cost_map);
+            info.expire_drop += from.expire_drop;
+            info.schedule_drop += from.schedule_drop;
+            info.max_req_size = std::max(info.max_req_size, from.max_req_size);
+            info.max_rsp_size = std::max(info.max_rsp_size, from.max_rsp_size);
+            info.total_recv_num += from.total_recv_num;
+        }
+        for (const auto& [cmd, from] : other.send_cmd_2_info_)
+        {
+            auto& info = send_cmd_2_info_[cmd];
+            info.total_send_num += from.total_send_num;
+            info.max_send_size = std::max(info.max_send_size, from.max_send_size);
+        }
+        for (const auto& [transport_type, from] : other.transport_2_info_)
+        {
+            auto& info = transport_2_info_[transport_type];
+            MergeCostMap(info.queue_cost_map, from.queue_cost_map);
+            info.recv_num += from.recv_num;
+            info.busy_num += from.busy_num;
+        }
+        for (const auto& [sched_class, from] : other.sched_class_2_info_)
+        {
+            auto& info = sched_class_2_info_[sched_class];
+            MergeCostMap(info.wait_cost_map, from.wait_cost_map);
+            MergeCostMap(info.service_cost_map, from.service_cost_map);
+            info.dispatch_num += from.dispatch_num;
+            info.drop_num += from.drop_num;
+            info.expire_drop += from.expire_drop;
+            info.max_queue_len = std::max(info.max_queue_len, from.max_queue_len);
+        }
+    }
+
 private:
-    friend class Singleton<ServerStatistics>;
-    ServerStatistics() = default;
+    static void MergeCostMap(std::map<uint32_t, uint32_t>& to, const std::map<uint32_t, uint32_t>& from)
+    {
+        for (const auto& [lower, num] : from)
+            to[lower] += num;
+    }
 
     ServerStatisticsSt statistics_{};
     NotClearServerStatisticsSt not_clear_statistics_{};
     std::unordered_map<uint32_t, RecvCmdStatisticsInfo> recv_cmd_2_info_;
     std::unordered_map<uint32_t, SendCmdStatisticsInfo> send_cmd_2_info_;
+    std::unordered_map<uint32_t, TransportStatisticsInfo> transport_2_info_;
+    std::unordered_map<uint32_t, SchedClassStatisticsInfo> sched_class_2_info_;
 };
 
 }  // namespace ua
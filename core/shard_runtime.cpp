@@ -0,0 +1,457 @@
+/// @file shard_runtime.cpp
+/// @brief 按 gid 分片的多线程运行时实现
+#include "shard_runtime.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include "common/clock.h"
+#include "common/utils.h"
+#include "containers/spsc_ring_buf.h"
+#include "interface/codec_interface.h"
+#include "logger.h"
+#include "server_core.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+namespace
+{
+
+thread_local int32_t tls_shard_id = -1;
+thread_local const ShardRuntime* tls_runtime = nullptr;
+
+}  // namespace
+
+struct ShardRuntime::Ring
+{
+    std::unique_ptr<uint8_t[]> mem;
+    SpscRingBuf buf;
+
+    bool Init(size_t size)
+    {
+        size_t mem_size = SpscRingBuf::need_total_mem_size(size);
+        mem = std::make_unique<uint8_t[]>(mem_size);
+        return buf.init(mem.get(), mem_size);
+    }
+};
+
+struct alignas(64) ShardRuntime::Shard
+{
+    ShardChannel channel;
+    std::atomic<uint64_t> dispatch_num{0};
+    std::atomic<uint64_t> dispatch_drop_num{0};
+    std::atomic<uint64_t> post_num{0};
+    std::atomic<uint64_t> post_drop_num{0};
+    std::atomic<uint64_t> send_num{0};
+    std::atomic<uint64_t> send_drop_num{0};
+    std::mutex stat_mutex;
+    ServerStatistics stat;  // 统计交接区，stat_mutex 保护
+};
+
+// ========== ShardChannel ==========
+
+uint32_t ShardChannel::MyID() const
+{
+    return runtime_->option_.io_channel->MyID();
+}
+
+int32_t ShardChannel::Send(uint32_t dest_id, const char* buff, size_t buff_len)
+{
+    ShardRuntime::MsgHead head{ShardRuntime::kMsgPacket, dest_id, 0};
+    struct iovec iov[2] = {{&head, sizeof(head)}, {const_cast<char*>(buff), buff_len}};
+    auto& shard = *runtime_->shards_[shard_id_];
+    if (!runtime_->out_rings_[shard_id_]->buf.push(iov, 2))
+    {
+        shard.send_drop_num.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    shard.send_num.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+size_t ShardChannel::Loop(uint32_t max_recv_count)
+{
+    // 生产者之间轮转起点，避免 IO 线程的包饿死分片间任务
+    const uint32_t producer_num = runtime_->shard_num_ + 1;
+    size_t count = 0;
+    for (uint32_t i = 0; i < producer_num && count < max_recv_count; ++i)
+    {
+        uint32_t producer = (next_producer_ + i) % producer_num;
+        SpscRingBuf& ring = runtime_->InRing(producer, shard_id_);
+        uint32_t len = 0;
+        const uint8_t* data = nullptr;
+        while (count < max_recv_count && (data = ring.front(len)) != nullptr)
+        {
+            ShardRuntime::MsgHead head;
+            std::memcpy(&head, data, sizeof(head));
+            if (head.type == ShardRuntime::kMsgTask)
+            {
+                ShardRuntime::Task* task = nullptr;
+                std::memcpy(&task, data + sizeof(head), sizeof(task));
+                ring.pop();
+                (*task)();
+                delete task;
+            }
+            else
+            {
+                if (recv_callback_)
+                    recv_callback_(reinterpret_cast<const char*>(data) + sizeof(head), len - sizeof(head), head.id,
+                                   head.arrived_time);
+                ring.pop();
+            }
+            ++count;
+        }
+    }
+    next_producer_ = (next_producer_ + 1) % producer_num;
+    return count;
+}
+
+// ========== ShardRuntime ==========
+
+ShardRuntime::ShardRuntime() = default;
+
+ShardRuntime::~ShardRuntime()
+{
+    Stop();
+}
+
+int32_t ShardRuntime::CurrentShard() noexcept
+{
+    return tls_shard_id;
+}
+
+SpscRingBuf& ShardRuntime::InRing(uint32_t producer, uint32_t shard_id) const
+{
+    return in_rings_[producer * shard_num_ + shard_id]->buf;
+}
+
+int32_t ShardRuntime::CurrentProducer() const noexcept
+{
+    if (tls_runtime == this)
+        return tls_shard_id + 1;
+    if (std::this_thread::get_id() == io_thread_id_)
+        return 0;
+    return -1;
+}
+
+bool ShardRuntime::Start(const Option& option, CoreFactory factory, std::string* err_msg)
+{
+    if (!threads_.empty())
+    {
+        if (err_msg)
+            *err_msg += "shard runtime already started";
+        return false;
+    }
+    if (option.shard_num == 0 || !option.io_channel || !option.route_codec || !factory)
+    {
+        if (err_msg)
+            *err_msg += "invalid shard option";
+        return false;
+    }
+
+    option_ = option;
+    shard_num_ = option.shard_num;
+    // 调用 Start 的线程即 IO 线程
+    io_thread_id_ = std::this_thread::get_id();
+    stop_.store(false, std::memory_order_relaxed);
+    ready_num_.store(0, std::memory_order_relaxed);
+    exited_num_.store(0, std::memory_order_relaxed);
+    init_failed_.store(false, std::memory_order_relaxed);
+
+    in_rings_.clear();
+    out_rings_.clear();
+    shards_.clear();
+    for (uint32_t producer = 0; producer <= shard_num_; ++producer)
+    {
+        for (uint32_t i = 0; i < shard_num_; ++i)
+        {
+            auto ring = std::make_unique<Ring>();
+            if (!ring->Init(producer == 0 ? option.in_ring_size : option.post_ring_size))
+            {
+                if (err_msg)
+                    *err_msg += "init shard ring failed";
+                return false;
+            }
+            in_rings_.push_back(std::move(ring));
+        }
+    }
+    for (uint32_t i = 0; i < shard_num_; ++i)
+    {
+        auto ring = std::make_unique<Ring>();
+        if (!ring->Init(option.out_ring_size))
+        {
+            if (err_msg)
+                *err_msg += "init shard ring failed";
+            return false;
+        }
+        out_rings_.push_back(std::move(ring));
+
+        auto shard = std::make_unique<Shard>();
+        shard->channel.runtime_ = this;
+        shard->channel.shard_id_ = i;
+        shards_.push_back(std::move(shard));
+    }
+
+    option_.io_channel->SetCallback([this](const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time) {
+        Dispatch(data, len, recv_id, arrived_time);
+        return 0;
+    });
+
+    for (uint32_t i = 0; i < shard_num_; ++i)
+        threads_.emplace_back([this, i, &factory]() { WorkerMain(i, factory); });
+
+    // factory 以引用传入，必须等所有分片初始化完
+    while (ready_num_.load(std::memory_order_acquire) < shard_num_)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    if (init_failed_.load(std::memory_order_acquire))
+    {
+        Stop();
+        if (err_msg)
+            *err_msg += "shard core init failed";
+        return false;
+    }
+    UA_LOG_INFO(0, "shard runtime start, shard_num:%u", shard_num_);
+    return true;
+}
+
+void ShardRuntime::Stop()
+{
+    if (threads_.empty())
+        return;
+
+    stop_.store(true, std::memory_order_release);
+    // 分片在 SvrStopReady 前要等在途 RPC 的回包，发给客户端的应答也要发出：IO 线程继续收发直到分片全部退出循环
+    if (std::this_thread::get_id() == io_thread_id_)
+    {
+        while (exited_num_.load(std::memory_order_acquire) < threads_.size())
+        {
+            if (PollIO(kStopPollRecvNum) > 0)
+                continue;
+            if (option_.idle_sleep_us > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(option_.idle_sleep_us));
+            else
+                std::this_thread::yield();
+        }
+    }
+    else
+    {
+        UA_LOG_WARN(0, "shard runtime stop outside io thread, inflight rpc can only time out");
+    }
+    for (auto& thread : threads_)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+    threads_.clear();
+    // 退出后残留的待发包直接发出，未执行的任务释放
+    FlushSend();
+    DrainRings();
+}
+
+void ShardRuntime::WorkerMain(uint32_t shard_id, const CoreFactory& factory)
+{
+    tls_shard_id = static_cast<int32_t>(shard_id);
+    tls_runtime = this;
+
+    if (!option_.cpus.empty())
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(option_.cpus[shard_id % option_.cpus.size()], &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+            UA_LOG_WARN(0, "shard %u set cpu affinity failed", shard_id);
+    }
+
+    std::unique_ptr<ServerCore> core = factory(shard_id, &shards_[shard_id]->channel);
+    if (!core)
+    {
+        UA_LOG_ERROR(0, "shard %u create core failed", shard_id);
+        init_failed_.store(true, std::memory_order_release);
+    }
+    ready_num_.fetch_add(1, std::memory_order_acq_rel);
+    if (!core)
+    {
+        HandOverStatistics(shard_id);
+        tls_runtime = nullptr;
+        tls_shard_id = -1;
+        exited_num_.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+
+    uint64_t tick_count = 0;
+    uint64_t next_tick_ms = 0;
+    bool quit_notified = false;
+    while (true)
+    {
+        uint64_t now_us = utils::CurrentRealMicroSec();
+        uint64_t now_ms = now_us / 1000;
+        Clock::GetInst().Update(now_us);
+
+        if (now_ms >= next_tick_ms)
+        {
+            core->SvrTick(now_ms, tick_count++);
+            HandOverStatistics(shard_id);
+            next_tick_ms = now_ms + option_.tick_interval_ms;
+        }
+        if (!quit_notified && stop_.load(std::memory_order_acquire))
+        {
+            core->SvrNtfQuit();
+            quit_notified = true;
+        }
+
+        size_t deal_num = core->SvrProc(now_ms);
+        if (quit_notified && core->SvrStopReady())
+            break;
+        if (deal_num == 0)
+        {
+            if (option_.idle_sleep_us > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(option_.idle_sleep_us));
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    core->SvrFinish();
+    core.reset();
+    HandOverStatistics(shard_id);
+    tls_runtime = nullptr;
+    tls_shard_id = -1;
+    // 之后不再往出队列写，IO 线程可以停止轮询（SvrFinish 中发的包由 Stop 最后的 FlushSend 发出）
+    exited_num_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+size_t ShardRuntime::PollIO(uint32_t max_recv_count)
+{
+    Clock::GetInst().Update(utils::CurrentRealMicroSec());
+    size_t count = option_.io_channel->Loop(max_recv_count);
+    return count + FlushSend();
+}
+
+bool ShardRuntime::Dispatch(const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time)
+{
+    RecvCodec* codec = option_.route_codec;
+    codec->Reset();
+    if (!codec->Decode(data, static_cast<uint32_t>(len)))
+    {
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "shard dispatch decode failed, len:%zu, recv_id:%u", len, recv_id);
+        return false;
+    }
+
+    uint32_t shard_id = ShardOf(codec->GetGid());
+    Shard& shard = *shards_[shard_id];
+    MsgHead head{kMsgPacket, recv_id, arrived_time};
+    struct iovec iov[2] = {{&head, sizeof(head)}, {const_cast<char*>(data), len}};
+    if (!InRing(0, shard_id).push(iov, 2))
+    {
+        shard.dispatch_drop_num.fetch_add(1, std::memory_order_relaxed);
+        UA_LOG_WARN_EVERY_MS(1000, codec->GetGid(), "shard %u in ring full, drop cmd:%u", shard_id, codec->GetCmd());
+        return false;
+    }
+    shard.dispatch_num.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ShardRuntime::Post(uint32_t shard_id, Task task)
+{
+    int32_t producer = CurrentProducer();
+    if (producer < 0 || shard_id >= shard_num_)
+        return false;
+
+    Shard& shard = *shards_[shard_id];
+    auto* task_ptr = new Task(std::move(task));
+    MsgHead head{kMsgTask, 0, 0};
+    struct iovec iov[2] = {{&head, sizeof(head)}, {&task_ptr, sizeof(task_ptr)}};
+    if (!InRing(static_cast<uint32_t>(producer), shard_id).push(iov, 2))
+    {
+        delete task_ptr;
+        shard.post_drop_num.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    shard.post_num.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t ShardRuntime::FlushSend()
+{
+    size_t count = 0;
+    for (auto& ring : out_rings_)
+    {
+        uint32_t len = 0;
+        const uint8_t* data = nullptr;
+        while ((data = ring->buf.front(len)) != nullptr)
+        {
+            MsgHead head;
+            std::memcpy(&head, data, sizeof(head));
+            if (option_.io_channel->Send(head.id, reinterpret_cast<const char*>(data) + sizeof(head),
+                                         len - sizeof(head)) != 0)
+                UA_LOG_ERROR_EVERY_MS(1000, 0, "shard send failed, dest:%u, len:%u", head.id, len);
+            ring->buf.pop();
+            ++count;
+        }
+    }
+    return count;
+}
+
+void ShardRuntime::DrainRings()
+{
+    for (auto& ring : in_rings_)
+    {
+        uint32_t len = 0;
+        const uint8_t* data = nullptr;
+        while ((data = ring->buf.front(len)) != nullptr)
+        {
+            MsgHead head;
+            std::memcpy(&head, data, sizeof(head));
+            if (head.type == kMsgTask)
+            {
+                Task* task = nullptr;
+                std::memcpy(&task, data + sizeof(head), sizeof(task));
+                delete task;
+            }
+            ring->buf.pop();
+        }
+    }
+}
+
+ShardRuntime::ShardStat ShardRuntime::GetStat(uint32_t shard_id) const
+{
+    ShardStat stat;
+    if (shard_id >= shards_.size())
+        return stat;
+    const Shard& shard = *shards_[shard_id];
+    stat.dispatch_num = shard.dispatch_num.load(std::memory_order_relaxed);
+    stat.dispatch_drop_num = shard.dispatch_drop_num.load(std::memory_order_relaxed);
+    stat.post_num = shard.post_num.load(std::memory_order_relaxed);
+    stat.post_drop_num = shard.post_drop_num.load(std::memory_order_relaxed);
+    stat.send_num = shard.send_num.load(std::memory_order_relaxed);
+    stat.send_drop_num = shard.send_drop_num.load(std::memory_order_relaxed);
+    return stat;
+}
+
+void ShardRuntime::HandOverStatistics(uint32_t shard_id)
+{
+    auto& local = ServerStatistics::GetInst();
+    Shard& shard = *shards_[shard_id];
+    {
+        std::lock_guard<std::mutex> lock(shard.stat_mutex);
+        shard.stat.Merge(local);
+    }
+    local.ClearStatistics();
+}
+
+void ShardRuntime::CollectStatistics(ServerStatistics& out)
+{
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->stat_mutex);
+        out.Merge(shard->stat);
+        shard->stat.ClearStatistics();
+    }
+}
+
+}  // namespace ua
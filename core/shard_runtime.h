@@ -0,0 +1,157 @@
+/// @file shard_runtime.h
+/// @brief 按 gid 分片的多线程运行时
+/// @note 每个分片一个工作线程，独占一个 ServerCore（ContextController / TimeoutDecorator / 协程池 / PBService 各自一份），
+///       可绑定到指定 CPU；IO 线程调用 PollIO 从真实 channel 收包，解出 gid 后按 hash(gid) % N 投递到分片，
+///       同一 gid 的包总在同一分片上按到达顺序处理
+///       队列均为单生产者单消费者无锁环形缓冲：IO 线程和每个分片各有一条到每个分片的入队列，
+///       每个分片有一条到 IO 线程的出队列，真实 channel 只在 IO 线程上收发
+///       分片内的 ServerCore 用 ShardChannel 作为 transport 的 channel，PBService 的收发包流程不变
+///       限制: 分片内发起 RPC 的 gid 应属于本分片（回包按 gid 路由回来），其他 gid 的逻辑用 Post 投递到所属分片
+///       ServerStatistics 为线程级：分片每次 SvrTick 后把本线程的增量交给分片的交接区并清零，
+///       导出线程调用 CollectStatistics 汇总到自己的 ServerStatistics 后再 Publish
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "interface/channel_interface.h"
+
+namespace ua
+{
+
+class RecvCodec;
+class ServerCore;
+class ServerStatistics;
+class ShardRuntime;
+class SpscRingBuf;
+
+/// 分片内的 channel：从本分片的入队列收包和任务，发包转交 IO 线程
+class ShardChannel : public IChannel
+{
+public:
+    [[nodiscard]] uint32_t MyID() const override;
+    int32_t Send(uint32_t dest_id, const char* buff, size_t buff_len) override;
+    size_t Loop(uint32_t max_recv_count) override;
+
+    [[nodiscard]] uint32_t ShardID() const noexcept { return shard_id_; }
+
+private:
+    friend class ShardRuntime;
+    ShardRuntime* runtime_ = nullptr;
+    uint32_t shard_id_ = 0;
+    uint32_t next_producer_ = 0;
+};
+
+class ShardRuntime
+{
+public:
+    using Task = std::function<void()>;
+    /// 在分片线程上创建并初始化 ServerCore（SvrInit、把 channel 加为 transport 等），失败返回 nullptr
+    using CoreFactory = std::function<std::unique_ptr<ServerCore>(uint32_t shard_id, ShardChannel* channel)>;
+
+    struct Option
+    {
+        uint32_t shard_num = 1;
+        IChannel* io_channel = nullptr;        // 真实收发通道，只在 PollIO 所在线程使用
+        RecvCodec* route_codec = nullptr;      // IO 线程解出 gid 用，只在 PollIO 所在线程使用
+        std::vector<int> cpus;                 // 分片 i 绑定到 cpus[i % size]，为空不绑定
+        uint32_t in_ring_size = 4 << 20;       // IO 线程到每个分片的队列大小
+        uint32_t post_ring_size = 256 << 10;   // 分片之间的队列大小
+        uint32_t out_ring_size = 4 << 20;      // 每个分片到 IO 线程的队列大小
+        uint32_t tick_interval_ms = 100;       // 分片 SvrTick 间隔
+        uint32_t idle_sleep_us = 100;          // 分片空闲时休眠时长，0 表示只让出 CPU
+    };
+
+    struct ShardStat
+    {
+        uint64_t dispatch_num = 0;       // 投递到本分片的包
+        uint64_t dispatch_drop_num = 0;  // 入队列满丢弃的包
+        uint64_t post_num = 0;           // 投递到本分片的任务
+        uint64_t post_drop_num = 0;      // 队列满未能投递的任务
+        uint64_t send_num = 0;           // 本分片经 IO 线程发出的包
+        uint64_t send_drop_num = 0;      // 出队列满丢弃的包
+    };
+
+    ShardRuntime();
+    ~ShardRuntime();
+    ShardRuntime(const ShardRuntime&) = delete;
+    ShardRuntime& operator=(const ShardRuntime&) = delete;
+
+    /// 创建队列并启动分片线程，所有分片的 factory 都成功后返回
+    bool Start(const Option& option, CoreFactory factory, std::string* err_msg = nullptr);
+    /// 通知所有分片退出，等待 SvrStopReady 后 SvrFinish 并回收线程
+    /// 应在 IO 线程调用：等待期间继续 PollIO，在途 RPC 的回包照常送达，分片的应答照常发出
+    void Stop();
+
+    /// IO 线程驱动：收包并分发到分片，再把分片的待发包交给真实 channel，返回收发包数
+    size_t PollIO(uint32_t max_recv_count);
+    /// 按 gid 把一个包投递到分片，解码失败或队列满返回 false（只能在 IO 线程调用）
+    bool Dispatch(const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time);
+
+    /// 投递任务到指定分片执行，可在 IO 线程或分片线程上调用，其他线程调用返回 false
+    bool Post(uint32_t shard_id, Task task);
+    bool PostToGid(uint64_t gid, Task task) { return Post(ShardOf(gid), std::move(task)); }
+
+    [[nodiscard]] uint32_t ShardOf(uint64_t gid) const noexcept { return ShardOf(gid, shard_num_); }
+    [[nodiscard]] static uint32_t ShardOf(uint64_t gid, uint32_t shard_num) noexcept
+    {
+        // 连续分配的 gid 也能打散
+        return static_cast<uint32_t>(((gid * 0x9e3779b97f4a7c15ULL) >> 32) % shard_num);
+    }
+    [[nodiscard]] uint32_t ShardNum() const noexcept { return shard_num_; }
+    /// 当前线程所在的分片，不是分片线程返回 -1
+    [[nodiscard]] static int32_t CurrentShard() noexcept;
+
+    [[nodiscard]] ShardStat GetStat(uint32_t shard_id) const;
+    /// 把各分片上次汇总以来的统计增量 Merge 到 out 并清空交接区，可在任意线程调用
+    /// 分片在 SvrTick 后交出增量，所以最多滞后一个 tick_interval_ms；Stop 之后调用可拿到全部剩余统计
+    void CollectStatistics(ServerStatistics& out);
+
+private:
+    friend class ShardChannel;
+    struct Ring;
+    struct Shard;
+
+    static constexpr uint32_t kStopPollRecvNum = 256;  // Stop 等待分片退出时每次 PollIO 的收包上限
+
+    enum MsgType : uint32_t
+    {
+        kMsgPacket = 1,
+        kMsgTask = 2,
+    };
+
+    /// 队列中每条记录的头部，后面跟包数据或 Task 指针
+    struct MsgHead
+    {
+        uint32_t type;
+        uint32_t id;  // 收包为来源 id，发包为目的 id
+        uint64_t arrived_time;
+    };
+
+    /// 入队列下标: 生产者 0 为 IO 线程，1 + i 为分片 i
+    [[nodiscard]] SpscRingBuf& InRing(uint32_t producer, uint32_t shard_id) const;
+    [[nodiscard]] int32_t CurrentProducer() const noexcept;
+    void WorkerMain(uint32_t shard_id, const CoreFactory& factory);
+    /// 分片线程把本线程的统计交到交接区并清零
+    void HandOverStatistics(uint32_t shard_id);
+    size_t FlushSend();
+    void DrainRings();
+
+    uint32_t shard_num_ = 0;
+    Option option_;
+    std::vector<std::unique_ptr<Ring>> in_rings_;
+    std::vector<std::unique_ptr<Ring>> out_rings_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::thread> threads_;
+    std::thread::id io_thread_id_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint32_t> ready_num_{0};
+    std::atomic<uint32_t> exited_num_{0};  // 已退出主循环的分片数
+    std::atomic<bool> init_failed_{false};
+};
+
+}  // namespace ua
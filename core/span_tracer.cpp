@@ -0,0 +1,182 @@
+/// @file span_tracer.cpp
+/// @brief span 追踪实现
+#include "span_tracer.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "containers/fixed_ring_buf.h"
+
+namespace ua
+{
+
+namespace
+{
+
+/// 每线程缓冲；线程退出后仍由注册表持有，事件可继续导出
+struct ThreadSpanBuffer
+{
+    uint32_t tid = 0;
+    /// 只有本线程写，导出时与写入互斥；只有采样请求才会加锁
+    std::mutex mutex;
+    FixedRingBuf<SpanEvent, SpanTracer::kThreadEventNum> events;
+};
+
+std::mutex& RegistryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::unique_ptr<ThreadSpanBuffer>>& Registry()
+{
+    static std::vector<std::unique_ptr<ThreadSpanBuffer>> buffers;
+    return buffers;
+}
+
+ThreadSpanBuffer* LocalBuffer()
+{
+    static thread_local ThreadSpanBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        auto new_buffer = std::make_unique<ThreadSpanBuffer>();
+        new_buffer->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+        buffer = new_buffer.get();
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        Registry().push_back(std::move(new_buffer));
+    }
+    return buffer;
+}
+
+struct ExportEvent
+{
+    SpanEvent event;
+    uint32_t tid;
+};
+
+/// 事件名来自代码中的字面量，只做最小转义
+void AppendJsonString(std::string& out, const char* str)
+{
+    out.push_back('"');
+    for (const char* p = str; *p; ++p)
+    {
+        if (*p == '"' || *p == '\\')
+            out.push_back('\\');
+        out.push_back(*p);
+    }
+    out.push_back('"');
+}
+
+}  // namespace
+
+uint64_t SpanTracer::NowNs() noexcept
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+}
+
+uint64_t SpanTracer::NewId() noexcept
+{
+    // 进程启动时取随机种子，之后递增并打散
+    static const uint64_t seed = []() {
+        std::random_device rd;
+        return (static_cast<uint64_t>(rd()) << 32) ^ rd() ^ NowNs();
+    }();
+    static std::atomic<uint64_t> counter{0};
+    uint64_t id = seed + counter.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ULL;
+    id ^= id >> 31;
+    id *= 0xbf58476d1ce4e5b9ULL;
+    id ^= id >> 29;
+    return id ? id : 1;
+}
+
+void SpanTracer::StartSampled(ServerContext& ctx, const TraceContext* upstream) noexcept
+{
+    ctx.trace_id = upstream ? upstream->trace_id : NewId();
+    ctx.span_id = NewId();
+    if (upstream && upstream->span_id)
+        Instant(Ref(&ctx), "upstream", upstream->span_id);
+}
+
+void SpanTracer::Record(SpanRef ref, char phase, const char* name, uint64_t arg, uint64_t ts_ns) noexcept
+{
+    ThreadSpanBuffer* buffer = LocalBuffer();
+    SpanEvent event{ts_ns ? ts_ns : NowNs(), ref.trace_id, ref.span_id, arg, name, phase};
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->events.push(event, true);
+}
+
+void SpanTracer::ExportJson(std::string& out)
+{
+    std::vector<ExportEvent> events;
+    {
+        std::lock_guard<std::mutex> registry_lock(RegistryMutex());
+        for (auto& buffer : Registry())
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            for (size_t i = 0; i < buffer->events.size(); ++i)
+                events.push_back({buffer->events.front(i), buffer->tid});
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const ExportEvent& a, const ExportEvent& b) { return a.event.ts_ns < b.event.ts_ns; });
+
+    int pid = getpid();
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char buf[256];
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const SpanEvent& event = events[i].event;
+        if (i > 0)
+            out.push_back(',');
+        out += "{\"name\":";
+        AppendJsonString(out, event.name);
+        // ts 单位为微秒，保留纳秒精度
+        int n = snprintf(buf, sizeof(buf),
+                         ",\"cat\":\"request\",\"ph\":\"%c\",\"id\":\"0x%" PRIx64 "\",\"ts\":%" PRIu64 ".%03" PRIu64
+                         ",\"pid\":%d,\"tid\":%u,\"args\":{\"trace_id\":\"0x%" PRIx64 "\",\"arg\":%" PRIu64 "}}",
+                         event.phase, event.span_id, event.ts_ns / 1000, event.ts_ns % 1000, pid, events[i].tid,
+                         event.trace_id, event.arg);
+        if (n > 0)
+            out.append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+    }
+    out += "]}\n";
+}
+
+bool SpanTracer::ExportFile(const std::string& path, std::string* err_msg)
+{
+    std::string json;
+    ExportJson(json);
+
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp)
+    {
+        if (err_msg)
+            *err_msg += "open " + path + " failed";
+        return false;
+    }
+    bool ok = fwrite(json.data(), 1, json.size(), fp) == json.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok && err_msg)
+        *err_msg += "write " + path + " failed";
+    return ok;
+}
+
+void SpanTracer::Clear()
+{
+    std::lock_guard<std::mutex> registry_lock(RegistryMutex());
+    for (auto& buffer : Registry())
+    {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
+
+}  // namespace ua
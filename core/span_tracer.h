@@ -0,0 +1,121 @@
+/// @file span_tracer.h
+/// @brief 按请求采样的 span 追踪，导出 Chrome trace_event JSON
+/// @note 请求进入时（DealRequest）调用 StartRequest：带上游 TraceContext 的请求服从上游的采样决定并加入其 trace，
+///       否则作为入口请求按 context id 采样；结果写入 ServerContext::trace_id / span_id，
+///       未采样的请求在各埋点只有一次字段判断
+///       事件写入本线程的定长环形缓冲（满时覆盖最旧的），只在导出时跨线程读取
+///       一个请求可能在协程间切换、在不同时刻被唤醒，所以 span 使用 Chrome 的异步事件（ph = b/e/n），
+///       以本请求的 span id 作为异步 id，同一请求的所有 span 在 chrome://tracing 或 Perfetto UI 中聚成一行，
+///       args 中带 trace id，上游 span id 记在 "upstream" 事件里，多个服务导出的文件可按 trace id 拼接
+///       时间戳取系统时钟，便于跨进程对齐
+///       事件名必须是静态字符串
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "context.h"
+#include "trace_context.h"
+
+namespace ua
+{
+
+/// 一个 span 事件
+struct SpanEvent
+{
+    uint64_t ts_ns;     // 系统时钟纳秒
+    uint64_t trace_id;
+    uint64_t span_id;   // 本进程内请求的 span id，作为异步事件 id
+    uint64_t arg;       // 附加参数（cmd / seq_id / ret 等，含义随事件名）
+    const char* name;
+    char phase;         // 'b' 开始 / 'e' 结束 / 'n' 瞬时
+};
+
+/// 埋点引用的请求 span，span_id 为 0 表示未采样
+struct SpanRef
+{
+    uint64_t trace_id = 0;
+    uint64_t span_id = 0;
+};
+
+class SpanTracer
+{
+public:
+    /// 每线程保留的事件数
+    static constexpr uint32_t kThreadEventNum = 16 * 1024;
+
+    /// 采样率：0 关闭，1 全采，N 表示每 N 个请求采一个
+    static void SetSampleEvery(uint32_t every_n) noexcept { sample_every_.store(every_n, std::memory_order_relaxed); }
+    [[nodiscard]] static uint32_t GetSampleEvery() noexcept { return sample_every_.load(std::memory_order_relaxed); }
+
+    /// 入口请求的本地采样决定
+    [[nodiscard]] static bool ShouldSample(uint64_t context_id) noexcept
+    {
+        uint32_t every_n = sample_every_.load(std::memory_order_relaxed);
+        if (__builtin_expect(every_n == 0, 1))
+            return false;
+        return context_id % every_n == 0;
+    }
+
+    /// 请求入口调用，upstream 为从扩展头解出的上游追踪上下文，没有时传 nullptr
+    static void StartRequest(ServerContext& ctx, const TraceContext* upstream) noexcept
+    {
+        if (upstream ? upstream->Sampled() : ShouldSample(ctx.id))
+            StartSampled(ctx, upstream);
+    }
+
+    /// 发起 RPC 时下发的追踪上下文（已做出不采样决定的请求也下发，下游不再自行采样）
+    [[nodiscard]] static TraceContext Propagate(const ServerContext& ctx) noexcept
+    {
+        return {ctx.trace_id, ctx.span_id, ctx.span_id ? TraceContext::kFlagSampled : uint8_t{0}};
+    }
+
+    [[nodiscard]] static SpanRef Ref(const ServerContext* ctx) noexcept
+    {
+        return ctx ? SpanRef{ctx->trace_id, ctx->span_id} : SpanRef{};
+    }
+
+    static void Begin(SpanRef ref, const char* name, uint64_t arg = 0) noexcept
+    {
+        if (ref.span_id)
+            Record(ref, 'b', name, arg, 0);
+    }
+    static void End(SpanRef ref, const char* name, uint64_t arg = 0) noexcept
+    {
+        if (ref.span_id)
+            Record(ref, 'e', name, arg, 0);
+    }
+    static void Instant(SpanRef ref, const char* name, uint64_t arg = 0) noexcept
+    {
+        if (ref.span_id)
+            Record(ref, 'n', name, arg, 0);
+    }
+    /// 补记一个已经开始的 span，begin_ns 为 NowNs() 取的开始时刻
+    static void Span(SpanRef ref, const char* name, uint64_t begin_ns, uint64_t arg = 0) noexcept
+    {
+        if (ref.span_id)
+        {
+            Record(ref, 'b', name, arg, begin_ns);
+            Record(ref, 'e', name, arg, 0);
+        }
+    }
+
+    [[nodiscard]] static uint64_t NowNs() noexcept;
+
+    /// 导出所有线程当前保留的事件为 Chrome trace_event JSON（Perfetto UI 可直接打开）
+    static void ExportJson(std::string& out);
+    static bool ExportFile(const std::string& path, std::string* err_msg = nullptr);
+    /// 清空所有线程的事件
+    static void Clear();
+
+private:
+    static void StartSampled(ServerContext& ctx, const TraceContext* upstream) noexcept;
+    /// 进程内唯一、跨进程大概率不冲突的 id
+    static uint64_t NewId() noexcept;
+    /// ts_ns 为 0 时取当前时间
+    static void Record(SpanRef ref, char phase, const char* name, uint64_t arg, uint64_t ts_ns) noexcept;
+
+    static constinit inline std::atomic<uint32_t> sample_every_{0};
+};
+
+}  // namespace ua
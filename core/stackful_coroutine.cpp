@@ -0,0 +1,308 @@
+/// @file stackful_coroutine.cpp
+/// @brief 内置有栈协程实现
+#include "stackful_coroutine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include "coro_context.h"
+#include "logger.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+namespace
+{
+
+/// 中转上下文只做拷贝，用一个小栈
+constexpr size_t kRelayStackSize = 64 * 1024;
+/// 保存缓冲区按 512 字节取整，容量超过用量 4 倍时收缩
+constexpr size_t kSaveAlign = 512;
+
+}  // namespace
+
+class StackfulCoroutine::StackfulCoro : public Coro
+{
+public:
+    explicit StackfulCoro(StackfulCoroutine* owner) : owner_(owner) {}
+
+    void Resume() override { owner_->SwitchIn(this); }
+    void Yield() override { owner_->SwitchOut(this); }
+
+    StackfulCoroutine* owner_;
+    CoroStackPool::Stack stack;      // 独立栈模式
+    SharedStack* shared = nullptr;   // 共享栈模式
+    CoroTask task;
+    CoroFunc* func = nullptr;
+    void* args = nullptr;
+    void* sp = nullptr;              // 切走时的栈指针
+    StackfulCoro* caller = nullptr;  // 恢复它的协程，主协程为 nullptr
+    bool active = false;             // 正在执行（未挂起）
+    bool done = true;
+
+    std::unique_ptr<char[]> save_buf;
+    size_t save_cap = 0;
+    size_t save_size = 0;
+};
+
+StackfulCoroutine::StackfulCoroutine(const Option& option) : option_(option)
+{
+}
+
+StackfulCoroutine::~StackfulCoroutine()
+{
+    // 挂起未结束的协程无法展开，栈上对象不析构
+    if (running_num_ > 0)
+        UA_LOG_WARN(0, "destroy stackful coroutine with %zu unfinished coroutines", running_num_);
+    for (auto& coro : coros_)
+        stack_pool_.Free(coro->stack);
+    for (auto& shared : shared_stacks_)
+        stack_pool_.Free(shared.stack);
+    stack_pool_.Free(relay_stack_);
+}
+
+bool StackfulCoroutine::InitShared()
+{
+    if (!relay_stack_.valid())
+    {
+        if (!stack_pool_.Alloc(kRelayStackSize, relay_stack_))
+            return false;
+        relay_sp_ = CoroMakeContext(relay_stack_.high(), &StackfulCoroutine::RelayEntry, this);
+    }
+    uint32_t num = option_.shared_stack_num > 0 ? option_.shared_stack_num : 1;
+    shared_stacks_.reserve(num);
+    while (shared_stacks_.size() < num)
+    {
+        SharedStack shared;
+        if (!stack_pool_.Alloc(option_.stack_size, shared.stack))
+            return false;
+        shared_stacks_.push_back(shared);
+    }
+    return true;
+}
+
+StackfulCoroutine::StackfulCoro* StackfulCoroutine::Acquire()
+{
+    if (max_coro_num_ > 0 && running_num_ >= max_coro_num_)
+    {
+        UA_LOG_WARN_EVERY_MS(1000, 0, "coroutine num reach limit %zu", max_coro_num_);
+        return nullptr;
+    }
+    if (!free_coros_.empty())
+    {
+        StackfulCoro* coro = free_coros_.back();
+        free_coros_.pop_back();
+        return coro;
+    }
+
+    auto coro = std::make_unique<StackfulCoro>(this);
+    if (StackShared())
+    {
+        if (shared_stacks_.empty() && !InitShared())
+            return nullptr;
+        coro->shared = &shared_stacks_[next_shared_++ % shared_stacks_.size()];
+    }
+    else if (!stack_pool_.Alloc(option_.stack_size, coro->stack))
+    {
+        return nullptr;
+    }
+    coros_.push_back(std::move(coro));
+    // 保证回收时 push_back 不扩容
+    free_coros_.reserve(coros_.size());
+    return coros_.back().get();
+}
+
+bool StackfulCoroutine::Spawn(CoroFunc f, void* args)
+{
+    StackfulCoro* coro = Acquire();
+    if (!coro)
+        return false;
+    coro->func = f;
+    coro->args = args;
+    return Start(coro);
+}
+
+bool StackfulCoroutine::Spawn(CoroTask task)
+{
+    StackfulCoro* coro = Acquire();
+    if (!coro)
+        return false;
+    coro->task = std::move(task);
+    coro->func = nullptr;
+    return Start(coro);
+}
+
+bool StackfulCoroutine::Start(StackfulCoro* coro)
+{
+    if (!coro->shared)
+    {
+        // 栈上可能残留上一个协程（或同地址旧线程栈）的 ASan 红区标记
+        CoroUnpoisonStack(coro->stack.low, coro->stack.size);
+        coro->sp = CoroMakeContext(coro->stack.high(), &StackfulCoroutine::Entry, coro);
+    }
+    else
+    {
+        // 共享栈此时可能被占用（甚至就是当前栈），初始帧先放进保存缓冲区，切入时再换入
+        alignas(16) char frame[256];
+        char* frame_high = frame + sizeof(frame);
+        auto* frame_sp = static_cast<char*>(CoroMakeContext(frame_high, &StackfulCoroutine::Entry, coro));
+        size_t size = static_cast<size_t>(frame_high - frame_sp);
+        if (!ReserveSave(coro, size))
+        {
+            coro->task = nullptr;
+            free_coros_.push_back(coro);
+            return false;
+        }
+        std::memcpy(coro->save_buf.get(), frame_sp, size);
+        coro->save_size = size;
+        coro->sp = coro->shared->stack.high() - size;
+        saved_bytes_ += size;
+    }
+    coro->done = false;
+    ++running_num_;
+    SwitchIn(coro);
+    return true;
+}
+
+Coro* StackfulCoroutine::ThisCoro() const
+{
+    return current_;
+}
+
+void StackfulCoroutine::SwitchIn(StackfulCoro* coro)
+{
+    if (coro->done || coro->active)
+    {
+        UA_LOG_ERROR(0, "resume coroutine that is %s", coro->done ? "finished" : "running");
+        return;
+    }
+    StackfulCoro* from = current_;
+    coro->caller = from;
+    coro->active = true;
+    current_ = coro;
+    Jump(from, coro);
+
+    // 协程挂起或结束后回到这里
+    current_ = from;
+    if (coro->done)
+    {
+        --running_num_;
+        free_coros_.push_back(coro);
+    }
+}
+
+void StackfulCoroutine::SwitchOut(StackfulCoro* coro)
+{
+    if (coro != current_)
+    {
+        UA_LOG_ERROR(0, "yield coroutine that is not running");
+        return;
+    }
+    coro->active = false;
+    Jump(coro, coro->caller);
+}
+
+void StackfulCoroutine::Jump(StackfulCoro* from, StackfulCoro* to)
+{
+    void** save_sp = from ? &from->sp : &main_sp_;
+    if (to && to->shared && to->shared->owner != to)
+    {
+        relay_target_ = to;
+        ua_coro_switch(save_sp, relay_sp_);
+        return;
+    }
+    ua_coro_switch(save_sp, to ? to->sp : main_sp_);
+}
+
+bool StackfulCoroutine::ReserveSave(StackfulCoro* coro, size_t size)
+{
+    size_t cap = (size + kSaveAlign - 1) / kSaveAlign * kSaveAlign;
+    if (coro->save_cap >= size && coro->save_cap <= std::max(cap, size * 4))
+        return true;
+    std::unique_ptr<char[]> buf(new (std::nothrow) char[cap]);
+    if (!buf)
+    {
+        UA_LOG_ERROR_EVERY_MS(1000, 0, "alloc coroutine save buffer failed, size %zu", cap);
+        return false;
+    }
+    saved_capacity_ = saved_capacity_ - coro->save_cap + cap;
+    coro->save_buf = std::move(buf);
+    coro->save_cap = cap;
+    return true;
+}
+
+void StackfulCoroutine::SaveStack(StackfulCoro* coro)
+{
+    size_t size = static_cast<size_t>(coro->shared->stack.high() - static_cast<char*>(coro->sp));
+    if (!ReserveSave(coro, size))
+    {
+        // 没有内存保存栈内容，无法继续
+        std::abort();
+    }
+    // 换出的栈内容含帧间红区，拷贝前清掉标记
+    CoroUnpoisonStack(coro->sp, size);
+    std::memcpy(coro->save_buf.get(), coro->sp, size);
+    coro->save_size = size;
+    saved_bytes_ += size;
+    ++copy_num_;
+    ServerStatistics::GetInst().statistics().save_max_coro_saved_stack_bytes_max(saved_bytes_);
+}
+
+void StackfulCoroutine::RestoreStack(StackfulCoro* coro)
+{
+    if (coro->save_size == 0)
+        return;
+    CoroUnpoisonStack(coro->shared->stack.low, coro->shared->stack.size);
+    std::memcpy(coro->shared->stack.high() - coro->save_size, coro->save_buf.get(), coro->save_size);
+    saved_bytes_ -= coro->save_size;
+    coro->save_size = 0;
+}
+
+void StackfulCoroutine::RelayEntry(void* arg)
+{
+    auto* self = static_cast<StackfulCoroutine*>(arg);
+    while (true)
+    {
+        // 切到这里的一方已把栈指针存好，占用者的内容可以安全换出
+        StackfulCoro* to = self->relay_target_;
+        SharedStack& shared = *to->shared;
+        if (shared.owner)
+            self->SaveStack(shared.owner);
+        self->RestoreStack(to);
+        shared.owner = to;
+        ua_coro_switch(&self->relay_sp_, to->sp);
+    }
+}
+
+void StackfulCoroutine::Entry(void* arg)
+{
+    auto* coro = static_cast<StackfulCoro*>(arg);
+    try
+    {
+        if (coro->func)
+            coro->func(coro->args);
+        else
+            coro->task();
+    }
+    catch (const std::exception& e)
+    {
+        UA_LOG_ERROR(0, "coroutine task throw exception: %s", e.what());
+    }
+    catch (...)
+    {
+        UA_LOG_ERROR(0, "coroutine task throw unknown exception");
+    }
+    // 在协程栈上释放捕获的对象
+    coro->task = nullptr;
+    coro->done = true;
+    coro->active = false;
+    // 结束的协程栈内容不再需要保存
+    if (coro->shared)
+        coro->shared->owner = nullptr;
+    coro->owner_->Jump(coro, coro->caller);
+    // 结束的协程不会再被切入
+    std::abort();
+}
+
+}  // namespace ua
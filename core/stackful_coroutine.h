@@ -0,0 +1,110 @@
+/// @file stackful_coroutine.h
+/// @brief 内置的有栈协程实现（ICoroutine）
+/// @note 上下文切换见 coro_context.h，只保存被调用者保存寄存器，不做系统调用
+///       协程对象和栈结束后放回池里复用：Spawn 不分配内存（CoroTask 为内联闭包，直接 move 进池化对象）
+///       Spawn 立即在新协程里执行任务，直到第一次 Yield 或结束才返回；Yield 切回最近一次 Resume 它的协程
+///       两种栈模式:
+///       kPrivate 每个协程独占一个栈，协程对象按峰值并发数保留，栈未触及的页不占物理内存
+///       kShared  协程按创建顺序轮流分到 shared_stack_num 个共享运行栈上；切入时若栈被别的协程占用，
+///                先把占用者已用的部分拷到它自己的保存缓冲区（按实际用量分配），再换入目标协程保存的内容。
+///                拷贝在一个独立的小栈上完成，同一共享栈上的协程之间也可以互相 Resume。
+///                挂起期间协程栈上对象的地址不可用：不能把栈上对象的指针交给别的协程或主循环在挂起期间访问
+///       非线程安全，每个线程一个实例（配合 CoroMgr 的线程级设置）
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "coro_stack_pool.h"
+#include "interface/coroutine_interface.h"
+
+namespace ua
+{
+
+enum class CoroStackMode : uint8_t
+{
+    kPrivate = 0,
+    kShared = 1,
+};
+
+class StackfulCoroutine : public ICoroutine
+{
+public:
+    struct Option
+    {
+        CoroStackMode mode = CoroStackMode::kPrivate;
+        size_t stack_size = 128 * 1024;  // 独立栈: 每个协程的栈大小；共享栈: 每个共享栈的大小（向上取到栈池的级别）
+        uint32_t shared_stack_num = 4;   // 共享栈个数
+    };
+
+    StackfulCoroutine() : StackfulCoroutine(Option{}) {}
+    explicit StackfulCoroutine(const Option& option);
+    ~StackfulCoroutine() override;
+    StackfulCoroutine(const StackfulCoroutine&) = delete;
+    StackfulCoroutine& operator=(const StackfulCoroutine&) = delete;
+
+    /// 0 表示不限制
+    void SetMaxCoroNum(size_t max_num) override { max_coro_num_ = max_num; }
+    [[nodiscard]] size_t GetMaxCoroNum() const override { return max_coro_num_; }
+    /// 已启动未结束的协程数（含挂起的）
+    [[nodiscard]] size_t GetRunningCoro() const override { return running_num_; }
+    /// 创建过的协程对象总数（含池中空闲的）
+    [[nodiscard]] size_t GetTotalCoro() const override { return coros_.size(); }
+
+    bool Spawn(CoroFunc f, void* args) override;
+    bool Spawn(CoroTask task) override;
+
+    [[nodiscard]] Coro* ThisCoro() const override;
+    [[nodiscard]] bool StackShared() const override { return option_.mode == CoroStackMode::kShared; }
+
+    [[nodiscard]] const CoroStackPool& StackPool() const noexcept { return stack_pool_; }
+    /// 共享栈: 被换出的协程当前保存的栈字节总数
+    [[nodiscard]] size_t SavedStackBytes() const noexcept { return saved_bytes_; }
+    /// 共享栈: 保存缓冲区的总容量
+    [[nodiscard]] size_t SavedStackCapacity() const noexcept { return saved_capacity_; }
+    /// 共享栈: 换出拷贝次数
+    [[nodiscard]] uint64_t StackCopyNum() const noexcept { return copy_num_; }
+
+private:
+    class StackfulCoro;
+    friend class StackfulCoro;
+
+    struct SharedStack
+    {
+        CoroStackPool::Stack stack;
+        StackfulCoro* owner = nullptr;  // 栈上当前是谁的内容
+    };
+
+    bool InitShared();
+    StackfulCoro* Acquire();
+    bool Start(StackfulCoro* coro);
+    void SwitchIn(StackfulCoro* coro);
+    void SwitchOut(StackfulCoro* coro);
+    /// 从 from 切到 to（nullptr 表示主协程），to 的栈内容不在共享栈上时经由中转上下文换入
+    void Jump(StackfulCoro* from, StackfulCoro* to);
+    bool ReserveSave(StackfulCoro* coro, size_t size);
+    void SaveStack(StackfulCoro* coro);
+    void RestoreStack(StackfulCoro* coro);
+    static void Entry(void* arg);
+    static void RelayEntry(void* arg);
+
+    Option option_;
+    CoroStackPool stack_pool_;
+    std::vector<std::unique_ptr<StackfulCoro>> coros_;
+    std::vector<StackfulCoro*> free_coros_;
+    StackfulCoro* current_ = nullptr;
+    void* main_sp_ = nullptr;
+    size_t max_coro_num_ = 0;
+    size_t running_num_ = 0;
+
+    std::vector<SharedStack> shared_stacks_;
+    uint32_t next_shared_ = 0;
+    CoroStackPool::Stack relay_stack_;
+    void* relay_sp_ = nullptr;
+    StackfulCoro* relay_target_ = nullptr;
+    size_t saved_bytes_ = 0;
+    size_t saved_capacity_ = 0;
+    uint64_t copy_num_ = 0;
+};
+
+}  // namespace ua
@@ -0,0 +1,245 @@
+/// @file stat_exporter.cpp
+/// @brief 统计共享内存导出实现
+#include "stat_exporter.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include "common/utils.h"
+
+namespace ua
+{
+
+static uint32_t CostBucketIndex(uint32_t lower)
+{
+    auto iter = std::lower_bound(kLowerCostTime.begin(), kLowerCostTime.end(), lower);
+    auto index = static_cast<uint32_t>(iter - kLowerCostTime.begin());
+    return std::min(index, kStatCostBucketNum - 1);
+}
+
+bool StatExporter::Init(const std::string& shm_file, std::string* err_msg)
+{
+    if (kLowerCostTime.size() != kStatCostBucketNum)
+    {
+        if (err_msg)
+            *err_msg += "kLowerCostTime size not equal kStatCostBucketNum";
+        return false;
+    }
+
+    bool is_exist = false;
+    char* mem = utils::GetMmapMem(shm_file, static_cast<uint32_t>(ShmSize()), is_exist, err_msg);
+    if (!mem)
+        return false;
+
+    auto* header = reinterpret_cast<StatShmHeader*>(mem);
+    if (!is_exist || header->magic != StatShmHeader::kMagic || header->version != StatShmHeader::kVersion ||
+        header->snapshot_size != sizeof(StatSnapshot))
+    {
+        // 新建或布局不一致：重新初始化，seq 置为偶数表示空快照可读
+        header->seq.store(0, std::memory_order_relaxed);
+        header->magic = StatShmHeader::kMagic;
+        header->version = StatShmHeader::kVersion;
+        header->snapshot_size = sizeof(StatSnapshot);
+        header->reserved = 0;
+        new (mem + sizeof(StatShmHeader)) StatSnapshot{};
+    }
+
+    header_ = header;
+    shm_snapshot_ = reinterpret_cast<StatSnapshot*>(mem + sizeof(StatShmHeader));
+    staging_ = std::make_unique<StatSnapshot>();
+    period_id_ = shm_snapshot_->period_id;
+    return true;
+}
+
+void StatExporter::Collect(uint64_t now_ms)
+{
+    auto& stat = ServerStatistics::GetInst();
+    StatSnapshot& snap = *staging_;
+
+    snap.publish_ms = now_ms;
+    snap.period_id = ++period_id_;
+    snap.statistics = stat.statistics();
+    snap.not_clear_statistics = stat.not_clear_statistics();
+    std::copy(kLowerCostTime.begin(), kLowerCostTime.end(), snap.cost_bucket_lower);
+    snap.recv_cmd_num = 0;
+    snap.send_cmd_num = 0;
+    snap.error_num = 0;
+    snap.truncated = 0;
+    snap.transport_num = 0;
+    snap.sched_class_num = 0;
+
+    for (const auto& [cmd, info] : stat.RecvCmd2Info())
+    {
+        for (const auto& [ret_code, num] : info.error_code_2_num)
+        {
+            if (snap.error_num >= kStatMaxErrorNum)
+            {
+                ++snap.truncated;
+                continue;
+            }
+            snap.errors[snap.error_num++] = {cmd, ret_code, num};
+        }
+
+        if (snap.recv_cmd_num >= kStatMaxRecvCmdNum)
+        {
+            ++snap.truncated;
+            continue;
+        }
+        StatRecvCmdItem& item = snap.recv_cmds[snap.recv_cmd_num++];
+        item = {};
+        item.cmd = cmd;
+        item.total_recv_num = info.total_recv_num;
+        item.expire_drop = info.expire_drop;
+        item.schedule_drop = info.schedule_drop;
+        item.max_req_size = info.max_req_size;
+        item.max_rsp_size = info.max_rsp_size;
+        for (const auto& [lower, num] : info.cost_map)
+            item.cost[CostBucketIndex(lower)] += num;
+        for (const auto& [lower, num] : info.queue_cost_map)
+            item.queue_cost[CostBucketIndex(lower)] += num;
+    }
+
+    for (const auto& [cmd, info] : stat.SendCmd2Info())
+    {
+        if (snap.send_cmd_num >= kStatMaxSendCmdNum)
+        {
+            ++snap.truncated;
+            continue;
+        }
+        snap.send_cmds[snap.send_cmd_num++] = {cmd, info.total_send_num, info.max_send_size};
+    }
+
+    for (const auto& [transport_type, info] : stat.Transport2Info())
+    {
+        if (snap.transport_num >= kStatMaxTransportNum)
+        {
+            ++snap.truncated;
+            continue;
+        }
+        StatTransportItem& item = snap.transports[snap.transport_num++];
+        item = {};
+        item.transport_type = transport_type;
+        item.recv_num = info.recv_num;
+        item.busy_num = info.busy_num;
+        for (const auto& [lower, num] : info.queue_cost_map)
+            item.queue_cost[CostBucketIndex(lower)] += num;
+    }
+
+    for (const auto& [sched_class, info] : stat.SchedClass2Info())
+    {
+        if (snap.sched_class_num >= kStatMaxSchedClassNum)
+        {
+            ++snap.truncated;
+            continue;
+        }
+        StatSchedClassItem& item = snap.sched_classes[snap.sched_class_num++];
+        item = {};
+        item.sched_class = sched_class;
+        item.dispatch_num = info.dispatch_num;
+        item.drop_num = info.drop_num;
+        item.expire_drop = info.expire_drop;
+        item.max_queue_len = info.max_queue_len;
+        for (const auto& [lower, num] : info.wait_cost_map)
+            item.wait_cost[CostBucketIndex(lower)] += num;
+        for (const auto& [lower, num] : info.service_cost_map)
+            item.service_cost[CostBucketIndex(lower)] += num;
+    }
+}
+
+void StatExporter::Publish(uint64_t now_ms)
+{
+    if (!header_)
+        return;
+
+    Collect(now_ms);
+
+    // seqlock 写端：奇数 -> 拷贝 -> 偶数
+    uint64_t seq = header_->seq.load(std::memory_order_relaxed);
+    header_->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void*>(shm_snapshot_), staging_.get(), sizeof(StatSnapshot));
+    header_->seq.store(seq + 2, std::memory_order_release);
+}
+
+StatReader::~StatReader()
+{
+    if (header_)
+        munmap(const_cast<StatShmHeader*>(header_), map_size_);
+}
+
+bool StatReader::Open(const std::string& shm_file, std::string* err_msg)
+{
+    int fd = open(shm_file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        if (err_msg)
+        {
+            *err_msg += "open file failed, error: ";
+            *err_msg += strerror(errno);
+        }
+        return false;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < StatExporter::ShmSize())
+    {
+        if (err_msg)
+            *err_msg += "file size not match, maybe exporter not init";
+        close(fd);
+        return false;
+    }
+
+    void* mem = mmap(nullptr, StatExporter::ShmSize(), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        if (err_msg)
+        {
+            *err_msg += "mmap failed, error: ";
+            *err_msg += strerror(errno);
+        }
+        return false;
+    }
+
+    const auto* header = static_cast<const StatShmHeader*>(mem);
+    if (header->magic != StatShmHeader::kMagic || header->version != StatShmHeader::kVersion ||
+        header->snapshot_size != sizeof(StatSnapshot))
+    {
+        if (err_msg)
+            *err_msg += "header magic/version/size not match";
+        munmap(mem, StatExporter::ShmSize());
+        return false;
+    }
+
+    header_ = header;
+    shm_snapshot_ = reinterpret_cast<const StatSnapshot*>(static_cast<const char*>(mem) + sizeof(StatShmHeader));
+    map_size_ = StatExporter::ShmSize();
+    return true;
+}
+
+bool StatReader::Read(StatSnapshot& out, uint32_t max_retry) const
+{
+    if (!header_)
+        return false;
+
+    for (uint32_t i = 0; i <= max_retry; ++i)
+    {
+        uint64_t seq1 = header_->seq.load(std::memory_order_acquire);
+        if (seq1 & 1)
+            continue;
+
+        std::memcpy(static_cast<void*>(&out), shm_snapshot_, sizeof(StatSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        uint64_t seq2 = header_->seq.load(std::memory_order_relaxed);
+        if (seq1 == seq2)
+            return true;
+    }
+    return false;
+}
+
+}  // namespace ua
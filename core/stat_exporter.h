@@ -0,0 +1,158 @@
+/// @file stat_exporter.h
+/// @brief 运行时统计共享内存导出（seqlock 版本化快照）
+/// @note 服务端每个统计周期调用一次 Publish，代价为一次快照整理 + 一次 memcpy
+///       监控进程通过 StatReader 只读映射同一块共享内存，可任意频率轮询，不打扰服务进程
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "server_statistics.h"
+
+namespace ua
+{
+
+/// 耗时分桶个数，需与 kLowerCostTime 保持一致
+inline constexpr uint32_t kStatCostBucketNum = 8;
+/// 快照中最多记录的收包 cmd 数
+inline constexpr uint32_t kStatMaxRecvCmdNum = 512;
+/// 快照中最多记录的发包 cmd 数
+inline constexpr uint32_t kStatMaxSendCmdNum = 512;
+/// 快照中最多记录的 (cmd, 错误码) 组合数
+inline constexpr uint32_t kStatMaxErrorNum = 1024;
+/// 快照中最多记录的 transport 数
+inline constexpr uint32_t kStatMaxTransportNum = 64;
+/// 快照中最多记录的调度类别数
+inline constexpr uint32_t kStatMaxSchedClassNum = 64;
+
+/// 单个收包 cmd 的统计（map 展开为定长分桶数组）
+struct StatRecvCmdItem
+{
+    uint32_t cmd = 0;
+    uint32_t total_recv_num = 0;
+    uint32_t expire_drop = 0;
+    uint32_t schedule_drop = 0;
+    uint32_t max_req_size = 0;
+    uint32_t max_rsp_size = 0;
+    uint32_t cost[kStatCostBucketNum] = {};        // 下标对应 kLowerCostTime
+    uint32_t queue_cost[kStatCostBucketNum] = {};  // 下标对应 kLowerCostTime
+};
+
+struct StatSendCmdItem
+{
+    uint32_t cmd = 0;
+    uint32_t total_send_num = 0;
+    uint32_t max_send_size = 0;
+};
+
+struct StatErrorItem
+{
+    uint32_t cmd = 0;
+    int32_t ret_code = 0;
+    uint32_t num = 0;
+};
+
+/// 单个 transport 的收包统计（见 ServerStatistics::Transport2Info）
+struct StatTransportItem
+{
+    uint32_t transport_type = 0;
+    uint32_t recv_num = 0;
+    uint32_t busy_num = 0;
+    uint32_t queue_cost[kStatCostBucketNum] = {};  // 下标对应 kLowerCostTime
+};
+
+/// 单个调度类别的统计（见 ServerStatistics::SchedClass2Info）
+struct StatSchedClassItem
+{
+    uint32_t sched_class = 0;
+    uint32_t dispatch_num = 0;
+    uint32_t drop_num = 0;
+    uint32_t expire_drop = 0;
+    uint32_t max_queue_len = 0;
+    uint32_t wait_cost[kStatCostBucketNum] = {};     // 下标对应 kLowerCostTime
+    uint32_t service_cost[kStatCostBucketNum] = {};  // 下标对应 kLowerCostTime
+};
+
+/// 一次发布的完整快照，纯 POD，可直接 memcpy
+struct StatSnapshot
+{
+    uint64_t publish_ms = 0;   // 发布时间
+    uint64_t period_id = 0;    // 发布序号，每次 Publish 递增
+    ServerStatisticsSt statistics{};
+    NotClearServerStatisticsSt not_clear_statistics{};
+    uint32_t cost_bucket_lower[kStatCostBucketNum] = {};
+    uint32_t recv_cmd_num = 0;
+    uint32_t send_cmd_num = 0;
+    uint32_t error_num = 0;
+    uint32_t truncated = 0;    // 超出定长表容量被丢弃的条目数
+    uint32_t transport_num = 0;
+    uint32_t sched_class_num = 0;
+    StatRecvCmdItem recv_cmds[kStatMaxRecvCmdNum];
+    StatSendCmdItem send_cmds[kStatMaxSendCmdNum];
+    StatErrorItem errors[kStatMaxErrorNum];
+    StatTransportItem transports[kStatMaxTransportNum];
+    StatSchedClassItem sched_classes[kStatMaxSchedClassNum];
+};
+
+/// 共享内存头部
+struct StatShmHeader
+{
+    static constexpr uint32_t kMagic = 0x55415354;  // "UAST"
+    static constexpr uint32_t kVersion = 6;  // 2: ServerStatisticsSt 增加 log_suppressed_num 3: 增加 shed_drop_num 4: 增加 recv_*_num 5: 增加 coro_saved_stack_bytes_max 6: 增加 transport / 调度类别表
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t snapshot_size = 0;
+    uint32_t reserved = 0;
+    /// seqlock 序号：奇数表示正在写
+    std::atomic<uint64_t> seq{0};
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock 需要跨进程无锁原子量");
+
+/// 写端：挂在服务进程里
+class StatExporter
+{
+public:
+    /// 映射共享内存文件，已存在且布局一致时复用
+    bool Init(const std::string& shm_file, std::string* err_msg = nullptr);
+    [[nodiscard]] bool IsInit() const noexcept { return header_ != nullptr; }
+
+    /// 把当前线程的 ServerStatistics 发布到共享内存，一般在 ClearStatistics 之前调用
+    /// 多分片时先用 ShardRuntime::CollectStatistics 把各分片的统计汇总到当前线程
+    void Publish(uint64_t now_ms);
+
+    [[nodiscard]] static constexpr size_t ShmSize() noexcept { return sizeof(StatShmHeader) + sizeof(StatSnapshot); }
+
+private:
+    void Collect(uint64_t now_ms);
+
+    StatShmHeader* header_ = nullptr;
+    StatSnapshot* shm_snapshot_ = nullptr;
+    /// 暂存区：先在进程内整理好，再一次性拷贝到共享内存，缩短写锁窗口
+    std::unique_ptr<StatSnapshot> staging_;
+    uint64_t period_id_ = 0;
+};
+
+/// 读端：监控进程使用，只读映射
+class StatReader
+{
+public:
+    StatReader() = default;
+    StatReader(const StatReader&) = delete;
+    StatReader& operator=(const StatReader&) = delete;
+    ~StatReader();
+
+    bool Open(const std::string& shm_file, std::string* err_msg = nullptr);
+    /// 读取一份一致的快照，写端持续占用时重试 max_retry 次后失败
+    bool Read(StatSnapshot& out, uint32_t max_retry = 1000) const;
+
+private:
+    const StatShmHeader* header_ = nullptr;
+    const StatSnapshot* shm_snapshot_ = nullptr;
+    size_t map_size_ = 0;
+};
+
+}  // namespace ua
@@ -0,0 +1,109 @@
+/// @file task.cpp
+/// @brief 协程帧分配池实现
+#include "task.h"
+#include <array>
+#include <new>
+
+namespace ua
+{
+
+namespace
+{
+
+/// 帧前的头部，记录大小级别；16 字节保证帧按 max_align_t 对齐
+struct alignas(16) FrameHead
+{
+    uint32_t size_class;
+};
+static_assert(sizeof(FrameHead) == 16);
+
+constexpr uint32_t kLargeClass = UINT32_MAX;
+
+struct FreeNode
+{
+    FreeNode* next;
+};
+
+struct FramePoolState
+{
+    std::array<FreeNode*, TaskFramePool::kClassNum> free_lists{};
+    std::array<size_t, TaskFramePool::kClassNum> free_nums{};
+    size_t free_num = 0;
+    uint64_t sys_alloc_num = 0;
+
+    ~FramePoolState()
+    {
+        for (FreeNode* node : free_lists)
+        {
+            while (node)
+            {
+                FreeNode* next = node->next;
+                ::operator delete(node);
+                node = next;
+            }
+        }
+    }
+};
+
+thread_local FramePoolState t_pool;
+
+}  // namespace
+
+void* TaskFramePool::Alloc(size_t size)
+{
+    size_t total = size + sizeof(FrameHead);
+    uint32_t size_class = static_cast<uint32_t>((total + kClassSize - 1) / kClassSize - 1);
+    if (size_class >= kClassNum)
+    {
+        ++t_pool.sys_alloc_num;
+        auto* head = static_cast<FrameHead*>(::operator new(total));
+        head->size_class = kLargeClass;
+        return head + 1;
+    }
+
+    FrameHead* head = nullptr;
+    if (FreeNode* node = t_pool.free_lists[size_class])
+    {
+        t_pool.free_lists[size_class] = node->next;
+        --t_pool.free_nums[size_class];
+        --t_pool.free_num;
+        head = reinterpret_cast<FrameHead*>(node);
+    }
+    else
+    {
+        ++t_pool.sys_alloc_num;
+        head = static_cast<FrameHead*>(::operator new((size_class + 1) * kClassSize));
+    }
+    head->size_class = size_class;
+    return head + 1;
+}
+
+void TaskFramePool::Free(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+    auto* head = static_cast<FrameHead*>(ptr) - 1;
+    uint32_t size_class = head->size_class;
+    if (size_class == kLargeClass || t_pool.free_nums[size_class] >= kMaxFreePerClass)
+    {
+        ::operator delete(head);
+        return;
+    }
+    auto* node = reinterpret_cast<FreeNode*>(head);
+    node->next = t_pool.free_lists[size_class];
+    t_pool.free_lists[size_class] = node;
+    ++t_pool.free_nums[size_class];
+    ++t_pool.free_num;
+}
+
+size_t TaskFramePool::FreeNum() noexcept
+{
+    return t_pool.free_num;
+}
+
+uint64_t TaskFramePool::SysAllocNum() noexcept
+{
+    return t_pool.sys_alloc_num;
+}
+
+}  // namespace ua
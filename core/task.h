@@ -0,0 +1,228 @@
+/// @file task.h
+/// @brief C++20 无栈协程任务 Task<T>
+/// @note 惰性启动：创建后不执行，被 co_await 或 StartTask 时才开始；结束时对称转移回等待者，嵌套调用不增加栈深度
+///       协程帧从 TaskFramePool 分配（线程级、按 64 字节分级的空闲链表），热路径上不走 malloc
+///       挂起等待 RPC 见 ContextController::PendingAwait 和 PBService::RpcAsync
+///       异常在 co_await 处重新抛出；顶层任务的异常交给 StartTask 的 on_done
+///       非线程安全：任务在哪个线程启动，就在哪个线程恢复和结束
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace ua
+{
+
+/// 协程帧分配池（线程级）
+class TaskFramePool
+{
+public:
+    static constexpr size_t kClassSize = 64;
+    static constexpr size_t kClassNum = 32;          // 64B .. 2KB，更大的帧直接 operator new
+    static constexpr size_t kMaxFreePerClass = 4096;
+
+    static void* Alloc(size_t size);
+    static void Free(void* ptr) noexcept;
+
+    /// 当前线程池中空闲的帧数
+    [[nodiscard]] static size_t FreeNum() noexcept;
+    /// 当前线程向系统申请帧内存的次数（不含复用）
+    [[nodiscard]] static uint64_t SysAllocNum() noexcept;
+};
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+
+struct TaskPromiseBase
+{
+    static void* operator new(size_t size) { return TaskFramePool::Alloc(size); }
+    static void operator delete(void* ptr) noexcept { TaskFramePool::Free(ptr); }
+
+    struct FinalAwaiter
+    {
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase
+{
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+    T TakeResult()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+    void TakeResult() const
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+}  // namespace detail
+
+template <typename T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() noexcept = default;
+    explicit Task(Handle handle) noexcept : handle_(handle) {}
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { Reset(); }
+
+    [[nodiscard]] bool Valid() const noexcept { return static_cast<bool>(handle_); }
+    [[nodiscard]] bool Done() const noexcept { return handle_ && handle_.done(); }
+
+    /// co_await 启动任务并等待结果
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            [[nodiscard]] bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().TakeResult(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    void Reset() noexcept
+    {
+        if (handle_)
+            handle_.destroy();
+        handle_ = nullptr;
+    }
+
+    Handle handle_;
+};
+
+namespace detail
+{
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+/// 顶层任务的载体：立即执行，结束后自行销毁
+struct DetachedTask
+{
+    struct promise_type
+    {
+        static void* operator new(size_t size) { return TaskFramePool::Alloc(size); }
+        static void operator delete(void* ptr) noexcept { TaskFramePool::Free(ptr); }
+
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+template <typename T, typename OnDone>
+DetachedTask RunDetached(Task<T> task, OnDone on_done)
+{
+    std::exception_ptr error;
+    if constexpr (std::is_void_v<T>)
+    {
+        try
+        {
+            co_await std::move(task);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        on_done(error);
+    }
+    else
+    {
+        std::optional<T> result;
+        try
+        {
+            result.emplace(co_await std::move(task));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        on_done(error, result ? std::move(*result) : T{});
+    }
+}
+
+}  // namespace detail
+
+/// 启动顶层任务：立即执行到第一次挂起后返回，结束时调用 on_done
+/// on_done 签名: Task<void> 为 void(std::exception_ptr)，否则为 void(std::exception_ptr, T)（异常时 T 为默认值）
+template <typename T, typename OnDone>
+void StartTask(Task<T> task, OnDone on_done)
+{
+    detail::RunDetached(std::move(task), std::move(on_done));
+}
+
+}  // namespace ua
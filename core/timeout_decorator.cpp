@@ -1,14 +1,19 @@
 /// @file timeout_decorator.cpp
 /// @brief 定时事件装饰器实现（C++20 重写版）
+#define UA_LOG_MODULE ua::kLogModuleCore  // 框架日志单独归类，可按模块调级别
 #include "timeout_decorator.h"
+#include <cassert>
 #include <memory>
 #include "common/clock.h"
 #include "common/id_generator.h"
 #include "context.h"
+#include "context_pool.h"
 #include "context_mgr.h"
 #include "coro_mgr.h"
+#include "flight_recorder.h"
 #include "interface/scheduler_interface.h"
 #include "logger.h"
+#include "span_tracer.h"
 
 namespace ua
 {
@@ -19,6 +24,7 @@ struct EventInfo
     uint64_t event_id = 0;
     uint64_t gid = 0;
     uint64_t timer_id = 0;
+    uint64_t slot_key = 0;  // 事件槽号 + 代数，本次触发持有该槽的一个引用
     uint32_t interval_time = 0;
 };
 
@@ -35,21 +41,29 @@ void TimeoutDecorator::SetReqScheduler(IScheduler* scheduler, uint32_t special_t
 
 uint64_t TimeoutDecorator::AddEvent(uint64_t gid, TimeoutTask callback, uint64_t expire_time, uint32_t interval_time)
 {
+    // 定时器的 task 持有一个引用，一次性定时器触发后、循环定时器取消后随 task 析构释放
+    EventRef timer_ref(this, AllocSlot(std::move(callback)));
     return timeout_mgr_.Add(
-        [this, gid, callback = std::move(callback), expire_time, interval_time](uint64_t timer_id,
-                                                                                 uint32_t interval) {
+        [this, gid, ref = std::move(timer_ref), expire_time, interval_time](uint64_t timer_id, uint32_t interval) {
             uint64_t seq_id = IDGenerator::GetInst().GenerateSeqID();
-            timeout_event_.emplace(seq_id, std::move(callback));
-            EventInfo info{seq_id, gid, timer_id, interval};
+            EventSlot& slot = *event_slots_[ref.Index()];
+            ++slot.ref_num;
+            EventInfo info{seq_id, gid, timer_id, MakeSlotKey(ref.Index(), slot.generation), interval};
 
             UA_LOG_TRACE(gid, "recv timeout event, seq_id %lu, timer_id %lu, expire %lu, interval %u", seq_id,
                          timer_id, expire_time, interval_time);
 
             auto* data_ptr = reinterpret_cast<const char*>(&info);
             if (scheduler_)
-                scheduler_->OnRequest(seq_id, gid, data_ptr, sizeof(info), special_transport_type_);
+            {
+                // 调度器拒收时不会再调 DealEvent，归还本次触发的引用
+                if (!scheduler_->OnRequest(seq_id, gid, data_ptr, sizeof(info), special_transport_type_))
+                    ReleaseSlot(ref.Index());
+            }
             else
+            {
                 DealEvent(data_ptr, sizeof(info));
+            }
         },
         expire_time, interval_time);
 }
@@ -78,12 +92,14 @@ bool TimeoutDecorator::DealEvent(const char* data, uint32_t len)
     uint64_t event_id = info->event_id;
     uint64_t gid = info->gid;
 
-    auto iter = timeout_event_.find(event_id);
-    if (iter == timeout_event_.end())
+    uint32_t index = ResolveSlot(info->slot_key);
+    if (index == kNil)
     {
         UA_LOG_WARN(gid, "find timeout event, event_id %lu", event_id);
         return false;
     }
+    // 接管本次触发的引用，出错返回或协程结束时随闭包析构释放
+    EventRef ref(this, index);
 
     // 循环定时器事件：如果已被取消，则不执行
     if (info->interval_time > 0)
@@ -92,30 +108,30 @@ bool TimeoutDecorator::DealEvent(const char* data, uint32_t len)
         {
             UA_LOG_INFO(gid, "interval timeout has cancel, event_id %lu, timer_id %lu, interval %u", event_id,
                         info->timer_id, info->interval_time);
-            timeout_event_.erase(iter);
             return false;
         }
     }
 
-    // 拷贝出 task 再删除
-    TimeoutTask task = std::move(iter->second);
-    timeout_event_.erase(iter);
-
     UA_LOG_TRACE(gid, "timeout event, event_id %lu", event_id);
+    FlightRecorder::RecordEvent(FlightEvent::kTimerTimeout, gid, event_id, 0, 0, info->interval_time);
 
-    auto context = std::make_unique<ServerContext>();
+    auto context = ContextPool<ServerContext>::MakeUnique();
     auto* context_ptr = context.get();
 
     context->SetCallback(
-        [this, context_ptr, gid](int32_t ret) { EventFinish(context_ptr, gid); },
-        [context_ptr]() { delete context_ptr; });
+        [this, context_ptr](int32_t ret) { EventFinish(context_ptr, context_ptr->gid); },
+        [context_ptr]() { ContextPool<ServerContext>::Delete(context_ptr); });
     context->start_time = Clock::GetInst().CurrentMilliSec();
     context->gid = gid;
+    context->sched_seq = event_id;
+    // 定时事件是 trace 的入口，其中发起的 RPC 沿用这里的采样决定
+    SpanTracer::StartRequest(*context, nullptr);
+    SpanTracer::Begin(SpanTracer::Ref(context.get()), "timer", event_id);
 
     if (use_coroutine_)
     {
-        if (!CoroMgr::GetInst().Spawn([this, task = std::move(task), gid, context_ptr]() {
-                Run(context_ptr, task, gid);
+        if (!CoroMgr::GetInst().Spawn([this, ref = std::move(ref), gid, context_ptr]() {
+                Run(context_ptr, event_slots_[ref.Index()]->task, gid);
             }))
         {
             UA_LOG_ERROR(gid, "spawn error, event_id %lu", event_id);
@@ -124,7 +140,7 @@ bool TimeoutDecorator::DealEvent(const char* data, uint32_t len)
     }
     else
     {
-        Run(context_ptr, task, gid);
+        Run(context_ptr, event_slots_[index]->task, gid);
     }
 
     // 没出错则内存由 context Run 释放
@@ -132,6 +148,71 @@ bool TimeoutDecorator::DealEvent(const char* data, uint32_t len)
     return true;
 }
 
+void TimeoutDecorator::DropEvent(const char* data, uint32_t len)
+{
+    if (!data || len != sizeof(EventInfo))
+    {
+        UA_LOG_ERROR(0, "drop timeout event param fail, len %u", len);
+        return;
+    }
+
+    const auto* info = reinterpret_cast<const EventInfo*>(data);
+    uint32_t index = ResolveSlot(info->slot_key);
+    if (index == kNil)
+    {
+        UA_LOG_WARN(info->gid, "drop timeout event not found, event_id %lu", info->event_id);
+        return;
+    }
+    UA_LOG_WARN_RATE(20, 50, info->gid, "scheduler drop timeout event, event_id %lu, timer_id %lu", info->event_id,
+                     info->timer_id);
+    ReleaseSlot(index);
+}
+
+uint32_t TimeoutDecorator::AllocSlot(TimeoutTask task)
+{
+    uint32_t index = free_slot_;
+    if (index != kNil)
+    {
+        free_slot_ = event_slots_[index]->next_free;
+    }
+    else
+    {
+        index = static_cast<uint32_t>(event_slots_.size());
+        event_slots_.push_back(std::make_unique<EventSlot>());
+    }
+    EventSlot& slot = *event_slots_[index];
+    slot.task = std::move(task);
+    slot.ref_num = 1;
+    slot.next_free = kNil;
+    ++used_slot_num_;
+    return index;
+}
+
+void TimeoutDecorator::ReleaseSlot(uint32_t index) noexcept
+{
+    EventSlot& slot = *event_slots_[index];
+    assert(slot.ref_num > 0);
+    if (--slot.ref_num > 0)
+        return;
+    // 代数加一，之后用旧 key 查不到；task 的析构可能再添加事件，先析构再放回空闲链表
+    ++slot.generation;
+    slot.task = nullptr;
+    slot.next_free = free_slot_;
+    free_slot_ = index;
+    --used_slot_num_;
+}
+
+uint32_t TimeoutDecorator::ResolveSlot(uint64_t slot_key) const noexcept
+{
+    auto index = static_cast<uint32_t>(slot_key);
+    if (index >= event_slots_.size())
+        return kNil;
+    const EventSlot& slot = *event_slots_[index];
+    if (slot.ref_num == 0 || slot.generation != static_cast<uint32_t>(slot_key >> 32))
+        return kNil;
+    return index;
+}
+
 void TimeoutDecorator::Run(ServerContext* context, const TimeoutTask& task, uint64_t gid)
 {
     ContextMgr::SetCurrServerContext(context);
@@ -143,12 +224,13 @@ void TimeoutDecorator::Run(ServerContext* context, const TimeoutTask& task, uint
 void TimeoutDecorator::EventFinish(ServerContext* context, uint64_t gid)
 {
     if (scheduler_)
-        scheduler_->OnResponse(gid);
+        scheduler_->OnResponse(gid, context->sched_seq);
 
     if (watch_func_)
         watch_func_(*context, gid);
 
     context->end_time = Clock::GetInst().CurrentMilliSec();
+    SpanTracer::End(SpanTracer::Ref(context), "timer");
     ContextMgr::SetCurrServerContext(nullptr);
 }
 
@@ -3,11 +3,19 @@
 /// @note 将超时事件包装成类似 Service 的上下文处理
 ///       支持协程和异步两种模式
 ///       支持调度器集成
+///       TimeoutTask 为 InplaceFunction，添加时放进池化的事件槽（循环定时器每次触发共用），触发时不再拷贝闭包
+///       事件槽按引用计数回收：定时器本身和每次排队 / 执行中的触发各持一个引用，
+///       引用随定时器的 task、协程闭包的析构自动释放；槽号 + 代数随事件信息传递，稳态下不申请内存
+///       调度器拒收或丢弃（DropEvent）的触发同样归还引用，循环定时器取消后槽总能回收
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
-#include <unordered_map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common/inplace_function.h"
 #include "common/timeout_queue.h"
 
 namespace ua
@@ -20,7 +28,7 @@ class TimeoutDecorator
 {
 public:
     using FinishWatchFunc = std::function<void(const ServerContext&, uint64_t gid)>;
-    using TimeoutTask = std::function<int32_t()>;
+    using TimeoutTask = InplaceFunction<int32_t(), 48>;
 
     void Init(bool use_coroutine);
 
@@ -34,13 +42,66 @@ public:
 
     /// 定时器循环处理
     uint32_t ProcTimeOut(uint64_t now);
+    /// 最近一个定时事件的到期时间，没有返回 0
+    [[nodiscard]] uint64_t NextExpireTime() const noexcept { return timeout_mgr_.NextExpireTime(); }
 
     /// 处理超时事件（从调度器或直接调用）
     bool DealEvent(const char* data, uint32_t len);
+    /// 调度器丢弃了已接收的超时事件（见 IScheduler::DropFunc），归还本次触发持有的引用
+    void DropEvent(const char* data, uint32_t len);
 
     void SetFinishWatch(FinishWatchFunc watch_func) { watch_func_ = std::move(watch_func); }
 
+    /// 仍被引用的事件数（未触发、循环中或触发后尚未执行完）
+    [[nodiscard]] size_t EventNum() const noexcept { return used_slot_num_; }
+    /// 已分配的事件槽数（只增不减，空闲槽复用）
+    [[nodiscard]] size_t EventSlotNum() const noexcept { return event_slots_.size(); }
+
 private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+
+    /// 事件槽：对象地址固定（协程挂起期间 task 仍在执行）
+    struct EventSlot
+    {
+        TimeoutTask task;
+        uint32_t generation = 1;
+        uint32_t ref_num = 0;
+        uint32_t next_free = kNil;
+    };
+
+    /// 事件槽的一个引用，析构时释放；只移动
+    class EventRef
+    {
+    public:
+        /// 接管 index 上已计入的一个引用
+        EventRef(TimeoutDecorator* owner, uint32_t index) noexcept : owner_(owner), index_(index) {}
+        EventRef(EventRef&& other) noexcept : owner_(std::exchange(other.owner_, nullptr)), index_(other.index_) {}
+        EventRef& operator=(EventRef&&) = delete;
+        ~EventRef()
+        {
+            if (owner_)
+                owner_->ReleaseSlot(index_);
+        }
+
+        [[nodiscard]] uint32_t Index() const noexcept { return index_; }
+
+    private:
+        TimeoutDecorator* owner_;
+        uint32_t index_;
+    };
+
+    [[nodiscard]] static constexpr uint64_t MakeSlotKey(uint32_t index, uint32_t generation) noexcept
+    {
+        return (static_cast<uint64_t>(generation) << 32) | index;
+    }
+
+    /// 分配事件槽并放入 task，引用计数为 1
+    uint32_t AllocSlot(TimeoutTask task);
+    /// 引用计数减一，到 0 时析构 task 并回收槽
+    void ReleaseSlot(uint32_t index) noexcept;
+    /// 槽 key 对应的槽号，代数不符或已回收返回 kNil
+    [[nodiscard]] uint32_t ResolveSlot(uint64_t slot_key) const noexcept;
+
     void Run(ServerContext* context, const TimeoutTask& task, uint64_t gid);
     void EventFinish(ServerContext* context, uint64_t gid);
 
@@ -48,7 +109,10 @@ private:
     bool use_coroutine_ = true;
     uint32_t special_transport_type_ = 0;
     IScheduler* scheduler_ = nullptr;
-    std::unordered_map<uint64_t, TimeoutTask> timeout_event_;
+    // 先于 timeout_mgr_ 声明：定时器析构时释放的引用要落到仍然有效的槽上
+    std::vector<std::unique_ptr<EventSlot>> event_slots_;
+    uint32_t free_slot_ = kNil;
+    size_t used_slot_num_ = 0;
     TimeoutQueue timeout_mgr_;
     FinishWatchFunc watch_func_ = nullptr;
 };
@@ -0,0 +1,49 @@
+/// @file trace_context.h
+/// @brief 跨服务传递的追踪上下文
+/// @note 放在 codec 扩展头（type = kExtHeadType）中随 RPC 请求下发，下游据此加入上游的 trace：
+///       头部采样，入口服务做采样决定，下游服从上游的 sampled 位，不再自行采样
+///       线上格式（小端）: [u8 version][u8 flags][u64 trace_id][u64 span_id]，span_id 为上游发起 RPC 时所在的 span
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace ua
+{
+
+struct TraceContext
+{
+    static constexpr uint32_t kExtHeadType = 0x5452;  // "TR"
+    static constexpr uint8_t kVersion = 1;
+    static constexpr uint8_t kFlagSampled = 0x01;
+    static constexpr uint32_t kWireSize = 18;
+
+    uint64_t trace_id = 0;
+    uint64_t span_id = 0;
+    uint8_t flags = 0;
+
+    [[nodiscard]] bool Sampled() const noexcept { return trace_id != 0 && (flags & kFlagSampled); }
+
+    void Encode(char (&buf)[kWireSize]) const noexcept
+    {
+        buf[0] = static_cast<char>(kVersion);
+        buf[1] = static_cast<char>(flags);
+        std::memcpy(buf + 2, &trace_id, sizeof(trace_id));
+        std::memcpy(buf + 10, &span_id, sizeof(span_id));
+    }
+
+    /// 版本不同或长度不足返回 false；长度更长时忽略尾部，便于以后扩展字段
+    bool Decode(const char* data, uint32_t len) noexcept
+    {
+        if (!data || len < kWireSize || static_cast<uint8_t>(data[0]) != kVersion)
+            return false;
+        flags = static_cast<uint8_t>(data[1]);
+        std::memcpy(&trace_id, data + 2, sizeof(trace_id));
+        std::memcpy(&span_id, data + 10, sizeof(span_id));
+        return true;
+    }
+};
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "TraceContext 线上格式按小端直接拷贝");
+
+}  // namespace ua
@@ -0,0 +1,116 @@
+/// @file transport_poller.cpp
+/// @brief 多 transport 收包实现
+#include "transport_poller.h"
+#include <algorithm>
+#include "interface/channel_interface.h"
+#include "logger.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+bool TransportPoller::Add(uint32_t transport_type, IChannel* channel, uint32_t weight)
+{
+    if (!channel)
+        return false;
+    for (const auto& entry : entries_)
+    {
+        if (entry.transport_type == transport_type)
+        {
+            UA_LOG_ERROR(0, "transport %u already polled", transport_type);
+            return false;
+        }
+    }
+    Entry entry;
+    entry.transport_type = transport_type;
+    entry.channel = channel;
+    entry.weight = std::max(weight, 1u);
+    entries_.push_back(entry);
+    return true;
+}
+
+bool TransportPoller::SetWeight(uint32_t transport_type, uint32_t weight)
+{
+    for (auto& entry : entries_)
+    {
+        if (entry.transport_type == transport_type)
+        {
+            entry.weight = std::max(weight, 1u);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<IChannel*> TransportPoller::Channels() const
+{
+    std::vector<IChannel*> channels;
+    channels.reserve(entries_.size());
+    for (const auto& entry : entries_)
+        channels.push_back(entry.channel);
+    return channels;
+}
+
+size_t TransportPoller::LoopOne(Entry& entry, uint32_t quota, uint32_t& remain)
+{
+    quota = std::min(quota, remain);
+    size_t count = entry.channel->Loop(quota);
+    entry.busy = count >= quota;
+    entry.frame_recv += static_cast<uint32_t>(count);
+    remain -= static_cast<uint32_t>(std::min<size_t>(count, remain));
+    return count;
+}
+
+size_t TransportPoller::Poll(uint32_t budget)
+{
+    size_t num = entries_.size();
+    if (num == 0 || budget == 0)
+        return 0;
+
+    uint64_t total_weight = 0;
+    for (auto& entry : entries_)
+    {
+        total_weight += entry.weight;
+        entry.frame_recv = 0;
+        entry.busy = false;
+    }
+
+    // 第一轮按权重分配
+    size_t total = 0;
+    uint32_t remain = budget;
+    for (size_t i = 0; i < num && remain > 0; ++i)
+    {
+        Entry& entry = entries_[(start_ + i) % num];
+        auto quota = static_cast<uint32_t>(std::max<uint64_t>(1, budget * entry.weight / total_weight));
+        total += LoopOne(entry, quota, remain);
+    }
+
+    // 空闲 transport 没用完的预算按权重分给忙碌的
+    for (uint32_t round = 0; round < kMaxExtraRound && remain > 0; ++round)
+    {
+        uint64_t busy_weight = 0;
+        for (const auto& entry : entries_)
+            busy_weight += entry.busy ? entry.weight : 0;
+        if (busy_weight == 0)
+            break;
+
+        uint32_t round_budget = remain;
+        for (size_t i = 0; i < num && remain > 0; ++i)
+        {
+            Entry& entry = entries_[(start_ + i) % num];
+            if (!entry.busy)
+                continue;
+            auto quota = static_cast<uint32_t>(std::max<uint64_t>(1, round_budget * entry.weight / busy_weight));
+            total += LoopOne(entry, quota, remain);
+        }
+    }
+
+    start_ = (start_ + 1) % num;
+
+    auto& statistics = ServerStatistics::GetInst();
+    for (const auto& entry : entries_)
+        statistics.AddTransportRecv(entry.transport_type, entry.frame_recv, entry.busy);
+    return total;
+}
+
+}  // namespace ua
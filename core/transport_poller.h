@@ -0,0 +1,51 @@
+/// @file transport_poller.h
+/// @brief 收包阶段驱动所有 transport 的 channel，按权重分配每帧收包预算
+/// @note 每帧预算（流控结果）分两步分配:
+///       1. 按权重给每个 transport 一份配额（至少 1），依次 Loop
+///       2. 用满配额的视为忙碌，空闲 transport 剩下的预算按权重再分给忙碌的，最多 kMaxExtraRound 轮
+///       每帧轮换起始 transport，预算不够分时不会总是同一个 transport 吃亏；
+///       一个繁忙的 transport 最多拿走空闲者让出的预算，不会饿死其他 transport
+///       每帧按 transport 记录收包数和忙碌次数（ServerStatistics::Transport2Info）
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ua
+{
+
+class IChannel;
+
+class TransportPoller
+{
+public:
+    static constexpr uint32_t kMaxExtraRound = 4;
+
+    /// 同一个 transport_type 只能添加一次，weight 为 0 时按 1 处理
+    bool Add(uint32_t transport_type, IChannel* channel, uint32_t weight = 1);
+    bool SetWeight(uint32_t transport_type, uint32_t weight);
+
+    /// 按预算驱动所有 channel，返回处理的包数
+    size_t Poll(uint32_t budget);
+
+    [[nodiscard]] bool Empty() const noexcept { return entries_.empty(); }
+    [[nodiscard]] std::vector<IChannel*> Channels() const;
+
+private:
+    struct Entry
+    {
+        uint32_t transport_type = 0;
+        IChannel* channel = nullptr;
+        uint32_t weight = 1;
+        uint32_t frame_recv = 0;  // 本帧收包数
+        bool busy = false;        // 最近一次 Loop 是否用满配额
+    };
+
+    size_t LoopOne(Entry& entry, uint32_t quota, uint32_t& remain);
+
+    std::vector<Entry> entries_;
+    size_t start_ = 0;
+};
+
+}  // namespace ua
@@ -0,0 +1,261 @@
+/// @file wfq_scheduler.cpp
+/// @brief 按 cmd 类别加权公平排队的请求调度器实现
+#include "wfq_scheduler.h"
+#include <algorithm>
+#include "common/clock.h"
+#include "logger.h"
+#include "server_statistics.h"
+
+namespace ua
+{
+
+WfqScheduler::~WfqScheduler()
+{
+    for (auto& queue : classes_)
+    {
+        while (queue.head)
+        {
+            PkgArena::Pkg* pkg = PopHead(queue);
+            DropOnce(pkg->gid, pkg->data(), pkg->len, pkg->custom_data);
+            arena_.Free(pkg);
+        }
+    }
+}
+
+bool WfqScheduler::Init(const Option& option, std::string* err_msg)
+{
+    if (option.classes.empty() || option.default_class >= option.classes.size())
+    {
+        if (err_msg)
+            *err_msg += "wfq scheduler classes empty or default_class out of range";
+        return false;
+    }
+    for (const auto& [cmd, sched_class] : option.cmd_class)
+    {
+        if (sched_class >= option.classes.size())
+        {
+            if (err_msg)
+                *err_msg += "wfq scheduler cmd " + std::to_string(cmd) + " class out of range";
+            return false;
+        }
+    }
+
+    classes_.clear();
+    classes_.resize(option.classes.size());
+    for (size_t i = 0; i < classes_.size(); ++i)
+    {
+        classes_[i].option = option.classes[i];
+        classes_[i].option.weight = std::max(classes_[i].option.weight, 1u);
+    }
+    cmd_class_ = option.cmd_class;
+    default_class_ = option.default_class;
+    drop_expired_ = option.drop_expired;
+    return true;
+}
+
+uint32_t WfqScheduler::ClassOf(uint32_t cmd) const
+{
+    auto iter = cmd_class_.find(cmd);
+    return iter == cmd_class_.end() ? default_class_ : iter->second;
+}
+
+bool WfqScheduler::OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data)
+{
+    return OnRequest(seq, gid, data, len, custom_data, ReqMeta{});
+}
+
+bool WfqScheduler::OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data,
+                             const ReqMeta& meta)
+{
+    uint32_t sched_class = ClassOf(meta.cmd);
+    ClassQueue& queue = classes_[sched_class];
+    uint64_t now_ms = Clock::GetInst().CurrentMilliSec();
+
+    if (drop_expired_ && meta.deadline_ms > 0 && meta.deadline_ms < now_ms)
+    {
+        ServerStatistics::GetInst().AddCmdExpireDrop(meta.cmd);
+        ServerStatistics::GetInst().AddSchedClassDrop(sched_class, true);
+        DropOnce(gid, data, len, custom_data);
+        return true;
+    }
+
+    if (queue.num >= queue.option.max_queue_len)
+    {
+        if (queue.option.drop_policy == DropPolicy::kRejectNew || !queue.head)
+        {
+            ServerStatistics::GetInst().AddSchedClassDrop(sched_class, false);
+            UA_LOG_WARN_RATE(20, 50, gid, "wfq class %u full, cmd(0x%08X), seq(%lu)", sched_class, meta.cmd, seq);
+            return false;
+        }
+        PkgArena::Pkg* oldest = PopHead(queue);
+        UA_LOG_WARN_RATE(20, 50, oldest->gid, "wfq class %u full, drop oldest cmd(0x%08X), seq(%lu)", sched_class,
+                         oldest->cmd, oldest->seq);
+        DropPkg(sched_class, oldest, false);
+    }
+
+    PkgArena::Pkg* pkg = arena_.Alloc(data, len);
+    pkg->gid = gid;
+    pkg->seq = seq;
+    pkg->custom_data = custom_data;
+    pkg->enqueue_ms = now_ms;
+    pkg->deadline_ms = meta.deadline_ms;
+    pkg->cmd = meta.cmd;
+    // 虚拟完成时间：权重越大增量越小
+    pkg->tag = std::max(virtual_time_, queue.last_finish) + kVirtualScale / queue.option.weight;
+    queue.last_finish = pkg->tag;
+
+    if (queue.tail)
+        queue.tail->next = pkg;
+    else
+        queue.head = pkg;
+    queue.tail = pkg;
+    ++queue.num;
+    ++total_num_;
+    ++gid_cache_num_[gid];
+    return true;
+}
+
+PkgArena::Pkg* WfqScheduler::PopHead(ClassQueue& queue)
+{
+    PkgArena::Pkg* pkg = queue.head;
+    queue.head = pkg->next;
+    if (!queue.head)
+        queue.tail = nullptr;
+    --queue.num;
+    --total_num_;
+    auto iter = gid_cache_num_.find(pkg->gid);
+    if (iter != gid_cache_num_.end() && --iter->second == 0)
+        gid_cache_num_.erase(iter);
+    return pkg;
+}
+
+void WfqScheduler::DropPkg(uint32_t sched_class, PkgArena::Pkg* pkg, bool expired)
+{
+    if (expired)
+        ServerStatistics::GetInst().AddCmdExpireDrop(pkg->cmd);
+    ServerStatistics::GetInst().AddSchedClassDrop(sched_class, expired);
+    DropOnce(pkg->gid, pkg->data(), pkg->len, pkg->custom_data);
+    arena_.Free(pkg);
+}
+
+uint32_t WfqScheduler::LoopOnce(uint32_t proc_num)
+{
+    uint64_t now_ms = Clock::GetInst().CurrentMilliSec();
+    uint32_t count = 0;
+    while (proc_num == 0 || count < proc_num)
+    {
+        // 在未达并发上限的类别里选队首虚拟完成时间最小的
+        ClassQueue* best = nullptr;
+        uint32_t best_class = 0;
+        for (uint32_t i = 0; i < classes_.size(); ++i)
+        {
+            ClassQueue& queue = classes_[i];
+            if (drop_expired_)
+            {
+                while (queue.head && queue.head->deadline_ms > 0 && queue.head->deadline_ms < now_ms)
+                    DropPkg(i, PopHead(queue), true);
+            }
+            if (!queue.head)
+                continue;
+            if (queue.option.max_concurrency > 0 && queue.in_flight >= queue.option.max_concurrency)
+                continue;
+            if (!best || queue.head->tag < best->head->tag)
+            {
+                best = &queue;
+                best_class = i;
+            }
+        }
+        if (!best)
+            break;
+
+        PkgArena::Pkg* pkg = PopHead(*best);
+        virtual_time_ = pkg->tag;
+        ++best->in_flight;
+        uint64_t wait_ms = now_ms > pkg->enqueue_ms ? now_ms - pkg->enqueue_ms : 0;
+        ServerStatistics::GetInst().SetSchedClassWait(best_class, static_cast<uint32_t>(wait_ms), best->num + 1);
+
+        uint64_t gid = pkg->gid;
+        uint64_t seq = pkg->seq;
+        gid_in_flight_[gid].push_back(InFlight{seq, now_ms, best_class});
+
+        // 非协程模式下 ProcOnce 里可能同步 OnResponse
+        bool ok = ProcOnce(seq, gid, pkg->data(), pkg->len, pkg->custom_data);
+        arena_.Free(pkg);
+        ++count;
+
+        // 处理失败不会有 OnResponse，按 seq 找回在途记录直接结束
+        if (!ok)
+            FinishSeq(gid, seq, now_ms);
+    }
+    return count;
+}
+
+bool WfqScheduler::FinishSeq(uint64_t gid, uint64_t seq, uint64_t now_ms)
+{
+    auto iter = gid_in_flight_.find(gid);
+    if (iter == gid_in_flight_.end())
+        return false;
+    auto& list = iter->second;
+    auto found = std::find_if(list.begin(), list.end(), [seq](const InFlight& f) { return f.seq == seq; });
+    if (found == list.end())
+        return false;
+    InFlight in_flight = *found;
+    list.erase(found);
+    if (list.empty())
+        gid_in_flight_.erase(iter);
+    Finish(in_flight, now_ms);
+    return true;
+}
+
+void WfqScheduler::OnResponse(uint64_t gid)
+{
+    auto iter = gid_in_flight_.find(gid);
+    if (iter == gid_in_flight_.end())
+    {
+        UA_LOG_WARN_EVERY_MS(1000, gid, "wfq response without in flight request");
+        return;
+    }
+    InFlight in_flight = iter->second.front();
+    iter->second.erase(iter->second.begin());
+    if (iter->second.empty())
+        gid_in_flight_.erase(iter);
+    Finish(in_flight, Clock::GetInst().CurrentMilliSec());
+}
+
+void WfqScheduler::OnResponse(uint64_t gid, uint64_t seq)
+{
+    if (seq == 0)
+    {
+        OnResponse(gid);
+        return;
+    }
+    if (!FinishSeq(gid, seq, Clock::GetInst().CurrentMilliSec()))
+        UA_LOG_WARN_EVERY_MS(1000, gid, "wfq response without in flight request, seq(%lu)", seq);
+}
+
+void WfqScheduler::Finish(const InFlight& in_flight, uint64_t now_ms)
+{
+    ClassQueue& queue = classes_[in_flight.sched_class];
+    if (queue.in_flight > 0)
+        --queue.in_flight;
+    uint64_t cost = now_ms > in_flight.dispatch_ms ? now_ms - in_flight.dispatch_ms : 0;
+    ServerStatistics::GetInst().SetSchedClassService(in_flight.sched_class, static_cast<uint32_t>(cost));
+}
+
+size_t WfqScheduler::CacheNum(uint64_t gid) const
+{
+    auto iter = gid_cache_num_.find(gid);
+    return iter == gid_cache_num_.end() ? 0 : iter->second;
+}
+
+size_t WfqScheduler::QueueNum(uint32_t sched_class) const
+{
+    return sched_class < classes_.size() ? classes_[sched_class].num : 0;
+}
+
+uint32_t WfqScheduler::InFlightNum(uint32_t sched_class) const
+{
+    return sched_class < classes_.size() ? classes_[sched_class].in_flight : 0;
+}
+
+}  // namespace ua
@@ -0,0 +1,108 @@
+/// @file wfq_scheduler.h
+/// @brief 按 cmd 类别加权公平排队的请求调度器
+/// @note cmd 映射到类别（未配置的 cmd 和定时事件归 default_class），每个类别一个 FIFO 队列
+///       派发按自计时公平排队（SCFQ）：请求入队时打虚拟完成时间 max(V, 类别上一个请求的完成时间) + 1/weight，
+///       每次在未达并发上限的类别里选队首完成时间最小的派发，V 推进到该完成时间；
+///       重 cmd 突增只会拉长自己类别的队列，轻 cmd 的排队时间只取决于自己的权重
+///       max_concurrency 限制类别同时在处理的请求数（OnResponse 归还），0 为不限
+///       队列满时按 drop_policy 拒绝新请求（OnRequest 返回 false）或丢弃最老的请求
+///       drop_expired 时已过期的请求在入队和派发前丢弃（计入 expire_drop）
+///       被丢弃（含挤掉的最老请求）和析构时仍在排队的请求都经 DropFunc 通知所有者
+///       每个类别的排队耗时 / 处理耗时 / 丢弃数记录在 ServerStatistics::SchedClass2Info
+///       OnResponse(gid, seq) 按 seq 归还对应的在途请求（seq 为 OnRequest 传入的，派发时见 DispatchingSeq），
+///       只带 gid 的 OnResponse 在同一 gid 有多个在途请求时按派发顺序归还
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "interface/scheduler_interface.h"
+#include "pkg_arena.h"
+
+namespace ua
+{
+
+class WfqScheduler : public IScheduler
+{
+public:
+    enum class DropPolicy : uint8_t
+    {
+        kRejectNew = 0,   // 拒绝新请求
+        kDropOldest = 1,  // 丢弃队列里最老的请求，接收新请求
+    };
+
+    struct ClassOption
+    {
+        uint32_t weight = 1;
+        uint32_t max_concurrency = 0;   // 同时处理中的请求数上限，0 表示不限
+        uint32_t max_queue_len = 1024;  // 排队上限
+        DropPolicy drop_policy = DropPolicy::kRejectNew;
+    };
+
+    struct Option
+    {
+        std::vector<ClassOption> classes;                 // 下标即类别 id
+        std::unordered_map<uint32_t, uint32_t> cmd_class;  // cmd -> 类别 id
+        uint32_t default_class = 0;
+        bool drop_expired = true;
+    };
+
+    WfqScheduler() = default;
+    ~WfqScheduler() override;
+
+    bool Init(const Option& option, std::string* err_msg = nullptr);
+
+    bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) override;
+    bool OnRequest(uint64_t seq, uint64_t gid, const char* data, uint32_t len, uint64_t custom_data,
+                   const ReqMeta& meta) override;
+    void OnResponse(uint64_t gid) override;
+    void OnResponse(uint64_t gid, uint64_t seq) override;
+    [[nodiscard]] uint32_t LoopOnce(uint32_t proc_num) override;
+    [[nodiscard]] size_t CacheNum(uint64_t gid) const override;
+
+    [[nodiscard]] uint32_t ClassOf(uint32_t cmd) const;
+    [[nodiscard]] size_t QueueNum(uint32_t sched_class) const;
+    [[nodiscard]] uint32_t InFlightNum(uint32_t sched_class) const;
+    [[nodiscard]] size_t TotalNum() const noexcept { return total_num_; }
+
+private:
+    static constexpr uint64_t kVirtualScale = 1 << 20;
+
+    struct ClassQueue
+    {
+        ClassOption option;
+        PkgArena::Pkg* head = nullptr;
+        PkgArena::Pkg* tail = nullptr;
+        uint32_t num = 0;
+        uint32_t in_flight = 0;
+        uint64_t last_finish = 0;  // 最后入队请求的虚拟完成时间
+    };
+
+    struct InFlight
+    {
+        uint64_t seq = 0;
+        uint64_t dispatch_ms = 0;
+        uint32_t sched_class = 0;
+    };
+
+    PkgArena::Pkg* PopHead(ClassQueue& queue);
+    void DropPkg(uint32_t sched_class, PkgArena::Pkg* pkg, bool expired);
+    /// 按 seq 结束 gid 的在途请求，没有返回 false
+    bool FinishSeq(uint64_t gid, uint64_t seq, uint64_t now_ms);
+    /// 结束一个在途请求
+    void Finish(const InFlight& in_flight, uint64_t now_ms);
+
+    std::vector<ClassQueue> classes_;
+    std::unordered_map<uint32_t, uint32_t> cmd_class_;
+    uint32_t default_class_ = 0;
+    bool drop_expired_ = true;
+    uint64_t virtual_time_ = 0;
+    size_t total_num_ = 0;
+    std::unordered_map<uint64_t, uint32_t> gid_cache_num_;
+    std::unordered_map<uint64_t, std::vector<InFlight>> gid_in_flight_;
+    PkgArena arena_;
+};
+
+}  // namespace ua
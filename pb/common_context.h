@@ -5,9 +5,16 @@
 #include <cstdint>
 #include "core/context.h"
 
+namespace google::protobuf
+{
+class Message;
+}  // namespace google::protobuf
+
 namespace ua
 {
 
+class ReadCodec;
+
 /// PB 上下文头部（从 Codec 中解析出来的公共字段）
 /// 改进: 把字段集中在一个 head 结构中避免重复
 struct PBContextHead
@@ -35,10 +42,18 @@ struct PBContext : public ServerContext
 };
 
 /// PB 客户端上下文
+/// 回包处理所需的状态和业务回调都放在这里（异步模式从池里取），
+/// 交给 ContextController 的闭包只捕获 PBService 和本上下文的指针，放得进 std::function 的小对象缓冲
 struct PBClientContext : public ClientContext
 {
     uint32_t cmd = 0;
     uint32_t transport_index = 0;
+    uint64_t gid = 0;
+    uint64_t seq_id = 0;
+    const ReadCodec* recv_codec = nullptr;
+    google::protobuf::Message* rsp = nullptr;
+    AsyncTask::RpcCallback callback;         // 业务回调，回包拦截之后执行
+    AsyncTask::RecycleCallBack recycle_fun;  // 业务回收函数，在本上下文放回池里之前执行
     ~PBClientContext() override = default;
 };
 
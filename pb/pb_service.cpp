@@ -2,6 +2,7 @@
 /// @brief RPC 引擎核心实现（C++20 重写版）
 /// @note 改进: CheckPkgMem 逐字段比较
 ///       改进: Rpc 方法使用 RpcOptions 参数
+#define UA_LOG_MODULE ua::kLogModulePb  // 框架日志单独归类，可按模块调级别
 #include "pb_service.h"
 #include <cstring>
 #include <memory>
@@ -10,13 +11,18 @@
 #include "common/utils.h"
 #include "common_context.h"
 #include "core/context_controller.h"
+#include "core/context_pool.h"
 #include "core/coro_mgr.h"
+#include "core/flight_recorder.h"
 #include "core/interface/channel_interface.h"
 #include "core/interface/codec_interface.h"
 #include "core/interface/scheduler_interface.h"
 #include "core/logger.h"
+#include "core/recv_classifier.h"
 #include "core/rpc_error.h"
 #include "core/server_statistics.h"
+#include "core/span_tracer.h"
+#include "core/trace_context.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/service.h"
@@ -36,6 +42,16 @@ bool PBService::RegisterMethod(uint32_t cmd, const RpcMethod& method_info)
     return methods_.emplace(cmd, method_info).second;
 }
 
+bool PBService::RegisterTaskMethod(uint32_t cmd, RpcMethod::TaskHandler handler, bool is_private)
+{
+    if (!handler)
+        return false;
+    RpcMethod method_info;
+    method_info.is_private = is_private;
+    method_info.task_handler = std::move(handler);
+    return RegisterMethod(cmd, method_info);
+}
+
 // ===== 改进: 防毒包逐字段比较代替 memcmp =====
 void PBService::RegisterPkgMem(uint32_t id)
 {
@@ -145,20 +161,53 @@ void PBService::InterceptReply(int32_t ret_code, uint64_t seq_id, const ReadCode
 int32_t PBService::OnRecv(uint32_t transport_type, const char* data, size_t data_len, uint32_t recv_id,
                           uint64_t arrived_time)
 {
-    auto& recv_codec = transport_infos_[transport_type].recv_codec;
+    uint64_t recv_ns = SpanTracer::GetSampleEvery() ? SpanTracer::NowNs() : 0;
+    auto* recv_codec = transport_infos_[transport_type].recv_codec;
     if (!recv_codec->Decode(data, data_len))
     {
         UA_LOG_ERROR(0, "decode pkg failed, recv_id=%u", recv_id);
         return RPC_SYS_ERR;
     }
+    return OnDecoded(transport_type, *recv_codec, data, data_len, recv_id, arrived_time, recv_ns);
+}
+
+int32_t PBService::OnDecoded(uint32_t transport_type, RecvCodec& codec, const char* data, size_t data_len,
+                             uint32_t recv_id, uint64_t arrived_time, uint64_t recv_ns)
+{
+    // 预解码的包用的是流水线槽里的 codec，拦截器和回包拦截器看到的也应是它
+    const RecvCodec* recv_codec = &codec;
+    TransportInfo recv_info = transport_infos_[transport_type];
+    recv_info.recv_codec = &codec;
+    curr_recv_codec_ = &codec;
 
     uint64_t gid = recv_codec->GetGid();
     uint32_t cmd = recv_codec->GetCmd();
     bool is_rsp = recv_codec->GetFlag() & FLAG_RSP_PKG;
 
+    // 超出本帧预算的普通请求延后，下一帧重放时重新解码
+    if (recv_classifier_ &&
+        !recv_classifier_->Admit(recv_codec->GetFlag(), transport_type, data, data_len, recv_id, arrived_time))
+    {
+        curr_recv_codec_ = nullptr;
+        return RPC_SUCCESS;
+    }
+
     uint64_t now = utils::CurrentRealMilliSec();
+    uint64_t queue_cost = now >= arrived_time ? now - arrived_time : 0;
     if (now >= arrived_time)
-        ServerStatistics::GetInst().SetQueueCost(cmd, now - arrived_time);
+    {
+        ServerStatistics::GetInst().SetQueueCost(cmd, queue_cost);
+        ServerStatistics::GetInst().SetTransportQueueCost(transport_type, queue_cost);
+    }
+
+    // 按排队时延提前丢弃请求，回包总是处理
+    if (sojourn_watch_ && sojourn_watch_(queue_cost, !is_rsp))
+    {
+        UA_LOG_WARN_RATE(20, 50, gid, "shed pkg, cmd(0x%08X), other_seq_id(%lu), queue_cost(%lu)", cmd,
+                         recv_codec->GetSeqID(), queue_cost);
+        curr_recv_codec_ = nullptr;
+        return RPC_SUCCESS;
+    }
 
     UA_LOG_TRACE(gid,
                  "on recv, cmd(0x%08X), type(%d), other_seq_id(%lu), expired(%lu), len(%u), recv_id(%u), arrived_time(%lu)",
@@ -170,6 +219,7 @@ int32_t PBService::OnRecv(uint32_t transport_type, const char* data, size_t data
     {
         UA_LOG_ERROR(0, "skip pkg|cmd(0x%08X), src(%u), dest(%u), from(%u), body_len(%u), data_len(%lu)", cmd,
                      recv_codec->GetSrc(), recv_codec->GetDst(), recv_id, recv_codec->GetBodyLen(), data_len);
+        curr_recv_codec_ = nullptr;
         ClearPkgMem();
         return RPC_SUCCESS;
     }
@@ -178,13 +228,15 @@ int32_t PBService::OnRecv(uint32_t transport_type, const char* data, size_t data
         ServerStatistics::GetInst().SetReqSize(cmd, recv_codec->GetBodyLen());
 
     // 收包拦截器
-    if (!InterceptRecv(transport_infos_[transport_type], recv_id))
+    if (!InterceptRecv(recv_info, recv_id))
     {
         if (!is_rsp)
         {
             if (scheduler_)
             {
-                bool result = scheduler_->OnRequest(IDGenerator::GetInst().GenerateSeqID(), gid, data, data_len, transport_type);
+                IScheduler::ReqMeta meta{cmd, recv_codec->GetTimeout()};
+                bool result = scheduler_->OnRequest(IDGenerator::GetInst().GenerateSeqID(), gid, data,
+                                                    static_cast<uint32_t>(data_len), transport_type, meta);
                 if (!result)
                 {
                     UA_LOG_ERROR(gid, "scheduler fail, cmd(0x%08X), other_seq_id(%lu)", cmd, recv_codec->GetSeqID());
@@ -193,12 +245,12 @@ int32_t PBService::OnRecv(uint32_t transport_type, const char* data, size_t data
             }
             else
             {
-                DealRequest(transport_type, *recv_codec);
+                DealRequest(transport_type, codec, recv_ns);
             }
         }
         else
         {
-            DealResponse(*recv_codec);
+            DealResponse(codec);
         }
     }
     else
@@ -206,21 +258,25 @@ int32_t PBService::OnRecv(uint32_t transport_type, const char* data, size_t data
         UA_LOG_TRACE(gid, "pkg intercept|msg_type(%d) cmd(0x%08X) seq_id(%lu)", is_rsp, cmd, recv_codec->GetSeqID());
     }
 
+    curr_recv_codec_ = nullptr;
     ClearPkgMem();
     return RPC_SUCCESS;
 }
 
 // ===== 请求处理 =====
-bool PBService::DealRequest(uint32_t transport_type, const ReadCodec& codec)
+bool PBService::DealRequest(uint32_t transport_type, const ReadCodec& codec, uint64_t recv_ns)
 {
     uint64_t gid = codec.GetGid();
     uint32_t cmd = codec.GetCmd();
+    FlightRecorder::RecordEvent(FlightEvent::kRecvCmd, gid, codec.GetSeqID(), cmd, 0, codec.GetBodyLen());
 
     // 过期包丢弃
     if (codec.GetTimeout() > 0 && codec.GetTimeout() < Clock::GetInst().CurrentMilliSec())
     {
         ServerStatistics::GetInst().AddCmdExpireDrop(cmd);
-        UA_LOG_WARN(gid, "drop pkg, cmd(0x%08X), other_seq_id(%lu), expired(%lu)", cmd, codec.GetSeqID(), codec.GetTimeout());
+        // 过载时过期包会成批出现，限频避免日志放大负载；总数见 expire_drop 统计
+        UA_LOG_WARN_RATE(20, 50, gid, "drop pkg, cmd(0x%08X), other_seq_id(%lu), expired(%lu)", cmd, codec.GetSeqID(),
+                         codec.GetTimeout());
         return false;
     }
 
@@ -239,8 +295,8 @@ bool PBService::DealRequest(uint32_t transport_type, const ReadCodec& codec)
         return false;
     }
 
-    // 创建上下文
-    auto context = std::make_unique<PBContext>();
+    // 创建上下文，处理完由 recycle 放回池里
+    auto context = ContextPool<PBContext>::MakeUnique();
     context->transport_index = transport_type;
     context->head.gid = gid;
     context->head.seq_id = codec.GetSeqID();
@@ -251,6 +307,18 @@ bool PBService::DealRequest(uint32_t transport_type, const ReadCodec& codec)
     context->head.timeout = codec.GetTimeout();
     context->gid = gid;
     context->pkg_flag = codec.GetFlag();
+    if (scheduler_)
+        context->sched_seq = scheduler_->DispatchingSeq();
+
+    // 上游带追踪上下文时加入其 trace，否则作为入口请求本地采样
+    uint32_t trace_len = 0;
+    const char* trace_data = codec.GetExtHead(TraceContext::kExtHeadType, trace_len);
+    TraceContext upstream;
+    SpanTracer::StartRequest(*context, upstream.Decode(trace_data, trace_len) ? &upstream : nullptr);
+    SpanRef span = SpanTracer::Ref(context.get());
+    if (recv_ns)
+        SpanTracer::Span(span, "decode", recv_ns, cmd);
+    SpanTracer::Begin(span, "request", cmd);
 
     // 反序列化请求（这里需要协议上下文的 req/rsp 由外部设置，简化了 Arena 逻辑）
     // 注意：实际使用中此处应根据 rpc_method.request/response 创建消息实例
@@ -265,10 +333,15 @@ bool PBService::DealRequest(uint32_t transport_type, const ReadCodec& codec)
 
     context->SetCallback(
         [this, context_ptr](int32_t ret) { MethodFinish(context_ptr); },
-        [context_ptr]() { delete context_ptr; });
+        [context_ptr]() { ContextPool<PBContext>::Delete(context_ptr); });
     context->start_time = Clock::GetInst().CurrentMilliSec();
 
-    if (context_ctrl_->UseCoroutine())
+    if (rpc_method.task_handler)
+    {
+        // C++20 协程处理函数，挂起时只保存协程帧
+        DealTaskMethod(context_ptr, rpc_method.task_handler);
+    }
+    else if (context_ctrl_->UseCoroutine() && !rpc_method.is_non_blocking)
     {
         if (!CoroMgr::GetInst().Spawn([this, context_ptr, proto_service, method_desc]() {
                 ServerStatistics::GetInst().statistics().save_max_coro_num_max(
@@ -293,6 +366,9 @@ void PBService::DealMethod(PBContext* context, google::protobuf::Service* servic
                            const google::protobuf::MethodDescriptor* method_desc)
 {
     ContextMgr::SetCurrServerContext(context);
+    // Run 之后 context 可能已被回收，先取出 span
+    SpanRef span = SpanTracer::Ref(context);
+    SpanTracer::Begin(span, "handler", context->head.cmd);
 
     if (InterceptReq(*context))
     {
@@ -304,13 +380,47 @@ void PBService::DealMethod(PBContext* context, google::protobuf::Service* servic
         service->CallMethod(method_desc, context, nullptr, nullptr, nullptr);
     }
 
+    SpanTracer::End(span, "handler", context->head.cmd);
     if (context->IsFinish())
         context->Run();
 }
 
+void PBService::DealTaskMethod(PBContext* context, const RpcMethod::TaskHandler& handler)
+{
+    ContextMgr::SetCurrServerContext(context);
+    SpanRef span = SpanTracer::Ref(context);
+    SpanTracer::Begin(span, "handler", context->head.cmd);
+
+    auto finish = [context, span](int32_t ret_code) {
+        SpanTracer::End(span, "handler", context->head.cmd);
+        context->ret_code = ret_code;
+        context->to_be_continue = false;
+        context->Run();
+    };
+    if (InterceptReq(*context))
+    {
+        UA_LOG_TRACE(context->head.gid, "pb req intercept|cmd(0x%08X) seq_id(%lu)", context->head.cmd, context->head.seq_id);
+        context->ignore = true;
+        finish(context->ret_code);
+        return;
+    }
+
+    // 立即执行到第一次挂起；结束（可能在之后的回包处理中）时回包并回收上下文
+    StartTask(handler(*context), [context, finish](std::exception_ptr error, int32_t ret_code) {
+        if (error)
+        {
+            UA_LOG_ERROR(context->head.gid, "task handler throw exception, cmd(0x%08X)", context->head.cmd);
+            ret_code = RPC_SYS_ERR;
+        }
+        ContextMgr::SetCurrServerContext(context);
+        finish(ret_code);
+    });
+}
+
 void PBService::MethodFinish(PBContext* context)
 {
     assert(context->transport_index < MAX_TRANSPORT_NUM);
+    SpanTracer::Begin(SpanTracer::Ref(context), "reply", context->head.cmd);
 
     bool be_intercept = InterceptRsp(*context);
     if (be_intercept)
@@ -341,8 +451,10 @@ void PBService::MethodFinish(PBContext* context)
     ServerStatistics::GetInst().SetCoroRunTime(context->head.cmd, context->Duration(), context->ret_code);
 
     if (scheduler_)
-        scheduler_->OnResponse(context->head.gid);
+        scheduler_->OnResponse(context->head.gid, context->sched_seq);
 
+    SpanTracer::End(SpanTracer::Ref(context), "reply", context->head.cmd);
+    SpanTracer::End(SpanTracer::Ref(context), "request", static_cast<uint64_t>(context->ret_code));
     ContextMgr::SetCurrServerContext(nullptr);
 }
 
@@ -417,12 +529,11 @@ int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
     return Rpc(transport_type, gid, cmd, req, rsp, task, RpcOptions{dest, broadcast, timeout});
 }
 
-int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
-                       const google::protobuf::Message& req,
-                       google::protobuf::Message* rsp,
-                       const AsyncTask& task,
-                       const RpcOptions& opts)
+int32_t PBService::SendRpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
+                           const google::protobuf::Message& req, google::protobuf::Message* rsp,
+                           const RpcOptions& opts, uint64_t& seq_id)
 {
+    seq_id = 0;
     if (opts.broadcast && rsp)
     {
         UA_LOG_ERROR(gid, "broadcast have not response");
@@ -444,13 +555,12 @@ int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
     send_codec->SetCmd(cmd);
     send_codec->SetRetCode(RPC_SUCCESS);
 
-    uint64_t seq_id = 0;
     uint32_t pkg_flag = 0;
 
     if (!rsp)
         pkg_flag |= FLAG_DONT_RSP;
     else
-        seq_id = IDGenerator::GetInst().GenerateSeqID();
+        seq_id = context_ctrl_->AllocSeqID(opts.timeout);
 
     if (opts.broadcast)
         pkg_flag |= FLAG_IS_BROADCAST;
@@ -458,9 +568,19 @@ int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
     send_codec->SetFlag(pkg_flag);
     send_codec->SetSeqID(seq_id);
 
+    // 下发追踪上下文，下游服从本请求的采样决定
+    if (auto* server_ctx = ContextMgr::GetCurrServerContext())
+    {
+        char trace_buf[TraceContext::kWireSize];
+        SpanTracer::Propagate(*server_ctx).Encode(trace_buf);
+        send_codec->AddExtHead(TraceContext::kExtHeadType, trace_buf, sizeof(trace_buf));
+    }
+
     if (InterceptCall(*send_codec, req, rsp))
     {
         UA_LOG_TRACE(gid, "pb call intercept|cmd(0x%08X) seq_id(%lu)", cmd, seq_id);
+        context_ctrl_->ReleaseSeqID(seq_id);
+        seq_id = 0;
         return RPC_SUCCESS;
     }
 
@@ -468,59 +588,143 @@ int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
     if (ret != RPC_SUCCESS)
     {
         UA_LOG_ERROR(gid, "send req error(%d), cmd(0x%08X)", ret, cmd);
+        context_ctrl_->ReleaseSeqID(seq_id);
         return ret;
     }
 
+    SpanTracer::Instant(SpanTracer::Ref(ContextMgr::GetCurrServerContext()), "rpc_send", cmd);
     UA_LOG_TRACE(gid, "Rpc|gid(%lu) cmd(0x%08X) seq_id(%lu) req: (%s): %s",
                  gid, cmd, seq_id, req.GetTypeName().c_str(), req.ShortDebugString().c_str());
 
-    if (!rsp)
-        return RPC_SUCCESS;
+    return RPC_SUCCESS;
+}
+
+int32_t PBService::Rpc(uint32_t transport_type, uint64_t gid, uint32_t cmd,
+                       const google::protobuf::Message& req,
+                       google::protobuf::Message* rsp,
+                       const AsyncTask& task,
+                       const RpcOptions& opts)
+{
+    // 要挂起等回包却不在协程里（处理函数标记为非阻塞却调了同步 Rpc）：发包前拒绝，否则请求已发出而回包无人接收
+    if (context_ctrl_->UseCoroutine() && rsp && !task.callback && !CoroMgr::ThisCoro())
+    {
+        UA_LOG_ERROR(gid, "rpc pending outside coroutine, cmd(0x%08X), handler marked non-blocking?", cmd);
+        assert(false && "pending outside coroutine");
+        return RPC_SYS_ERR;
+    }
+
+    uint64_t seq_id = 0;
+    int32_t ret = SendRpc(transport_type, gid, cmd, req, rsp, opts, seq_id);
+    if (ret != RPC_SUCCESS || seq_id == 0)
+        return ret;
+    auto& info = transport_infos_[transport_type];
+    auto fill = [&](PBClientContext& client_ctx) {
+        client_ctx.cmd = cmd;
+        client_ctx.gid = gid;
+        client_ctx.seq_id = seq_id;
+        client_ctx.recv_codec = info.recv_codec;
+        client_ctx.rsp = rsp;
+    };
 
     // 异步模式或者有 callback
     if (!context_ctrl_->UseCoroutine() || task.callback)
     {
-        auto* client_ctx = new PBClientContext;
-        client_ctx->cmd = cmd;
+        auto* client_ctx = ContextPool<PBClientContext>::New();
+        fill(*client_ctx);
+        client_ctx->callback = task.callback;
+        client_ctx->recycle_fun = task.recycle_fun;
 
-        auto* recv_codec = info.recv_codec;
+        // 两个闭包都只捕获指针，std::function 不分配
         AsyncTask task_wrapper = {
-            [=, cb = task.callback, this](int32_t ret_code, ServerContext* ctx) {
-                if (ret_code != RPC_SUCCESS)
-                    UA_LOG_WARN(gid, "rpc fail: cmd(0x%08X) seq_id(%lu) ret(%d)", cmd, seq_id, ret_code);
-
-                InterceptReply(ret_code, seq_id, (ret_code != RPC_TIME_OUT) ? recv_codec : nullptr, *rsp);
-                if (cb) cb(ret_code, ctx);
-            },
-            [=, recycle = task.recycle_fun]() {
-                if (recycle) recycle();
-                delete client_ctx;
+            [this, client_ctx](int32_t ret_code, ServerContext* ctx) { RpcReply(*client_ctx, ret_code, ctx); },
+            [client_ctx]() {
+                if (client_ctx->recycle_fun)
+                    client_ctx->recycle_fun();
+                ContextPool<PBClientContext>::Delete(client_ctx);
             },
             task.blocking_fun};
 
-        ret = context_ctrl_->Pending(seq_id, opts.timeout, client_ctx, task_wrapper);
+        ret = context_ctrl_->Pending(seq_id, opts.timeout, client_ctx, std::move(task_wrapper));
         if (ret != RPC_SUCCESS)
-            delete client_ctx;
+            ContextPool<PBClientContext>::Delete(client_ctx);
         return ret;
     }
     else
     {
-        // 协程模式: 局部变量
+        auto pending = [&](PBClientContext& client_ctx) {
+            fill(client_ctx);
+            PBClientContext* ctx_ptr = &client_ctx;
+            AsyncTask task_wrapper(
+                [this, ctx_ptr](int32_t ret_code, ServerContext* ctx) { RpcReply(*ctx_ptr, ret_code, ctx); });
+            int32_t pending_ret = context_ctrl_->Pending(seq_id, opts.timeout, ctx_ptr, std::move(task_wrapper));
+            return pending_ret != RPC_SUCCESS ? pending_ret : client_ctx.ret_code;
+        };
+
+        // 协程模式: 共享栈挂起期间栈内容被换出，唤醒时访问的上下文放到堆上；独立栈用局部变量
+        if (context_ctrl_->StackShared())
+        {
+            auto client_ctx = ContextPool<PBClientContext>::MakeUnique();
+            return pending(*client_ctx);
+        }
         PBClientContext client_ctx;
-        client_ctx.cmd = cmd;
+        return pending(client_ctx);
+    }
+}
 
-        auto* recv_codec = info.recv_codec;
-        AsyncTask task_wrapper = {[=, this](int32_t ret_code, ServerContext* ctx) {
-            if (ret_code != RPC_SUCCESS)
-                UA_LOG_WARN(gid, "rpc fail: cmd(0x%08X) seq_id(%lu) ret(%d)", cmd, seq_id, ret_code);
+void PBService::RpcReply(PBClientContext& client_ctx, int32_t ret_code, ServerContext* ctx)
+{
+    if (ret_code != RPC_SUCCESS)
+        UA_LOG_WARN(client_ctx.gid, "rpc fail: cmd(0x%08X) seq_id(%lu) ret(%d)", client_ctx.cmd, client_ctx.seq_id,
+                    ret_code);
+
+    InterceptReply(ret_code, client_ctx.seq_id,
+                   (ret_code != RPC_TIME_OUT) ? ReplyCodec(client_ctx.recv_codec) : nullptr, *client_ctx.rsp);
+    if (client_ctx.callback)
+        client_ctx.callback(ret_code, ctx);
+}
 
-            InterceptReply(ret_code, seq_id, (ret_code != RPC_TIME_OUT) ? recv_codec : nullptr, *rsp);
-        }};
-        ret = context_ctrl_->Pending(seq_id, opts.timeout, &client_ctx, task_wrapper);
-        if (ret != RPC_SUCCESS)
-            return ret;
-        return client_ctx.ret_code;
-    }
+// ===== C++20 协程 RPC =====
+PBService::RpcAwaiter PBService::RpcAsync(uint32_t transport_type, uint64_t gid, uint32_t cmd,
+                                          const google::protobuf::Message& req, google::protobuf::Message* rsp,
+                                          const RpcOptions& opts)
+{
+    uint64_t seq_id = 0;
+    int32_t ret = SendRpc(transport_type, gid, cmd, req, rsp, opts, seq_id);
+    return RpcAwaiter(*this, transport_infos_[transport_type].recv_codec, gid, cmd, rsp, opts.timeout, seq_id, ret);
+}
+
+PBService::RpcAwaiter::RpcAwaiter(PBService& service, const ReadCodec* recv_codec, uint64_t gid, uint32_t cmd,
+                                  google::protobuf::Message* rsp, uint32_t timeout, uint64_t seq_id, int32_t ret)
+    : service_(service), recv_codec_(recv_codec), rsp_(rsp), gid_(gid), seq_id_(seq_id), timeout_(timeout), ret_(ret)
+{
+    client_ctx_.cmd = cmd;
+}
+
+bool PBService::RpcAwaiter::await_ready() const noexcept
+{
+    return ret_ != RPC_SUCCESS || seq_id_ == 0;
+}
+
+bool PBService::RpcAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    ret_ = service_.context_ctrl_->PendingAsync(seq_id_, timeout_, &client_ctx_, handle);
+    pending_ = ret_ == RPC_SUCCESS;
+    return pending_;
+}
+
+int32_t PBService::RpcAwaiter::await_resume()
+{
+    if (!pending_)
+        return ret_;
+
+    // 在协程内处理回包，与回调模式相同
+    ContextMgr::SetCurrServerContext(client_ctx_.server_ctx);
+    int32_t ret_code = client_ctx_.ret_code;
+    if (ret_code != RPC_SUCCESS)
+        UA_LOG_WARN(gid_, "rpc fail: cmd(0x%08X) seq_id(%lu) ret(%d)", client_ctx_.cmd, seq_id_, ret_code);
+    service_.InterceptReply(ret_code, seq_id_, (ret_code != RPC_TIME_OUT) ? service_.ReplyCodec(recv_codec_) : nullptr,
+                            *rsp_);
+    return ret_code;
 }
 
 // ===== Transport / Scheduler / DealReqPkg / DealResponse =====
@@ -545,9 +749,27 @@ bool PBService::AddTransport(uint32_t transport_type, const TransportInfo& info)
     info.channel->SetCallback([this, transport_type](const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time) {
         return OnRecv(transport_type, data, len, recv_id, arrived_time);
     });
+    info.channel->SetDecodedCallback(
+        [this, transport_type](RecvCodec& codec, const char* data, size_t len, uint32_t recv_id, uint64_t arrived_time) {
+            uint64_t recv_ns = SpanTracer::GetSampleEvery() ? SpanTracer::NowNs() : 0;
+            return OnDecoded(transport_type, codec, data, len, recv_id, arrived_time, recv_ns);
+        });
     return true;
 }
 
+// 分级收包默认掩码与 PB 包标志位一致
+static_assert(RecvClassifier::Option{}.rsp_flag_mask == FLAG_RSP_PKG);
+static_assert(RecvClassifier::Option{}.key_flag_mask == (FLAG_CLIENT_KEY_PKG | FLAG_SVR_KEY_PKG));
+
+void PBService::SetRecvClassifier(RecvClassifier* classifier)
+{
+    recv_classifier_ = classifier;
+    if (!classifier)
+        return;
+    classifier->SetReplayer([this](uint32_t transport_type, const char* data, size_t len, uint32_t recv_id,
+                                   uint64_t arrived_time) { OnRecv(transport_type, data, len, recv_id, arrived_time); });
+}
+
 const TransportInfo* PBService::FindTransport(uint32_t transport_type) const
 {
     if (transport_type >= MAX_TRANSPORT_NUM)
@@ -594,7 +816,11 @@ void PBService::DealResponse(const ReadCodec& codec)
     UA_LOG_TRACE(gid, "deal rsp, seq_id(%lu) cmd(0x%08X), ret(%d), body_len(%u)", seq_id, cmd,
                  client_ctx->ret_code, codec.GetBodyLen());
 
+    // 唤醒后的续跑（协程恢复或异步回调）单独成一个 span
+    SpanRef span = SpanTracer::Ref(client_ctx->server_ctx);
+    SpanTracer::Begin(span, "continue", cmd);
     client_ctx->Run();
+    SpanTracer::End(span, "continue", cmd);
 }
 
 }  // namespace ua
@@ -3,12 +3,15 @@
 /// @note 改进: 不再使用 Singleton 继承，方便测试
 ///       改进: Rpc 方法参数改为结构体 Options，避免 9 参数函数
 ///       改进: CheckPkgMem 使用逐字段比较代替 memcmp
+///       线程级单例，分片运行时下每个工作线程各自一份
 #pragma once
 
 #include <array>
 #include <functional>
 #include <unordered_map>
 #include <vector>
+#include "common/inplace_function.h"
+#include "common_context.h"
 #include "core/transport.h"
 #include "intercepter.h"
 #include "patterns/singleton.h"
@@ -28,23 +31,26 @@ struct PBContext;
 struct AsyncTask;
 class IScheduler;
 class ReadCodec;
+class RecvCodec;
 class WriteCodec;
 class ContextController;
+class RecvClassifier;
 
 // ========== 拦截器类型定义 ==========
-using PBRecvIntercepter = TRecvIntercepter<std::function<bool(const TransportInfo&, uint32_t recv_id)>>;
-using PBSendIntercepter = TSendIntercepter<std::function<bool(WriteCodec&)>>;
-using PBSender = std::function<void(const TransportInfo&, const google::protobuf::Message&)>;
-using PBReqIntercepter = TReqIntercepter<std::function<bool(PBContext&, const PBSender&)>>;
-using PBRspIntercepter = TRspIntercepter<std::function<bool(PBContext&)>>;
+// 拦截器为 InplaceFunction：注册时移入，闭包内联存放，超出容量编译报错
+using PBRecvIntercepter = TRecvIntercepter<InplaceFunction<bool(const TransportInfo&, uint32_t recv_id)>>;
+using PBSendIntercepter = TSendIntercepter<InplaceFunction<bool(WriteCodec&)>>;
+using PBSender = InplaceFunction<void(const TransportInfo&, const google::protobuf::Message&), 16>;
+using PBReqIntercepter = TReqIntercepter<InplaceFunction<bool(PBContext&, const PBSender&)>>;
+using PBRspIntercepter = TRspIntercepter<InplaceFunction<bool(PBContext&)>>;
 using PBCallIntercepter =
-    TCallIntercepter<std::function<bool(WriteCodec&, const google::protobuf::Message&, google::protobuf::Message*)>>;
+    TCallIntercepter<InplaceFunction<bool(WriteCodec&, const google::protobuf::Message&, google::protobuf::Message*)>>;
 using PBReplyIntercepter =
-    TReplyIntercepter<std::function<void(int32_t, uint64_t, const ReadCodec*, google::protobuf::Message&)>>;
+    TReplyIntercepter<InplaceFunction<void(int32_t, uint64_t, const ReadCodec*, google::protobuf::Message&)>>;
 
 class PBService : public IntercepterMgr<PBRecvIntercepter, PBSendIntercepter, PBReqIntercepter, PBRspIntercepter,
                                          PBCallIntercepter, PBReplyIntercepter>,
-                  public Singleton<PBService>
+                  public MSingleton<PBService, true>
 {
 public:
     static constexpr uint32_t MAX_TRANSPORT_NUM = 10;
@@ -53,7 +59,16 @@ public:
 
     void SetContextCtrl(ContextController* context_ctrl) { context_ctrl_ = context_ctrl; }
 
+    /// 收包时上报排队时延，返回 true 表示该请求应提前丢弃（droppable 为是否请求包）
+    using SojournWatch = std::function<bool(uint64_t sojourn_ms, bool droppable)>;
+    void SetSojournWatch(SojournWatch watch) { sojourn_watch_ = std::move(watch); }
+
+    /// 分级收包：回包/关键包立即处理，超出预算的普通请求由 classifier 延后重放
+    void SetRecvClassifier(RecvClassifier* classifier);
+
     bool RegisterMethod(uint32_t cmd, const RpcMethod& method_info);
+    /// 注册 C++20 协程处理函数（RpcMethod::task_handler）
+    bool RegisterTaskMethod(uint32_t cmd, RpcMethod::TaskHandler handler, bool is_private = false);
 
     /// 改进: Rpc 调用选项结构体，替代 9 参数函数
     struct RpcOptions
@@ -77,6 +92,43 @@ public:
                 const AsyncTask& task,
                 uint32_t dest, bool broadcast, uint32_t timeout);
 
+    /// co_await RpcAsync(...) 的等待体，结果为 RPC 返回码
+    /// 请求在 RpcAsync 调用时已发出，需立即 co_await；客户端上下文放在等待体里，随协程帧保存
+    class RpcAwaiter
+    {
+    public:
+        RpcAwaiter(PBService& service, const ReadCodec* recv_codec, uint64_t gid, uint32_t cmd,
+                   google::protobuf::Message* rsp, uint32_t timeout, uint64_t seq_id, int32_t ret);
+        RpcAwaiter(const RpcAwaiter&) = delete;
+        RpcAwaiter& operator=(const RpcAwaiter&) = delete;
+
+        /// 发送失败、不需要回包或被调用拦截器处理时不挂起
+        [[nodiscard]] bool await_ready() const noexcept;
+        bool await_suspend(std::coroutine_handle<> handle);
+        int32_t await_resume();
+
+    private:
+        PBService& service_;
+        PBClientContext client_ctx_;
+        const ReadCodec* recv_codec_;
+        google::protobuf::Message* rsp_;
+        uint64_t gid_;
+        uint64_t seq_id_;
+        uint32_t timeout_;
+        int32_t ret_;
+        bool pending_ = false;
+    };
+
+    /// 在 C++20 协程（Task）中发起 RPC：co_await 挂起直到回包或超时，不占用 ICoroutine 协程
+    [[nodiscard]] RpcAwaiter RpcAsync(uint32_t transport_type, uint64_t gid, uint32_t cmd,
+                                      const google::protobuf::Message& req, google::protobuf::Message* rsp,
+                                      const RpcOptions& opts);
+    [[nodiscard]] RpcAwaiter RpcAsync(uint32_t transport_type, uint64_t gid, uint32_t cmd,
+                                      const google::protobuf::Message& req, google::protobuf::Message* rsp)
+    {
+        return RpcAsync(transport_type, gid, cmd, req, rsp, RpcOptions{});
+    }
+
     bool AddTransport(uint32_t transport_type, const TransportInfo& info);
     [[nodiscard]] const TransportInfo* FindTransport(uint32_t transport_type) const;
     void SetReqScheduler(IScheduler* req_scheduler);
@@ -88,10 +140,23 @@ private:
     void ClearPkgMem();
 
     int32_t OnRecv(uint32_t transport_type, const char* data, size_t data_len, uint32_t recv_id, uint64_t arrived_time);
-    bool DealRequest(uint32_t transport_type, const ReadCodec& codec);
+    /// 解码之后的收包处理，codec 可能来自 transport 自身或 RecvPipeline 的槽
+    int32_t OnDecoded(uint32_t transport_type, RecvCodec& codec, const char* data, size_t data_len, uint32_t recv_id,
+                      uint64_t arrived_time, uint64_t recv_ns);
+    /// 回包拦截器使用的 codec：收包处理中为当前包的 codec，否则为 transport 的 codec
+    [[nodiscard]] const ReadCodec* ReplyCodec(const ReadCodec* transport_codec) const
+    {
+        return curr_recv_codec_ ? curr_recv_codec_ : transport_codec;
+    }
+    /// recv_ns: OnRecv 入口时刻（SpanTracer::NowNs），用于补记解码 span，0 表示不记
+    bool DealRequest(uint32_t transport_type, const ReadCodec& codec, uint64_t recv_ns = 0);
     void DealResponse(const ReadCodec& codec);
     void DealMethod(PBContext* context, google::protobuf::Service* service,
                     const google::protobuf::MethodDescriptor* method_desc);
+    void DealTaskMethod(PBContext* context, const RpcMethod::TaskHandler& handler);
+    /// 发出请求；返回 RPC_SUCCESS 且 seq_id 为 0 表示不需要等回包（无 rsp 或被调用拦截器处理）
+    int32_t SendRpc(uint32_t transport_type, uint64_t gid, uint32_t cmd, const google::protobuf::Message& req,
+                    google::protobuf::Message* rsp, const RpcOptions& opts, uint64_t& seq_id);
     void MethodFinish(PBContext* context);
     int32_t SendMessage(const TransportInfo& info, const google::protobuf::Message& msg);
 
@@ -101,14 +166,19 @@ private:
     bool InterceptRsp(PBContext& context);
     bool InterceptCall(WriteCodec& codec, const google::protobuf::Message& req, google::protobuf::Message* rsp);
     void InterceptReply(int32_t ret_code, uint64_t seq_id, const ReadCodec* codec, google::protobuf::Message& rsp);
+    /// Rpc 回包（或超时）：回包拦截后执行 client_ctx 中的业务回调
+    void RpcReply(PBClientContext& client_ctx, int32_t ret_code, ServerContext* ctx);
 
 private:
-    friend class Singleton<PBService>;
+    friend class MSingleton<PBService, true>;
     PBService() = default;
     ~PBService() = default;
 
     std::unordered_map<uint32_t, RpcMethod> methods_;
     ContextController* context_ctrl_ = nullptr;
+    const ReadCodec* curr_recv_codec_ = nullptr;
+    SojournWatch sojourn_watch_;
+    RecvClassifier* recv_classifier_ = nullptr;
     std::array<TransportInfo, MAX_TRANSPORT_NUM> transport_infos_{};
     IScheduler* scheduler_ = nullptr;
 
@@ -2,6 +2,10 @@
 /// @brief RPC 方法注册信息（C++20 重写版）
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include "core/task.h"
+
 namespace google::protobuf
 {
 class Service;
@@ -12,13 +16,22 @@ class MethodDescriptor;
 namespace ua
 {
 
+struct PBContext;
+
 struct RpcMethod
 {
+    /// C++20 协程处理函数，返回值作为回包 ret_code，挂起等待 RPC 用 PBService::RpcAsync
+    using TaskHandler = std::function<Task<int32_t>(PBContext&)>;
+
     google::protobuf::Service* service = nullptr;
     const google::protobuf::MethodDescriptor* method = nullptr;
     const google::protobuf::Message* request = nullptr;
     const google::protobuf::Message* response = nullptr;
     bool is_private = false;
+    /// 处理函数不会挂起（不发起需要等回包的同步 RPC）：协程模式下也直接在主栈上执行，省去 Spawn 和切换
+    /// 这类处理函数里调用需要挂起的 Rpc 会触发断言，release 下返回 RPC_SYS_ERR
+    bool is_non_blocking = false;
+    TaskHandler task_handler;  // 非空时代替 service->CallMethod，不占用 ICoroutine 协程
 };
 
 }  // namespace ua
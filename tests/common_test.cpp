@@ -1,9 +1,12 @@
 /// @file common_test.cpp
-/// @brief common 模块单元测试（Clock + IDGenerator + TimeoutQueue）
+/// @brief common 模块单元测试（Clock + IDGenerator + TimeoutQueue + InplaceFunction）
 #include <gtest/gtest.h>
+#include <functional>
+#include <memory>
 #include <vector>
 #include "common/clock.h"
 #include "common/id_generator.h"
+#include "common/inplace_function.h"
 #include "common/timeout_queue.h"
 
 namespace ua::test
@@ -140,6 +143,34 @@ TEST(TimeoutQueueTest, IntervalTimerRepeats)
     EXPECT_TRUE(queue.Exist(id));
 }
 
+TEST(TimeoutQueueTest, IntervalTimerCancelInsideTask)
+{
+    ua::TimeoutQueue queue;
+
+    // 只移动的闭包也能作为 task
+    int fire_count = 0;
+    uint64_t id = 0;
+    auto counter = std::make_unique<int>(0);
+    id = queue.Add(
+        [&, counter = std::move(counter)](uint64_t timer_id, uint32_t) {
+            ++*counter;
+            fire_count = *counter;
+            EXPECT_TRUE(queue.Exist(timer_id));
+            if (*counter == 2)
+                queue.Cancel(timer_id);
+        },
+        100, 100);
+
+    EXPECT_EQ(queue.TimeOut(100), 1u);
+    EXPECT_TRUE(queue.Exist(id));
+    EXPECT_EQ(queue.NextExpireTime(), 200u);
+    EXPECT_EQ(queue.TimeOut(200), 1u);
+    EXPECT_EQ(fire_count, 2);
+    EXPECT_FALSE(queue.Exist(id));
+    EXPECT_EQ(queue.TimeOut(300), 0u);
+    EXPECT_EQ(queue.NextExpireTime(), 0u);
+}
+
 TEST(TimeoutQueueTest, ClearRemovesAll)
 {
     ua::TimeoutQueue queue;
@@ -163,4 +194,46 @@ TEST(TimeoutQueueTest, MultipleTimersSameExpireTime)
     EXPECT_EQ(fire_count, 3);
 }
 
+// ==================== InplaceFunction 测试 ====================
+
+TEST(InplaceFunctionTest, MoveOnlyInlineClosure)
+{
+    using Func = ua::InplaceFunction<int(int), 32>;
+    Func empty;
+    EXPECT_FALSE(empty);
+    EXPECT_FALSE(Func(nullptr));
+    EXPECT_FALSE(Func(std::function<int(int)>()));
+
+    auto base = std::make_unique<int>(10);
+    Func add([base = std::move(base)](int value) { return *base + value; });
+    ASSERT_TRUE(add);
+    EXPECT_EQ(add(5), 15);
+
+    // 移动后原对象为空，闭包随之搬走
+    Func moved(std::move(add));
+    EXPECT_FALSE(add);
+    EXPECT_EQ(moved(1), 11);
+    add = std::move(moved);
+    EXPECT_EQ(add(2), 12);
+
+    // mutable lambda 通过 const operator() 调用
+    const Func counter([count = 0](int step) mutable { return count += step; });
+    EXPECT_EQ(counter(1), 1);
+    EXPECT_EQ(counter(2), 3);
+
+    // 小容量的可以放进大容量的
+    ua::InplaceFunction<int(int), 64> wide(std::move(add));
+    EXPECT_EQ(wide(3), 13);
+    wide = nullptr;
+    EXPECT_FALSE(wide);
+
+    // 析构时释放闭包持有的资源
+    auto shared = std::make_shared<int>(1);
+    {
+        ua::InplaceFunction<void()> holder([shared]() {});
+        EXPECT_EQ(shared.use_count(), 2);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
 }  // namespace ua::test
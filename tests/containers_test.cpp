@@ -2,7 +2,7 @@
 /// @brief containers 模块单元测试
 /// @note 覆盖: traits_utils + FixedVector + FixedRingBuf + UnfixedRingBuf
 ///             + MemSet + MemMap + MemList + MemLRUSet + MemLRUMap
-///             + FixedMemPool + HashMemPool + FreeLockQueue
+///             + FixedMemPool + HashMemPool + FreeLockQueue + SpscRingBuf
 #include <gtest/gtest.h>
 #include <algorithm>
 #include <cstring>
@@ -23,6 +23,7 @@
 #include "containers/fixed_mem_pool.h"
 #include "containers/hash_mem_pool.h"
 #include "containers/queue_lock_free.h"
+#include "containers/spsc_ring_buf.h"
 
 namespace ua::test
 {
@@ -751,4 +752,104 @@ TEST(FreeLockQueueTest, ConcurrentPushSinglePop)
     EXPECT_EQ(values.size(), kNumThreads * kItemsPerThread);
 }
 
+// ==================== SpscRingBuf 测试 ====================
+
+TEST(SpscRingBufTest, PushAndFront)
+{
+    std::vector<uint8_t> mem(SpscRingBuf::need_total_mem_size(256));
+    SpscRingBuf ring;
+    ASSERT_TRUE(ring.init(mem.data(), mem.size()));
+    EXPECT_EQ(ring.capacity(), 256u);
+    EXPECT_TRUE(ring.empty());
+
+    EXPECT_TRUE(ring.push("hello", 5));
+    EXPECT_TRUE(ring.push("world!", 6));
+
+    uint32_t len = 0;
+    const uint8_t* data = ring.front(len);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), len), "hello");
+    ring.pop();
+
+    data = ring.front(len);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), len), "world!");
+    ring.pop();
+
+    EXPECT_EQ(ring.front(len), nullptr);
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingBufTest, FullAndWrap)
+{
+    std::vector<uint8_t> mem(SpscRingBuf::need_total_mem_size(256));
+    SpscRingBuf ring;
+    ASSERT_TRUE(ring.init(mem.data(), mem.size()));
+
+    // 超过单条上限
+    std::string big(ring.max_item_len() + 1, 'x');
+    EXPECT_FALSE(ring.push(big.data(), static_cast<uint32_t>(big.size())));
+
+    // 反复写读，覆盖尾部回绕
+    char buf[40];
+    for (int i = 0; i < 100; ++i)
+    {
+        memset(buf, 'a' + i % 26, sizeof(buf));
+        ASSERT_TRUE(ring.push(buf, sizeof(buf)));
+        uint32_t len = 0;
+        const uint8_t* data = ring.front(len);
+        ASSERT_NE(data, nullptr);
+        ASSERT_EQ(len, sizeof(buf));
+        EXPECT_EQ(data[0], static_cast<uint8_t>('a' + i % 26));
+        ring.pop();
+    }
+
+    // 写满后失败
+    int pushed = 0;
+    while (ring.push(buf, sizeof(buf)))
+        ++pushed;
+    EXPECT_GT(pushed, 0);
+    EXPECT_LE(pushed * 48, 256);
+}
+
+TEST(SpscRingBufTest, ProducerConsumerThreads)
+{
+    std::vector<uint8_t> mem(SpscRingBuf::need_total_mem_size(4096));
+    SpscRingBuf ring;
+    ASSERT_TRUE(ring.init(mem.data(), mem.size()));
+
+    constexpr uint32_t kCount = 100000;
+    std::thread producer([&ring]() {
+        for (uint32_t i = 0; i < kCount; ++i)
+        {
+            // 变长记录：值 + 填充
+            uint8_t buf[64] = {};
+            memcpy(buf, &i, sizeof(i));
+            uint32_t len = sizeof(i) + i % 50;
+            while (!ring.push(buf, len))
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t expect = 0;
+    while (expect < kCount)
+    {
+        uint32_t len = 0;
+        const uint8_t* data = ring.front(len);
+        if (!data)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t value = 0;
+        memcpy(&value, data, sizeof(value));
+        ASSERT_EQ(value, expect);
+        ASSERT_EQ(len, sizeof(value) + expect % 50);
+        ring.pop();
+        ++expect;
+    }
+    producer.join();
+    EXPECT_TRUE(ring.empty());
+}
+
 }  // namespace ua::test
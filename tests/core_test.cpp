@@ -1,20 +1,118 @@
 /// @file core_test.cpp
-/// @brief core 模块单元测试（GenerateTypeID + RpcError + ServerStatistics + SystemMgr + WaitGroup）
+/// @brief core 模块单元测试（GenerateTypeID + RpcError + ServerStatistics + StatExporter + ShardRuntime + RecvPipeline + ServerRunner + StackfulCoroutine + Task + PendingTable + ContextPool + SystemMgr + WaitGroup）
 #include <gtest/gtest.h>
+#include <csignal>
+#include <unistd.h>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
+#include "common/clock.h"
+#include "common/utils.h"
+#include "core/context_controller.h"
+#include "core/context_pool.h"
+#include "core/coro_mgr.h"
+#include "core/flow_controller.h"
 #include "core/generate_type_id.h"
+#include "core/gid_serial_scheduler.h"
+#include "core/pending_table.h"
+#include "core/interface/codec_interface.h"
+#include "core/logger.h"
+#include "core/recv_classifier.h"
+#include "core/recv_pipeline.h"
 #include "core/rpc_error.h"
+#include "core/server_core.h"
+#include "core/server_runner.h"
 #include "core/server_statistics.h"
+#include "core/shard_runtime.h"
+#include "core/span_tracer.h"
+#include "core/stackful_coroutine.h"
+#include "core/stat_exporter.h"
 #include "core/system_interface.h"
 #include "core/system_mgr.h"
+#include "core/task.h"
+#include "core/timeout_decorator.h"
+#include "core/transport_poller.h"
 #include "core/wait_group.h"
+#include "core/wfq_scheduler.h"
+
+// 替换全局 operator new，按线程计数，用来确认热路径上不申请堆内存
+// TSan 自己接管 new/delete，此时不替换，计数恒为 0（分配相关的用例也不在 TSan 下运行）
+#ifndef __SANITIZE_THREAD__
+#define UA_TEST_COUNT_ALLOC 1
+
+namespace
+{
+
+thread_local uint64_t t_alloc_num = 0;
+
+void* CountedAlloc(size_t size, size_t align)
+{
+    ++t_alloc_num;
+    size = size ? size : 1;
+    void* ptr = align <= alignof(std::max_align_t) ? std::malloc(size)
+                                                   : std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size)
+{
+    return CountedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+    return CountedAlloc(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
 
 namespace ua::test
 {
 
+/// 当前线程累计的 operator new 次数
+uint64_t AllocNum() noexcept
+{
+#ifdef UA_TEST_COUNT_ALLOC
+    return t_alloc_num;
+#else
+    return 0;
+#endif
+}
+
 // ==================== AutoGenTypeID 测试 ====================
 
 struct Scope1 {};
@@ -161,6 +259,1933 @@ TEST(ServerStatisticsTest, SetCoroRunTimeRecords)
     EXPECT_EQ(it->second.error_code_2_num.at(-1), 1u);
 }
 
+TEST(ServerStatisticsTest, PerThreadAndMerge)
+{
+    auto& stats = ua::ServerStatistics::GetInst();
+    stats.ClearStatistics();
+    stats.statistics().inc_on_proc_num(2);
+    stats.statistics().set_max_tick_deal_time(30);
+    stats.SetReqSize(1001, 100);
+
+    // 其他线程拿到的是自己的一份
+    ua::ServerStatistics other;
+    std::thread([&]() {
+        auto& local = ua::ServerStatistics::GetInst();
+        EXPECT_NE(&local, &stats);
+        EXPECT_EQ(local.statistics().on_proc_num, 0u);
+        local.statistics().inc_on_proc_num(3);
+        local.statistics().set_max_tick_deal_time(20);
+        local.SetReqSize(1001, 300);
+        local.SetCoroRunTime(1001, 150, 0);
+        other.Merge(local);
+    }).join();
+
+    stats.Merge(other);
+    EXPECT_EQ(stats.statistics().on_proc_num, 5u);
+    EXPECT_EQ(stats.statistics().tick_deal_time, 30u);
+    const auto& info = stats.RecvCmd2Info().at(1001);
+    EXPECT_EQ(info.total_recv_num, 2u);
+    EXPECT_EQ(info.max_req_size, 300u);
+    EXPECT_EQ(info.cost_map.at(100), 1u);
+    stats.ClearStatistics();
+}
+
+// ==================== StatExporter 测试 ====================
+
+TEST(StatExporterTest, PublishAndRead)
+{
+    const std::string shm_file = "/tmp/ua_test_stat_exporter_" + std::to_string(getpid());
+    auto& stats = ua::ServerStatistics::GetInst();
+    stats.ClearStatistics();
+    stats.statistics().inc_recv_pkg_num(7);
+    stats.SetReqSize(0x1001, 64);
+    stats.SetCoroRunTime(0x1001, 75, 0);
+    stats.SetCoroRunTime(0x1001, 75, -3);
+    stats.SetQueueCost(0x1001, 1);
+    stats.AddSendCmd(0x2002);
+    stats.AddTransportRecv(3, 10, true);
+    stats.SetTransportQueueCost(3, 120);
+    stats.SetSchedClassWait(1, 60, 4);
+    stats.SetSchedClassService(1, 600);
+    stats.AddSchedClassDrop(1, false);
+
+    ua::StatExporter exporter;
+    ASSERT_TRUE(exporter.Init(shm_file));
+    exporter.Publish(12345);
+
+    ua::StatReader reader;
+    ASSERT_TRUE(reader.Open(shm_file));
+    auto snap = std::make_unique<ua::StatSnapshot>();
+    ASSERT_TRUE(reader.Read(*snap));
+
+    EXPECT_EQ(snap->period_id, 1u);
+    EXPECT_EQ(snap->publish_ms, 12345u);
+    EXPECT_EQ(snap->statistics.recv_pkg_num, 7u);
+    ASSERT_EQ(snap->recv_cmd_num, 1u);
+    EXPECT_EQ(snap->recv_cmds[0].cmd, 0x1001u);
+    EXPECT_EQ(snap->recv_cmds[0].total_recv_num, 1u);
+    EXPECT_EQ(snap->recv_cmds[0].max_req_size, 64u);
+    // 75ms 落在下界为 50 的桶（下标 1）
+    EXPECT_EQ(snap->recv_cmds[0].cost[1], 2u);
+    EXPECT_EQ(snap->recv_cmds[0].queue_cost[0], 1u);
+    EXPECT_EQ(snap->error_num, 2u);
+    ASSERT_EQ(snap->send_cmd_num, 1u);
+    EXPECT_EQ(snap->send_cmds[0].total_send_num, 1u);
+    ASSERT_EQ(snap->transport_num, 1u);
+    EXPECT_EQ(snap->transports[0].transport_type, 3u);
+    EXPECT_EQ(snap->transports[0].recv_num, 10u);
+    EXPECT_EQ(snap->transports[0].busy_num, 1u);
+    EXPECT_EQ(snap->transports[0].queue_cost[2], 1u);
+    ASSERT_EQ(snap->sched_class_num, 1u);
+    EXPECT_EQ(snap->sched_classes[0].sched_class, 1u);
+    EXPECT_EQ(snap->sched_classes[0].dispatch_num, 1u);
+    EXPECT_EQ(snap->sched_classes[0].drop_num, 1u);
+    EXPECT_EQ(snap->sched_classes[0].max_queue_len, 4u);
+    EXPECT_EQ(snap->sched_classes[0].wait_cost[1], 1u);
+    EXPECT_EQ(snap->sched_classes[0].service_cost[3], 1u);
+
+    // 再次发布，序号递增
+    stats.ClearStatistics();
+    exporter.Publish(12346);
+    ASSERT_TRUE(reader.Read(*snap));
+    EXPECT_EQ(snap->period_id, 2u);
+    EXPECT_EQ(snap->recv_cmd_num, 0u);
+    EXPECT_EQ(snap->transport_num, 0u);
+    EXPECT_EQ(snap->sched_class_num, 0u);
+
+    unlink(shm_file.c_str());
+}
+
+// ==================== SpanTracer ====================
+
+TEST(SpanTracerTest, SampleEvery)
+{
+    ua::SpanTracer::SetSampleEvery(0);
+    EXPECT_FALSE(ua::SpanTracer::ShouldSample(8));
+
+    ua::SpanTracer::SetSampleEvery(4);
+    uint32_t sampled = 0;
+    for (uint64_t id = 1; id <= 100; ++id)
+        sampled += ua::SpanTracer::ShouldSample(id) ? 1 : 0;
+    EXPECT_EQ(sampled, 25u);
+    ua::SpanTracer::SetSampleEvery(0);
+}
+
+TEST(SpanTracerTest, PendingAwakeExportsAsyncSpans)
+{
+    ua::SpanTracer::Clear();
+    ua::SpanTracer::SetSampleEvery(1);
+
+    ua::ServerContext server_ctx;
+    server_ctx.SetCallback([](int32_t) {});
+    ua::SpanTracer::StartRequest(server_ctx, nullptr);
+    ASSERT_NE(server_ctx.span_id, 0u);
+    ASSERT_NE(server_ctx.trace_id, 0u);
+    ua::SpanRef span = ua::SpanTracer::Ref(&server_ctx);
+
+    // 未采样的请求不产生事件
+    ua::ServerContext other_ctx;
+    ua::SpanTracer::Begin(ua::SpanTracer::Ref(&other_ctx), "request");
+
+    ua::SpanTracer::Begin(span, "request", 0x1001);
+    ua::ContextMgr::SetCurrServerContext(&server_ctx);
+    ua::ContextController ctrl;
+    ctrl.Init(nullptr);
+    ua::ClientContext client_ctx;
+    ASSERT_EQ(ctrl.Pending(77, 1000, &client_ctx, ua::AsyncTask([](int32_t, ua::ServerContext*) {})),
+              ua::RPC_SUCCESS);
+    ASSERT_EQ(ctrl.Awake(77, ua::RPC_SUCCESS), &client_ctx);
+    client_ctx.Run();
+
+    // 其他线程的事件也能导出
+    std::thread([span]() { ua::SpanTracer::Instant(span, "worker"); }).join();
+    ua::SpanTracer::End(span, "request", 0);
+    ua::ContextMgr::SetCurrServerContext(nullptr);
+    ua::SpanTracer::SetSampleEvery(0);
+
+    std::string json;
+    ua::SpanTracer::ExportJson(json);
+    char id[32];
+    snprintf(id, sizeof(id), "\"id\":\"0x%lx\"", static_cast<unsigned long>(server_ctx.span_id));
+    EXPECT_NE(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), std::string::npos);
+    EXPECT_NE(json.find(id), std::string::npos) << json;
+
+    // 按时间排序: request 开始 < rpc_wait 开始 < rpc_wait 结束 < worker < request 结束
+    size_t pos = 0;
+    for (const char* expect : {"\"name\":\"request\",\"cat\":\"request\",\"ph\":\"b\"",
+                               "\"name\":\"rpc_wait\",\"cat\":\"request\",\"ph\":\"b\"",
+                               "\"name\":\"rpc_wait\",\"cat\":\"request\",\"ph\":\"e\"",
+                               "\"name\":\"worker\",\"cat\":\"request\",\"ph\":\"n\"",
+                               "\"name\":\"request\",\"cat\":\"request\",\"ph\":\"e\""})
+    {
+        size_t next = json.find(expect, pos);
+        ASSERT_NE(next, std::string::npos) << expect << "\n" << json;
+        pos = next + 1;
+    }
+    EXPECT_EQ(json.find("\"name\":\"request\"", pos), std::string::npos);
+
+    ua::SpanTracer::Clear();
+    json.clear();
+    ua::SpanTracer::ExportJson(json);
+    EXPECT_EQ(json, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}\n");
+}
+
+TEST(SpanTracerTest, TraceContextPropagation)
+{
+    ua::SpanTracer::Clear();
+    ua::SpanTracer::SetSampleEvery(1);
+
+    // 入口服务采样后下发
+    ua::ServerContext gateway_ctx;
+    ua::SpanTracer::StartRequest(gateway_ctx, nullptr);
+    char buf[ua::TraceContext::kWireSize];
+    ua::SpanTracer::Propagate(gateway_ctx).Encode(buf);
+
+    // 下游即使本地关闭采样，也加入上游的 trace
+    ua::SpanTracer::SetSampleEvery(0);
+    ua::TraceContext upstream;
+    ASSERT_TRUE(upstream.Decode(buf, sizeof(buf)));
+    EXPECT_TRUE(upstream.Sampled());
+    ua::ServerContext logic_ctx;
+    ua::SpanTracer::StartRequest(logic_ctx, &upstream);
+    EXPECT_EQ(logic_ctx.trace_id, gateway_ctx.trace_id);
+    EXPECT_NE(logic_ctx.span_id, 0u);
+    EXPECT_NE(logic_ctx.span_id, gateway_ctx.span_id);
+
+    std::string json;
+    ua::SpanTracer::ExportJson(json);
+    char upstream_arg[64];
+    snprintf(upstream_arg, sizeof(upstream_arg), "\"arg\":%lu", static_cast<unsigned long>(gateway_ctx.span_id));
+    EXPECT_NE(json.find("\"name\":\"upstream\""), std::string::npos) << json;
+    EXPECT_NE(json.find(upstream_arg), std::string::npos) << json;
+
+    // 上游决定不采样时，下游即使本地全采也不采
+    ua::SpanTracer::SetSampleEvery(1);
+    ua::ServerContext unsampled_ctx;
+    ua::SpanTracer::Propagate(unsampled_ctx).Encode(buf);
+    ASSERT_TRUE(upstream.Decode(buf, sizeof(buf)));
+    EXPECT_FALSE(upstream.Sampled());
+    ua::ServerContext db_ctx;
+    ua::SpanTracer::StartRequest(db_ctx, &upstream);
+    EXPECT_EQ(db_ctx.span_id, 0u);
+
+    // 版本不对或长度不足的扩展头忽略
+    buf[0] = 2;
+    EXPECT_FALSE(upstream.Decode(buf, sizeof(buf)));
+    EXPECT_FALSE(upstream.Decode(buf, 4));
+
+    ua::SpanTracer::SetSampleEvery(0);
+    ua::SpanTracer::Clear();
+}
+
+// ==================== ShardRuntime / RecvPipeline 测试 ====================
+
+/// 测试包格式: [u64 gid][u32 seq]，可选 [u64 timeout]
+class TestPkgCodec : public ua::RecvCodec
+{
+public:
+    bool Decode(const char* data, uint32_t data_len) override
+    {
+        if (data_len < sizeof(gid_) + sizeof(seq_))
+            return false;
+        std::memcpy(&gid_, data, sizeof(gid_));
+        std::memcpy(&seq_, data + sizeof(gid_), sizeof(seq_));
+        timeout_ = 0;
+        if (data_len >= sizeof(gid_) + sizeof(seq_) + sizeof(timeout_))
+            std::memcpy(&timeout_, data + sizeof(gid_) + sizeof(seq_), sizeof(timeout_));
+        decoded_ = true;
+        return true;
+    }
+    [[nodiscard]] uint64_t GetTimeout() const override { return timeout_; }
+    [[nodiscard]] bool HasDecoded() const override { return decoded_; }
+    void Reset() override { decoded_ = false; }
+
+    [[nodiscard]] uint32_t GetCmd() const override { return 0; }
+    [[nodiscard]] uint32_t GetSvrType() const override { return 0; }
+    [[nodiscard]] uint64_t GetGid() const override { return gid_; }
+    [[nodiscard]] uint64_t GetSeqID() const override { return seq_; }
+    [[nodiscard]] uint32_t GetSrc() const override { return 0; }
+    [[nodiscard]] uint32_t GetDst() const override { return 0; }
+    [[nodiscard]] uint32_t GetBodyLen() const override { return 0; }
+    [[nodiscard]] const char* GetBody() const override { return nullptr; }
+    [[nodiscard]] const char* GetRawData(uint32_t& data_len) const override { return nullptr; }
+
+private:
+    uint64_t gid_ = 0;
+    uint32_t seq_ = 0;
+    uint64_t timeout_ = 0;
+    bool decoded_ = false;
+};
+
+/// 只在一个线程上收发，包在启动前准备好
+class TestIOChannel : public ua::IChannel
+{
+public:
+    [[nodiscard]] uint32_t MyID() const override { return 1; }
+    int32_t Send(uint32_t dest_id, const char* buff, size_t buff_len) override
+    {
+        sent.emplace_back(buff, buff_len);
+        return 0;
+    }
+    size_t Loop(uint32_t max_recv_count) override
+    {
+        size_t count = 0;
+        while (count < max_recv_count && !packets.empty())
+        {
+            recv_callback_(packets.front().data(), packets.front().size(), 2, 0);
+            packets.pop_front();
+            ++count;
+        }
+        return count;
+    }
+
+    std::deque<std::string> packets;
+    std::vector<std::string> sent;
+};
+
+struct ShardRecord
+{
+    uint64_t gid;
+    uint32_t seq;
+    int32_t shard;
+};
+
+/// 不依赖 PBService，在 OnProc 里直接驱动分片 channel
+class ShardTestCore : public ua::ServerCore
+{
+public:
+    ShardTestCore(ua::ShardChannel* channel, std::vector<ShardRecord>* records, std::atomic<uint32_t>* recv_num)
+        : channel_(channel), records_(records), recv_num_(recv_num)
+    {
+    }
+
+protected:
+    bool OnInit() override
+    {
+        channel_->SetCallback([this](const char* data, size_t len, uint32_t, uint64_t) {
+            ShardRecord record{};
+            std::memcpy(&record.gid, data, sizeof(record.gid));
+            std::memcpy(&record.seq, data + sizeof(record.gid), sizeof(record.seq));
+            record.shard = ua::ShardRuntime::CurrentShard();
+            records_->push_back(record);
+            // 每个 gid 的最后一个包回一个应答
+            if (record.seq == 99)
+                channel_->Send(2, data, len);
+            recv_num_->fetch_add(1, std::memory_order_release);
+            return 0;
+        });
+        return true;
+    }
+    size_t OnProc(uint64_t now_ms, uint64_t remain_ms, bool stop) override { return channel_->Loop(64); }
+
+private:
+    ua::ShardChannel* channel_;
+    std::vector<ShardRecord>* records_;
+    std::atomic<uint32_t>* recv_num_;
+};
+
+template <typename Pred>
+bool PollUntil(ua::ShardRuntime& runtime, Pred pred)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        if (runtime.PollIO(256) == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    runtime.PollIO(256);
+    return true;
+}
+
+TEST(ShardRuntimeTest, DispatchKeepsPerGidOrder)
+{
+    constexpr uint32_t kShardNum = 4;
+    constexpr uint64_t kGidNum = 64;
+    constexpr uint32_t kSeqNum = 100;
+
+    TestPkgCodec codec;
+    TestIOChannel io_channel;
+    for (uint32_t seq = 0; seq < kSeqNum; ++seq)
+    {
+        for (uint64_t gid = 0; gid < kGidNum; ++gid)
+        {
+            char buf[12];
+            std::memcpy(buf, &gid, sizeof(gid));
+            std::memcpy(buf + sizeof(gid), &seq, sizeof(seq));
+            io_channel.packets.emplace_back(buf, sizeof(buf));
+        }
+    }
+
+    std::vector<std::vector<ShardRecord>> records(kShardNum);
+    std::atomic<uint32_t> recv_num{0};
+    ua::ShardRuntime runtime;
+    ua::ShardRuntime::Option option;
+    option.shard_num = kShardNum;
+    option.io_channel = &io_channel;
+    option.route_codec = &codec;
+    // 一次全部投递也放得下，不丢包
+    option.in_ring_size = 1 << 20;
+    option.idle_sleep_us = 10;
+    std::string err_msg;
+    ASSERT_TRUE(runtime.Start(
+        option,
+        [&](uint32_t shard_id, ua::ShardChannel* channel) -> std::unique_ptr<ua::ServerCore> {
+            auto core = std::make_unique<ShardTestCore>(channel, &records[shard_id], &recv_num);
+            if (!core->SvrInit({}))
+                return nullptr;
+            return core;
+        },
+        &err_msg))
+        << err_msg;
+
+    ASSERT_TRUE(PollUntil(runtime, [&]() { return recv_num.load(std::memory_order_acquire) == kGidNum * kSeqNum; }));
+    ASSERT_TRUE(PollUntil(runtime, [&]() { return io_channel.sent.size() == kGidNum; }));
+    runtime.Stop();
+
+    uint64_t total = 0;
+    for (uint32_t shard_id = 0; shard_id < kShardNum; ++shard_id)
+    {
+        std::vector<int64_t> last_seq(kGidNum, -1);
+        for (const auto& record : records[shard_id])
+        {
+            EXPECT_EQ(record.shard, static_cast<int32_t>(shard_id));
+            EXPECT_EQ(runtime.ShardOf(record.gid), shard_id);
+            EXPECT_EQ(static_cast<int64_t>(record.seq), last_seq[record.gid] + 1);
+            last_seq[record.gid] = record.seq;
+        }
+        total += records[shard_id].size();
+        // gid 能打散到每个分片
+        EXPECT_FALSE(records[shard_id].empty());
+        auto stat = runtime.GetStat(shard_id);
+        EXPECT_EQ(stat.dispatch_num, records[shard_id].size());
+        EXPECT_EQ(stat.dispatch_drop_num, 0u);
+    }
+    EXPECT_EQ(total, kGidNum * kSeqNum);
+    EXPECT_EQ(ua::ShardRuntime::CurrentShard(), -1);
+
+    // 分片的统计各写各的，汇总后才能看到；本线程的统计不受影响
+    uint32_t local_proc_num = ua::ServerStatistics::GetInst().statistics().on_proc_num;
+    ua::ServerStatistics collected;
+    runtime.CollectStatistics(collected);
+    EXPECT_GE(collected.statistics().on_proc_num, kShardNum);
+    EXPECT_EQ(ua::ServerStatistics::GetInst().statistics().on_proc_num, local_proc_num);
+    ua::ServerStatistics again;
+    runtime.CollectStatistics(again);
+    EXPECT_EQ(again.statistics().on_proc_num, 0u);
+}
+
+TEST(ShardRuntimeTest, PostRunsOnTargetShard)
+{
+    constexpr uint32_t kShardNum = 3;
+    TestPkgCodec codec;
+    TestIOChannel io_channel;
+    std::vector<std::vector<ShardRecord>> records(kShardNum);
+    std::atomic<uint32_t> recv_num{0};
+    ua::ShardRuntime runtime;
+    ua::ShardRuntime::Option option;
+    option.shard_num = kShardNum;
+    option.io_channel = &io_channel;
+    option.route_codec = &codec;
+    option.in_ring_size = 64 * 1024;
+    option.post_ring_size = 16 * 1024;
+    option.out_ring_size = 16 * 1024;
+    option.idle_sleep_us = 10;
+    ASSERT_TRUE(runtime.Start(option, [&](uint32_t shard_id, ua::ShardChannel* channel) {
+        auto core = std::make_unique<ShardTestCore>(channel, &records[shard_id], &recv_num);
+        return core->SvrInit({}) ? std::unique_ptr<ua::ServerCore>(std::move(core)) : nullptr;
+    }));
+
+    // IO 线程 -> 分片 0 -> 分片 2 -> 分片 1
+    std::atomic<int32_t> hops[kShardNum];
+    for (auto& hop : hops)
+        hop.store(-1);
+    std::atomic<bool> done{false};
+    ASSERT_TRUE(runtime.Post(0, [&]() {
+        hops[0] = ua::ShardRuntime::CurrentShard();
+        EXPECT_TRUE(runtime.Post(2, [&]() {
+            hops[2] = ua::ShardRuntime::CurrentShard();
+            EXPECT_TRUE(runtime.Post(1, [&]() {
+                hops[1] = ua::ShardRuntime::CurrentShard();
+                done.store(true, std::memory_order_release);
+            }));
+        }));
+    }));
+    EXPECT_FALSE(runtime.Post(kShardNum, []() {}));
+
+    ASSERT_TRUE(PollUntil(runtime, [&]() { return done.load(std::memory_order_acquire); }));
+    for (uint32_t i = 0; i < kShardNum; ++i)
+    {
+        EXPECT_EQ(hops[i].load(), static_cast<int32_t>(i));
+        EXPECT_EQ(runtime.GetStat(i).post_num, 1u);
+    }
+
+    // 非 IO 线程、非分片线程不能投递
+    bool posted = true;
+    std::thread([&]() { posted = runtime.Post(0, []() {}); }).join();
+    EXPECT_FALSE(posted);
+    runtime.Stop();
+}
+
+/// 收到客户端请求（seq 0）后向后端发起一个 RPC 挂起等回包（seq 1，包体带 rpc seq_id），回包到达后应答客户端
+class RpcShardCore : public ua::ServerCore
+{
+public:
+    static constexpr uint32_t kRpcTimeoutMs = 3000;
+    static constexpr uint32_t kBackendID = 3;
+
+    RpcShardCore(ua::ShardChannel* channel, std::atomic<uint64_t>* rpc_seq, std::atomic<int32_t>* rpc_ret)
+        : channel_(channel), rpc_seq_(rpc_seq), rpc_ret_(rpc_ret)
+    {
+    }
+
+protected:
+    bool OnInit() override
+    {
+        channel_->SetCallback([this](const char* data, size_t len, uint32_t recv_id, uint64_t) {
+            uint64_t gid = 0;
+            uint32_t seq = 0;
+            std::memcpy(&gid, data, sizeof(gid));
+            std::memcpy(&seq, data + sizeof(gid), sizeof(seq));
+            if (seq == 1)
+            {
+                uint64_t rpc_seq = 0;
+                std::memcpy(&rpc_seq, data + sizeof(gid) + sizeof(seq), sizeof(rpc_seq));
+                if (auto* client_ctx = context_ctrl_.Awake(rpc_seq, ua::RPC_SUCCESS))
+                    client_ctx->Run();
+                return 0;
+            }
+
+            server_ctx_.gid = gid;
+            server_ctx_.SetCallback([this, recv_id](int32_t) {
+                char buf[12] = {};
+                std::memcpy(buf, &server_ctx_.gid, sizeof(server_ctx_.gid));
+                channel_->Send(recv_id, buf, sizeof(buf));
+            });
+            ua::ContextMgr::SetCurrServerContext(&server_ctx_);
+            uint64_t rpc_seq = context_ctrl_.AllocSeqID(kRpcTimeoutMs);
+            client_ctx_ = std::make_unique<ua::ClientContext>();
+            EXPECT_EQ(context_ctrl_.Pending(rpc_seq, kRpcTimeoutMs, client_ctx_.get(),
+                                            ua::AsyncTask([this](int32_t ret, ua::ServerContext*) {
+                                                rpc_ret_->store(ret, std::memory_order_release);
+                                            })),
+                      ua::RPC_SUCCESS);
+            char buf[20];
+            std::memcpy(buf, &gid, sizeof(gid));
+            std::memcpy(buf + sizeof(gid), &seq, sizeof(seq));
+            std::memcpy(buf + sizeof(gid) + sizeof(seq), &rpc_seq, sizeof(rpc_seq));
+            channel_->Send(kBackendID, buf, sizeof(buf));
+            rpc_seq_->store(rpc_seq, std::memory_order_release);
+            return 0;
+        });
+        return true;
+    }
+    size_t OnProc(uint64_t now_ms, uint64_t remain_ms, bool stop) override { return channel_->Loop(64); }
+
+private:
+    ua::ShardChannel* channel_;
+    std::atomic<uint64_t>* rpc_seq_;
+    std::atomic<int32_t>* rpc_ret_;
+    ua::ServerContext server_ctx_;
+    std::unique_ptr<ua::ClientContext> client_ctx_;
+};
+
+TEST(ShardRuntimeTest, StopDeliversReplyOfPendingRpc)
+{
+    TestPkgCodec codec;
+    TestIOChannel io_channel;
+    uint64_t gid = 7;
+    char req[12] = {};
+    std::memcpy(req, &gid, sizeof(gid));
+    io_channel.packets.emplace_back(req, sizeof(req));
+
+    std::atomic<uint64_t> rpc_seq{0};
+    std::atomic<int32_t> rpc_ret{ua::RPC_SYS_ERR};
+    ua::ShardRuntime runtime;
+    ua::ShardRuntime::Option option;
+    option.shard_num = 2;
+    option.io_channel = &io_channel;
+    option.route_codec = &codec;
+    option.in_ring_size = 64 * 1024;
+    option.post_ring_size = 16 * 1024;
+    option.out_ring_size = 16 * 1024;
+    option.idle_sleep_us = 10;
+    ASSERT_TRUE(runtime.Start(option, [&](uint32_t, ua::ShardChannel* channel) {
+        auto core = std::make_unique<RpcShardCore>(channel, &rpc_seq, &rpc_ret);
+        return core->SvrInit({}) ? std::unique_ptr<ua::ServerCore>(std::move(core)) : nullptr;
+    }));
+    ASSERT_TRUE(PollUntil(runtime, [&]() { return rpc_seq.load(std::memory_order_acquire) != 0; }));
+    ASSERT_EQ(io_channel.sent.size(), 1u);
+
+    // 后端的回包在 Stop 之后才到：分片等 SvrStopReady 期间 IO 线程仍要收包，不能等到 RPC 超时
+    char rsp[20];
+    uint32_t seq = 1;
+    uint64_t seq_id = rpc_seq.load(std::memory_order_acquire);
+    std::memcpy(rsp, &gid, sizeof(gid));
+    std::memcpy(rsp + sizeof(gid), &seq, sizeof(seq));
+    std::memcpy(rsp + sizeof(gid) + sizeof(seq), &seq_id, sizeof(seq_id));
+    io_channel.packets.emplace_back(rsp, sizeof(rsp));
+
+    auto begin = std::chrono::steady_clock::now();
+    runtime.Stop();
+    auto cost_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+    EXPECT_EQ(rpc_ret.load(std::memory_order_acquire), ua::RPC_SUCCESS);
+    EXPECT_LT(cost_ms, RpcShardCore::kRpcTimeoutMs / 2);
+    // 退出过程中给客户端的应答也已发出
+    ASSERT_EQ(io_channel.sent.size(), 2u);
+    EXPECT_EQ(io_channel.sent[1].size(), 12u);
+    EXPECT_EQ(runtime.GetStat(runtime.ShardOf(gid)).send_drop_num, 0u);
+}
+
+TEST(RecvPipelineTest, DecodeOnIOThreadAndDropExpired)
+{
+    constexpr uint32_t kPkgNum = 1000;
+    TestIOChannel io_channel;
+    uint32_t expect_ready = 0;
+    for (uint32_t seq = 0; seq < kPkgNum; ++seq)
+    {
+        uint64_t gid = seq % 16;
+        // 每 10 个包一个已过期，gid 13 的包由校验丢弃
+        uint64_t timeout = seq % 10 == 0 ? 1 : 0;
+        char buf[20];
+        std::memcpy(buf, &gid, sizeof(gid));
+        std::memcpy(buf + sizeof(gid), &seq, sizeof(seq));
+        std::memcpy(buf + sizeof(gid) + sizeof(seq), &timeout, sizeof(timeout));
+        io_channel.packets.emplace_back(buf, sizeof(buf));
+        if (timeout == 0 && gid != 13)
+            ++expect_ready;
+    }
+    io_channel.packets.emplace_back("bad");
+
+    ua::ServerStatistics::GetInst().ClearStatistics();
+    // 开到 WARN，过期丢包日志才会进入限频器
+    ua::Logger::GetInst().SetLevel(ua::Logger::PRIORITY_WARN);
+    ua::RecvPipeline pipeline;
+    std::vector<uint32_t> seqs;
+    std::thread::id io_thread_id;
+    pipeline.SetDecodedCallback([&](ua::RecvCodec& codec, const char* data, size_t len, uint32_t recv_id, uint64_t) {
+        // codec 已在 IO 线程上对槽内数据解码
+        uint32_t seq = 0;
+        std::memcpy(&seq, data + sizeof(uint64_t), sizeof(seq));
+        EXPECT_EQ(codec.GetSeqID(), seq);
+        EXPECT_EQ(recv_id, 2u);
+        seqs.push_back(seq);
+        return 0;
+    });
+
+    ua::RecvPipeline::Option option;
+    option.channel = &io_channel;
+    option.codec_creator = []() { return std::make_unique<TestPkgCodec>(); };
+    option.validator = [&](const ua::RecvCodec& codec) {
+        io_thread_id = std::this_thread::get_id();
+        return codec.GetGid() != 13;
+    };
+    // 槽很少，逼出背压
+    option.slot_num = 8;
+    option.batch_num = 4;
+    option.idle_sleep_us = 10;
+    std::string err_msg;
+    ASSERT_TRUE(pipeline.Start(option, &err_msg)) << err_msg;
+    EXPECT_FALSE(pipeline.Start(option));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (seqs.size() < expect_ready && std::chrono::steady_clock::now() < deadline)
+    {
+        if (pipeline.Loop(16) == 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    while (pipeline.GetStat().decode_fail_num == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    pipeline.Stop();
+
+    ASSERT_EQ(seqs.size(), expect_ready);
+    for (size_t i = 1; i < seqs.size(); ++i)
+        EXPECT_LT(seqs[i - 1], seqs[i]);
+    EXPECT_NE(io_thread_id, std::this_thread::get_id());
+
+    auto stat = pipeline.GetStat();
+    EXPECT_EQ(stat.recv_num, kPkgNum + 1);
+    EXPECT_EQ(stat.ready_num, expect_ready);
+    EXPECT_EQ(stat.expire_drop_num, kPkgNum / 10);
+    EXPECT_EQ(stat.validate_drop_num, kPkgNum - kPkgNum / 10 - expect_ready);
+    EXPECT_EQ(stat.decode_fail_num, 1u);
+    // IO 线程上被限频抑制的过期日志计入 IO 线程自己的统计，Stop 时并入本线程
+    uint32_t suppressed = ua::ServerStatistics::GetInst().statistics().log_suppressed_num;
+    EXPECT_GT(suppressed, 0u);
+    EXPECT_LE(suppressed, kPkgNum / 10);
+    ua::ServerStatistics::GetInst().ClearStatistics();
+    ua::Logger::GetInst().SetCanOutputFunc(nullptr);
+}
+
+// ==================== ServerRunner 测试 ====================
+
+class RunnerTestCore : public ua::ServerCore
+{
+public:
+    std::atomic<bool> work{false};
+    std::atomic<uint32_t> work_num{0};
+    uint64_t timer_fire_ms = 0;
+    uint32_t tick_num = 0;
+    bool finished = false;
+    int quit_signal = 0;
+
+protected:
+    void OnTick(uint64_t now_ms, uint64_t tick_count) override
+    {
+        ++tick_num;
+        if (quit_signal && tick_num == 3)
+            raise(quit_signal);
+    }
+    size_t OnProc(uint64_t now_ms, uint64_t remain_ms, bool stop) override
+    {
+        if (!work.exchange(false))
+            return 0;
+        work_num.fetch_add(1);
+        return 1;
+    }
+    bool OnFinish() override
+    {
+        finished = true;
+        return true;
+    }
+};
+
+TEST(ServerRunnerTest, IdleWaitWakeupAndStop)
+{
+    RunnerTestCore core;
+    ASSERT_TRUE(core.SvrInit({}));
+
+    ua::ServerRunner runner;
+    ua::ServerRunner::Option option;
+    option.tick_interval_ms = 10;
+    option.max_wait_ms = 1000;
+    option.quit_signals.clear();
+    std::string err_msg;
+    ASSERT_TRUE(runner.Init(option, &err_msg)) << err_msg;
+
+    // 定时事件的到期时间决定 epoll 等待时长
+    uint64_t expire_ms = ua::utils::CurrentRealMilliSec() + 30;
+    core.AddTimer(0, [&core, expire_ms]() {
+        core.timer_fire_ms = ua::utils::CurrentRealMilliSec();
+        return 0;
+    }, expire_ms);
+
+    std::thread other([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        core.work = true;
+        runner.Wakeup();
+        while (core.work_num.load() == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        runner.Stop();
+    });
+    uint64_t begin_ms = ua::utils::CurrentRealMilliSec();
+    EXPECT_TRUE(runner.Run(core));
+    uint64_t cost_ms = ua::utils::CurrentRealMilliSec() - begin_ms;
+    other.join();
+
+    EXPECT_TRUE(core.finished);
+    EXPECT_EQ(core.work_num.load(), 1u);
+    EXPECT_GE(core.timer_fire_ms, expire_ms);
+    EXPECT_LT(core.timer_fire_ms, expire_ms + 50);
+    // 约 100ms 内按 10ms 间隔 tick，空闲时在 epoll 里等待而不是空转
+    EXPECT_GE(runner.TickCount(), cost_ms / 10 / 2);
+    EXPECT_LE(runner.TickCount(), cost_ms / 10 + 2);
+    EXPECT_GT(runner.IdleNum(), 0u);
+    EXPECT_LT(runner.IdleNum(), 200u);
+    EXPECT_EQ(ua::Clock::GetInst().CurrentMilliSec() / 100, ua::utils::CurrentRealMilliSec() / 100);
+}
+
+TEST(ServerRunnerTest, QuitOnSignal)
+{
+    RunnerTestCore core;
+    core.quit_signal = SIGUSR2;
+    ASSERT_TRUE(core.SvrInit({}));
+
+    ua::ServerRunner runner;
+    ua::ServerRunner::Option option;
+    option.tick_interval_ms = 5;
+    option.quit_signals = {SIGUSR2};
+    ASSERT_TRUE(runner.Init(option));
+    EXPECT_TRUE(runner.Run(core));
+    EXPECT_TRUE(core.finished);
+    EXPECT_EQ(core.tick_num, 3u);
+}
+
+// ==================== FlowController 测试 ====================
+
+static ua::FlowControlOption MakeFlowOption(ua::FlowMode mode)
+{
+    ua::FlowControlOption option;
+    option.max_deal_pkg_num = 100;
+    option.max_num = 1000;
+    option.min_num = 10;
+    option.inc_delta = 2;
+    option.dec_delta = 50;
+    option.judge_range_ms = 1;
+    option.mode = mode;
+    option.target_delay_ms = 5;
+    option.interval_ms = 100;
+    return option;
+}
+
+TEST(FlowControllerTest, AimdDecreaseFastIncreaseSlow)
+{
+    ua::FlowController ctrl;
+    ctrl.Init(MakeFlowOption(ua::FlowMode::kAimd));
+    EXPECT_EQ(ctrl.Budget(), 100u);
+
+    EXPECT_EQ(ctrl.OnFrame(1000, 5, 10), 50u);  // 超时
+    EXPECT_EQ(ctrl.OnFrame(1001, 5, 10), 10u);  // 不低于 min_num
+    EXPECT_EQ(ctrl.OnFrame(1002, 5, 5), 10u);   // 差异区间内不变
+    EXPECT_EQ(ctrl.OnFrame(1003, 8, 1), 12u);   // 有余量
+
+    // kAimd 不看排队时延，也不丢包
+    ua::FlowControlOption option = MakeFlowOption(ua::FlowMode::kAimd);
+    option.shed_on_delay = true;
+    ctrl.Init(option);
+    EXPECT_FALSE(ctrl.OnSojourn(10000, true));
+    EXPECT_FALSE(ctrl.Dropping());
+}
+
+TEST(FlowControllerTest, DelayTargetStandingQueue)
+{
+    ua::FlowController ctrl;
+    ctrl.Init(MakeFlowOption(ua::FlowMode::kDelayTarget));
+
+    // 第一个区间内排队时延一直高于目标
+    EXPECT_EQ(ctrl.OnFrame(1000, 8, 1), 102u);
+    ctrl.OnSojourn(20, true);
+    ctrl.OnSojourn(8, true);
+    EXPECT_EQ(ctrl.OnFrame(1050, 8, 1), 104u);
+    EXPECT_FALSE(ctrl.Dropping());
+
+    // 区间结束进入积压状态，按预算 1/4 增长
+    EXPECT_EQ(ctrl.OnFrame(1100, 8, 1), 130u);
+    EXPECT_TRUE(ctrl.Dropping());
+    // 超时的保护仍然生效
+    EXPECT_EQ(ctrl.OnFrame(1110, 5, 10), 80u);
+
+    // 区间内出现过低于目标的时延，退出积压状态
+    ctrl.OnSojourn(3, true);
+    ctrl.OnSojourn(30, true);
+    EXPECT_EQ(ctrl.OnFrame(1200, 8, 1), 82u);
+    EXPECT_FALSE(ctrl.Dropping());
+
+    // 没有样本的区间不算积压
+    EXPECT_EQ(ctrl.OnFrame(1300, 8, 1), 84u);
+    EXPECT_FALSE(ctrl.Dropping());
+}
+
+TEST(FlowControllerTest, DelayTargetShed)
+{
+    ua::FlowControlOption option = MakeFlowOption(ua::FlowMode::kDelayTarget);
+    option.shed_on_delay = true;
+    ua::FlowController ctrl;
+    ctrl.Init(option);
+
+    // 非积压时只丢超过 interval_ms 的请求
+    ctrl.OnFrame(1000, 8, 1);
+    EXPECT_FALSE(ctrl.OnSojourn(50, true));
+    EXPECT_TRUE(ctrl.OnSojourn(101, true));
+    EXPECT_FALSE(ctrl.OnSojourn(101, false));  // 回包不丢
+
+    // 积压时超过 target_delay_ms 就丢
+    ctrl.OnFrame(1100, 8, 1);
+    EXPECT_TRUE(ctrl.Dropping());
+    EXPECT_FALSE(ctrl.OnSojourn(5, true));
+    EXPECT_TRUE(ctrl.OnSojourn(6, true));
+    EXPECT_FALSE(ctrl.OnSojourn(6, false));
+}
+
+// ==================== RecvClassifier 测试 ====================
+
+TEST(RecvClassifierTest, ResponseAndKeyFirstNormalDeferred)
+{
+    constexpr uint32_t kRsp = 0x0001;
+    constexpr uint32_t kKey = 0x0010;
+    ua::ServerStatistics::GetInst().ClearStatistics();
+
+    ua::RecvClassifier classifier;
+    ua::RecvClassifier::Option option;
+    option.enable = true;
+    option.deferred_max_num = 2;
+    ASSERT_TRUE(classifier.Init(option));
+
+    std::vector<std::string> replayed;
+    classifier.SetReplayer([&](uint32_t transport_type, const char* data, size_t len, uint32_t, uint64_t) {
+        EXPECT_EQ(transport_type, 3u);
+        // 重放时走和收包相同的流程，不会再被延后
+        EXPECT_TRUE(classifier.Admit(0, transport_type, data, len, 0, 0));
+        replayed.emplace_back(data, len);
+    });
+
+    // 不在收包阶段时不延后
+    EXPECT_TRUE(classifier.Admit(0, 3, "x", 1, 0, 0));
+
+    EXPECT_EQ(classifier.BeginFrame(1), 0u);
+    EXPECT_EQ(classifier.ReadLimit(10), 3u);  // 预算 1 + 队列剩余 2
+    EXPECT_TRUE(classifier.Admit(0, 3, "a", 1, 0, 0));
+    EXPECT_FALSE(classifier.Admit(0, 3, "b", 1, 0, 0));
+    EXPECT_TRUE(classifier.Admit(kRsp, 3, "r", 1, 0, 0));
+    EXPECT_TRUE(classifier.Admit(kKey, 3, "k", 1, 0, 0));
+    EXPECT_FALSE(classifier.Admit(0, 3, "c", 1, 0, 0));
+    EXPECT_EQ(classifier.ReadLimit(10), 0u);
+    // 队列满了（绕过 ReadLimit）直接处理
+    EXPECT_TRUE(classifier.Admit(0, 3, "d", 1, 0, 0));
+    classifier.EndFrame();
+    EXPECT_EQ(classifier.DeferredNum(), 2u);
+
+    // 下一帧先按预算重放，新请求排在延后的请求之后
+    EXPECT_EQ(classifier.BeginFrame(1), 1u);
+    EXPECT_EQ(replayed, (std::vector<std::string>{"b"}));
+    EXPECT_EQ(classifier.ReadLimit(10), 1u);
+    EXPECT_FALSE(classifier.Admit(0, 3, "e", 1, 0, 0));
+    classifier.EndFrame();
+
+    EXPECT_EQ(classifier.BeginFrame(5), 2u);
+    EXPECT_EQ(replayed, (std::vector<std::string>{"b", "c", "e"}));
+    EXPECT_EQ(classifier.DeferredNum(), 0u);
+    EXPECT_EQ(classifier.ReadLimit(10), 5u);
+    classifier.EndFrame();
+
+    const auto& st = ua::ServerStatistics::GetInst().statistics();
+    EXPECT_EQ(st.recv_rsp_num, 1u);
+    EXPECT_EQ(st.recv_key_num, 1u);
+    EXPECT_EQ(st.recv_deferred_num, 3u);
+}
+
+// ==================== TransportPoller 测试 ====================
+
+TEST(TransportPollerTest, WeightedShareAndSpareRedistribution)
+{
+    ua::ServerStatistics::GetInst().ClearStatistics();
+    TestIOChannel channels[2];
+    for (auto& channel : channels)
+        channel.SetCallback([](const char*, size_t, uint32_t, uint64_t) { return 0; });
+
+    ua::TransportPoller poller;
+    ASSERT_TRUE(poller.Add(0, &channels[0], 1));
+    ASSERT_TRUE(poller.Add(1, &channels[1], 3));
+    EXPECT_FALSE(poller.Add(1, &channels[1]));
+    EXPECT_EQ(poller.Channels().size(), 2u);
+
+    // 都忙时按权重分
+    channels[0].packets.assign(100, "a");
+    channels[1].packets.assign(100, "b");
+    EXPECT_EQ(poller.Poll(8), 8u);
+    EXPECT_EQ(channels[0].packets.size(), 98u);
+    EXPECT_EQ(channels[1].packets.size(), 94u);
+
+    // 空闲 transport 的预算让给忙碌的
+    channels[1].packets.clear();
+    EXPECT_EQ(poller.Poll(8), 8u);
+    EXPECT_EQ(channels[0].packets.size(), 90u);
+
+    channels[1].packets.assign(1, "b");
+    EXPECT_EQ(poller.Poll(8), 8u);
+    EXPECT_EQ(channels[0].packets.size(), 83u);
+    EXPECT_TRUE(channels[1].packets.empty());
+
+    // 预算小于 transport 数时轮换起始 transport
+    channels[1].packets.assign(100, "b");
+    EXPECT_EQ(poller.Poll(1) + poller.Poll(1), 2u);
+    EXPECT_EQ(channels[0].packets.size(), 82u);
+    EXPECT_EQ(channels[1].packets.size(), 99u);
+
+    ASSERT_TRUE(poller.SetWeight(0, 3));
+    EXPECT_EQ(poller.Poll(6), 6u);
+    EXPECT_EQ(channels[0].packets.size(), 79u);
+    EXPECT_EQ(channels[1].packets.size(), 96u);
+
+    const auto& info = ua::ServerStatistics::GetInst().Transport2Info();
+    EXPECT_EQ(info.at(0).recv_num, 21u);
+    EXPECT_EQ(info.at(1).recv_num, 11u);
+}
+
+// ==================== GidSerialScheduler 测试 ====================
+
+TEST(GidSerialSchedulerTest, OneInFlightPerGidRoundRobin)
+{
+    ua::GidSerialScheduler::Option option;
+    option.max_queue_per_gid = 2;
+    ua::GidSerialScheduler scheduler(option);
+
+    std::vector<std::string> dealt;
+    scheduler.SetProcFunc([&](uint64_t gid, const char* data, uint32_t len, uint64_t custom_data) {
+        dealt.push_back(std::to_string(gid) + std::string(data, len));
+        return custom_data != 1;  // custom_data 为 1 的模拟处理失败
+    });
+
+    EXPECT_TRUE(scheduler.OnRequest(1, 10, "a", 1, 0));
+    EXPECT_TRUE(scheduler.OnRequest(2, 10, "b", 1, 0));
+    EXPECT_FALSE(scheduler.OnRequest(3, 10, "c", 1, 0));  // 超过每 gid 上限
+    EXPECT_TRUE(scheduler.OnRequest(4, 20, "x", 1, 0));
+    EXPECT_TRUE(scheduler.OnRequest(5, 20, "y", 1, 0));
+    EXPECT_EQ(scheduler.TotalNum(), 4u);
+    EXPECT_EQ(scheduler.CacheNum(10), 2u);
+
+    // 每个 gid 同时只派发一个
+    EXPECT_EQ(scheduler.LoopOnce(0), 2u);
+    EXPECT_EQ(dealt, (std::vector<std::string>{"10a", "20x"}));
+    EXPECT_EQ(scheduler.LoopOnce(0), 0u);
+    EXPECT_EQ(scheduler.CacheNum(10), 1u);
+
+    // 处理中的 gid 再来请求也不就绪
+    EXPECT_TRUE(scheduler.OnRequest(6, 10, "c", 1, 0));
+    scheduler.OnResponse(20);
+    scheduler.OnResponse(10);
+    EXPECT_EQ(scheduler.LoopOnce(1), 1u);
+    EXPECT_EQ(dealt.back(), "20y");
+    EXPECT_EQ(scheduler.LoopOnce(0), 1u);
+    EXPECT_EQ(dealt.back(), "10b");
+
+    // 处理失败时立即放行
+    scheduler.OnResponse(20);
+    EXPECT_EQ(scheduler.GidNum(), 1u);
+    EXPECT_TRUE(scheduler.OnRequest(7, 30, "f", 1, 1));
+    EXPECT_TRUE(scheduler.OnRequest(8, 30, "g", 1, 0));
+    EXPECT_EQ(scheduler.LoopOnce(0), 2u);  // 30f 失败放行后 30g 重新就绪
+    EXPECT_EQ(dealt.back(), "30g");
+    EXPECT_EQ(scheduler.GetStat().proc_fail_num, 1u);
+
+    // 同步回包（非协程模式）也能继续派发
+    scheduler.SetProcFunc([&](uint64_t gid, const char* data, uint32_t len, uint64_t) {
+        dealt.push_back(std::to_string(gid) + std::string(data, len));
+        scheduler.OnResponse(gid);
+        return true;
+    });
+    scheduler.OnResponse(10);
+    scheduler.OnResponse(30);
+    EXPECT_EQ(scheduler.LoopOnce(0), 1u);
+    EXPECT_EQ(dealt.back(), "10c");
+    EXPECT_EQ(scheduler.GidNum(), 0u);
+    EXPECT_EQ(scheduler.TotalNum(), 0u);
+    EXPECT_EQ(scheduler.Arena().UsedNum(), 0u);
+
+    scheduler.OnResponse(99);
+    EXPECT_EQ(scheduler.GetStat().unknown_rsp_num, 1u);
+}
+
+TEST(GidSerialSchedulerTest, GidTableChurn)
+{
+    // 表初始很小，gid 反复进出时扩容、向后移位删除后仍能查到所有活跃 gid
+    ua::GidSerialScheduler::Option option;
+    option.expect_gid_num = 4;
+    ua::GidSerialScheduler scheduler(option);
+    std::vector<uint64_t> in_flight;
+    scheduler.SetProcFunc([&](uint64_t gid, const char*, uint32_t, uint64_t) {
+        in_flight.push_back(gid);
+        return true;
+    });
+
+    std::mt19937_64 rng(7);
+    std::map<uint64_t, size_t> expect;  // gid -> 未派发的请求数
+    for (uint32_t round = 0; round < 200; ++round)
+    {
+        for (uint32_t i = 0; i < 50; ++i)
+        {
+            // 相邻 gid 容易落在同一探测链上
+            uint64_t gid = (rng() % 300) << (round % 2 ? 0 : 32);
+            ASSERT_TRUE(scheduler.OnRequest(i, gid, "p", 1, 0));
+            ++expect[gid];
+        }
+        uint32_t dispatch_num = scheduler.LoopOnce(0);
+        ASSERT_EQ(dispatch_num, in_flight.size());
+        for (uint64_t gid : in_flight)
+        {
+            if (--expect[gid] == 0)
+                expect.erase(gid);
+        }
+        for (const auto& [gid, num] : expect)
+            ASSERT_EQ(scheduler.CacheNum(gid), num);
+        for (uint64_t gid : in_flight)
+            scheduler.OnResponse(gid);
+        in_flight.clear();
+        ASSERT_EQ(scheduler.GidNum(), expect.size());
+    }
+    while (scheduler.LoopOnce(0) > 0)
+    {
+        for (uint64_t gid : in_flight)
+            scheduler.OnResponse(gid);
+        in_flight.clear();
+    }
+    EXPECT_EQ(scheduler.GidNum(), 0u);
+    EXPECT_EQ(scheduler.TotalNum(), 0u);
+    EXPECT_EQ(scheduler.GetStat().unknown_rsp_num, 0u);
+}
+
+TEST(GidSerialSchedulerTest, ArenaReusesBlocks)
+{
+    ua::PkgArena arena;
+    std::string big(100 * 1024, 'z');
+    auto* small = arena.Alloc("abc", 3);
+    auto* large = arena.Alloc(big.data(), static_cast<uint32_t>(big.size()));
+    EXPECT_EQ(std::string(small->data(), small->len), "abc");
+    EXPECT_EQ(std::string(large->data(), large->len), big);
+    size_t reserved = arena.ReservedBytes();
+    arena.Free(large);
+    arena.Free(small);
+    EXPECT_EQ(arena.UsedNum(), 0u);
+
+    // 同级别的块复用，不再向系统要内存
+    auto* again = arena.Alloc("xyz", 3);
+    EXPECT_EQ(again, small);
+    EXPECT_LT(arena.ReservedBytes(), reserved);
+    arena.Free(again);
+}
+
+TEST(GidSerialSchedulerTest, EdfWithFairnessAndExpiredDrop)
+{
+    uint64_t now_ms = ua::utils::CurrentRealMilliSec();
+    ua::Clock::GetInst().Update(now_ms * 1000);
+    ua::ServerStatistics::GetInst().ClearStatistics();
+
+    ua::GidSerialScheduler::Option option;
+    option.mode = ua::GidSerialScheduler::Mode::kEdf;
+    option.edf_fair_num = 3;
+    ua::GidSerialScheduler scheduler(option);
+
+    std::vector<uint64_t> dealt;
+    scheduler.SetProcFunc([&](uint64_t gid, const char*, uint32_t, uint64_t) {
+        dealt.push_back(gid);
+        return true;
+    });
+
+    auto meta = [&](uint64_t deadline_offset) {
+        return ua::IScheduler::ReqMeta{0x100, deadline_offset ? now_ms + deadline_offset : 0};
+    };
+    // 入队时已过期：直接丢弃，不算失败
+    EXPECT_TRUE(scheduler.OnRequest(0, 9, "e", 1, 0, ua::IScheduler::ReqMeta{0x100, now_ms - 1}));
+    EXPECT_EQ(scheduler.TotalNum(), 0u);
+
+    EXPECT_TRUE(scheduler.OnRequest(1, 1, "a", 1, 0, meta(0)));     // 不过期，最先就绪
+    EXPECT_TRUE(scheduler.OnRequest(2, 2, "b", 1, 0, meta(500)));
+    EXPECT_TRUE(scheduler.OnRequest(3, 3, "c", 1, 0, meta(100)));
+    EXPECT_TRUE(scheduler.OnRequest(4, 4, "d", 1, 0, meta(300)));
+    EXPECT_TRUE(scheduler.OnRequest(5, 5, "f", 1, 0, meta(200)));
+
+    // 最早过期先派发，第 3 次按就绪顺序选最早就绪的 gid 1
+    EXPECT_EQ(scheduler.LoopOnce(0), 5u);
+    EXPECT_EQ(dealt, (std::vector<uint64_t>{3, 5, 1, 4, 2}));
+
+    // 排队期间过期的请求在派发前丢弃，同一 gid 的后续请求照常处理
+    dealt.clear();
+    for (uint64_t gid = 1; gid <= 5; ++gid)
+        scheduler.OnResponse(gid);
+    EXPECT_TRUE(scheduler.OnRequest(6, 6, "g", 1, 0, meta(10)));
+    EXPECT_TRUE(scheduler.OnRequest(7, 6, "h", 1, 0, meta(50)));
+    EXPECT_TRUE(scheduler.OnRequest(8, 7, "i", 1, 0, meta(10)));
+    ua::Clock::GetInst().Update((now_ms + 20) * 1000);
+    EXPECT_EQ(scheduler.LoopOnce(0), 1u);
+    EXPECT_EQ(dealt, (std::vector<uint64_t>{6}));
+    EXPECT_EQ(scheduler.GetStat().expire_drop_num, 3u);
+    EXPECT_EQ(scheduler.GidNum(), 1u);
+    EXPECT_EQ(ua::ServerStatistics::GetInst().RecvCmd2Info().at(0x100).expire_drop, 3u);
+
+    ua::Clock::GetInst().Update(ua::utils::CurrentRealMicroSec());
+}
+
+// ==================== WfqScheduler 测试 ====================
+
+TEST(WfqSchedulerTest, WeightsCapsAndDropPolicies)
+{
+    ua::Clock::GetInst().Update(ua::utils::CurrentRealMicroSec());
+    ua::ServerStatistics::GetInst().ClearStatistics();
+    constexpr uint32_t kLightCmd = 0x10;
+    constexpr uint32_t kHeavyCmd = 0x20;
+
+    ua::WfqScheduler::Option option;
+    option.classes.resize(2);
+    option.classes[0].weight = 4;
+    option.classes[1].weight = 1;
+    option.classes[1].max_concurrency = 1;
+    option.classes[1].max_queue_len = 3;
+    option.cmd_class = {{kLightCmd, 0}, {kHeavyCmd, 1}};
+    ua::WfqScheduler scheduler;
+    std::string err_msg;
+    ASSERT_TRUE(scheduler.Init(option, &err_msg)) << err_msg;
+    EXPECT_EQ(scheduler.ClassOf(0x99), 0u);
+
+    std::vector<std::string> dealt;
+    scheduler.SetProcFunc([&](uint64_t, const char* data, uint32_t len, uint64_t) {
+        dealt.emplace_back(data, len);
+        return true;
+    });
+    ua::IScheduler::ReqMeta heavy{kHeavyCmd, 0};
+    ua::IScheduler::ReqMeta light{kLightCmd, 0};
+
+    // 重 cmd 先到也不会挡住轻 cmd
+    EXPECT_TRUE(scheduler.OnRequest(1, 100, "H1", 2, 0, heavy));
+    EXPECT_TRUE(scheduler.OnRequest(2, 101, "H2", 2, 0, heavy));
+    EXPECT_TRUE(scheduler.OnRequest(3, 102, "H3", 2, 0, heavy));
+    EXPECT_FALSE(scheduler.OnRequest(4, 103, "H4", 2, 0, heavy));  // 超过排队上限，拒绝新请求
+    for (int i = 1; i <= 4; ++i)
+        EXPECT_TRUE(scheduler.OnRequest(10 + i, 200 + i, ("L" + std::to_string(i)).c_str(), 2, 0, light));
+    EXPECT_EQ(scheduler.CacheNum(201), 1u);
+
+    // 权重 4:1，重 cmd 并发上限 1
+    EXPECT_EQ(scheduler.LoopOnce(0), 5u);
+    EXPECT_EQ(dealt, (std::vector<std::string>{"L1", "L2", "L3", "L4", "H1"}));
+    EXPECT_EQ(scheduler.InFlightNum(1), 1u);
+    EXPECT_EQ(scheduler.QueueNum(1), 2u);
+    EXPECT_EQ(scheduler.LoopOnce(0), 0u);
+
+    scheduler.OnResponse(100);
+    EXPECT_EQ(scheduler.LoopOnce(0), 1u);
+    EXPECT_EQ(dealt.back(), "H2");
+
+    // 丢弃最老的请求
+    ua::WfqScheduler::Option drop_option;
+    drop_option.classes.resize(1);
+    drop_option.classes[0].max_queue_len = 2;
+    drop_option.classes[0].drop_policy = ua::WfqScheduler::DropPolicy::kDropOldest;
+    ua::WfqScheduler drop_scheduler;
+    ASSERT_TRUE(drop_scheduler.Init(drop_option));
+    drop_scheduler.SetProcFunc([&](uint64_t, const char* data, uint32_t len, uint64_t) {
+        dealt.emplace_back(data, len);
+        return false;  // 处理失败也归还并发
+    });
+    dealt.clear();
+    EXPECT_TRUE(drop_scheduler.OnRequest(1, 1, "a", 1, 0));
+    EXPECT_TRUE(drop_scheduler.OnRequest(2, 1, "b", 1, 0));
+    EXPECT_TRUE(drop_scheduler.OnRequest(3, 1, "c", 1, 0));
+    EXPECT_EQ(drop_scheduler.LoopOnce(0), 2u);
+    EXPECT_EQ(dealt, (std::vector<std::string>{"b", "c"}));
+    EXPECT_EQ(drop_scheduler.InFlightNum(0), 0u);
+
+    const auto& info = ua::ServerStatistics::GetInst().SchedClass2Info();
+    EXPECT_EQ(info.at(0).dispatch_num, 6u);
+    EXPECT_EQ(info.at(0).drop_num, 1u);
+    EXPECT_EQ(info.at(1).dispatch_num, 2u);
+    EXPECT_EQ(info.at(1).drop_num, 1u);
+    EXPECT_EQ(info.at(1).service_cost_map.size(), 1u);
+
+    ua::WfqScheduler bad;
+    option.cmd_class[0x30] = 5;
+    EXPECT_FALSE(bad.Init(option));
+}
+
+TEST(WfqSchedulerTest, ResponseBySeqReleasesMatchingClass)
+{
+    ua::Clock::GetInst().Update(ua::utils::CurrentRealMicroSec());
+    ua::ServerStatistics::GetInst().ClearStatistics();
+    ua::WfqScheduler::Option option;
+    option.classes.resize(2);
+    option.classes[0].weight = 4;
+    option.classes[1].max_concurrency = 1;
+    option.cmd_class = {{0x10, 0}, {0x20, 1}};
+    ua::WfqScheduler scheduler;
+    ASSERT_TRUE(scheduler.Init(option));
+
+    std::vector<uint64_t> seqs;
+    scheduler.SetProcFunc([&](uint64_t, const char*, uint32_t, uint64_t) {
+        seqs.push_back(scheduler.DispatchingSeq());
+        return true;
+    });
+
+    // 同一 gid 两个类别各一个在途请求，轻的先派发
+    EXPECT_TRUE(scheduler.OnRequest(1, 7, "H", 1, 0, ua::IScheduler::ReqMeta{0x20, 0}));
+    EXPECT_TRUE(scheduler.OnRequest(2, 7, "L", 1, 0, ua::IScheduler::ReqMeta{0x10, 0}));
+    EXPECT_TRUE(scheduler.OnRequest(3, 8, "H", 1, 0, ua::IScheduler::ReqMeta{0x20, 0}));
+    EXPECT_EQ(scheduler.LoopOnce(0), 2u);
+    EXPECT_EQ(seqs, (std::vector<uint64_t>{2, 1}));
+    EXPECT_EQ(scheduler.DispatchingSeq(), 0u);
+
+    // 重的先处理完：按 seq 归还重类别，不是按派发顺序归还轻类别
+    scheduler.OnResponse(7, 1);
+    EXPECT_EQ(scheduler.InFlightNum(1), 0u);
+    EXPECT_EQ(scheduler.InFlightNum(0), 1u);
+    EXPECT_EQ(scheduler.LoopOnce(0), 1u);
+    EXPECT_EQ(seqs.back(), 3u);
+
+    // 不认识的 seq 不归还任何请求
+    scheduler.OnResponse(7, 99);
+    EXPECT_EQ(scheduler.InFlightNum(0), 1u);
+    scheduler.OnResponse(7, 2);
+    scheduler.OnResponse(8, 3);
+    EXPECT_EQ(scheduler.InFlightNum(0), 0u);
+    EXPECT_EQ(scheduler.InFlightNum(1), 0u);
+    EXPECT_EQ(ua::ServerStatistics::GetInst().SchedClass2Info().at(1).service_cost_map.begin()->second, 2u);
+}
+
+// ==================== StackfulCoroutine 测试 ====================
+
+TEST(StackfulCoroutineTest, SpawnYieldResumeOrder)
+{
+    ua::StackfulCoroutine coroutine;
+    std::vector<int> trace;
+    ua::Coro* coro = nullptr;
+
+    EXPECT_EQ(coroutine.ThisCoro(), nullptr);
+    ASSERT_TRUE(coroutine.Spawn([&]() {
+        coro = coroutine.ThisCoro();
+        trace.push_back(1);
+        coro->Yield();
+        trace.push_back(3);
+        coro->Yield();
+        trace.push_back(5);
+    }));
+    // Spawn 立即执行到第一次 Yield
+    trace.push_back(2);
+    ASSERT_NE(coro, nullptr);
+    EXPECT_EQ(coroutine.ThisCoro(), nullptr);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 1u);
+    coro->Resume();
+    trace.push_back(4);
+    coro->Resume();
+    EXPECT_EQ(trace, (std::vector<int>{1, 2, 3, 4, 5}));
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+
+    // C 风格入口，浮点运算跨切换
+    static double value = 0;
+    double input = 1.5;
+    ASSERT_TRUE(coroutine.Spawn([](void* args) { value = *static_cast<double*>(args) * 2; }, &input));
+    EXPECT_DOUBLE_EQ(value, 3.0);
+}
+
+TEST(StackfulCoroutineTest, NestedResumeAndLimit)
+{
+    ua::StackfulCoroutine coroutine;
+    std::vector<int> trace;
+    ua::Coro* outer = nullptr;
+    ua::Coro* inner = nullptr;
+
+    ASSERT_TRUE(coroutine.Spawn([&]() {
+        outer = coroutine.ThisCoro();
+        ASSERT_TRUE(coroutine.Spawn([&]() {
+            inner = coroutine.ThisCoro();
+            trace.push_back(1);
+            inner->Yield();
+            trace.push_back(4);
+        }));
+        // 内层 Yield 回到外层协程
+        EXPECT_EQ(coroutine.ThisCoro(), outer);
+        trace.push_back(2);
+        outer->Yield();
+        inner->Resume();
+        EXPECT_EQ(coroutine.ThisCoro(), outer);
+        trace.push_back(5);
+    }));
+    trace.push_back(3);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 2u);
+
+    coroutine.SetMaxCoroNum(2);
+    EXPECT_FALSE(coroutine.Spawn([]() {}));
+
+    outer->Resume();
+    EXPECT_EQ(trace, (std::vector<int>{1, 2, 3, 4, 5}));
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    EXPECT_EQ(coroutine.ThisCoro(), nullptr);
+}
+
+TEST(StackfulCoroutineTest, PooledCoroAndStackReuse)
+{
+    ua::StackfulCoroutine::Option option;
+    option.stack_size = 64 * 1024;
+    ua::StackfulCoroutine coroutine(option);
+
+    int sum = 0;
+    ASSERT_TRUE(coroutine.Spawn([&]() { ++sum; }));
+    size_t mapped = coroutine.StackPool().MappedBytes();
+    EXPECT_GT(mapped, option.stack_size);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_TRUE(coroutine.Spawn([&]() {
+            // 栈上使用一些空间
+            char buf[4096];
+            std::memset(buf, i & 0xff, sizeof(buf));
+            sum += buf[100] == static_cast<char>(i & 0xff) ? 1 : 0;
+        }));
+    }
+    EXPECT_EQ(sum, 1001);
+    EXPECT_EQ(coroutine.GetTotalCoro(), 1u);
+    EXPECT_EQ(coroutine.StackPool().MappedBytes(), mapped);
+    EXPECT_EQ(coroutine.StackPool().UsedNum(), 1u);
+
+    // 异常不会跨出协程
+    ASSERT_TRUE(coroutine.Spawn([]() { throw std::runtime_error("test"); }));
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+}
+
+TEST(StackfulCoroutineTest, SharedStackSwapsSuspendedCoroutines)
+{
+    ua::StackfulCoroutine::Option option;
+    option.mode = ua::CoroStackMode::kShared;
+    option.stack_size = 256 * 1024;
+    option.shared_stack_num = 2;
+    ua::StackfulCoroutine coroutine(option);
+    EXPECT_TRUE(coroutine.StackShared());
+
+    constexpr int kCoroNum = 200;
+    std::vector<ua::Coro*> coros(kCoroNum, nullptr);
+    int ok_num = 0;
+    for (int i = 0; i < kCoroNum; ++i)
+    {
+        ASSERT_TRUE(coroutine.Spawn([&, i]() {
+            // 栈上的数据在换出、换入后保持不变
+            char buf[1024];
+            std::memset(buf, i & 0xff, sizeof(buf));
+            // 防止优化掉栈上的数组
+            asm volatile("" : : "r"(buf) : "memory");
+            coros[i] = coroutine.ThisCoro();
+            coros[i]->Yield();
+            asm volatile("" : : "r"(buf) : "memory");
+            bool same = buf[0] == static_cast<char>(i & 0xff) && buf[sizeof(buf) - 1] == buf[0];
+            coros[i]->Yield();
+            ok_num += same ? 1 : 0;
+        }));
+    }
+    EXPECT_EQ(coroutine.GetRunningCoro(), static_cast<size_t>(kCoroNum));
+    // 除了还占着两个共享栈的协程，其余都已换出，每个只保存实际用到的栈
+    EXPECT_GT(coroutine.SavedStackBytes(), static_cast<size_t>(kCoroNum - 2) * 1024);
+    EXPECT_LT(coroutine.SavedStackBytes(), static_cast<size_t>(kCoroNum) * 4096);
+    EXPECT_LT(coroutine.StackPool().MappedBytes(), 2 * option.stack_size + 128 * 1024);
+
+    // 倒序恢复两轮
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int i = kCoroNum - 1; i >= 0; --i)
+            coros[i]->Resume();
+    }
+    EXPECT_EQ(ok_num, kCoroNum);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    EXPECT_EQ(coroutine.SavedStackBytes(), 0u);
+    EXPECT_GT(coroutine.StackCopyNum(), static_cast<uint64_t>(kCoroNum));
+
+    // 同一共享栈上的协程互相 Resume
+    option.shared_stack_num = 1;
+    ua::StackfulCoroutine single(option);
+    std::vector<int> trace;
+    ua::Coro* inner = nullptr;
+    ASSERT_TRUE(single.Spawn([&]() {
+        int outer_value = 11;
+        ASSERT_TRUE(single.Spawn([&]() {
+            int inner_value = 22;
+            inner = single.ThisCoro();
+            inner->Yield();
+            trace.push_back(inner_value);
+        }));
+        trace.push_back(outer_value);
+        inner->Resume();
+        trace.push_back(outer_value + 1);
+    }));
+    EXPECT_EQ(trace, (std::vector<int>{11, 22, 12}));
+    EXPECT_EQ(single.GetRunningCoro(), 0u);
+}
+
+TEST(StackfulCoroutineTest, SharedStackPendingRunsCallbackAfterResume)
+{
+    ua::StackfulCoroutine::Option option;
+    option.mode = ua::CoroStackMode::kShared;
+    option.shared_stack_num = 1;
+    ua::StackfulCoroutine coroutine(option);
+    ua::CoroMgr::SetCoroutine(&coroutine);
+    ua::ContextController ctrl;
+    ctrl.Init(&coroutine);
+    EXPECT_TRUE(ctrl.StackShared());
+
+    std::vector<int32_t> results;
+    for (uint64_t seq_id : {101, 102})
+    {
+        ASSERT_TRUE(coroutine.Spawn([&, seq_id]() {
+            // 回调写协程栈上的变量：共享栈下推迟到恢复后执行
+            int32_t rsp = -1;
+            auto client_ctx = std::make_unique<ua::ClientContext>();
+            int32_t ret = ctrl.Pending(seq_id, 1000, client_ctx.get(),
+                                       ua::AsyncTask([&rsp](int32_t ret_code, ua::ServerContext*) { rsp = ret_code; }));
+            results.push_back(ret == ua::RPC_SUCCESS ? rsp : ret);
+        }));
+    }
+    EXPECT_EQ(coroutine.GetRunningCoro(), 2u);
+
+    ua::ClientContext* ctx = ctrl.Awake(101, 7);
+    ASSERT_NE(ctx, nullptr);
+    ctx->Run();
+    ctx = ctrl.Awake(102, 9);
+    ASSERT_NE(ctx, nullptr);
+    ctx->Run();
+    EXPECT_EQ(results, (std::vector<int32_t>{7, 9}));
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    ua::CoroMgr::SetCoroutine(nullptr);
+}
+
+TEST(StackfulCoroutineTest, PendingOutsideCoroutineRejected)
+{
+    ua::StackfulCoroutine coroutine;
+    ua::CoroMgr::SetCoroutine(&coroutine);
+    ua::ContextController ctrl;
+    ctrl.Init(&coroutine);
+
+    // 非阻塞处理函数直接在主栈上执行，不能挂起
+    ua::ClientContext client_ctx;
+    int32_t ret = ua::RPC_SUCCESS;
+    EXPECT_DEBUG_DEATH(ret = ctrl.Pending(201, 1000, &client_ctx, ua::AsyncTask(nullptr)), "pending outside coroutine");
+#ifdef NDEBUG
+    EXPECT_EQ(ret, ua::RPC_SYS_ERR);
+#endif
+    EXPECT_EQ(ctrl.PendingContextNum(), 0u);
+
+    // 协程里正常挂起
+    ASSERT_TRUE(coroutine.Spawn([&]() { ret = ctrl.Pending(202, 1000, &client_ctx, ua::AsyncTask(nullptr)); }));
+    EXPECT_EQ(ctrl.PendingContextNum(), 1u);
+    ctrl.Awake(202, ua::RPC_SUCCESS)->Run();
+    EXPECT_EQ(ret, ua::RPC_SUCCESS);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    ua::CoroMgr::SetCoroutine(nullptr);
+}
+
+// ==================== Task 测试 ====================
+
+ua::Task<int> AddLater(ua::ContextController& ctrl, uint64_t seq_id, int base)
+{
+    ua::ClientContext client_ctx;
+    int32_t ret = co_await ctrl.PendingAwait(seq_id, 1000, &client_ctx);
+    co_return base + ret;
+}
+
+ua::Task<void> ThrowAfter(ua::Task<int> inner)
+{
+    int value = co_await std::move(inner);
+    if (value > 0)
+        throw std::runtime_error("task error");
+}
+
+TEST(TaskTest, NestedAwaitPendingAndPooledFrames)
+{
+    ua::ContextController ctrl;
+    ctrl.Init(nullptr);
+
+    // 惰性启动：未 co_await 的任务不执行
+    bool run = false;
+    auto lazy = [&run]() -> ua::Task<void> {
+        run = true;
+        co_return;
+    }();
+    EXPECT_FALSE(run);
+
+    std::vector<int> results;
+    auto handler = [&](uint64_t seq_id) -> ua::Task<int> {
+        int first = co_await AddLater(ctrl, seq_id, 100);
+        int second = co_await AddLater(ctrl, seq_id + 1000, first);
+        co_return second;
+    };
+    for (uint64_t seq_id : {1, 2})
+    {
+        ua::StartTask(handler(seq_id), [&results](std::exception_ptr error, int value) {
+            results.push_back(error ? -1 : value);
+        });
+    }
+    EXPECT_EQ(ctrl.PendingContextNum(), 2u);
+    EXPECT_TRUE(results.empty());
+
+    // 唤醒顺序与挂起顺序无关
+    ctrl.Awake(2, 5)->Run();
+    ctrl.Awake(1, 3)->Run();
+    ctrl.Awake(1001, 10)->Run();
+    EXPECT_EQ(results, (std::vector<int>{113}));
+    ctrl.Awake(1002, 20)->Run();
+    EXPECT_EQ(results, (std::vector<int>{113, 125}));
+    EXPECT_EQ(ctrl.PendingContextNum(), 0u);
+
+    // 异常在 co_await 处抛出，顶层异常交给 on_done
+    std::exception_ptr caught;
+    ua::StartTask(ThrowAfter(AddLater(ctrl, 7, 1)), [&caught](std::exception_ptr error) { caught = error; });
+    ctrl.Awake(7, 0)->Run();
+    EXPECT_NE(caught, nullptr);
+
+    // 超时同样恢复协程
+    int timeout_ret = 0;
+    ua::StartTask(AddLater(ctrl, 8, 0), [&timeout_ret](std::exception_ptr, int value) { timeout_ret = value; });
+    ctrl.ProcTimeOut(ua::Clock::GetInst().CurrentMilliSec() + 2000);
+    EXPECT_EQ(timeout_ret, ua::RPC_TIME_OUT);
+
+    // 帧复用：热路径上不再向系统申请
+    uint64_t sys_alloc = ua::TaskFramePool::SysAllocNum();
+    for (uint64_t seq_id = 100; seq_id < 200; ++seq_id)
+    {
+        ua::StartTask(handler(seq_id), [](std::exception_ptr, int) {});
+        ctrl.Awake(seq_id, 0)->Run();
+        ctrl.Awake(seq_id + 1000, 0)->Run();
+    }
+    EXPECT_EQ(ua::TaskFramePool::SysAllocNum(), sys_alloc);
+    EXPECT_GT(ua::TaskFramePool::FreeNum(), 0u);
+}
+
+// ==================== PendingTable 测试 ====================
+
+TEST(PendingTableTest, SlotGenerationAndCoarseTimeout)
+{
+    ua::PendingTable table(10, 8);
+    ua::ClientContext ctx_a;
+    ua::ClientContext ctx_b;
+
+    // 取号后挂起，回包直接按槽定位
+    uint64_t seq_a = table.Reserve(1000);
+    EXPECT_TRUE(ua::PendingTable::IsTableID(seq_a));
+    EXPECT_EQ(table.ReservedNum(), 1u);
+    ASSERT_TRUE(table.Add(seq_a, &ctx_a, 1005));
+    EXPECT_FALSE(table.Add(seq_a, &ctx_b, 1005));  // 重复挂起
+    EXPECT_EQ(table.PendingNum(), 1u);
+    EXPECT_EQ(table.Remove(seq_a), &ctx_a);
+    EXPECT_EQ(table.Remove(seq_a), nullptr);  // 重复回包
+
+    // 槽复用后代数不同，旧 seq_id 查不到
+    uint64_t seq_b = 0;
+    ASSERT_TRUE(table.Add(seq_b, &ctx_b, 1005));
+    EXPECT_EQ(seq_b & 0xFFFFFFFFu, seq_a & 0xFFFFFFFFu);
+    EXPECT_NE(seq_b, seq_a);
+    EXPECT_FALSE(table.Contains(seq_a));
+    EXPECT_EQ(table.SlotNum(), 1u);
+
+    // 调用方自带的 seq_id 走兼容索引
+    uint64_t foreign = 77;
+    ASSERT_TRUE(table.Add(foreign, &ctx_a, 1025));
+    EXPECT_EQ(foreign, 77u);
+    EXPECT_FALSE(table.Add(foreign, &ctx_a, 1025));
+
+    // 未挂起的预留到期自动释放；超时按 10ms 向上取整，不提前
+    uint64_t reserved = table.Reserve(1001);
+    std::vector<uint64_t> expired;
+    table.Expire(1000, expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_EQ(table.NextExpireTime(), 1010u);
+    table.Expire(1010, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>{seq_b});
+    EXPECT_EQ(table.ReservedNum(), 0u);
+    EXPECT_EQ(table.Remove(seq_b), &ctx_b);
+    table.Release(reserved);
+
+    // 跨过多圈也能找到到期的项
+    expired.clear();
+    table.Expire(5000, expired);
+    EXPECT_EQ(expired, std::vector<uint64_t>{77});
+    EXPECT_EQ(table.Remove(77), &ctx_a);
+    EXPECT_EQ(table.PendingNum(), 0u);
+    EXPECT_EQ(table.NextExpireTime(), 0u);
+}
+
+TEST(PendingTableTest, IDsDifferAcrossTables)
+{
+    // 两张表模拟两个分片（或重启前后的同一进程）：槽号都从 0 开始，但代数随机，对方的 seq_id 查不到
+    constexpr uint32_t kNum = 64;
+    ua::PendingTable shard_a;
+    ua::PendingTable shard_b;
+    ua::ClientContext ctx_a;
+    ua::ClientContext ctx_b;
+    std::vector<uint64_t> ids_a;
+    std::vector<uint64_t> ids_b;
+    for (uint32_t i = 0; i < kNum; ++i)
+    {
+        uint64_t seq_a = 0;
+        uint64_t seq_b = 0;
+        ASSERT_TRUE(shard_a.Add(seq_a, &ctx_a, 1000));
+        ASSERT_TRUE(shard_b.Add(seq_b, &ctx_b, 1000));
+        EXPECT_EQ(seq_a & 0xFFFFFFFFu, seq_b & 0xFFFFFFFFu);
+        EXPECT_NE(seq_a, seq_b);
+        ids_a.push_back(seq_a);
+        ids_b.push_back(seq_b);
+    }
+    for (uint32_t i = 0; i < kNum; ++i)
+    {
+        EXPECT_FALSE(shard_b.Contains(ids_a[i]));
+        EXPECT_EQ(shard_b.Remove(ids_a[i]), nullptr);
+        EXPECT_EQ(shard_a.Remove(ids_b[i]), nullptr);
+    }
+    EXPECT_EQ(shard_a.PendingNum(), kNum);
+    EXPECT_EQ(shard_b.PendingNum(), kNum);
+
+    // 重启后新建的表同样认不出旧表的 seq_id
+    ua::PendingTable restarted;
+    uint64_t seq_new = 0;
+    ASSERT_TRUE(restarted.Add(seq_new, &ctx_b, 1000));
+    EXPECT_EQ(restarted.Remove(ids_a[0]), nullptr);
+    EXPECT_EQ(restarted.Remove(seq_new), &ctx_b);
+}
+
+TEST(PendingTableTest, ControllerDropsStaleResponse)
+{
+    ua::ContextController ctrl;
+    ctrl.Init(nullptr);
+    ua::ServerContext server_ctx;
+    server_ctx.SetCallback([](int32_t) {});
+    ua::ContextMgr::SetCurrServerContext(&server_ctx);
+
+    int32_t result = 0;
+    auto* client_ctx = new ua::ClientContext;
+    uint64_t seq_id = ctrl.AllocSeqID(100);
+    ASSERT_EQ(ctrl.Pending(seq_id, 100, client_ctx,
+                           ua::AsyncTask([&result](int32_t ret, ua::ServerContext*) { result = ret; },
+                                         [client_ctx]() { delete client_ctx; })),
+              ua::RPC_SUCCESS);
+    EXPECT_EQ(ctrl.PendingContextNum(), 1u);
+    EXPECT_GT(ctrl.NextExpireTime(), 0u);
+
+    EXPECT_EQ(ctrl.ProcTimeOut(ua::Clock::GetInst().CurrentMilliSec() + 200), 1u);
+    EXPECT_EQ(result, ua::RPC_TIME_OUT);
+    // 超时后迟到的回包，以及复用了同一槽后的旧 seq_id，都被丢弃
+    EXPECT_EQ(ctrl.Awake(seq_id, ua::RPC_SUCCESS), nullptr);
+    uint64_t next_id = ctrl.AllocSeqID(100);
+    EXPECT_EQ(ctrl.Awake(seq_id, ua::RPC_SUCCESS), nullptr);
+    ctrl.ReleaseSeqID(next_id);
+    EXPECT_EQ(ctrl.PendingContextNum(), 0u);
+    ua::ContextMgr::SetCurrServerContext(nullptr);
+}
+
+// ==================== ContextPool 测试 ====================
+
+TEST(ContextPoolTest, RecycleReusesObjects)
+{
+    using Pool = ua::ContextPool<ua::ClientContext>;
+    ua::ClientContext* first = Pool::New();
+    uint64_t first_id = first->id;
+    size_t free_num = Pool::FreeNum();
+    Pool::Delete(first);
+    EXPECT_EQ(Pool::FreeNum(), free_num + 1);
+
+    // 复用同一块内存，重新构造
+    ua::ClientContext* second = Pool::New();
+    EXPECT_EQ(second, first);
+    EXPECT_GT(second->id, first_id);
+    EXPECT_EQ(second->ret_code, 0);
+    Pool::Delete(second);
+
+    {
+        auto ptr = Pool::MakeUnique();
+        EXPECT_EQ(ptr.get(), first);
+    }
+    EXPECT_EQ(Pool::FreeNum(), free_num + 1);
+}
+
+TEST(ContextPoolTest, TimerEventSteadyStateNoAlloc)
+{
+    ua::StackfulCoroutine coroutine;
+    ua::CoroMgr::SetCoroutine(&coroutine);
+    uint64_t now = ua::Clock::GetInst().CurrentMilliSec();
+    for (bool use_coroutine : {false, true})
+    {
+        ua::TimeoutDecorator decorator;
+        decorator.Init(use_coroutine);
+        int run_num = 0;
+        auto fire = [&]() {
+            (void)decorator.AddEvent(42, [&run_num]() { ++run_num; return 0; }, now);
+            decorator.ProcTimeOut(now);
+        };
+
+        fire();
+        uint64_t alloc_num = AllocNum();
+        for (int i = 0; i < 100; ++i)
+            fire();
+        EXPECT_EQ(run_num, 101);
+        EXPECT_EQ(AllocNum() - alloc_num, 0u) << "use_coroutine " << use_coroutine;
+        EXPECT_GE(ua::ContextPool<ua::ServerContext>::FreeNum(), 1u);
+    }
+    ua::CoroMgr::SetCoroutine(nullptr);
+}
+
+TEST(ContextPoolTest, RequestWithRpcSteadyStateNoAlloc)
+{
+    // 与 PBService::DealRequest 相同：池化上下文、内联回调、32 字节捕获的 Spawn；
+    // 处理函数里取号、协程挂起等回包，回包唤醒后结束请求
+    ua::StackfulCoroutine coroutine;
+    ua::CoroMgr::SetCoroutine(&coroutine);
+    ua::ContextController ctrl;
+    ctrl.Init(&coroutine);
+    uint32_t finish_num = 0;
+    uint64_t seq_id = 0;
+    int32_t rpc_ret = ua::RPC_SYS_ERR;
+    auto deal = [&](uint64_t gid) {
+        auto context = ua::ContextPool<ua::ServerContext>::MakeUnique();
+        auto* context_ptr = context.get();
+        context->gid = gid;
+        context->SetCallback([&finish_num](int32_t) { ++finish_num; },
+                             [context_ptr]() { ua::ContextPool<ua::ServerContext>::Delete(context_ptr); });
+        ASSERT_TRUE(ua::CoroMgr::GetInst().Spawn([&ctrl, &seq_id, &rpc_ret, context_ptr]() {
+            ua::ContextMgr::SetCurrServerContext(context_ptr);
+            seq_id = ctrl.AllocSeqID(1000);
+            ua::ClientContext client_ctx;
+            rpc_ret = ctrl.Pending(seq_id, 1000, &client_ctx, ua::AsyncTask([](int32_t, ua::ServerContext*) {}));
+            context_ptr->Run();
+        }));
+        context.release();
+        ctrl.Awake(seq_id, ua::RPC_SUCCESS)->Run();
+    };
+
+    deal(1);
+    uint64_t alloc_num = AllocNum();
+    for (uint64_t gid = 2; gid <= 100; ++gid)
+        deal(gid);
+    EXPECT_EQ(AllocNum() - alloc_num, 0u);
+    EXPECT_EQ(finish_num, 100u);
+    EXPECT_EQ(rpc_ret, ua::RPC_SUCCESS);
+    EXPECT_EQ(ctrl.PendingContextNum(), 0u);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    ua::ContextMgr::SetCurrServerContext(nullptr);
+    ua::CoroMgr::SetCoroutine(nullptr);
+}
+
+/// 与 PBClientContext 相同的布局：回包状态和业务回调放在上下文里
+struct RpcClientContext : public ua::ClientContext
+{
+    uint32_t cmd = 0;
+    uint64_t gid = 0;
+    uint64_t seq_id = 0;
+    int32_t* rsp = nullptr;
+    ua::AsyncTask::RpcCallback callback;
+    ua::AsyncTask::RecycleCallBack recycle_fun;
+};
+
+TEST(ContextPoolTest, AsyncRpcSteadyStateNoAlloc)
+{
+    ua::ContextController ctrl;
+    ctrl.Init(nullptr);
+    ua::ServerContext server_ctx;
+    server_ctx.SetCallback([](int32_t) {});
+    ua::ContextMgr::SetCurrServerContext(&server_ctx);
+    using Pool = ua::ContextPool<ua::ClientContext>;
+
+    // 业务回调捕获不超过 std::function 的小对象缓冲，AsyncTask 移动进挂起上下文：不分配
+    int32_t result = ua::RPC_SYS_ERR;
+    auto rpc = [&]() {
+        auto* client_ctx = Pool::New();
+        uint64_t seq_id = ctrl.AllocSeqID(1000);
+        ASSERT_EQ(ctrl.Pending(seq_id, 1000, client_ctx,
+                               ua::AsyncTask([&result](int32_t ret, ua::ServerContext*) { result = ret; },
+                                             [client_ctx]() { Pool::Delete(client_ctx); })),
+                  ua::RPC_SUCCESS);
+        ctrl.Awake(seq_id, ua::RPC_SUCCESS)->Run();
+        ua::ContextMgr::SetCurrServerContext(&server_ctx);
+    };
+    rpc();
+    uint64_t alloc_num = AllocNum();
+    for (int i = 0; i < 100; ++i)
+        rpc();
+    EXPECT_EQ(AllocNum() - alloc_num, 0u);
+    EXPECT_EQ(result, ua::RPC_SUCCESS);
+
+    // 与 PBService::Rpc 相同：回包处理所需的状态和业务回调放在池化的客户端上下文里，
+    // 交给 ContextController 的闭包只捕获指针，不超过 std::function 的小对象缓冲
+    int32_t reply_num = 0;
+    auto wrapped_rpc = [&]() {
+        using RpcPool = ua::ContextPool<RpcClientContext>;
+        auto* client_ctx = RpcPool::New();
+        client_ctx->gid = 42;
+        client_ctx->cmd = 0x1001;
+        client_ctx->seq_id = ctrl.AllocSeqID(1000);
+        client_ctx->rsp = &reply_num;
+        client_ctx->callback = [&result](int32_t ret, ua::ServerContext*) { result = ret; };
+        uint64_t seq_id = client_ctx->seq_id;
+        ua::AsyncTask task_wrapper = {
+            [client_ctx](int32_t ret_code, ua::ServerContext* ctx) {
+                if (ret_code == ua::RPC_SUCCESS && client_ctx->gid && client_ctx->cmd)
+                    ++*client_ctx->rsp;
+                if (client_ctx->callback)
+                    client_ctx->callback(ret_code, ctx);
+            },
+            [client_ctx]() {
+                if (client_ctx->recycle_fun)
+                    client_ctx->recycle_fun();
+                RpcPool::Delete(client_ctx);
+            }};
+        ASSERT_EQ(ctrl.Pending(seq_id, 1000, client_ctx, std::move(task_wrapper)), ua::RPC_SUCCESS);
+        ctrl.Awake(seq_id, ua::RPC_SUCCESS)->Run();
+        ua::ContextMgr::SetCurrServerContext(&server_ctx);
+    };
+    wrapped_rpc();
+    alloc_num = AllocNum();
+    for (int i = 0; i < 100; ++i)
+        wrapped_rpc();
+    EXPECT_EQ(AllocNum() - alloc_num, 0u);
+    EXPECT_EQ(reply_num, 101);
+    EXPECT_EQ(ctrl.PendingContextNum(), 0u);
+    ua::ContextMgr::SetCurrServerContext(nullptr);
+}
+
+TEST(ContextPoolTest, TimerEventSlotHeldUntilTaskDone)
+{
+    ua::StackfulCoroutine coroutine;
+    ua::CoroMgr::SetCoroutine(&coroutine);
+    ua::TimeoutDecorator decorator;
+    decorator.Init(true);
+    uint64_t now = ua::Clock::GetInst().CurrentMilliSec();
+    int run_num = 0;
+
+    // 一次性定时器触发后协程挂起：定时器已摘除，事件槽仍被协程闭包引用
+    ua::Coro* suspended = nullptr;
+    (void)decorator.AddEvent(1, [&]() {
+        ++run_num;
+        suspended = ua::CoroMgr::ThisCoro();
+        suspended->Yield();
+        return 0;
+    }, now);
+    EXPECT_EQ(decorator.EventNum(), 1u);
+    EXPECT_EQ(decorator.ProcTimeOut(now), 1u);
+    ASSERT_NE(suspended, nullptr);
+    EXPECT_EQ(decorator.EventNum(), 1u);
+    suspended->Resume();
+    EXPECT_EQ(run_num, 1);
+    EXPECT_EQ(decorator.EventNum(), 0u);
+
+    // 循环定时器每次触发共用一个槽，取消后释放并析构闭包；空闲槽复用
+    auto token = std::make_shared<int>(0);
+    uint64_t timer_id = decorator.AddEvent(2, [&run_num, token]() { ++run_num; return 0; }, now, 10);
+    decorator.ProcTimeOut(now);
+    decorator.ProcTimeOut(now + 10);
+    EXPECT_EQ(run_num, 3);
+    EXPECT_EQ(decorator.EventNum(), 1u);
+    EXPECT_EQ(token.use_count(), 2);
+    EXPECT_TRUE(decorator.DelEvent(timer_id));
+    EXPECT_EQ(decorator.EventNum(), 0u);
+    EXPECT_EQ(token.use_count(), 1);
+    EXPECT_EQ(decorator.EventSlotNum(), 1u);
+    EXPECT_EQ(coroutine.GetRunningCoro(), 0u);
+    ua::CoroMgr::SetCoroutine(nullptr);
+}
+
+TEST(ContextPoolTest, TimerEventDroppedBySchedulerReleasesSlot)
+{
+    constexpr uint32_t kTimerType = 7;
+    ua::TimeoutDecorator decorator;
+    decorator.Init(false);
+    uint64_t now = ua::Clock::GetInst().CurrentMilliSec();
+    int run_num = 0;
+    auto token = std::make_shared<int>(0);
+    {
+        ua::WfqScheduler::Option option;
+        option.classes.resize(1);
+        option.classes[0].max_queue_len = 1;
+        option.classes[0].drop_policy = ua::WfqScheduler::DropPolicy::kDropOldest;
+        ua::WfqScheduler scheduler;
+        ASSERT_TRUE(scheduler.Init(option));
+        scheduler.SetProcFunc([&](uint64_t, const char* data, uint32_t len, uint64_t) {
+            return decorator.DealEvent(data, len);
+        });
+        scheduler.SetDropFunc([&](uint64_t, const char* data, uint32_t len, uint64_t custom_data) {
+            EXPECT_EQ(custom_data, kTimerType);
+            decorator.DropEvent(data, len);
+        });
+        decorator.SetReqScheduler(&scheduler, kTimerType);
+
+        // 循环定时器的第一次触发被第二次挤掉，槽只剩定时器和排队中的触发两个引用
+        uint64_t timer_id = decorator.AddEvent(3, [&run_num, token]() { ++run_num; return 0; }, now, 10);
+        decorator.ProcTimeOut(now);
+        decorator.ProcTimeOut(now + 10);
+        EXPECT_EQ(scheduler.QueueNum(0), 1u);
+        EXPECT_EQ(decorator.EventNum(), 1u);
+
+        // 取消后排队中的触发仍持有引用，调度器析构时丢弃并归还
+        EXPECT_TRUE(decorator.DelEvent(timer_id));
+        EXPECT_EQ(decorator.EventNum(), 1u);
+        EXPECT_EQ(token.use_count(), 2);
+    }
+    EXPECT_EQ(run_num, 0);
+    EXPECT_EQ(decorator.EventNum(), 0u);
+    EXPECT_EQ(token.use_count(), 1);
+}
+
 // ==================== SystemMgr 测试 ====================
 
 class MockSystemA : public ua::ISystem
@@ -1,9 +1,17 @@
 /// @file logger_test.cpp
-/// @brief Logger 模块单元测试
+/// @brief Logger 模块单元测试（含 AsyncLogger / BinaryLog / LogLevelTable / LogGidFilter / 限频宏）
 #include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <thread>
 #include <vector>
+#include "core/async_logger.h"
+#include "core/binary_log.h"
+#include "core/context.h"
+#include "core/flight_recorder.h"
 #include "core/logger.h"
 
 namespace ua::test
@@ -97,4 +105,469 @@ TEST(LoggerTest, ThreadLocalBufferIsolation)
     EXPECT_EQ(std::string(logger.GetBuff()), main_result);
 }
 
+namespace
+{
+
+uint32_t CountLines(const std::string& path)
+{
+    std::ifstream in(path);
+    std::string line;
+    uint32_t count = 0;
+    while (std::getline(in, line))
+        ++count;
+    return count;
+}
+
+}  // namespace
+
+TEST(AsyncLoggerTest, MultiThreadWriteAndFlush)
+{
+    std::string path = "/tmp/ua_test_async_logger_" + std::to_string(getpid()) + ".log";
+    unlink(path.c_str());
+
+    AsyncLogger::Option option;
+    option.sink.file_path = path;
+    option.ring_size = 64 * 1024;
+    option.full_policy = AsyncLogger::FullPolicy::Block;
+
+    auto& async_logger = AsyncLogger::GetInst();
+    std::string err_msg;
+    ASSERT_TRUE(async_logger.Start(option, &err_msg)) << err_msg;
+    EXPECT_FALSE(async_logger.Start(option));
+
+    constexpr int kThreads = 4;
+    constexpr int kLinesPerThread = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&async_logger, t]() {
+            char line[64];
+            for (int i = 0; i < kLinesPerThread; ++i)
+            {
+                int len = snprintf(line, sizeof(line), "thread %d line %d", t, i);
+                async_logger.Output(Logger::PRIORITY_INFO, line, static_cast<uint32_t>(len));
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    async_logger.Flush();
+    EXPECT_EQ(CountLines(path), static_cast<uint32_t>(kThreads * kLinesPerThread));
+
+    // 通过 Logger 输出
+    auto& logger = Logger::GetInst();
+    logger.SetOutputFunc([](Logger::PriorityType priority, const char* msg, uint32_t len) {
+        AsyncLogger::GetInst().Output(priority, msg, len);
+    });
+    logger.SetCanOutputFunc([](Logger::PriorityType) { return true; });
+    UA_LOG_INFO(0, "via logger %d", 1);
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+
+    async_logger.Stop();
+    EXPECT_FALSE(async_logger.IsRunning());
+    EXPECT_EQ(CountLines(path), static_cast<uint32_t>(kThreads * kLinesPerThread + 1));
+    EXPECT_EQ(async_logger.DropNum(), 0u);
+    unlink(path.c_str());
+}
+
+TEST(AsyncLoggerTest, RotateBySize)
+{
+    std::string path = "/tmp/ua_test_async_rotate_" + std::to_string(getpid()) + ".log";
+    unlink(path.c_str());
+    unlink((path + ".1").c_str());
+    unlink((path + ".2").c_str());
+
+    LogFileSink sink;
+    LogFileSink::Option option;
+    option.file_path = path;
+    option.rotate_size = 1024;
+    option.rotate_num = 2;
+    option.write_buf_size = 256;
+    ASSERT_TRUE(sink.Open(option));
+
+    std::string line(99, 'x');
+    line += '\n';
+    for (int i = 0; i < 30; ++i)
+    {
+        sink.Append(line.data(), line.size());
+        sink.Flush(0);
+    }
+    EXPECT_GE(sink.RotateCount(), 2u);
+    sink.Close();
+
+    EXPECT_EQ(access((path + ".1").c_str(), F_OK), 0);
+    EXPECT_EQ(access((path + ".2").c_str(), F_OK), 0);
+    unlink(path.c_str());
+    unlink((path + ".1").c_str());
+    unlink((path + ".2").c_str());
+}
+
+TEST(BinaryLogTest, FormatOnFlusherMatchesTextMode)
+{
+    std::string path = "/tmp/ua_test_binary_log_" + std::to_string(getpid()) + ".log";
+    unlink(path.c_str());
+
+    AsyncLogger::Option option;
+    option.sink.file_path = path;
+    option.full_policy = AsyncLogger::FullPolicy::Block;
+    auto& async_logger = AsyncLogger::GetInst();
+    ASSERT_TRUE(async_logger.Start(option));
+
+    auto& logger = Logger::GetInst();
+    std::vector<std::string> text_lines;
+    logger.SetCanOutputFunc([](Logger::PriorityType) { return true; });
+    logger.SetOutputFunc([&text_lines](Logger::PriorityType, const char* msg, uint32_t len) {
+        text_lines.emplace_back(msg, len);
+    });
+
+    const char* name = "alice";
+    std::string zone = "zone-1";
+    auto log_all = [&]() {
+        UA_LOG_INFO(10001, "login|name=%s|level=%d|exp=%lu", name, 42, 123456789UL);
+        UA_LOG_WARN(10002, "ratio=%.3f|hex=0x%08X|ch=%c|pct=100%%|zone=%-8s|", 0.5, 0xBEEFu, 'z', zone.c_str());
+        UA_LOG_ERROR(0, "neg=%d|width=%*d|empty=[%s]", -7, 5, 3, "");
+    };
+
+    log_all();
+    logger.SetBinaryMode(true);
+    log_all();
+    logger.SetBinaryMode(false);
+    async_logger.Flush();
+    async_logger.Stop();
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+
+    ASSERT_EQ(text_lines.size(), 3u);
+    std::ifstream in(path);
+    std::vector<std::string> binary_lines;
+    std::string line;
+    while (std::getline(in, line))
+        binary_lines.push_back(line);
+    ASSERT_EQ(binary_lines.size(), 3u);
+
+    // 二进制模式在行首多一个记录时刻的时间戳 "YYYY-MM-DD HH:MM:SS.uuuuuu "
+    for (size_t i = 0; i < text_lines.size(); ++i)
+    {
+        ASSERT_GT(binary_lines[i].size(), 27u);
+        EXPECT_EQ(binary_lines[i].substr(27), text_lines[i]);
+    }
+    unlink(path.c_str());
+}
+
+TEST(BinaryLogTest, RawFileHasSiteBeforeRecord)
+{
+    std::string path = "/tmp/ua_test_binary_raw_" + std::to_string(getpid()) + ".log";
+    unlink(path.c_str());
+
+    AsyncLogger::Option option;
+    option.sink.file_path = path;
+    option.raw_binary = true;
+    auto& async_logger = AsyncLogger::GetInst();
+    ASSERT_TRUE(async_logger.Start(option));
+
+    auto& logger = Logger::GetInst();
+    logger.SetCanOutputFunc([](Logger::PriorityType) { return true; });
+    logger.SetBinaryMode(true);
+    for (int i = 0; i < 3; ++i)
+        UA_LOG_INFO(i, "raw record %d", i);
+    logger.SetBinaryMode(false);
+    logger.SetCanOutputFunc(nullptr);
+    async_logger.Stop();
+
+    std::ifstream in(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_GE(content.size(), sizeof(AsyncLogger::kRawFileMagic));
+    EXPECT_EQ(content.compare(0, sizeof(AsyncLogger::kRawFileMagic), AsyncLogger::kRawFileMagic,
+                              sizeof(AsyncLogger::kRawFileMagic)),
+              0);
+
+    std::vector<uint8_t> kinds;
+    size_t offset = sizeof(AsyncLogger::kRawFileMagic);
+    std::string decoded;
+    while (offset + sizeof(AsyncLogger::RawFrameHead) <= content.size())
+    {
+        AsyncLogger::RawFrameHead frame;
+        memcpy(&frame, content.data() + offset, sizeof(frame));
+        offset += sizeof(frame);
+        ASSERT_LE(offset + frame.len, content.size());
+        kinds.push_back(frame.kind);
+        if (frame.kind == AsyncLogger::kRecordBinary)
+        {
+            decoded.clear();
+            ASSERT_TRUE(BinaryLog::Format(frame.priority, "raw record %d", "f", 1, "fn",
+                                          reinterpret_cast<const uint8_t*>(content.data() + offset), frame.len,
+                                          decoded));
+            EXPECT_NE(decoded.find("raw record "), std::string::npos);
+        }
+        offset += frame.len;
+    }
+    EXPECT_EQ(offset, content.size());
+
+    // 同一调用点只写一次定义，且在记录之前
+    ASSERT_EQ(kinds.size(), 4u);
+    EXPECT_EQ(kinds[0], AsyncLogger::kRecordSite);
+    EXPECT_EQ(kinds[1], AsyncLogger::kRecordBinary);
+    EXPECT_EQ(kinds[3], AsyncLogger::kRecordBinary);
+    unlink(path.c_str());
+}
+
+TEST(LogLevelTableTest, ModuleLevelFiltersBeforeCanOutput)
+{
+    auto& logger = Logger::GetInst();
+    uint32_t can_output_calls = 0;
+    uint32_t output_calls = 0;
+    logger.SetCanOutputFunc([&can_output_calls](Logger::PriorityType) {
+        ++can_output_calls;
+        return true;
+    });
+    logger.SetOutputFunc([&output_calls](Logger::PriorityType, const char*, uint32_t) { ++output_calls; });
+
+    // SetCanOutputFunc 同步级别表时探测过一次
+    ASSERT_EQ(LogLevelTable::GetLevel(kLogModuleDefault), Logger::PRIORITY_TRACE);
+    can_output_calls = 0;
+    ASSERT_TRUE(LogLevelTable::SetLevel("default", Logger::PRIORITY_INFO));
+
+    UA_LOG_TRACE(1, "trace %d", 1);
+    UA_LOG_DEBUG(1, "debug %d", 1);
+    EXPECT_EQ(can_output_calls, 0u);
+    EXPECT_EQ(output_calls, 0u);
+
+    UA_LOG_INFO(1, "info %d", 1);
+    UA_LOG_ERROR(1, "error %d", 1);
+    EXPECT_EQ(can_output_calls, 2u);
+    EXPECT_EQ(output_calls, 2u);
+
+    // 其他模块不受影响
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleCore), Logger::PRIORITY_TRACE);
+    EXPECT_EQ(LogLevelTable::FindModule("pb"), static_cast<int32_t>(kLogModulePb));
+    EXPECT_FALSE(LogLevelTable::SetLevel("no_such_module", Logger::PRIORITY_INFO));
+    EXPECT_TRUE(LogLevelTable::RegisterModule(kLogModuleUserBegin, "battle"));
+    EXPECT_TRUE(LogLevelTable::SetLevel("battle", Logger::PRIORITY_ERROR));
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleUserBegin), Logger::PRIORITY_ERROR);
+
+    LogLevelTable::SetAllLevel(Logger::PRIORITY_TRACE);
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+}
+
+TEST(LogLevelTableTest, SyncedFromCanOutputFunc)
+{
+    auto& logger = Logger::GetInst();
+    uint32_t can_output_calls = 0;
+    logger.SetCanOutputFunc([&can_output_calls](Logger::PriorityType priority) {
+        ++can_output_calls;
+        return priority <= Logger::PRIORITY_INFO;
+    });
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleDefault), Logger::PRIORITY_INFO);
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleCore), Logger::PRIORITY_INFO);
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModulePb), Logger::PRIORITY_INFO);
+
+    // 关闭的级别只查表，不再调用 CanOutputFunc
+    can_output_calls = 0;
+    UA_LOG_TRACE(1, "trace %d", 1);
+    UA_LOG_DEBUG(1, "debug %d", 1);
+    EXPECT_EQ(can_output_calls, 0u);
+    UA_LOG_INFO(1, "info %d", 1);
+    EXPECT_EQ(can_output_calls, 1u);
+
+    logger.SetLevel(Logger::PRIORITY_WARN);
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleDefault), Logger::PRIORITY_WARN);
+    EXPECT_TRUE(logger.CanOutput(Logger::PRIORITY_ERROR));
+    EXPECT_FALSE(logger.CanOutput(Logger::PRIORITY_INFO));
+
+    // 未设置判定函数时 Logger 不输出，表同样全关
+    logger.SetCanOutputFunc(nullptr);
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleDefault), Logger::PRIORITY_NULL);
+    EXPECT_EQ(LogLevelTable::GetLevel(kLogModuleCore), Logger::PRIORITY_NULL);
+}
+
+TEST(LogGidFilterTest, WatchedGidBypassesLevel)
+{
+    auto& logger = Logger::GetInst();
+    std::vector<std::string> lines;
+    logger.SetCanOutputFunc([](Logger::PriorityType priority) { return priority <= Logger::PRIORITY_INFO; });
+    logger.SetOutputFunc([&lines](Logger::PriorityType, const char* msg, uint32_t len) { lines.emplace_back(msg, len); });
+
+    UA_LOG_TRACE(10001, "not watched yet");
+    EXPECT_TRUE(lines.empty());
+
+    ASSERT_TRUE(LogGidFilter::Add(10001));
+    EXPECT_EQ(LogGidFilter::Size(), 1u);
+    UA_LOG_TRACE(10001, "watched trace");
+    UA_LOG_DEBUG(10001, "watched debug");
+    UA_LOG_TRACE(10002, "other gid");
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("watched trace"), std::string::npos);
+
+    // 跟随当前 ServerContext 的 gid
+    ServerContext ctx;
+    ctx.gid = 10001;
+    ContextMgr::SetCurrServerContext(&ctx);
+    UA_LOG_TRACE(0, "in watched context");
+    ContextMgr::SetCurrServerContext(nullptr);
+    EXPECT_EQ(lines.size(), 3u);
+
+    ASSERT_TRUE(LogGidFilter::Remove(10001));
+    UA_LOG_TRACE(10001, "removed");
+    EXPECT_EQ(lines.size(), 3u);
+    EXPECT_FALSE(LogGidFilter::IsWatched(10001));
+
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+}
+
+TEST(LogGidFilterTest, ExecCommand)
+{
+    std::string result;
+    EXPECT_TRUE(LogGidFilter::ExecCommand("add 3 1 abc", result));
+    EXPECT_EQ(result, "3:ok 1:ok abc:fail");
+    EXPECT_TRUE(LogGidFilter::ExecCommand("list", result));
+    EXPECT_EQ(result, "1 3");
+    EXPECT_TRUE(LogGidFilter::ExecCommand("del 3", result));
+    EXPECT_TRUE(LogGidFilter::IsWatched(1));
+    EXPECT_FALSE(LogGidFilter::IsWatched(3));
+    EXPECT_TRUE(LogGidFilter::ExecCommand("clear", result));
+    EXPECT_EQ(LogGidFilter::Size(), 0u);
+    EXPECT_FALSE(LogGidFilter::ExecCommand("bogus", result));
+}
+
+TEST(LogLimiterTest, EveryNAndSuppressedSummary)
+{
+    auto& logger = Logger::GetInst();
+    std::vector<std::string> lines;
+    logger.SetCanOutputFunc([](Logger::PriorityType) { return true; });
+    logger.SetOutputFunc([&lines](Logger::PriorityType, const char* msg, uint32_t len) { lines.emplace_back(msg, len); });
+    auto& statistics = ServerStatistics::GetInst().statistics();
+    uint32_t suppressed_before = statistics.log_suppressed_num;
+
+    for (int i = 0; i < 25; ++i)
+        UA_LOG_WARN_EVERY_N(10, 0, "every n %d", i);
+
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_NE(lines[0].find("every n 0|suppressed(0)"), std::string::npos);
+    EXPECT_NE(lines[1].find("every n 10|suppressed(9)"), std::string::npos);
+    EXPECT_NE(lines[2].find("every n 20|suppressed(9)"), std::string::npos);
+    EXPECT_EQ(statistics.log_suppressed_num - suppressed_before, 22u);
+
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+}
+
+TEST(LogLimiterTest, EveryMsAndTokenBucket)
+{
+    uint32_t suppressed = 0;
+    LogEveryMs every_ms(60 * 1000);
+    EXPECT_TRUE(every_ms.Allow(suppressed));
+    EXPECT_EQ(suppressed, 0u);
+    for (int i = 0; i < 5; ++i)
+        EXPECT_FALSE(every_ms.Allow(suppressed));
+
+    // 突发 3 条后被限，令牌不会瞬间恢复
+    LogTokenBucket bucket(1, 3);
+    uint32_t allowed = 0;
+    for (int i = 0; i < 10; ++i)
+        allowed += bucket.Allow(suppressed) ? 1 : 0;
+    EXPECT_EQ(allowed, 3u);
+
+    // 日志宏本身：同一调用点 1 分钟内只输出一次
+    auto& logger = Logger::GetInst();
+    uint32_t output_num = 0;
+    logger.SetCanOutputFunc([](Logger::PriorityType) { return true; });
+    logger.SetOutputFunc([&output_num](Logger::PriorityType, const char*, uint32_t) { ++output_num; });
+    for (int i = 0; i < 100; ++i)
+        UA_LOG_ERROR_EVERY_MS(60 * 1000, 0, "every ms");
+    for (int i = 0; i < 100; ++i)
+        UA_LOG_INFO_RATE(1, 5, 0, "rate %d", i);
+    EXPECT_EQ(output_num, 6u);
+    logger.SetOutputFunc(nullptr);
+    logger.SetCanOutputFunc(nullptr);
+}
+
+namespace
+{
+
+std::string DumpFlight(const std::string& path, int64_t& count)
+{
+    char* buf = nullptr;
+    size_t size = 0;
+    FILE* out = open_memstream(&buf, &size);
+    count = FlightRecorder::Dump(path, out);
+    fclose(out);
+    std::string content(buf, size);
+    free(buf);
+    return content;
+}
+
+}  // namespace
+
+TEST(FlightRecorderTest, RecordsLogAndEventWhileLevelOff)
+{
+    std::string path = "/tmp/ua_test_flight_" + std::to_string(getpid());
+    unlink(path.c_str());
+    unlink((path + ".last").c_str());
+
+    FlightRecorder::Option option;
+    option.shm_file = path;
+    option.ring_size = 64 * 1024;
+    option.level = Logger::PRIORITY_TRACE;
+    ASSERT_TRUE(FlightRecorder::Init(option));
+    EXPECT_FALSE(FlightRecorder::Init(option));
+
+    // 正常日志全部关闭，飞行记录仍然写入
+    LogLevelTable::SetAllLevel(0);
+    UA_LOG_TRACE(42, "flight trace %d|%s", 7, "x");
+    LogLevelTable::SetAllLevel(Logger::PRIORITY_TRACE);
+    FlightRecorder::RecordEvent(FlightEvent::kPending, 42, 1001, 0, 0, 3000);
+
+    int64_t count = 0;
+    std::string content = DumpFlight(path, count);
+    EXPECT_EQ(count, 2);
+    EXPECT_NE(content.find("[TRACE]|0|42|logger_test.cpp:"), std::string::npos) << content;
+    EXPECT_NE(content.find("flight trace 7|x"), std::string::npos) << content;
+    EXPECT_NE(content.find("[EVENT]|pending|42|seq_id(1001)|cmd(0)|ret(0)|extra(3000)"), std::string::npos) << content;
+
+    // 模拟重启：上一轮内容导出到 .last，新一轮从空开始
+    FlightRecorder::Close();
+    ASSERT_TRUE(FlightRecorder::Init(option));
+    std::ifstream last(path + ".last");
+    std::string last_content((std::istreambuf_iterator<char>(last)), std::istreambuf_iterator<char>());
+    EXPECT_NE(last_content.find("flight trace 7|x"), std::string::npos) << last_content;
+    DumpFlight(path, count);
+    EXPECT_EQ(count, 0);
+    FlightRecorder::Close();
+
+    unlink(path.c_str());
+    unlink((path + ".last").c_str());
+}
+
+TEST(FlightRecorderTest, OverwriteKeepsNewest)
+{
+    std::string path = "/tmp/ua_test_flight_ring_" + std::to_string(getpid());
+    unlink(path.c_str());
+
+    FlightRecorder::Option option;
+    option.shm_file = path;
+    option.ring_size = 4 * 1024;
+    option.level = Logger::PRIORITY_INFO;
+    option.dump_previous = false;
+    ASSERT_TRUE(FlightRecorder::Init(option));
+
+    for (int i = 0; i < 1000; ++i)
+        UA_LOG_INFO(0, "seq %d", i);
+    UA_LOG_DEBUG(0, "above flight level");
+
+    int64_t count = 0;
+    std::string content = DumpFlight(path, count);
+    FlightRecorder::Close();
+    unlink(path.c_str());
+
+    EXPECT_GT(count, 0);
+    EXPECT_LT(count, 1000);
+    EXPECT_EQ(content.find("seq 0\n"), std::string::npos);
+    EXPECT_NE(content.find("seq 999\n"), std::string::npos);
+    EXPECT_EQ(content.find("above flight level"), std::string::npos);
+}
+
 }  // namespace ua::test
@@ -0,0 +1,25 @@
+/// @file flight_dump.cpp
+/// @brief 飞行记录导出工具
+/// @note 用法: flight_dump <shm_file>
+///       把 FlightRecorder 映射文件中保留的日志和框架事件按时间顺序输出到 stdout，
+///       进程崩溃后或运行中都可以使用（运行中为一次拷贝快照）
+#include <cstdio>
+#include <string>
+#include "core/flight_recorder.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <shm_file>\n", argv[0]);
+        return 1;
+    }
+
+    std::string err_msg;
+    if (ua::FlightRecorder::Dump(argv[1], stdout, &err_msg) < 0)
+    {
+        fprintf(stderr, "dump %s failed: %s\n", argv[1], err_msg.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/// @file log_decoder.cpp
+/// @brief 二进制日志解码工具
+/// @note 用法: log_decoder <raw_log_file> [...]
+///       读取 AsyncLogger raw_binary 模式写出的文件，还原为与文本模式一致的日志行输出到 stdout
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/async_logger.h"
+#include "core/binary_log.h"
+
+namespace
+{
+
+struct SiteInfo
+{
+    std::string fmt;
+    std::string file;
+    std::string func;
+    uint32_t line = 0;
+};
+
+bool ReadFile(const char* path, std::vector<uint8_t>& content)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    uint8_t buf[64 * 1024];
+    size_t n = 0;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        content.insert(content.end(), buf, buf + n);
+    fclose(fp);
+    return true;
+}
+
+/// 解析调用点定义: [u32 id][u32 行号][u8 优先级] fmt\0 file\0 func\0
+bool ParseSite(const uint8_t* data, uint32_t len, uint32_t& site_id, SiteInfo& site)
+{
+    if (len < 9)
+        return false;
+    std::memcpy(&site_id, data, sizeof(site_id));
+    std::memcpy(&site.line, data + 4, sizeof(site.line));
+
+    const char* str = reinterpret_cast<const char*>(data + 9);
+    const char* end = reinterpret_cast<const char*>(data + len);
+    std::string* fields[] = {&site.fmt, &site.file, &site.func};
+    for (auto* field : fields)
+    {
+        const char* zero = static_cast<const char*>(memchr(str, '\0', end - str));
+        if (!zero)
+            return false;
+        field->assign(str, zero);
+        str = zero + 1;
+    }
+    return true;
+}
+
+int Decode(const char* path)
+{
+    std::vector<uint8_t> content;
+    if (!ReadFile(path, content))
+    {
+        fprintf(stderr, "open %s failed\n", path);
+        return 1;
+    }
+
+    const auto& magic = ua::AsyncLogger::kRawFileMagic;
+    if (content.size() < sizeof(magic) || std::memcmp(content.data(), magic, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "%s is not a raw binary log file\n", path);
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, SiteInfo> sites;
+    std::string line;
+    size_t offset = sizeof(magic);
+    while (offset + sizeof(ua::AsyncLogger::RawFrameHead) <= content.size())
+    {
+        ua::AsyncLogger::RawFrameHead frame;
+        std::memcpy(&frame, content.data() + offset, sizeof(frame));
+        offset += sizeof(frame);
+        if (offset + frame.len > content.size())
+        {
+            fprintf(stderr, "%s truncated at offset %zu\n", path, offset);
+            return 1;
+        }
+
+        const uint8_t* data = content.data() + offset;
+        offset += frame.len;
+
+        if (frame.kind == ua::AsyncLogger::kRecordText)
+        {
+            fwrite(data, 1, frame.len, stdout);
+            fputc('\n', stdout);
+        }
+        else if (frame.kind == ua::AsyncLogger::kRecordSite)
+        {
+            // 进程重启后 id 会重新分配，后出现的定义覆盖旧定义
+            uint32_t site_id = 0;
+            SiteInfo site;
+            if (ParseSite(data, frame.len, site_id, site))
+                sites[site_id] = std::move(site);
+        }
+        else if (frame.kind == ua::AsyncLogger::kRecordBinary)
+        {
+            uint32_t site_id = 0;
+            if (frame.len >= sizeof(site_id))
+                std::memcpy(&site_id, data, sizeof(site_id));
+            auto it = sites.find(site_id);
+            line.clear();
+            if (it == sites.end() ||
+                !ua::BinaryLog::Format(frame.priority, it->second.fmt.c_str(), it->second.file.c_str(),
+                                       it->second.line, it->second.func.c_str(), data, frame.len, line))
+            {
+                printf("<undecodable record site=%u len=%u>\n", site_id, frame.len);
+                continue;
+            }
+            line.push_back('\n');
+            fwrite(line.data(), 1, line.size(), stdout);
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <raw_log_file> [...]\n", argv[0]);
+        return 1;
+    }
+
+    int ret = 0;
+    for (int i = 1; i < argc; ++i)
+        ret |= Decode(argv[i]);
+    return ret;
+}
@@ -0,0 +1,253 @@
+/// @file stat_reader.cpp
+/// @brief 统计共享内存读取工具
+/// @note 用法: stat_reader <shm_file> [text|prom]
+///       text: 人类可读格式（默认）
+///       prom: Prometheus 文本暴露格式，可直接被 node_exporter textfile 或 sidecar 采集
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "core/stat_exporter.h"
+
+using ua::StatSnapshot;
+
+namespace
+{
+
+struct StatField
+{
+    const char* name;
+    size_t offset;
+    size_t size;
+};
+
+#define STAT_FIELD(name) {#name, offsetof(ua::ServerStatisticsSt, name), sizeof(ua::ServerStatisticsSt::name)}
+
+const StatField kStatFields[] = {
+    STAT_FIELD(recv_pkg_num),         STAT_FIELD(recv_byte_num),        STAT_FIELD(recv_error_pkg_num),
+    STAT_FIELD(send_pkg_num),         STAT_FIELD(send_byte_num),        STAT_FIELD(send_error_pkg_num),
+    STAT_FIELD(send_pkg_size_max),    STAT_FIELD(recv_pkg_size_max),    STAT_FIELD(log_error_num),
+    STAT_FIELD(log_warn_num),         STAT_FIELD(log_info_num),         STAT_FIELD(log_debug_num),
+    STAT_FIELD(log_trace_num),        STAT_FIELD(log_suppressed_num),   STAT_FIELD(rpc_time_out_num),
+    STAT_FIELD(coro_num_max),
+    STAT_FIELD(coro_pending_num_max), STAT_FIELD(on_proc_num),          STAT_FIELD(on_idle_num),
+    STAT_FIELD(proc_timeout_0),       STAT_FIELD(proc_timeout_1),       STAT_FIELD(proc_timeout_2),
+    STAT_FIELD(proc_total_timeout),   STAT_FIELD(proc_deal_time_0),     STAT_FIELD(proc_deal_time_1),
+    STAT_FIELD(proc_deal_time_2),     STAT_FIELD(tick_timeout),         STAT_FIELD(tick_deal_time),
+    STAT_FIELD(shed_drop_num),        STAT_FIELD(recv_rsp_num),         STAT_FIELD(recv_key_num),
+    STAT_FIELD(recv_deferred_num),    STAT_FIELD(coro_saved_stack_bytes_max),
+};
+
+#undef STAT_FIELD
+
+void PrintTextBuckets(const uint32_t* buckets, const StatSnapshot& snap)
+{
+    for (uint32_t b = 0; b < ua::kStatCostBucketNum; ++b)
+    {
+        if (buckets[b])
+            printf(" >%u:%u", snap.cost_bucket_lower[b], buckets[b]);
+    }
+}
+
+uint64_t FieldValue(const ua::ServerStatisticsSt& st, const StatField& field)
+{
+    const auto* ptr = reinterpret_cast<const char*>(&st) + field.offset;
+    if (field.size == sizeof(uint64_t))
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, ptr, sizeof(v));
+        return v;
+    }
+    uint32_t v = 0;
+    std::memcpy(&v, ptr, sizeof(v));
+    return v;
+}
+
+void PrintText(const StatSnapshot& snap)
+{
+    printf("period_id: %" PRIu64 "  publish_ms: %" PRIu64 "  truncated: %u\n", snap.period_id, snap.publish_ms,
+           snap.truncated);
+    for (const auto& field : kStatFields)
+        printf("%-24s %" PRIu64 "\n", field.name, FieldValue(snap.statistics, field));
+
+    printf("\n%-12s %10s %8s %8s %8s %8s  cost_buckets(ms)\n", "recv_cmd", "total", "expire", "sched", "max_req",
+           "max_rsp");
+    for (uint32_t i = 0; i < snap.recv_cmd_num; ++i)
+    {
+        const auto& item = snap.recv_cmds[i];
+        printf("0x%08X   %10u %8u %8u %8u %8u ", item.cmd, item.total_recv_num, item.expire_drop, item.schedule_drop,
+               item.max_req_size, item.max_rsp_size);
+        PrintTextBuckets(item.cost, snap);
+        printf("  |queue");
+        PrintTextBuckets(item.queue_cost, snap);
+        printf("\n");
+    }
+
+    printf("\n%-12s %10s %8s\n", "send_cmd", "total", "max_size");
+    for (uint32_t i = 0; i < snap.send_cmd_num; ++i)
+    {
+        const auto& item = snap.send_cmds[i];
+        printf("0x%08X   %10u %8u\n", item.cmd, item.total_send_num, item.max_send_size);
+    }
+
+    printf("\n%-12s %10s %8s\n", "err_cmd", "ret_code", "num");
+    for (uint32_t i = 0; i < snap.error_num; ++i)
+    {
+        const auto& item = snap.errors[i];
+        printf("0x%08X   %10d %8u\n", item.cmd, item.ret_code, item.num);
+    }
+
+    printf("\n%-12s %10s %8s  queue_cost_buckets(ms)\n", "transport", "recv", "busy");
+    for (uint32_t i = 0; i < snap.transport_num; ++i)
+    {
+        const auto& item = snap.transports[i];
+        printf("%-12u %10u %8u ", item.transport_type, item.recv_num, item.busy_num);
+        PrintTextBuckets(item.queue_cost, snap);
+        printf("\n");
+    }
+
+    printf("\n%-12s %10s %8s %8s %8s  wait_cost_buckets(ms)  |service\n", "sched_class", "dispatch", "drop", "expire",
+           "max_len");
+    for (uint32_t i = 0; i < snap.sched_class_num; ++i)
+    {
+        const auto& item = snap.sched_classes[i];
+        printf("%-12u %10u %8u %8u %8u ", item.sched_class, item.dispatch_num, item.drop_num, item.expire_drop,
+               item.max_queue_len);
+        PrintTextBuckets(item.wait_cost, snap);
+        printf("  |service");
+        PrintTextBuckets(item.service_cost, snap);
+        printf("\n");
+    }
+}
+
+/// kLowerCostTime 是分桶下界，Prometheus 的 le 取下一个桶的下界
+/// labels 为不含 le 的标签，如 cmd="0x00001001"
+void PrintPromHistogram(const char* metric, const char* labels, const uint32_t* buckets, const StatSnapshot& snap)
+{
+    uint64_t cumulative = 0;
+    for (uint32_t b = 0; b < ua::kStatCostBucketNum; ++b)
+    {
+        cumulative += buckets[b];
+        if (b + 1 < ua::kStatCostBucketNum)
+            printf("%s_bucket{%s,le=\"%u\"} %" PRIu64 "\n", metric, labels, snap.cost_bucket_lower[b + 1], cumulative);
+        else
+            printf("%s_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n", metric, labels, cumulative);
+    }
+    printf("%s_count{%s} %" PRIu64 "\n", metric, labels, cumulative);
+}
+
+void PrintPromCmdHistogram(const char* metric, uint32_t cmd, const uint32_t* buckets, const StatSnapshot& snap)
+{
+    char labels[32];
+    snprintf(labels, sizeof(labels), "cmd=\"0x%08X\"", cmd);
+    PrintPromHistogram(metric, labels, buckets, snap);
+}
+
+void PrintProm(const StatSnapshot& snap)
+{
+    printf("ua_stat_period_id %" PRIu64 "\n", snap.period_id);
+    printf("ua_stat_publish_ms %" PRIu64 "\n", snap.publish_ms);
+    printf("ua_stat_truncated %u\n", snap.truncated);
+    for (const auto& field : kStatFields)
+        printf("ua_%s %" PRIu64 "\n", field.name, FieldValue(snap.statistics, field));
+
+    for (uint32_t i = 0; i < snap.recv_cmd_num; ++i)
+    {
+        const auto& item = snap.recv_cmds[i];
+        printf("ua_cmd_recv_total{cmd=\"0x%08X\"} %u\n", item.cmd, item.total_recv_num);
+        printf("ua_cmd_expire_drop{cmd=\"0x%08X\"} %u\n", item.cmd, item.expire_drop);
+        printf("ua_cmd_schedule_drop{cmd=\"0x%08X\"} %u\n", item.cmd, item.schedule_drop);
+        printf("ua_cmd_max_req_size{cmd=\"0x%08X\"} %u\n", item.cmd, item.max_req_size);
+        printf("ua_cmd_max_rsp_size{cmd=\"0x%08X\"} %u\n", item.cmd, item.max_rsp_size);
+    }
+
+    printf("# TYPE ua_cmd_cost_ms histogram\n");
+    for (uint32_t i = 0; i < snap.recv_cmd_num; ++i)
+        PrintPromCmdHistogram("ua_cmd_cost_ms", snap.recv_cmds[i].cmd, snap.recv_cmds[i].cost, snap);
+
+    printf("# TYPE ua_cmd_queue_cost_ms histogram\n");
+    for (uint32_t i = 0; i < snap.recv_cmd_num; ++i)
+        PrintPromCmdHistogram("ua_cmd_queue_cost_ms", snap.recv_cmds[i].cmd, snap.recv_cmds[i].queue_cost, snap);
+
+    for (uint32_t i = 0; i < snap.send_cmd_num; ++i)
+    {
+        const auto& item = snap.send_cmds[i];
+        printf("ua_cmd_send_total{cmd=\"0x%08X\"} %u\n", item.cmd, item.total_send_num);
+        printf("ua_cmd_max_send_size{cmd=\"0x%08X\"} %u\n", item.cmd, item.max_send_size);
+    }
+
+    for (uint32_t i = 0; i < snap.error_num; ++i)
+    {
+        const auto& item = snap.errors[i];
+        printf("ua_cmd_ret_code_total{cmd=\"0x%08X\",ret=\"%d\"} %u\n", item.cmd, item.ret_code, item.num);
+    }
+
+    char labels[32];
+    for (uint32_t i = 0; i < snap.transport_num; ++i)
+    {
+        const auto& item = snap.transports[i];
+        printf("ua_transport_recv_total{transport=\"%u\"} %u\n", item.transport_type, item.recv_num);
+        printf("ua_transport_busy_total{transport=\"%u\"} %u\n", item.transport_type, item.busy_num);
+    }
+    printf("# TYPE ua_transport_queue_cost_ms histogram\n");
+    for (uint32_t i = 0; i < snap.transport_num; ++i)
+    {
+        snprintf(labels, sizeof(labels), "transport=\"%u\"", snap.transports[i].transport_type);
+        PrintPromHistogram("ua_transport_queue_cost_ms", labels, snap.transports[i].queue_cost, snap);
+    }
+
+    for (uint32_t i = 0; i < snap.sched_class_num; ++i)
+    {
+        const auto& item = snap.sched_classes[i];
+        printf("ua_sched_class_dispatch_total{class=\"%u\"} %u\n", item.sched_class, item.dispatch_num);
+        printf("ua_sched_class_drop_total{class=\"%u\"} %u\n", item.sched_class, item.drop_num);
+        printf("ua_sched_class_expire_drop{class=\"%u\"} %u\n", item.sched_class, item.expire_drop);
+        printf("ua_sched_class_max_queue_len{class=\"%u\"} %u\n", item.sched_class, item.max_queue_len);
+    }
+    printf("# TYPE ua_sched_class_wait_ms histogram\n");
+    for (uint32_t i = 0; i < snap.sched_class_num; ++i)
+    {
+        snprintf(labels, sizeof(labels), "class=\"%u\"", snap.sched_classes[i].sched_class);
+        PrintPromHistogram("ua_sched_class_wait_ms", labels, snap.sched_classes[i].wait_cost, snap);
+    }
+    printf("# TYPE ua_sched_class_service_ms histogram\n");
+    for (uint32_t i = 0; i < snap.sched_class_num; ++i)
+    {
+        snprintf(labels, sizeof(labels), "class=\"%u\"", snap.sched_classes[i].sched_class);
+        PrintPromHistogram("ua_sched_class_service_ms", labels, snap.sched_classes[i].service_cost, snap);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <shm_file> [text|prom]\n", argv[0]);
+        return 1;
+    }
+
+    ua::StatReader reader;
+    std::string err_msg;
+    if (!reader.Open(argv[1], &err_msg))
+    {
+        fprintf(stderr, "open %s failed: %s\n", argv[1], err_msg.c_str());
+        return 1;
+    }
+
+    auto snap = std::make_unique<StatSnapshot>();
+    if (!reader.Read(*snap))
+    {
+        fprintf(stderr, "read snapshot failed, writer busy\n");
+        return 1;
+    }
+
+    if (argc >= 3 && strcmp(argv[2], "prom") == 0)
+        PrintProm(*snap);
+    else
+        PrintText(*snap);
+    return 0;
+}